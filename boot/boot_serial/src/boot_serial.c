@@ -72,6 +72,9 @@
 #ifdef MCUBOOT_ENC_IMAGES
 #include "boot_serial/boot_serial_encryption.h"
 #endif
+#if defined(MCUBOOT_HASH_TREE)
+#include "bootutil/hash_tree.h"
+#endif
 
 #include "bootutil/boot_hooks.h"
 
@@ -249,6 +252,8 @@ bs_list_img_ver(char *dst, int maxlen, struct image_version *ver)
 {
     int off;
 
+    (void)maxlen;
+
     off = u32toa(dst, ver->iv_major);
     dst[off++] = '.';
     off += u32toa(dst + off, ver->iv_minor);
@@ -292,6 +297,9 @@ bs_list(char *buf, int len)
     uint8_t hash[IMAGE_HASH_SIZE];
 #endif
 
+    (void)buf;
+    (void)len;
+
     zcbor_map_start_encode(cbor_state, 1);
     zcbor_tstr_put_lit_cast(cbor_state, "images");
     zcbor_list_start_encode(cbor_state, 5);
@@ -1276,6 +1284,10 @@ static void
 bs_reset(char *buf, int len)
 {
     int rc = BOOT_HOOK_CALL(boot_reset_request_hook, 0, false);
+
+    (void)buf;
+    (void)len;
+
     if (rc == BOOT_RESET_REQUEST_HOOK_BUSY) {
 	rc = MGMT_ERR_EBUSY;
     } else {
@@ -1315,7 +1327,7 @@ boot_serial_input(char *buf, int len)
     struct nmgr_hdr *hdr;
 
     hdr = (struct nmgr_hdr *)buf;
-    if (len < sizeof(*hdr) ||
+    if (len < (int)sizeof(*hdr) ||
       (hdr->nh_op != NMGR_OP_READ && hdr->nh_op != NMGR_OP_WRITE) ||
       (ntohs(hdr->nh_len) < len - sizeof(*hdr))) {
         return;
@@ -1475,17 +1487,22 @@ boot_serial_in_dec(char *in, int inlen, char *out, int *out_off, int maxout)
         return -1;
     }
 #else
+    int err;
+
+    (void)inlen;
+
     if (*out_off + base64_decode_len(in) >= maxout) {
         return -1;
     }
-    rc = base64_decode(in, &out[*out_off]);
-    if (rc < 0) {
+    err = base64_decode(in, &out[*out_off]);
+    if (err < 0) {
         return -1;
     }
+    rc = err;
 #endif
 
     *out_off += rc;
-    if (*out_off <= sizeof(uint16_t)) {
+    if (*out_off <= (int)sizeof(uint16_t)) {
         return 0;
     }
 
@@ -1664,6 +1681,12 @@ static int boot_serial_get_hash(const struct image_header *hdr,
 
             return 0;
         }
+#if defined(MCUBOOT_HASH_TREE)
+        if (type == IMAGE_TLV_HASH_TREE) {
+            /* Report the root of a tree hashed image. */
+            return bootutil_hash_tree_tlv_root(hdr, fap, offset, len, NULL, hash);
+        }
+#endif
     }
 
     return -1;
@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Asynchronous crypto jobs (MCUBOOT_CRYPTO_ASYNC).
+ *
+ * A job runs one hash update or one AES-CTR pass over a buffer.  It is
+ * handed to a driver with bootutil_crypto_async_submit(), and the buffer and
+ * the contexts of the job belong to the driver until the job is complete, as
+ * told by bootutil_crypto_async_poll() or bootutil_crypto_async_wait().  In
+ * the meantime the CPU reads the next block from flash into another buffer,
+ * so that flash I/O and crypto overlap in the image hash and in the copy of
+ * encrypted images.
+ *
+ * The driver is provided by the port, on top of a hash/AES engine or of
+ * another thread.  Jobs complete in the order they were submitted, so a hash
+ * job may follow the AES job that decrypts the same buffer.  A software
+ * driver runs the jobs with bootutil_crypto_job_run().
+ */
+
+#ifndef __BOOTUTIL_CRYPTO_ASYNC_H_
+#define __BOOTUTIL_CRYPTO_ASYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/crypto/sha.h"
+#if defined(MCUBOOT_ENC_IMAGES)
+#include "bootutil/crypto/aes_ctr.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum bootutil_crypto_job_op {
+    /* bootutil_sha_update(u.sha, buf, len). */
+    BOOTUTIL_CRYPTO_JOB_SHA_UPDATE,
+#if defined(MCUBOOT_ENC_IMAGES)
+    /* AES-CTR of buf in place, from u.aes.counter and u.aes.blk_off. */
+    BOOTUTIL_CRYPTO_JOB_AES_CTR,
+#endif
+};
+
+struct bootutil_crypto_job {
+    enum bootutil_crypto_job_op op;
+    uint8_t *buf;
+    uint32_t len;
+    union {
+        bootutil_sha_context *sha;
+#if defined(MCUBOOT_ENC_IMAGES)
+        struct {
+            bootutil_aes_ctr_context *ctx;
+            uint8_t counter[BOOT_ENC_BLOCK_SIZE];
+            uint32_t blk_off;
+        } aes;
+#endif
+    } u;
+    /* Result of the job, valid once it is complete. */
+    int rc;
+    /* For the use of the driver. */
+    struct bootutil_crypto_job *next;
+    volatile bool done;
+};
+
+/* Run the job on the CPU, returns its result. */
+int bootutil_crypto_job_run(struct bootutil_crypto_job *job);
+
+/*
+ * Implemented by the port.
+ */
+
+/**
+ * Queue a job.
+ *
+ * @return          0 on success, nonzero if the job could not be queued, in
+ *                  which case it must not be polled or waited for.
+ */
+int bootutil_crypto_async_submit(struct bootutil_crypto_job *job);
+
+/* Returns true once the job is complete. */
+bool bootutil_crypto_async_poll(struct bootutil_crypto_job *job);
+
+/* Wait until the job is complete, returns its result. */
+int bootutil_crypto_async_wait(struct bootutil_crypto_job *job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_CRYPTO_ASYNC_H_ */
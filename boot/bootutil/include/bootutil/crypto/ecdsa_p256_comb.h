@@ -0,0 +1,85 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Precomputed tables for verifying ECDSA P-256 signatures against the
+ * public keys built into the bootloader (MCUBOOT_ECDSA_P256_COMB).
+ *
+ * Both u1 * G and u2 * Q of the verification equation are fixed-base
+ * multiplications, so they can be computed with the comb method: a scalar
+ * is split into BOOTUTIL_ECDSA_P256_COMB_TEETH pieces of
+ * BOOTUTIL_ECDSA_P256_COMB_SPACING bits, and each of the
+ * BOOTUTIL_ECDSA_P256_COMB_SPACING steps needs one doubling and a single
+ * lookup in a table of 2^TEETH - 1 points.  Compared to the generic Shamir
+ * loop of tinycrypt's uECC_verify() this takes a quarter of the doublings.
+ *
+ * The table of a key is generated at build time with
+ * `imgtool getpub -e lang-c-comb`, the table of the generator is part of
+ * bootutil.  Only the tinycrypt backend is supported.
+ */
+
+#ifndef __BOOTUTIL_CRYPTO_ECDSA_P256_COMB_H_
+#define __BOOTUTIL_CRYPTO_ECDSA_P256_COMB_H_
+
+#include <stdint.h>
+#include "mcuboot_config/mcuboot_config.h"
+
+#include <tinycrypt/ecc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* These must match P256_COMB_TEETH and P256_COMB_SPACING in imgtool. */
+#define BOOTUTIL_ECDSA_P256_COMB_TEETH      4
+#define BOOTUTIL_ECDSA_P256_COMB_SPACING    64
+#define BOOTUTIL_ECDSA_P256_COMB_POINTS     ((1 << BOOTUTIL_ECDSA_P256_COMB_TEETH) - 1)
+
+struct bootutil_ecdsa_p256_comb {
+    /* Uncompressed public key (X || Y, big endian) the table was built for. */
+    uint8_t pubkey[2 * NUM_ECC_BYTES];
+    /*
+     * Entry i - 1 is the sum of 2^(SPACING * j) * Q over the bits j set in
+     * i, as affine coordinates (X then Y) in tinycrypt's native format.
+     */
+    uECC_word_t points[BOOTUTIL_ECDSA_P256_COMB_POINTS][2 * NUM_ECC_WORDS];
+};
+
+/*
+ * Comb tables of the built-in public keys, indexed like bootutil_keys[].
+ * A NULL entry makes the key use the generic verification.
+ */
+extern const struct bootutil_ecdsa_p256_comb *const bootutil_ecdsa_p256_combs[];
+
+/**
+ * Find the comb table of a built-in key.
+ *
+ * @param key_id    Index of the key in bootutil_keys[].
+ *
+ * @return          The table, or NULL if there is none or it was generated
+ *                  for a different key than bootutil_keys[key_id].
+ */
+const struct bootutil_ecdsa_p256_comb *
+bootutil_ecdsa_p256_comb_find(uint8_t key_id);
+
+/**
+ * Verify a signature with the comb table of the public key.
+ *
+ * @param comb      Table of the public key.
+ * @param hash      SHA-256 of the signed data.
+ * @param signature Signature as the big endian integers r || s.
+ *
+ * @return          0 if the signature is valid, -1 otherwise.
+ */
+int bootutil_ecdsa_p256_comb_verify(const struct bootutil_ecdsa_p256_comb *comb,
+                                    const uint8_t *hash,
+                                    const uint8_t *signature);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_CRYPTO_ECDSA_P256_COMB_H_ */
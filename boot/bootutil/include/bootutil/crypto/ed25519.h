@@ -0,0 +1,123 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Incremental Ed25519 verification, implemented in ext/fiat.
+ *
+ * ED25519_verify() needs the whole message in one buffer, which for pure
+ * signatures (MCUBOOT_SIGN_PURE) is the image itself.  The functions below
+ * take the message in pieces instead, so it can be read from flash a chunk at
+ * a time.  Only the SHA-512 over R || A || M is computed incrementally; the
+ * point arithmetic is done in ED25519_verify_finish().
+ *
+ * With MCUBOOT_ED25519_COMB, signatures made with the built-in keys can be
+ * finished with ED25519_verify_finish_comb() instead, which uses a table of
+ * the key generated at build time by `imgtool getpub -e lang-c-comb`.  Both
+ * scalars of [s]B - [h]A are split into two halves of
+ * BOOTUTIL_ED25519_COMB_SPACING bits (a comb with two teeth), and the four
+ * halves are multiplied together with width-5 sliding windows, which takes
+ * half the doublings of ED25519_verify_finish().  The key does not need to
+ * be decompressed either.
+ */
+
+#ifndef __BOOTUTIL_CRYPTO_ED25519_H_
+#define __BOOTUTIL_CRYPTO_ED25519_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_USE_MBED_TLS)
+    #include <mbedtls/sha512.h>
+#elif defined(MCUBOOT_USE_TINYCRYPT)
+    #include <tinycrypt/sha512.h>
+#else
+    #error "Incremental Ed25519 verification requires tinycrypt or Mbed TLS"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ed25519_verify_ctx {
+#if defined(MCUBOOT_USE_MBED_TLS)
+    mbedtls_sha512_context sha;
+#else
+    struct tc_sha512_state_struct sha;
+#endif
+    uint8_t signature[64];
+    uint8_t public_key[32];
+};
+
+/*
+ * Start verifying a signature.  Returns 1 on success, and 0 if the signature
+ * is malformed, in which case the context must not be used any further.
+ */
+int ED25519_verify_init(struct ed25519_verify_ctx *ctx,
+                        const uint8_t signature[64],
+                        const uint8_t public_key[32]);
+
+/* Add the next part of the message. */
+void ED25519_verify_update(struct ed25519_verify_ctx *ctx,
+                           const uint8_t *data, size_t len);
+
+/* Returns 1 if the signature is valid for the whole message, 0 otherwise. */
+int ED25519_verify_finish(struct ed25519_verify_ctx *ctx);
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+/*
+ * Number of signatures checked by a single multi-scalar multiplication, more
+ * are checked in groups of this size.  Each one takes about 2 KiB of static
+ * RAM in ED25519_verify_batch().
+ */
+#define ED25519_BATCH_MAX   4
+
+/*
+ * Verify num signatures at once, with one multi-scalar multiplication for up
+ * to ED25519_BATCH_MAX of them.  Returns 1 if all of them are valid, and 0 if
+ * at least one is not, without telling which; ED25519_verify() tells that.
+ */
+int ED25519_verify_batch(const uint8_t *const messages[],
+                         const size_t message_lens[],
+                         const uint8_t *const signatures[],
+                         const uint8_t *const public_keys[], size_t num);
+#endif
+
+#if defined(MCUBOOT_ED25519_COMB)
+/* These must match ED25519_COMB_SPACING and ED25519_COMB_POINTS in imgtool. */
+#define BOOTUTIL_ED25519_COMB_SPACING   128
+#define BOOTUTIL_ED25519_COMB_POINTS    8
+
+struct ed25519_comb {
+    /* Compressed public key A the table was built for. */
+    uint8_t public_key[32];
+    /*
+     * Entry i of row j is (2i + 1) * 2^(SPACING * j) * -A, as the
+     * precomputed (y + x, y - x, 2dxy) of fiat, in its ten-limb format.
+     */
+    uint32_t points[2][BOOTUTIL_ED25519_COMB_POINTS][3][10];
+};
+
+/*
+ * Comb tables of the built-in public keys, indexed like bootutil_keys[].
+ * A NULL entry makes the key use ED25519_verify_finish().
+ */
+extern const struct ed25519_comb *const bootutil_ed25519_combs[];
+
+/*
+ * Same as ED25519_verify_finish(), using the comb table of the public key.
+ * Falls back to ED25519_verify_finish() if the table was generated for a
+ * different key than the one given to ED25519_verify_init().
+ */
+int ED25519_verify_finish_comb(struct ed25519_verify_ctx *ctx,
+                               const struct ed25519_comb *comb);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_CRYPTO_ED25519_H_ */
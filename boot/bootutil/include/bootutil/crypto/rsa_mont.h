@@ -0,0 +1,76 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Verify-only RSA public operation for the public keys built into the
+ * bootloader (MCUBOOT_RSA_MONT).
+ *
+ * The generic path parses the key from ASN.1 into an Mbed TLS context and
+ * sets up the Montgomery constants of the modulus on every verification.
+ * For a built-in key these only depend on the key, so
+ * `imgtool getpub -e lang-c-mont` computes them at build time: the modulus
+ * n and R^2 mod n as 32-bit limbs, least significant first, with
+ * R = 2^MCUBOOT_SIGN_RSA_LEN, and -n^-1 mod 2^32.  The public exponent must
+ * be 65537, so sig^e mod n is 16 Montgomery squarings and one
+ * multiplication, with all the numbers on the stack.
+ */
+
+#ifndef __BOOTUTIL_CRYPTO_RSA_MONT_H_
+#define __BOOTUTIL_CRYPTO_RSA_MONT_H_
+
+#include <stdint.h>
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* This must match RSA_MONT_LIMB_BITS in imgtool. */
+#define BOOTUTIL_RSA_MONT_LIMB_BITS 32
+#define BOOTUTIL_RSA_MONT_LIMBS     (MCUBOOT_SIGN_RSA_LEN / BOOTUTIL_RSA_MONT_LIMB_BITS)
+
+struct bootutil_rsa_mont {
+    /* -n^-1 mod 2^32. */
+    uint32_t n0inv;
+    /* Modulus, least significant limb first. */
+    uint32_t n[BOOTUTIL_RSA_MONT_LIMBS];
+    /* R^2 mod n, least significant limb first. */
+    uint32_t rr[BOOTUTIL_RSA_MONT_LIMBS];
+};
+
+/*
+ * Montgomery constants of the built-in public keys, indexed like
+ * bootutil_keys[].  A NULL entry makes the key use the generic verification.
+ */
+extern const struct bootutil_rsa_mont *const bootutil_rsa_monts[];
+
+/**
+ * Find the Montgomery constants of a built-in key.
+ *
+ * @param key_id    Index of the key in bootutil_keys[].
+ *
+ * @return          The constants, or NULL if there are none or they were
+ *                  generated for a different key than bootutil_keys[key_id].
+ */
+const struct bootutil_rsa_mont *bootutil_rsa_mont_find(uint8_t key_id);
+
+/**
+ * Compute em = sig^65537 mod n.
+ *
+ * @param key       Constants of the public key.
+ * @param sig       Signature, MCUBOOT_SIGN_RSA_LEN / 8 bytes, big endian.
+ * @param em        Result, MCUBOOT_SIGN_RSA_LEN / 8 bytes, big endian.
+ *
+ * @return          0 on success, -1 if the signature is not less than n.
+ */
+int bootutil_rsa_mont_public(const struct bootutil_rsa_mont *key,
+                             const uint8_t *sig, uint8_t *em);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_CRYPTO_RSA_MONT_H_ */
@@ -16,6 +16,9 @@
  * that MCUBOOT_USE_MBED_TLS supports. For this reason, it's allowed to have
  * both of them defined, and for crypto modules that support both abstractions,
  * the MCUBOOT_USE_PSA_CRYPTO will take precedence.
+ *
+ * With MCUBOOT_SHA_KERNEL, the hashes below use the in-tree implementation
+ * of bootutil/crypto/sha_kernel.h instead, whatever the crypto library.
  */
 
 #ifndef __BOOTUTIL_CRYPTO_SHA_H_
@@ -88,7 +91,58 @@
 extern "C" {
 #endif
 
-#if defined(MCUBOOT_USE_PSA_CRYPTO)
+#if defined(MCUBOOT_SHA_KERNEL)
+
+#include "bootutil/crypto/sha_kernel.h"
+
+#if defined(MCUBOOT_SHA512) || defined(MCUBOOT_SIGN_EC384)
+typedef struct bootutil_sha512_ctx bootutil_sha_context;
+#else
+typedef struct bootutil_sha256_ctx bootutil_sha_context;
+#endif
+
+static inline int bootutil_sha_init(bootutil_sha_context *ctx)
+{
+#if defined(MCUBOOT_SHA512)
+    bootutil_sha512_init(ctx);
+#elif defined(MCUBOOT_SIGN_EC384)
+    bootutil_sha384_init(ctx);
+#else
+    bootutil_sha256_init(ctx);
+#endif
+    return 0;
+}
+
+static inline int bootutil_sha_drop(bootutil_sha_context *ctx)
+{
+    (void)ctx;
+    return 0;
+}
+
+static inline int bootutil_sha_update(bootutil_sha_context *ctx,
+                                      const void *data,
+                                      uint32_t data_len)
+{
+#if defined(MCUBOOT_SHA512) || defined(MCUBOOT_SIGN_EC384)
+    bootutil_sha512_update(ctx, data, data_len);
+#else
+    bootutil_sha256_update(ctx, data, data_len);
+#endif
+    return 0;
+}
+
+static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
+                                      uint8_t *output)
+{
+#if defined(MCUBOOT_SHA512) || defined(MCUBOOT_SIGN_EC384)
+    bootutil_sha512_finish(ctx, output);
+#else
+    bootutil_sha256_finish(ctx, output);
+#endif
+    return 0;
+}
+
+#elif defined(MCUBOOT_USE_PSA_CRYPTO)
 
 typedef psa_hash_operation_t bootutil_sha_context;
 
@@ -196,7 +250,7 @@ static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
 
 #endif /* MCUBOOT_USE_MBED_TLS */
 
-#if defined(MCUBOOT_USE_TINYCRYPT)
+#if defined(MCUBOOT_USE_TINYCRYPT) && !defined(MCUBOOT_SHA_KERNEL)
 #if defined(MCUBOOT_SHA512)
 typedef struct tc_sha512_state_struct bootutil_sha_context;
 #else
@@ -241,7 +295,7 @@ static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
 }
 #endif /* MCUBOOT_USE_TINYCRYPT */
 
-#if defined(MCUBOOT_USE_CC310)
+#if defined(MCUBOOT_USE_CC310) && !defined(MCUBOOT_SHA_KERNEL)
 static inline int bootutil_sha_init(bootutil_sha_context *ctx)
 {
     cc310_sha256_init(ctx);
@@ -271,7 +325,7 @@ static inline int bootutil_sha_finish(bootutil_sha_context *ctx,
 }
 #endif /* MCUBOOT_USE_CC310 */
 
-#if defined(MCUBOOT_USE_NRF_EXTERNAL_CRYPTO)
+#if defined(MCUBOOT_USE_NRF_EXTERNAL_CRYPTO) && !defined(MCUBOOT_SHA_KERNEL)
 
 #include <bl_crypto.h>
 
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * In-tree SHA-256, SHA-384 and SHA-512 (MCUBOOT_SHA_KERNEL), which the
+ * bootutil_sha_* wrappers of bootutil/crypto/sha.h use instead of the hash
+ * of the crypto library.
+ *
+ * The compression functions are kept in a table of kernels: the portable C
+ * one, with the rounds in a loop or fully unrolled
+ * (MCUBOOT_SHA_KERNEL_UNROLL), then the ones using the SHA instructions of
+ * x86 (SHA-NI) and ARMv8 (Cryptography Extension), built when the compiler
+ * targets such a CPU.  The last kernel the CPU supports is picked on first
+ * use; bootutil_sha_kernel_select() picks another one, to compare them.
+ * A kernel without SHA-512 uses the portable one for it.
+ *
+ * Updates hash the whole blocks straight out of the buffer of the caller,
+ * only the rest of the data is copied into the context.
+ */
+
+#ifndef __BOOTUTIL_CRYPTO_SHA_KERNEL_H_
+#define __BOOTUTIL_CRYPTO_SHA_KERNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mcuboot_config/mcuboot_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOTUTIL_SHA256_BLOCK_SIZE  64
+#define BOOTUTIL_SHA512_BLOCK_SIZE  128
+
+struct bootutil_sha_kernel {
+    const char *name;
+    /* Returns nonzero if the CPU can run the kernel, NULL if it always can. */
+    int (*supported)(void);
+    /* Compress the given number of consecutive blocks into the state. */
+    void (*sha256_blocks)(uint32_t state[8], const uint8_t *data,
+                          size_t blocks);
+    /* NULL if the kernel has no SHA-512. */
+    void (*sha512_blocks)(uint64_t state[8], const uint8_t *data,
+                          size_t blocks);
+};
+
+/* All the kernels built in, the portable one first. */
+extern const struct bootutil_sha_kernel *const bootutil_sha_kernels[];
+extern const int bootutil_sha_kernel_cnt;
+
+/*
+ * Use kernel index of bootutil_sha_kernels[] from now on, or the default one
+ * if index is -1.  Returns 0, or -1 if there is no such kernel or the CPU
+ * cannot run it.
+ */
+int bootutil_sha_kernel_select(int index);
+
+struct bootutil_sha256_ctx {
+    uint32_t state[8];
+    /* Bytes hashed so far, the last len % 64 of them are in buf. */
+    uint64_t len;
+    uint8_t buf[BOOTUTIL_SHA256_BLOCK_SIZE];
+};
+
+struct bootutil_sha512_ctx {
+    uint64_t state[8];
+    /* Bytes hashed so far, the last len % 128 of them are in buf. */
+    uint64_t len;
+    /* 48 for SHA-384, 64 for SHA-512. */
+    uint32_t digest_len;
+    uint8_t buf[BOOTUTIL_SHA512_BLOCK_SIZE];
+};
+
+void bootutil_sha256_init(struct bootutil_sha256_ctx *ctx);
+void bootutil_sha256_update(struct bootutil_sha256_ctx *ctx, const void *data,
+                            size_t len);
+/* Writes the 32 bytes of the digest. */
+void bootutil_sha256_finish(struct bootutil_sha256_ctx *ctx, uint8_t *output);
+
+void bootutil_sha384_init(struct bootutil_sha512_ctx *ctx);
+void bootutil_sha512_init(struct bootutil_sha512_ctx *ctx);
+void bootutil_sha512_update(struct bootutil_sha512_ctx *ctx, const void *data,
+                            size_t len);
+/* Writes the 48 or 64 bytes of the digest, for SHA-384 or SHA-512. */
+void bootutil_sha512_finish(struct bootutil_sha512_ctx *ctx, uint8_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_CRYPTO_SHA_KERNEL_H_ */
@@ -34,6 +34,9 @@
 #include "bootutil/image.h"
 #include "bootutil/sign_key.h"
 #include "bootutil/enc_key_public.h"
+#if defined(MCUBOOT_CRYPTO_ASYNC)
+#include "bootutil/crypto/async.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -77,7 +80,15 @@ void boot_enc_encrypt(struct enc_key_data *enc_state, int slot,
         uint32_t off, uint32_t sz, uint32_t blk_off, uint8_t *buf);
 void boot_enc_decrypt(struct enc_key_data *enc_state, int slot,
         uint32_t off, uint32_t sz, uint32_t blk_off, uint8_t *buf);
+#if defined(MCUBOOT_CRYPTO_ASYNC)
+void boot_enc_job(struct enc_key_data *enc_state, int slot,
+        uint32_t off, uint32_t sz, uint32_t blk_off, uint8_t *buf,
+        struct bootutil_crypto_job *job);
+#endif
 void boot_enc_zeroize(struct enc_key_data *enc_state);
+#if defined(MCUBOOT_ENC_KEY_CACHE)
+void boot_enc_cache_zeroize(struct boot_loader_state *state);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Asynchronous flash jobs (MCUBOOT_FLASH_ASYNC).
+ *
+ * A job erases or writes a region of a flash area.  It is handed to a driver
+ * with bootutil_flash_async_submit(), and the buffer of a write belongs to
+ * the driver until the job is complete, as told by
+ * bootutil_flash_async_poll() or bootutil_flash_async_wait().  In the
+ * meantime the CPU reads the next chunk of a copy from another flash device,
+ * so that the erase and the writes of the destination of a copy overlap with
+ * the reads of its source when they are on different devices.
+ *
+ * Jobs never cross a step of a swap: all the jobs of a copy are complete
+ * before boot_copy_region() returns, and so before the swap status that
+ * records the copy is written.
+ *
+ * The driver is provided by the port, on top of a flash controller that
+ * runs on its own or of another thread.  Jobs complete in the order they
+ * were submitted, so a write may follow the erase of the same region.  A
+ * software driver runs the jobs with bootutil_flash_job_run().
+ */
+
+#ifndef __BOOTUTIL_FLASH_ASYNC_H_
+#define __BOOTUTIL_FLASH_ASYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include <flash_map_backend/flash_map_backend.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum bootutil_flash_job_op {
+    /* Erase [off, off + len) of fa, as boot_erase_region() does. */
+    BOOTUTIL_FLASH_JOB_ERASE,
+    /* flash_area_write(fa, off, buf, len). */
+    BOOTUTIL_FLASH_JOB_WRITE,
+};
+
+struct bootutil_flash_job {
+    enum bootutil_flash_job_op op;
+    const struct flash_area *fa;
+    uint32_t off;
+    const uint8_t *buf;
+    uint32_t len;
+    /* Result of the job, valid once it is complete. */
+    int rc;
+    /* For the use of the driver. */
+    struct bootutil_flash_job *next;
+    volatile bool done;
+};
+
+/* Run the job on the CPU, returns its result. */
+int bootutil_flash_job_run(struct bootutil_flash_job *job);
+
+/*
+ * Implemented by the port.
+ */
+
+/**
+ * Tell whether jobs on one flash area may run while the CPU reads another,
+ * which is the case when they are on different devices.
+ *
+ * @return          true if jobs on fa_job overlap with reads of fa_read.
+ */
+bool bootutil_flash_async_concurrent(const struct flash_area *fa_job,
+                                     const struct flash_area *fa_read);
+
+/**
+ * Queue a job.
+ *
+ * @return          0 on success, nonzero if the job could not be queued, in
+ *                  which case it must not be polled or waited for.
+ */
+int bootutil_flash_async_submit(struct bootutil_flash_job *job);
+
+/* Returns true once the job is complete. */
+bool bootutil_flash_async_poll(struct bootutil_flash_job *job);
+
+/* Wait until the job is complete, returns its result. */
+int bootutil_flash_async_wait(struct bootutil_flash_job *job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_FLASH_ASYNC_H_ */
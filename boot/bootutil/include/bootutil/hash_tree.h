@@ -0,0 +1,133 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Tree hash of an image (MCUBOOT_HASH_TREE), an alternative to the linear
+ * SHA digest of IMAGE_TLV_SHA256/384/512.
+ *
+ * The data covered by the image hash, the header, the payload and the
+ * protected TLVs, is split into leaves of a power of two size, the last one
+ * possibly shorter.  Every leaf is hashed on its own, H(0x00 || leaf), and
+ * the leaf digests are combined as in RFC 6962: a node is
+ * H(0x01 || left || right), and the left subtree over n leaves holds the
+ * largest power of two of them smaller than n.  The root is
+ * H(0x02 || leaf size || top node), with the leaf size as 4 bytes little
+ * endian.  H is the image hash of bootutil/crypto/sha.h.
+ *
+ * The IMAGE_TLV_HASH_TREE TLV, in the unprotected area, holds the leaf
+ * size, 4 bytes little endian, followed by the digests of all the leaves in
+ * order.  The signature is over the root, which is computed from those
+ * digests, so it covers them: once the root is verified, every leaf can be
+ * checked against its own digest, in any order, without hashing the others.
+ *
+ * The root is computed by feeding the digests in order to
+ * bootutil_hash_tree_add_leaf().  Only the roots of the full subtrees seen
+ * so far are kept, one per set bit of the number of leaves.
+ */
+
+#ifndef __BOOTUTIL_HASH_TREE_H_
+#define __BOOTUTIL_HASH_TREE_H_
+
+#include <stdint.h>
+#include "bootutil/crypto/sha.h"
+#include "bootutil/image.h"
+
+struct flash_area;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOTUTIL_HASH_TREE_MIN_LEAF_LOG2    10
+#define BOOTUTIL_HASH_TREE_MAX_LEAF_LOG2    31
+/* A 4 GiB image has at most this many set bits in its number of leaves. */
+#define BOOTUTIL_HASH_TREE_DEPTH            (32 - BOOTUTIL_HASH_TREE_MIN_LEAF_LOG2)
+
+/* Number of leaves of size bytes of data. */
+#define BOOTUTIL_HASH_TREE_LEAVES(size, leaf_size) \
+    (((size) + (leaf_size) - 1) / (leaf_size))
+
+/* Length of the IMAGE_TLV_HASH_TREE TLV of that many leaves. */
+#define BOOTUTIL_HASH_TREE_TLV_LEN(leaves)  (4 + (leaves) * IMAGE_HASH_SIZE)
+
+struct bootutil_hash_tree {
+    uint32_t leaf_size;
+    /* Leaves added so far. */
+    uint32_t leaves;
+    /* Roots of the full subtrees, the biggest first. */
+    uint32_t depth;
+    uint8_t subtrees[BOOTUTIL_HASH_TREE_DEPTH][IMAGE_HASH_SIZE];
+};
+
+/**
+ * Start a tree hash.
+ *
+ * @param tree      Context.
+ * @param leaf_size Size of the leaves, a power of two between
+ *                  2^BOOTUTIL_HASH_TREE_MIN_LEAF_LOG2 and
+ *                  2^BOOTUTIL_HASH_TREE_MAX_LEAF_LOG2.
+ *
+ * @return          0 on success, -1 if the leaf size is not valid.
+ */
+int bootutil_hash_tree_init(struct bootutil_hash_tree *tree, uint32_t leaf_size);
+
+/**
+ * Compute the digest of one leaf, independently of any tree.
+ *
+ * @param data      Data of the leaf.
+ * @param len       Its length, the leaf size except for the last leaf.
+ * @param digest    Output, IMAGE_HASH_SIZE bytes.
+ */
+void bootutil_hash_tree_leaf(const void *data, uint32_t len, uint8_t *digest);
+
+/**
+ * Start the digest of a leaf given in pieces: the data is then passed to
+ * bootutil_sha_update() and the digest read with bootutil_sha_finish().
+ */
+void bootutil_hash_tree_leaf_init(bootutil_sha_context *ctx);
+
+/**
+ * Add the digest of the next leaf.
+ *
+ * @return          0 on success, -1 if there are too many leaves.
+ */
+int bootutil_hash_tree_add_leaf(struct bootutil_hash_tree *tree,
+                                const uint8_t *digest);
+
+/**
+ * Compute the root from the leaves added.
+ *
+ * @param root      Output, IMAGE_HASH_SIZE bytes.
+ *
+ * @return          0 on success, -1 if there was no leaf.
+ */
+int bootutil_hash_tree_finish(struct bootutil_hash_tree *tree, uint8_t *root);
+
+/**
+ * Compute the root of the IMAGE_TLV_HASH_TREE of an image from its leaf
+ * digests.  The root is only the hash of the image once it is verified
+ * against the signature and the leaves against their digests.
+ *
+ * @param hdr       Header of the image.
+ * @param fap       Flash area of the image.
+ * @param off       Offset of the TLV data in the flash area.
+ * @param len       Length of the TLV.
+ * @param leaf_size Output, the leaf size, NULL if not needed.
+ * @param root      Output, IMAGE_HASH_SIZE bytes.
+ *
+ * @return          0 on success, -1 if the TLV is not valid or on a read
+ *                  error.
+ */
+int bootutil_hash_tree_tlv_root(const struct image_header *hdr,
+                                const struct flash_area *fap, uint32_t off,
+                                uint16_t len, uint32_t *leaf_size,
+                                uint8_t *root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOTUTIL_HASH_TREE_H_ */
@@ -82,6 +82,12 @@ extern "C" {
 #define IMAGE_F_COMPRESSED_LZMA2         0x00000400
 #define IMAGE_F_COMPRESSED_ARM_THUMB_FLT 0x00000800
 
+/*
+ * Indicates that the image data is a patch to the image in the primary slot,
+ * see IMAGE_TLV_DELTA_BASE and IMAGE_TLV_DELTA_TARGET.
+ */
+#define IMAGE_F_DELTA                    0x00001000
+
 /*
  * ECSDA224 is with NIST P-224
  * ECSDA256 is with NIST P-256
@@ -101,6 +107,11 @@ extern "C" {
 #define IMAGE_TLV_SHA256            0x10    /* SHA256 of image hdr and body */
 #define IMAGE_TLV_SHA384            0x11    /* SHA384 of image hdr and body */
 #define IMAGE_TLV_SHA512            0x12    /* SHA512 of image hdr and body */
+#define IMAGE_TLV_HASH_TREE         0x13    /* Leaf size and leaf digests of
+                                             * the tree hash of image hdr and
+                                             * body, see
+                                             * bootutil/hash_tree.h
+                                             */
 #define IMAGE_TLV_RSA2048_PSS       0x20    /* RSA2048 of hash output */
 #define IMAGE_TLV_ECDSA224          0x21    /* ECDSA of hash output - Not supported anymore */
 #define IMAGE_TLV_ECDSA_SIG         0x22    /* ECDSA of hash output */
@@ -132,6 +143,15 @@ extern "C" {
                                              * signature
                                              */
 #define IMAGE_TLV_COMP_DEC_SIZE     0x73    /* Compressed decrypted image size */
+/* The following flags relate to delta images, each holds a 32-bit size followed by a hash */
+#define IMAGE_TLV_DELTA_BASE        0x74    /*
+                                             * Size and shaX hash of the whole image the
+                                             * patch applies to, TLVs included
+                                             */
+#define IMAGE_TLV_DELTA_TARGET      0x75    /*
+                                             * Size and shaX hash of the whole image the
+                                             * patch builds, TLVs included
+                                             */
                                             /*
                                              * vendor reserved TLVs at xxA0-xxFF,
                                              * where xx denotes the upper byte
@@ -199,6 +219,8 @@ STRUCT_PACKED image_tlv {
 #define MUST_DECRYPT(fap, idx, hdr) \
     (flash_area_get_id(fap) == FLASH_AREA_IMAGE_SECONDARY(idx) && IS_ENCRYPTED(hdr))
 
+#define IS_DELTA(hdr) ((hdr)->ih_flags & IMAGE_F_DELTA)
+
 #define COMPRESSIONFLAGS (IMAGE_F_COMPRESSED_LZMA1 | IMAGE_F_COMPRESSED_LZMA2 \
                           | IMAGE_F_COMPRESSED_ARM_THUMB_FLT)
 #define IS_COMPRESSED(hdr) ((hdr)->ih_flags & COMPRESSIONFLAGS)
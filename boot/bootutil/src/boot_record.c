@@ -31,6 +31,9 @@
 #include "bootutil_priv.h"
 #include "bootutil/image.h"
 #include "flash_map_backend/flash_map_backend.h"
+#if defined(MCUBOOT_HASH_TREE)
+#include "bootutil/hash_tree.h"
+#endif
 
 #if defined(MCUBOOT_DATA_SHARING_BOOTINFO)
 static bool saved_bootinfo = false;
@@ -175,14 +178,30 @@ boot_save_boot_status(uint8_t sw_module,
             record_len = len;
             boot_record_found = true;
 
-        } else if (type == EXPECTED_HASH_TLV) {
-            /* Get the image's hash value from the manifest section. */
-            if (len > sizeof(image_hash)) {
-                return -1;
-            }
-            rc = flash_area_read(fap, offset, image_hash, len);
-            if (rc) {
-                return -1;
+        } else if (type == EXPECTED_HASH_TLV
+#if defined(MCUBOOT_HASH_TREE)
+                   || type == IMAGE_TLV_HASH_TREE
+#endif
+                  ) {
+#if defined(MCUBOOT_HASH_TREE)
+            /* The measurement of a tree hashed image is the root. */
+            if (type == IMAGE_TLV_HASH_TREE) {
+                rc = bootutil_hash_tree_tlv_root(hdr, fap, offset, len, NULL,
+                                                 image_hash);
+                if (rc) {
+                    return -1;
+                }
+            } else
+#endif
+            {
+                /* Get the image's hash value from the manifest section. */
+                if (len > sizeof(image_hash)) {
+                    return -1;
+                }
+                rc = flash_area_read(fap, offset, image_hash, len);
+                if (rc) {
+                    return -1;
+                }
             }
 
             hash_found = true;
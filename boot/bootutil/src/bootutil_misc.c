@@ -39,6 +39,7 @@
 #include "bootutil_misc.h"
 #include "bootutil/bootutil_log.h"
 #include "bootutil/fault_injection_hardening.h"
+#include "bootutil/boot_public_hooks.h"
 #ifdef MCUBOOT_ENC_IMAGES
 #include "bootutil/enc_key.h"
 #endif
@@ -237,6 +238,56 @@ int boot_header_scramble_off_sz(const struct flash_area *fa, int slot, size_t *o
     return ret;
 }
 
+#if defined(MCUBOOT_IMAGE_EXTENT)
+int boot_image_scramble_sz(struct boot_loader_state *state, const struct flash_area *fa,
+                           int slot, size_t *size)
+{
+    struct flash_sector sector;
+    uint32_t img_sz;
+    uint32_t end;
+    int ret;
+
+    if (boot_img_hdr(state, slot)->ih_magic != IMAGE_MAGIC) {
+        return BOOT_EBADIMAGE;
+    }
+
+    ret = boot_read_image_size(state, slot, &img_sz);
+    if (ret != 0) {
+        return ret;
+    }
+
+    end = 0;
+#if defined(MCUBOOT_SWAP_USING_OFFSET)
+    /* The image in the secondary slot may start in its second sector. */
+    if (slot == BOOT_SECONDARY_SLOT) {
+        end = state->secondary_offset[BOOT_CURR_IMG(state)];
+    }
+#endif
+    if (img_sz == 0 || end >= flash_area_get_size(fa) ||
+        img_sz > flash_area_get_size(fa) - end) {
+        return BOOT_EBADIMAGE;
+    }
+    end += img_sz;
+
+    if (device_requires_erase(fa)) {
+        /* For device requiring erase align to erase unit */
+        ret = flash_area_get_sector(fa, end - 1, &sector);
+        if (ret < 0) {
+            return ret;
+        }
+
+        *size = flash_sector_get_off(&sector) + flash_sector_get_size(&sector);
+    } else {
+        /* For device not requiring erase align to write block */
+        *size = ALIGN_UP(end, flash_area_align(fa));
+    }
+
+    BOOT_LOG_DBG("boot_image_scramble_sz: slot %d, size %u", slot, (unsigned int)*size);
+
+    return 0;
+}
+#endif
+
 #if MCUBOOT_SWAP_USING_SCRATCH
 /*
  * Similar to `boot_trailer_sz` but this function returns the space used to
@@ -349,6 +400,90 @@ boot_find_status(const struct boot_loader_state *state, int image_index)
     return fa_p;
 }
 
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+/*
+ * The snapshot of an image is read once when the image is prepared for the
+ * update, and all the swap types and swap states asked for afterwards come
+ * from it instead of from the trailers, until its slots are written.  It is
+ * only made if all of it could be read; if not, the trailers are read every
+ * time as without the snapshot.
+ */
+void
+boot_snapshot_fill(struct boot_loader_state *state)
+{
+    int image_index = BOOT_CURR_IMG(state);
+    struct boot_swap_state primary_slot;
+    int slot;
+    int rc;
+
+    state->snapshot[image_index].valid = false;
+
+    for (slot = 0; slot < BOOT_NUM_SLOTS; slot++) {
+        if (BOOT_IMG_AREA(state, slot) == NULL) {
+            return;
+        }
+
+        rc = boot_read_swap_state(BOOT_IMG_AREA(state, slot),
+                                  &state->snapshot[image_index].swap_state[slot]);
+        if (rc != 0) {
+            return;
+        }
+    }
+
+    /* The hook may stand for the trailer of the primary slot in the swap
+     * type, but not in the swap states read by the swap code.
+     */
+    rc = BOOT_HOOK_CALL(boot_read_swap_state_primary_slot_hook,
+                        BOOT_HOOK_REGULAR, image_index, &primary_slot);
+    if (rc == BOOT_HOOK_REGULAR) {
+        primary_slot = state->snapshot[image_index].swap_state[BOOT_PRIMARY_SLOT];
+    } else if (rc != 0) {
+        return;
+    }
+
+    state->snapshot[image_index].swap_type =
+        boot_swap_type_decode(image_index, &primary_slot,
+                              &state->snapshot[image_index].swap_state[BOOT_SECONDARY_SLOT]);
+    state->snapshot[image_index].valid = true;
+}
+
+void
+boot_snapshot_invalidate(struct boot_loader_state *state, int image_index)
+{
+    state->snapshot[image_index].valid = false;
+}
+#endif /* MCUBOOT_SLOT_SNAPSHOT */
+
+int
+boot_snapshot_swap_type(struct boot_loader_state *state)
+{
+#if (BOOT_IMAGE_NUMBER == 1)
+    (void)state;
+#endif
+
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    if (state->snapshot[BOOT_CURR_IMG(state)].valid) {
+        return state->snapshot[BOOT_CURR_IMG(state)].swap_type;
+    }
+#endif
+
+    return boot_swap_type_multi(BOOT_CURR_IMG(state));
+}
+
+int
+boot_snapshot_swap_state(struct boot_loader_state *state, int slot,
+                         struct boot_swap_state *swap_state)
+{
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    if (state->snapshot[BOOT_CURR_IMG(state)].valid) {
+        *swap_state = state->snapshot[BOOT_CURR_IMG(state)].swap_state[slot];
+        return 0;
+    }
+#endif
+
+    return boot_read_swap_state(BOOT_IMG_AREA(state, slot), swap_state);
+}
+
 int
 boot_read_swap_size(const struct flash_area *fap, uint32_t *swap_size)
 {
@@ -430,6 +565,78 @@ boot_write_enc_key(const struct flash_area *fap, uint8_t slot,
 }
 #endif
 
+#ifdef MCUBOOT_ENC_IMAGES
+#if MCUBOOT_SWAP_SAVE_ENCTLV
+#define BOOT_TRAILER_INFO_ENC_SZ    (BOOT_ENC_TLV_ALIGN_SIZE * 2)
+#else
+#define BOOT_TRAILER_INFO_ENC_SZ    (BOOT_ENC_KEY_ALIGN_SIZE * 2)
+#endif
+#else
+#define BOOT_TRAILER_INFO_ENC_SZ    0
+#endif
+
+/*
+ * The encryption keys, swap_size and swap_info, from the first key up to
+ * copy_done.
+ */
+#define BOOT_TRAILER_INFO_WRITE_SZ  (BOOT_TRAILER_INFO_ENC_SZ + BOOT_MAX_ALIGN * 2)
+
+/**
+ * Writes the fields of a new trailer but copy_done: the encryption keys,
+ * swap_size and swap_info, which are next to each other, with a single write,
+ * then image_ok if set and the magic, last, so that the trailer is not taken
+ * as valid until all of it is written.
+ *
+ * @returns 0 on success, != 0 on error.
+ */
+int
+boot_write_trailer_info(const struct flash_area *fap, uint8_t swap_type,
+                        uint8_t image_num, bool image_ok,
+                        const struct boot_status *bs)
+{
+    uint8_t buf[BOOT_TRAILER_INFO_WRITE_SZ];
+    uint32_t off;
+    uint32_t end;
+    int rc;
+
+    off = boot_swap_size_off(fap) - BOOT_TRAILER_INFO_ENC_SZ;
+    end = boot_swap_info_off(fap);
+
+    memset(buf, flash_area_erased_val(fap), sizeof(buf));
+#ifdef MCUBOOT_ENC_IMAGES
+#if MCUBOOT_SWAP_SAVE_ENCTLV
+    memcpy(&buf[boot_enc_key_off(fap, 0) - off], bs->enctlv[0], BOOT_ENC_TLV_ALIGN_SIZE);
+    memcpy(&buf[boot_enc_key_off(fap, 1) - off], bs->enctlv[1], BOOT_ENC_TLV_ALIGN_SIZE);
+#else
+    memcpy(&buf[boot_enc_key_off(fap, 0) - off], bs->enckey[0], BOOT_ENC_KEY_ALIGN_SIZE);
+    memcpy(&buf[boot_enc_key_off(fap, 1) - off], bs->enckey[1], BOOT_ENC_KEY_ALIGN_SIZE);
+#endif
+#endif
+    memcpy(&buf[boot_swap_size_off(fap) - off], &bs->swap_size, sizeof(bs->swap_size));
+    if (swap_type != BOOT_SWAP_TYPE_NONE) {
+        BOOT_SET_SWAP_INFO(buf[end - off], image_num, swap_type);
+        end += BOOT_MAX_ALIGN;
+    }
+
+    BOOT_LOG_DBG("writing trailer info; fa_id=%d off=0x%lx (0x%lx), size=0x%lx",
+                 flash_area_get_id(fap), (unsigned long)off,
+                 (unsigned long)flash_area_get_off(fap) + off,
+                 (unsigned long)(end - off));
+    rc = flash_area_write(fap, off, buf, end - off);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    if (image_ok) {
+        rc = boot_write_image_ok(fap);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    return boot_write_magic(fap);
+}
+
 uint32_t bootutil_max_image_size(struct boot_loader_state *state, const struct flash_area *fap)
 {
 #if defined(CONFIG_MCUBOOT_MCUBOOT_IMAGE_NUMBER) && CONFIG_MCUBOOT_MCUBOOT_IMAGE_NUMBER != -1
@@ -469,10 +676,13 @@ uint32_t bootutil_max_image_size(struct boot_loader_state *state, const struct f
  * Compute the total size of the given image.  Includes the size of
  * the TLVs.
  */
-#if !defined(MCUBOOT_DIRECT_XIP) && \
+#if (!defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_IMAGE_EXTENT)) && \
     !defined(MCUBOOT_SWAP_USING_OFFSET) && \
     (!defined(MCUBOOT_OVERWRITE_ONLY) || \
-    defined(MCUBOOT_OVERWRITE_ONLY_FAST))
+    defined(MCUBOOT_OVERWRITE_ONLY_FAST) || \
+    defined(MCUBOOT_OVERWRITE_ONLY_RESUME) || \
+    defined(MCUBOOT_DELTA_IMAGES) || \
+    defined(MCUBOOT_IMAGE_EXTENT))
 int
 boot_read_image_size(struct boot_loader_state *state, int slot, uint32_t *size)
 {
@@ -564,6 +774,93 @@ done:
 }
 #endif /* !MCUBOOT_OVERWRITE_ONLY */
 
+#if defined(MCUBOOT_FLASH_ERASE_RANGE)
+/*
+ * Largest erase block of the device that erases [off, off + size) of the
+ * sector aligned range [start, end), from start, or from end if backwards.
+ * The block must be aligned to its size in the address space of the device
+ * and made of whole sectors.  Returns 0 if there is none.
+ */
+static uint32_t
+boot_erase_block(const struct flash_area *fa, uint32_t blocks, uint32_t start,
+                 uint32_t end, bool backwards, uint32_t *off)
+{
+    struct flash_sector sector;
+    uint32_t size;
+
+    for (size = 1u << 31; size != 0; size >>= 1) {
+        if ((blocks & size) == 0 || size > end - start) {
+            continue;
+        }
+
+        *off = backwards ? end - size : start;
+        if (((flash_area_get_off(fa) + *off) & (size - 1)) != 0) {
+            continue;
+        }
+
+        /* The other end of the block must be on a sector boundary. */
+        if (backwards) {
+            if (flash_area_get_sector(fa, *off, &sector) == 0 &&
+                flash_sector_get_off(&sector) == *off) {
+                return size;
+            }
+        } else {
+            if (flash_area_get_sector(fa, *off + size - 1, &sector) == 0 &&
+                flash_sector_get_off(&sector) + flash_sector_get_size(&sector) ==
+                *off + size) {
+                return size;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Erase the sector aligned range [start, end) with the erase blocks of the
+ * device, as large as they fit, and sector by sector where none does.
+ */
+static int
+boot_erase_blocks(const struct flash_area *fa, uint32_t blocks, uint32_t start,
+                  uint32_t end, bool backwards)
+{
+    struct flash_sector sector;
+    uint32_t off;
+    uint32_t size;
+    int rc;
+
+    while (start < end) {
+        size = boot_erase_block(fa, blocks, start, end, backwards, &off);
+        if (size != 0) {
+            rc = flash_area_erase_range(fa, off, size);
+        } else {
+            rc = flash_area_get_sector(fa, backwards ? end - 1 : start, &sector);
+            if (rc < 0) {
+                return rc;
+            }
+
+            off = flash_sector_get_off(&sector);
+            size = flash_sector_get_size(&sector);
+            rc = flash_area_erase(fa, off, size);
+        }
+
+        if (rc < 0) {
+            return rc;
+        }
+
+        MCUBOOT_WATCHDOG_FEED();
+
+        if (backwards) {
+            end = off;
+        } else {
+            start = off + size;
+        }
+    }
+
+    return 0;
+}
+#endif /* MCUBOOT_FLASH_ERASE_RANGE */
+
 /**
  * Erases a region of device that requires erase prior to write; does
  * nothing on devices without erase.
@@ -592,9 +889,33 @@ boot_erase_region(const struct flash_area *fa, uint32_t off, uint32_t size, bool
     } else if (device_requires_erase(fa)) {
         uint32_t end_offset = 0;
         struct flash_sector sector;
+#if defined(MCUBOOT_FLASH_ERASE_RANGE)
+        uint32_t blocks;
+#endif
 
         BOOT_LOG_DBG("boot_erase_region: device with erase");
 
+#if defined(MCUBOOT_FLASH_ERASE_RANGE)
+        blocks = flash_area_erase_blocks(fa);
+        if (blocks != 0 && size != 0) {
+            rc = flash_area_get_sector(fa, off + size - 1, &sector);
+            if (rc < 0) {
+                goto end;
+            }
+
+            end_offset = flash_sector_get_off(&sector) + flash_sector_get_size(&sector);
+
+            rc = flash_area_get_sector(fa, off, &sector);
+            if (rc < 0) {
+                goto end;
+            }
+
+            rc = boot_erase_blocks(fa, blocks, flash_sector_get_off(&sector), end_offset,
+                                   backwards);
+            goto end;
+        }
+#endif
+
         if (backwards) {
             /* Get the lowest page offset first */
             rc = flash_area_get_sector(fa, off, &sector);
@@ -43,6 +43,14 @@
 #include "bootutil/enc_key.h"
 #endif
 
+#if defined(MCUBOOT_BATCH_VERIFY) || defined(MCUBOOT_ENC_KEY_CACHE)
+#include "bootutil/crypto/sha.h"
+#endif
+
+#if defined(MCUBOOT_FLASH_ASYNC)
+#include "bootutil/flash_async.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -81,6 +89,74 @@ struct flash_area;
 #define MCUBOOT_SWAP_USING_SCRATCH 1
 #endif
 
+/*
+ * Pure signatures are verified over the image itself. Unless the storage is
+ * mapped to the address space, the image is read from the flash area and
+ * verified in pieces, which needs the incremental ED25519 implementation.
+ */
+#if defined(MCUBOOT_SIGN_PURE) && \
+    !defined(MCUBOOT_HASH_STORAGE_DIRECTLY) && \
+    !defined(MCUBOOT_RAM_LOAD) && \
+    (defined(MCUBOOT_USE_TINYCRYPT) || defined(MCUBOOT_USE_MBED_TLS))
+#define MCUBOOT_SIGN_PURE_FROM_FLASH 1
+#endif
+
+/*
+ * With batch verification the signatures of the images in the primary slots
+ * are collected while the images are validated, and checked together once
+ * all of them are hashed.
+ */
+#if defined(MCUBOOT_BATCH_VERIFY)
+#if !defined(MCUBOOT_SIGN_ED25519) || defined(MCUBOOT_SIGN_PURE)
+#error "MCUBOOT_BATCH_VERIFY requires ED25519 signatures of the image hash"
+#endif
+#if !defined(MCUBOOT_VALIDATE_PRIMARY_SLOT) || \
+    defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD)
+#error "MCUBOOT_BATCH_VERIFY requires MCUBOOT_VALIDATE_PRIMARY_SLOT with swap or overwrite upgrades"
+#endif
+#define BOOT_BATCH_SIG_SIZE     64
+#endif
+
+/*
+ * The resumable overwrite copies the image one sector at a time, which a
+ * decompression stream over the whole image cannot do.
+ */
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME) && \
+    (!defined(MCUBOOT_OVERWRITE_ONLY) || defined(MCUBOOT_DECOMPRESS_IMAGES))
+#error "MCUBOOT_OVERWRITE_ONLY_RESUME requires MCUBOOT_OVERWRITE_ONLY, without MCUBOOT_DECOMPRESS_IMAGES"
+#endif
+
+/*
+ * A delta image is built into the secondary slot and then copied over the
+ * image it patches, which has to be gone by then.
+ */
+#if defined(MCUBOOT_DELTA_IMAGES) && \
+    (!defined(MCUBOOT_OVERWRITE_ONLY) || defined(MCUBOOT_DECOMPRESS_IMAGES))
+#error "MCUBOOT_DELTA_IMAGES requires MCUBOOT_OVERWRITE_ONLY, without MCUBOOT_DECOMPRESS_IMAGES"
+#endif
+
+/*
+ * The slot snapshot stands for the trailers of the two slots of each image
+ * while the swap or overwrite upgrades decide what to do.
+ */
+#if defined(MCUBOOT_SLOT_SNAPSHOT) && \
+    (defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD) || \
+     defined(MCUBOOT_SINGLE_APPLICATION_SLOT) || defined(MCUBOOT_FIRMWARE_LOADER))
+#error "MCUBOOT_SLOT_SNAPSHOT requires the swap or overwrite upgrades"
+#endif
+
+/*
+ * The image extent narrows down the scramble of an entire slot, which the
+ * minimal scramble does not do.
+ */
+#if defined(MCUBOOT_IMAGE_EXTENT) && defined(MCUBOOT_MINIMAL_SCRAMBLE)
+#error "MCUBOOT_IMAGE_EXTENT can not be used with MCUBOOT_MINIMAL_SCRAMBLE"
+#endif
+
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING) && !defined(MCUBOOT_SWAP_USING_SCRATCH)
+#error "MCUBOOT_SCRATCH_WEAR_LEVELING requires the swap using scratch upgrade"
+#endif
+
 #if defined(MCUBOOT_SWAP_USING_OFFSET)
 #define BOOT_STATUS_OP_SWAP     1
 #else
@@ -199,6 +275,12 @@ _Static_assert(sizeof(boot_img_magic) == BOOT_MAGIC_SZ, "Invalid size for image
                  (hdr)->ih_ver.iv_build_num)
 
 #if MCUBOOT_SWAP_USING_MOVE
+/* Largest number of sectors moved or swapped by a step of the swap. */
+#if !defined(MCUBOOT_SWAP_MOVE_BATCH_SECTORS)
+#define MCUBOOT_SWAP_MOVE_BATCH_SECTORS 1
+#elif MCUBOOT_SWAP_MOVE_BATCH_SECTORS < 1
+#error "MCUBOOT_SWAP_MOVE_BATCH_SECTORS must be at least 1"
+#endif
 #define BOOT_STATUS_MOVE_STATE_COUNT    1
 #define BOOT_STATUS_SWAP_STATE_COUNT    2
 #define BOOT_STATUS_STATE_COUNT         (BOOT_STATUS_MOVE_STATE_COUNT + BOOT_STATUS_SWAP_STATE_COUNT)
@@ -230,6 +312,18 @@ typedef struct flash_sector boot_sector_t;
 typedef struct flash_area boot_sector_t;
 #endif
 
+#if defined(MCUBOOT_ENC_IMAGES) && defined(MCUBOOT_ENC_KEY_CACHE)
+#define BOOT_ENC_KEY_CACHE_SIZE         (BOOT_IMAGE_NUMBER * BOOT_NUM_SLOTS)
+
+/** A key unwrapped by boot_enc_load(), see boot_enc_cache_zeroize(). */
+struct boot_enc_key_cache {
+    /* Digest of the ENC TLV the key was unwrapped from. */
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint8_t key[BOOT_ENC_KEY_SIZE];
+    uint8_t valid;
+};
+#endif
+
 /** Private state maintained during boot. */
 struct boot_loader_state {
     struct {
@@ -259,6 +353,10 @@ struct boot_loader_state {
 
 #if defined(MCUBOOT_ENC_IMAGES)
     struct enc_key_data enc[BOOT_IMAGE_NUMBER][BOOT_NUM_SLOTS];
+#if defined(MCUBOOT_ENC_KEY_CACHE)
+    struct boot_enc_key_cache enc_cache[BOOT_ENC_KEY_CACHE_SIZE];
+    uint8_t enc_cache_next;
+#endif
 #endif
 
 #if (BOOT_IMAGE_NUMBER > 1)
@@ -281,6 +379,34 @@ struct boot_loader_state {
 #endif
     } slot_usage[BOOT_IMAGE_NUMBER];
 #endif /* MCUBOOT_DIRECT_XIP || MCUBOOT_RAM_LOAD */
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+    /* Set around the validation of each primary slot by boot_go(), for its
+     * signature to be collected instead of verified.
+     */
+    bool batch_verify;
+    struct {
+        bool pending;
+        uint8_t key_id;
+        uint8_t hash[IMAGE_HASH_SIZE];
+        uint8_t sig[BOOT_BATCH_SIG_SIZE];
+    } batch[BOOT_IMAGE_NUMBER];
+#endif
+
+#if defined(MCUBOOT_FLASH_ASYNC)
+    /* Erase running ahead of a copy, see boot_erase_region_for_copy(). */
+    struct bootutil_flash_job erase_job;
+    bool erase_queued;
+#endif
+
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    /* Trailers of the slots as read once per boot, see boot_snapshot_fill(). */
+    struct {
+        bool valid;
+        uint8_t swap_type;
+        struct boot_swap_state swap_state[BOOT_NUM_SLOTS];
+    } snapshot[BOOT_IMAGE_NUMBER];
+#endif
 };
 
 /* The function is intended for verification of image hash against
@@ -295,6 +421,39 @@ fih_ret bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig,
 fih_ret bootutil_verify_img(uint8_t *img, uint32_t size,
                             uint8_t *sig, size_t slen, uint8_t key_id);
 
+#if defined(MCUBOOT_SIGN_PURE_FROM_FLASH)
+/* The function is intended for direct verification of image against
+ * provided signature, when the image can only be accessed through
+ * flash_area_read(). The image starts at img_off in the flash area and
+ * is read in pieces of at most tmp_buf_sz bytes.
+ */
+fih_ret bootutil_verify_img_flash(const struct flash_area *fap, uint32_t img_off,
+                                  uint32_t size, uint8_t *tmp_buf,
+                                  uint32_t tmp_buf_sz, uint8_t *sig,
+                                  size_t slen, uint8_t key_id);
+#endif
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+/* Drop the signatures collected so far.  They are collected instead of
+ * verified while state->batch_verify is set.
+ */
+void bootutil_verify_sig_batch_start(struct boot_loader_state *state);
+
+/* Same checks as bootutil_verify_sig(), but the signature of the current
+ * image is only recorded, to be verified by
+ * bootutil_verify_sig_batch_finish().
+ */
+fih_ret bootutil_verify_sig_defer(struct boot_loader_state *state,
+                                  uint8_t *hash, uint32_t hlen, uint8_t *sig,
+                                  size_t slen, uint8_t key_id);
+
+/* Verify all the signatures recorded since bootutil_verify_sig_batch_start()
+ * at once. If that fails they are verified one by one, and the current image
+ * is set to the first one with an invalid signature.
+ */
+fih_ret bootutil_verify_sig_batch_finish(struct boot_loader_state *state);
+#endif
+
 fih_ret boot_fih_memequal(const void *s1, const void *s2, size_t n);
 
 const struct flash_area *boot_find_status(const struct boot_loader_state *state,
@@ -312,10 +471,45 @@ int boot_trailer_scramble_offset(const struct flash_area *fa, size_t alignment,
  */
 int boot_header_scramble_off_sz(const struct flash_area *fa, int slot, size_t *off,
                                 size_t *size);
+#if defined(MCUBOOT_IMAGE_EXTENT)
+/* Get size of the start of slot that holds its image, from the header to the
+ * end of the TLVs, aligned to device erase unit or write block.  Fails when
+ * the header of the image in the slot does not tell its size.
+ */
+int boot_image_scramble_sz(struct boot_loader_state *state, const struct flash_area *fa,
+                           int slot, size_t *size);
+#endif
 int boot_status_entries(int image_index, const struct flash_area *fap);
 uint32_t boot_status_off(const struct flash_area *fap);
 int boot_read_swap_state(const struct flash_area *fap,
                          struct boot_swap_state *state);
+/* Same as boot_swap_type_multi() and boot_read_swap_state() for the current
+ * image, from the snapshot of its trailers when there is one.
+ */
+int boot_snapshot_swap_type(struct boot_loader_state *state);
+int boot_snapshot_swap_state(struct boot_loader_state *state, int slot,
+                             struct boot_swap_state *swap_state);
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+/* The swap type that the trailers of the two slots of an image call for. */
+int boot_swap_type_decode(int image_index,
+                          const struct boot_swap_state *primary_slot,
+                          const struct boot_swap_state *secondary_slot);
+/* Read the trailers of the slots of the current image into its snapshot. */
+void boot_snapshot_fill(struct boot_loader_state *state);
+/* Drop the snapshot of an image, whose slots are about to be written. */
+void boot_snapshot_invalidate(struct boot_loader_state *state, int image_index);
+#else
+static inline void boot_snapshot_fill(struct boot_loader_state *state)
+{
+    (void)state;
+}
+static inline void boot_snapshot_invalidate(struct boot_loader_state *state,
+                                            int image_index)
+{
+    (void)state;
+    (void)image_index;
+}
+#endif
 int boot_write_magic(const struct flash_area *fap);
 int boot_write_status(const struct boot_loader_state *state, struct boot_status *bs);
 int boot_write_copy_done(const struct flash_area *fap);
@@ -323,6 +517,9 @@ int boot_write_image_ok(const struct flash_area *fap);
 int boot_write_swap_info(const struct flash_area *fap, uint8_t swap_type,
                          uint8_t image_num);
 int boot_write_swap_size(const struct flash_area *fap, uint32_t swap_size);
+int boot_write_trailer_info(const struct flash_area *fap, uint8_t swap_type,
+                            uint8_t image_num, bool image_ok,
+                            const struct boot_status *bs);
 int boot_write_trailer(const struct flash_area *fap, uint32_t off,
                        const uint8_t *inbuf, uint8_t inlen);
 int boot_write_trailer_flag(const struct flash_area *fap, uint32_t off,
@@ -347,13 +544,20 @@ int boot_copy_region(struct boot_loader_state *state,
  * do nothing on devices without erase requirement.
  */
 int boot_erase_region(const struct flash_area *fap, uint32_t off, uint32_t sz, bool backwards);
+/* Erase the destination of the boot_copy_region() from fap_src that follows,
+ * which waits for the erase if it runs in the background.
+ */
+int boot_erase_region_for_copy(struct boot_loader_state *state,
+                               const struct flash_area *fap, uint32_t off, uint32_t sz,
+                               const struct flash_area *fap_src);
 /* Similar to boot_erase_region but will always remove data */
 int boot_scramble_region(const struct flash_area *fap, uint32_t off, uint32_t sz, bool backwards);
-/* Makes slot unbootable, either by scrambling header magic, header sector
- * or entire slot, depending on settings.
+/* Makes slot unbootable, either by scrambling header magic, header sector,
+ * the image and trailer or entire slot, depending on settings.
  * Note: slot is passed here becuase at this point there is no function
  * matching flash_area object to slot */
-int boot_scramble_slot(const struct flash_area *fap, int slot);
+int boot_scramble_slot(struct boot_loader_state *state, const struct flash_area *fap,
+                       int slot);
 bool boot_status_is_reset(const struct boot_status *bs);
 
 #ifdef MCUBOOT_ENC_IMAGES
@@ -545,6 +749,18 @@ uint32_t bootutil_max_image_size(struct boot_loader_state *state, const struct f
 int boot_read_image_size(struct boot_loader_state *state, int slot,
                          uint32_t *size);
 
+#if defined(MCUBOOT_DELTA_IMAGES)
+/* Check that the delta image in the secondary slot applies to the primary
+ * slot, or that the image it builds is already complete.
+ */
+int boot_delta_check(struct boot_loader_state *state);
+/* Build the image of the delta image in the secondary slot unless it is
+ * already complete, and return where it is in the secondary slot.
+ */
+int boot_delta_apply(struct boot_loader_state *state, uint32_t *off,
+                     uint32_t *size);
+#endif
+
 /* Helper macro to avoid compile errors with systems that do not
  * provide function to check device type.
  * Note: it used to be inline, but somehow compiler would not
@@ -232,6 +232,7 @@ boot_read_flag(const struct flash_area *fap, uint8_t *flag, uint32_t off)
     return 0;
 }
 
+#if !defined(MCUBOOT_SLOT_SNAPSHOT)
 static inline int
 boot_read_copy_done(const struct flash_area *fap, uint8_t *copy_done)
 {
@@ -282,6 +283,70 @@ boot_read_swap_state(const struct flash_area *fap,
 
     return boot_read_image_ok(fap, &state->image_ok);
 }
+#else
+/* The trailer fields from swap_info up to the end of the magic, the part of
+ * the trailer that boot_read_swap_state() reads in one go when the boot takes
+ * the trailers from a snapshot.
+ */
+#define BOOT_SWAP_STATE_READ_SZ (4 * BOOT_MAX_ALIGN + BOOT_MAGIC_SZ)
+
+static uint8_t
+boot_swap_state_flag(const struct flash_area *fap, uint8_t flag)
+{
+    if (bootutil_buffer_is_erased(fap, &flag, sizeof flag)) {
+        return BOOT_FLAG_UNSET;
+    }
+    return boot_flag_decode(flag);
+}
+
+int
+boot_read_swap_state(const struct flash_area *fap,
+                     struct boot_swap_state *state)
+{
+    uint8_t buf[BOOT_SWAP_STATE_READ_SZ];
+    const uint8_t *magic;
+    uint32_t off;
+    uint32_t len;
+    uint8_t swap_info;
+    int rc;
+
+    off = boot_swap_info_off(fap);
+    len = flash_area_get_size(fap) - off;
+    assert(len <= sizeof buf);
+    if (len > sizeof buf) {
+        return BOOT_EFLASH;
+    }
+
+    rc = flash_area_read(fap, off, buf, len);
+    if (rc < 0) {
+        return BOOT_EFLASH;
+    }
+
+    magic = &buf[boot_magic_off(fap) - off];
+    if (bootutil_buffer_is_erased(fap, magic, BOOT_MAGIC_SZ)) {
+        state->magic = BOOT_MAGIC_UNSET;
+    } else {
+        state->magic = boot_magic_decode(magic);
+    }
+
+    swap_info = buf[0];
+
+    /* Extract the swap type and image number */
+    state->swap_type = BOOT_GET_SWAP_TYPE(swap_info);
+    state->image_num = BOOT_GET_IMAGE_NUM(swap_info);
+
+    if (bootutil_buffer_is_erased(fap, &swap_info, sizeof swap_info) ||
+            state->swap_type > BOOT_SWAP_TYPE_REVERT) {
+        state->swap_type = BOOT_SWAP_TYPE_NONE;
+        state->image_num = 0;
+    }
+
+    state->copy_done = boot_swap_state_flag(fap, buf[boot_copy_done_off(fap) - off]);
+    state->image_ok = boot_swap_state_flag(fap, buf[boot_image_ok_off(fap) - off]);
+
+    return 0;
+}
+#endif /* !MCUBOOT_SLOT_SNAPSHOT */
 
 int
 boot_read_swap_state_by_id(int flash_area_id, struct boot_swap_state *state)
@@ -421,6 +486,7 @@ boot_write_swap_info(const struct flash_area *fap, uint8_t swap_type,
     return boot_write_trailer(fap, off, (const uint8_t *) &swap_info, 1);
 }
 
+#if !defined(MCUBOOT_SLOT_SNAPSHOT)
 int
 boot_swap_type_multi(int image_index)
 {
@@ -490,6 +556,85 @@ boot_swap_type_multi(int image_index)
     BOOT_LOG_INF("Image index: %d, Swap type: none", image_index);
     return BOOT_SWAP_TYPE_NONE;
 }
+#else
+int
+boot_swap_type_decode(int image_index, const struct boot_swap_state *primary_slot,
+                      const struct boot_swap_state *secondary_slot)
+{
+    const struct boot_swap_table *table;
+    size_t i;
+
+    for (i = 0; i < BOOT_SWAP_TABLES_COUNT; i++) {
+        table = boot_swap_tables + i;
+
+        if (boot_magic_compatible_check(table->magic_primary_slot,
+                                        primary_slot->magic) &&
+            boot_magic_compatible_check(table->magic_secondary_slot,
+                                        secondary_slot->magic) &&
+            (table->image_ok_primary_slot == BOOT_FLAG_ANY   ||
+                table->image_ok_primary_slot == primary_slot->image_ok) &&
+            (table->image_ok_secondary_slot == BOOT_FLAG_ANY ||
+                table->image_ok_secondary_slot == secondary_slot->image_ok) &&
+            (table->copy_done_primary_slot == BOOT_FLAG_ANY  ||
+                table->copy_done_primary_slot == primary_slot->copy_done)
+#if defined(MCUBOOT_SWAP_USING_OFFSET)
+            && (table->copy_done_secondary_slot == BOOT_FLAG_ANY  ||
+                table->copy_done_secondary_slot == secondary_slot->copy_done)
+#endif
+            ) {
+            BOOT_LOG_INF("Image index: %d, Swap type: %s", image_index,
+                         table->swap_type == BOOT_SWAP_TYPE_TEST   ? "test"   :
+                         table->swap_type == BOOT_SWAP_TYPE_PERM   ? "perm"   :
+                         table->swap_type == BOOT_SWAP_TYPE_REVERT ? "revert" :
+                         "BUG; can't happen");
+            if (table->swap_type != BOOT_SWAP_TYPE_TEST &&
+                    table->swap_type != BOOT_SWAP_TYPE_PERM &&
+                    table->swap_type != BOOT_SWAP_TYPE_REVERT) {
+                return BOOT_SWAP_TYPE_PANIC;
+            }
+            return table->swap_type;
+        }
+    }
+
+    BOOT_LOG_INF("Image index: %d, Swap type: none", image_index);
+    return BOOT_SWAP_TYPE_NONE;
+}
+
+int
+boot_swap_type_multi(int image_index)
+{
+    struct boot_swap_state primary_slot;
+    struct boot_swap_state secondary_slot;
+    int rc;
+
+    rc = BOOT_HOOK_CALL(boot_read_swap_state_primary_slot_hook,
+                        BOOT_HOOK_REGULAR, image_index, &primary_slot);
+    if (rc == BOOT_HOOK_REGULAR)
+    {
+        rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_PRIMARY(image_index),
+                                        &primary_slot);
+    }
+    if (rc) {
+        return BOOT_SWAP_TYPE_PANIC;
+    }
+
+    rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_SECONDARY(image_index),
+                                    &secondary_slot);
+    if (rc == BOOT_EFLASH) {
+        BOOT_LOG_INF("Secondary image of image pair (%d.) "
+                     "is unreachable. Treat it as empty", image_index);
+        secondary_slot.magic = BOOT_MAGIC_UNSET;
+        secondary_slot.swap_type = BOOT_SWAP_TYPE_NONE;
+        secondary_slot.copy_done = BOOT_FLAG_UNSET;
+        secondary_slot.image_ok = BOOT_FLAG_UNSET;
+        secondary_slot.image_num = 0;
+    } else if (rc) {
+        return BOOT_SWAP_TYPE_PANIC;
+    }
+
+    return boot_swap_type_decode(image_index, &primary_slot, &secondary_slot);
+}
+#endif /* !MCUBOOT_SLOT_SNAPSHOT */
 
 int
 boot_write_copy_done(const struct flash_area *fap)
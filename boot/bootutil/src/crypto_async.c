@@ -0,0 +1,38 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Software execution of the asynchronous crypto jobs, see
+ * bootutil/crypto/async.h.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_CRYPTO_ASYNC)
+
+#include "bootutil/crypto/async.h"
+
+int
+bootutil_crypto_job_run(struct bootutil_crypto_job *job)
+{
+    switch (job->op) {
+    case BOOTUTIL_CRYPTO_JOB_SHA_UPDATE:
+        /* Not all backends return 0 on success, and an update can't fail. */
+        (void)bootutil_sha_update(job->u.sha, job->buf, job->len);
+        return 0;
+#if defined(MCUBOOT_ENC_IMAGES)
+    case BOOTUTIL_CRYPTO_JOB_AES_CTR:
+        /* Encryption and decryption are the same with CTR. */
+        return bootutil_aes_ctr_encrypt(job->u.aes.ctx, job->u.aes.counter,
+                                        job->buf, job->len,
+                                        job->u.aes.blk_off, job->buf);
+#endif
+    default:
+        return -1;
+    }
+}
+
+#endif /* MCUBOOT_CRYPTO_ASYNC */
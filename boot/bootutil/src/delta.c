@@ -0,0 +1,481 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Delta images (MCUBOOT_DELTA_IMAGES).
+ *
+ * A delta image has IMAGE_F_DELTA set and its payload is a patch from the
+ * image in the primary slot, the base, to a new image, the target.  Its
+ * protected TLVs hold the size and hash of both, whole images from the header
+ * to the end of the TLVs, so the delta image is signed for one base only.
+ *
+ * The patch is a list of records.  Each is a struct boot_delta_record followed
+ * by insert_len bytes, and adds copy_len bytes of the base from src_off and
+ * then these bytes to the target.
+ *
+ * The target is built in the secondary slot, from the first sector past the
+ * delta image, and it is then copied to the primary slot by the overwrite
+ * upgrade.  The primary slot is not written until the target is complete and
+ * its hash matches, so:
+ * - an interrupted build starts over, the base being still there;
+ * - an interrupted copy carries on from the target, found complete.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_DELTA_IMAGES)
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include "bootutil/bootutil.h"
+#include "bootutil/image.h"
+#include "bootutil/crypto/sha.h"
+#include "bootutil_priv.h"
+#include "bootutil/bootutil_log.h"
+
+BOOT_LOG_MODULE_DECLARE(mcuboot);
+
+#define BOOT_DELTA_BUF_SZ   256
+
+struct boot_delta_record {
+    uint32_t src_off;
+    uint32_t copy_len;
+    uint32_t insert_len;
+};
+
+/* Payload of IMAGE_TLV_DELTA_BASE and IMAGE_TLV_DELTA_TARGET. */
+struct boot_delta_image {
+    uint32_t size;
+    uint8_t hash[IMAGE_HASH_SIZE];
+};
+
+/* The target as it is being written, one buffer at a time. */
+struct boot_delta_out {
+    const struct flash_area *fap;
+    uint32_t off;
+    uint32_t size;
+    uint32_t done;
+    uint32_t fill;
+    uint8_t buf[BOOT_DELTA_BUF_SZ];
+};
+
+static int
+boot_delta_read_tlv(const struct image_header *hdr, const struct flash_area *fap,
+                    uint16_t type, struct boot_delta_image *image)
+{
+    struct image_tlv_iter it;
+    uint32_t off;
+    uint16_t len;
+    int rc;
+
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, type, true);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc != 0 || len != sizeof(*image)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (flash_area_read(fap, off, image, sizeof(*image)) != 0) {
+        return BOOT_EFLASH;
+    }
+
+    return 0;
+}
+
+/*
+ * Tell whether the size bytes from off in fap hash to image->hash.
+ */
+static bool
+boot_delta_hash_matches(const struct flash_area *fap, uint32_t off,
+                        const struct boot_delta_image *image)
+{
+    bootutil_sha_context sha_ctx;
+    uint8_t buf[BOOT_DELTA_BUF_SZ];
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint32_t done;
+    uint32_t len;
+    bool match = false;
+
+    if (off > flash_area_get_size(fap) ||
+        image->size > flash_area_get_size(fap) - off) {
+        return false;
+    }
+
+    bootutil_sha_init(&sha_ctx);
+    for (done = 0; done < image->size; done += len) {
+        len = image->size - done;
+        if (len > sizeof(buf)) {
+            len = sizeof(buf);
+        }
+        if (flash_area_read(fap, off + done, buf, len) != 0) {
+            goto out;
+        }
+        bootutil_sha_update(&sha_ctx, buf, len);
+    }
+    bootutil_sha_finish(&sha_ctx, hash);
+    match = (memcmp(hash, image->hash, sizeof(hash)) == 0);
+
+out:
+    bootutil_sha_drop(&sha_ctx);
+    return match;
+}
+
+/*
+ * Find where the target goes in the secondary slot: from the first sector
+ * past the delta image, and up to the sector that holds the trailer.  Returns
+ * the offset and the size of the sectors to erase for it.
+ */
+static int
+boot_delta_target_area(struct boot_loader_state *state, uint32_t target_size,
+                       uint32_t *off, uint32_t *erase_sz)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    size_t sect_count = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT);
+    uint32_t trailer_off = boot_status_off(fap);
+    uint32_t delta_size;
+    uint32_t sect_off;
+    uint32_t sect_end;
+    uint32_t start = 0;
+    bool found = false;
+    size_t sect;
+
+    if (boot_read_image_size(state, BOOT_SECONDARY_SLOT, &delta_size) != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    for (sect = 0; sect < sect_count; sect++) {
+        sect_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, sect);
+        sect_end = sect_off + boot_img_sector_size(state, BOOT_SECONDARY_SLOT, sect);
+        if (sect_end > trailer_off) {
+            break;
+        }
+        if (!found && sect_off >= delta_size) {
+            start = sect_off;
+            found = true;
+        }
+        if (found && sect_end - start >= target_size) {
+            *off = start;
+            *erase_sz = sect_end - start;
+            return 0;
+        }
+    }
+
+    BOOT_LOG_ERR("Image %d no room for the target of the delta image",
+                 BOOT_CURR_IMG(state));
+
+    return BOOT_EBADIMAGE;
+}
+
+static int
+boot_delta_flush(struct boot_delta_out *out)
+{
+    uint32_t align = flash_area_align(out->fap);
+    uint32_t len = out->fill;
+    int rc;
+
+    if (len % align != 0) {
+        memset(&out->buf[len], flash_area_erased_val(out->fap), align - len % align);
+        len += align - len % align;
+    }
+
+    rc = flash_area_write(out->fap, out->off + out->done, out->buf, len);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    out->done += out->fill;
+    out->fill = 0;
+
+    return 0;
+}
+
+/*
+ * Add len bytes from off in fap to the target.
+ */
+static int
+boot_delta_put(struct boot_delta_out *out, const struct flash_area *fap,
+               uint32_t off, uint32_t len)
+{
+    uint32_t chunk;
+    int rc;
+
+    if (len > out->size - out->done - out->fill) {
+        return BOOT_EBADIMAGE;
+    }
+
+    while (len > 0) {
+        chunk = sizeof(out->buf) - out->fill;
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        rc = flash_area_read(fap, off, &out->buf[out->fill], chunk);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+        out->fill += chunk;
+        off += chunk;
+        len -= chunk;
+
+        if (out->fill == sizeof(out->buf)) {
+            rc = boot_delta_flush(out);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Run the patch of the delta image against the base in the primary slot.
+ */
+static int
+boot_delta_build(struct boot_loader_state *state, const struct boot_delta_image *base,
+                 struct boot_delta_out *out)
+{
+    const struct flash_area *fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    const struct flash_area *fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    const struct image_header *hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    struct boot_delta_record rec;
+    uint32_t off = hdr->ih_hdr_size;
+    uint32_t end = hdr->ih_hdr_size + hdr->ih_img_size;
+    int rc;
+
+    if (base->size > flash_area_get_size(fap_pri) ||
+        sizeof(out->buf) % flash_area_align(out->fap) != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    while (off < end) {
+        if (end - off < sizeof(rec)) {
+            return BOOT_EBADIMAGE;
+        }
+        rc = flash_area_read(fap_sec, off, &rec, sizeof(rec));
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+        off += sizeof(rec);
+
+        if (rec.copy_len > base->size || rec.src_off > base->size - rec.copy_len ||
+            rec.insert_len > end - off) {
+            return BOOT_EBADIMAGE;
+        }
+
+        rc = boot_delta_put(out, fap_pri, rec.src_off, rec.copy_len);
+        if (rc == 0) {
+            rc = boot_delta_put(out, fap_sec, off, rec.insert_len);
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        off += rec.insert_len;
+    }
+
+    if (out->done + out->fill != out->size) {
+        return BOOT_EBADIMAGE;
+    }
+
+    return out->fill != 0 ? boot_delta_flush(out) : 0;
+}
+
+/*
+ * Read the security counter of the target of size bytes at off in fap from its
+ * protected TLVs.  Returns 1 when it has none.
+ */
+static int
+boot_delta_target_sec_cnt(const struct flash_area *fap, uint32_t off, uint32_t size,
+                          const struct image_header *hdr, uint32_t *cnt)
+{
+    struct image_tlv_info info;
+    struct image_tlv tlv;
+    uint32_t tlv_off;
+    uint32_t end;
+
+    if (hdr->ih_protect_tlv_size == 0) {
+        return 1;
+    }
+
+    tlv_off = hdr->ih_hdr_size + hdr->ih_img_size;
+    if (tlv_off > size || hdr->ih_protect_tlv_size > size - tlv_off ||
+        hdr->ih_protect_tlv_size < sizeof(info)) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (flash_area_read(fap, off + tlv_off, &info, sizeof(info)) != 0) {
+        return BOOT_EFLASH;
+    }
+    if (info.it_magic != IMAGE_TLV_PROT_INFO_MAGIC ||
+        info.it_tlv_tot != hdr->ih_protect_tlv_size) {
+        return BOOT_EBADIMAGE;
+    }
+
+    end = tlv_off + info.it_tlv_tot;
+    for (tlv_off += sizeof(info); end - tlv_off >= sizeof(tlv); tlv_off += tlv.it_len) {
+        if (flash_area_read(fap, off + tlv_off, &tlv, sizeof(tlv)) != 0) {
+            return BOOT_EFLASH;
+        }
+        tlv_off += sizeof(tlv);
+        if (tlv.it_len > end - tlv_off) {
+            return BOOT_EBADIMAGE;
+        }
+
+        if (tlv.it_type == IMAGE_TLV_SEC_CNT) {
+            if (tlv.it_len != sizeof(*cnt)) {
+                return BOOT_EBADIMAGE;
+            }
+            if (flash_area_read(fap, off + tlv_off, cnt, sizeof(*cnt)) != 0) {
+                return BOOT_EFLASH;
+            }
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * The downgrade prevention and the security counter update go by the header
+ * and TLVs of the delta image, so the target built at off must have the same
+ * version and security counter.
+ */
+static int
+boot_delta_target_check(struct boot_loader_state *state, uint32_t off, uint32_t size)
+{
+    const struct flash_area *fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    const struct image_header *hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    struct image_header target_hdr;
+    uint32_t target_cnt;
+    uint32_t cnt;
+    int target_rc;
+    int rc;
+
+    if (size < sizeof(target_hdr) ||
+        flash_area_read(fap_sec, off, &target_hdr, sizeof(target_hdr)) != 0) {
+        return BOOT_EBADIMAGE;
+    }
+
+    if (target_hdr.ih_magic != IMAGE_MAGIC ||
+        memcmp(&target_hdr.ih_ver, &hdr->ih_ver, sizeof(hdr->ih_ver)) != 0) {
+        BOOT_LOG_ERR("Image %d delta image target version mismatch",
+                     BOOT_CURR_IMG(state));
+        return BOOT_EBADIMAGE;
+    }
+
+    rc = bootutil_get_img_security_cnt(state, BOOT_SECONDARY_SLOT, fap_sec, &cnt);
+    target_rc = boot_delta_target_sec_cnt(fap_sec, off, size, &target_hdr, &target_cnt);
+    if (target_rc < 0) {
+        return target_rc;
+    }
+
+    if ((rc == 0) != (target_rc == 0) || (rc == 0 && cnt != target_cnt)) {
+        BOOT_LOG_ERR("Image %d delta image target security counter mismatch",
+                     BOOT_CURR_IMG(state));
+        return BOOT_EBADIMAGE;
+    }
+
+    return 0;
+}
+
+int
+boot_delta_check(struct boot_loader_state *state)
+{
+    const struct flash_area *fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    const struct flash_area *fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    const struct image_header *hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    struct boot_delta_image base;
+    struct boot_delta_image target;
+    uint32_t off;
+    uint32_t erase_sz;
+    int rc;
+
+    rc = boot_delta_read_tlv(hdr, fap_sec, IMAGE_TLV_DELTA_BASE, &base);
+    if (rc == 0) {
+        rc = boot_delta_read_tlv(hdr, fap_sec, IMAGE_TLV_DELTA_TARGET, &target);
+    }
+    if (rc == 0) {
+        rc = boot_delta_target_area(state, target.size, &off, &erase_sz);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (boot_delta_hash_matches(fap_pri, 0, &base)) {
+        return 0;
+    }
+    if (boot_delta_hash_matches(fap_sec, off, &target)) {
+        return boot_delta_target_check(state, off, target.size);
+    }
+
+    BOOT_LOG_ERR("Image %d delta image does not apply to the primary slot",
+                 BOOT_CURR_IMG(state));
+
+    return BOOT_EBADIMAGE;
+}
+
+int
+boot_delta_apply(struct boot_loader_state *state, uint32_t *off, uint32_t *size)
+{
+    const struct flash_area *fap_sec = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    const struct image_header *hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
+    struct boot_delta_image base;
+    struct boot_delta_image target;
+    struct boot_delta_out out;
+    uint32_t erase_sz;
+    int rc;
+
+    rc = boot_delta_read_tlv(hdr, fap_sec, IMAGE_TLV_DELTA_BASE, &base);
+    if (rc == 0) {
+        rc = boot_delta_read_tlv(hdr, fap_sec, IMAGE_TLV_DELTA_TARGET, &target);
+    }
+    if (rc == 0) {
+        rc = boot_delta_target_area(state, target.size, off, &erase_sz);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+    *size = target.size;
+
+    if (boot_delta_hash_matches(fap_sec, *off, &target)) {
+        BOOT_LOG_INF("Image %d delta image target already built",
+                     BOOT_CURR_IMG(state));
+        return boot_delta_target_check(state, *off, target.size);
+    }
+
+    BOOT_LOG_INF("Image %d building the target of the delta image: 0x%lx bytes",
+                 BOOT_CURR_IMG(state), (unsigned long)target.size);
+
+    rc = boot_erase_region(fap_sec, *off, erase_sz, false);
+    if (rc != 0) {
+        return BOOT_EFLASH;
+    }
+
+    out.fap = fap_sec;
+    out.off = *off;
+    out.size = target.size;
+    out.done = 0;
+    out.fill = 0;
+    rc = boot_delta_build(state, &base, &out);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (!boot_delta_hash_matches(fap_sec, *off, &target)) {
+        BOOT_LOG_ERR("Image %d delta image target hash mismatch",
+                     BOOT_CURR_IMG(state));
+        return BOOT_EBADIMAGE;
+    }
+
+    return boot_delta_target_check(state, *off, target.size);
+}
+
+#endif /* MCUBOOT_DELTA_IMAGES */
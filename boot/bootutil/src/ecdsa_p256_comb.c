@@ -0,0 +1,275 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * ECDSA P-256 verification using precomputed comb tables for both the
+ * generator and the public key, see bootutil/crypto/ecdsa_p256_comb.h.
+ */
+
+#include <string.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_ECDSA_P256_COMB)
+
+#if !defined(MCUBOOT_SIGN_EC256) || !defined(MCUBOOT_USE_TINYCRYPT)
+#error "MCUBOOT_ECDSA_P256_COMB requires ECDSA P-256 with tinycrypt"
+#endif
+#if defined(MCUBOOT_HW_KEY) || defined(MCUBOOT_BUILTIN_KEY)
+#error "MCUBOOT_ECDSA_P256_COMB requires the public keys to be built in"
+#endif
+
+#include "bootutil/sign_key.h"
+#include "bootutil/crypto/ecdsa_p256_comb.h"
+
+/*
+ * Comb table of the P-256 generator, in the layout of the tables emitted by
+ * `imgtool getpub -e lang-c-comb` (see p256_comb_table() in imgtool).
+ */
+static const uECC_word_t comb_g[BOOTUTIL_ECDSA_P256_COMB_POINTS][2 * NUM_ECC_WORDS] = {
+    /*  1 */ {
+        0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+        0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2,
+        0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+        0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2,
+    },
+    /*  2 */ {
+        0x8e14db63, 0x90e75cb4, 0xad651f7e, 0x29493baa,
+        0x326e25de, 0x8492592e, 0x2811aaa5, 0x0fa822bc,
+        0x5f462ee7, 0xe4112454, 0x50fe82f5, 0x34b1a650,
+        0xb3df188b, 0x6f4ad4bc, 0xf5dba80d, 0xbff44ae8,
+    },
+    /*  3 */ {
+        0x097992af, 0x93391ce2, 0x0d35f1fa, 0xe96c98fd,
+        0x95e02789, 0xb257c0de, 0x89d6726f, 0x300a4bbc,
+        0xc08127a0, 0xaa54a291, 0xa9d806a5, 0x5bb1eead,
+        0xff1e3c6f, 0x7f1ddb25, 0xd09b4644, 0x72aac7e0,
+    },
+    /*  4 */ {
+        0xd789bd85, 0x57c84fc9, 0xc297eac3, 0xfc35ff7d,
+        0x88c6766e, 0xfb982fd5, 0xeedb5e67, 0x447d739b,
+        0x72e25b32, 0x0c7e33c9, 0xa7fae500, 0x3d349b95,
+        0x3a4aaff7, 0xe12e9d95, 0x834131ee, 0x2d4825ab,
+    },
+    /*  5 */ {
+        0x2a1d367f, 0x13949c93, 0x1a0a11b7, 0xef7fbd2b,
+        0xb91dfc60, 0xddc6068b, 0x8a9c72ff, 0xef951932,
+        0x7376d8a8, 0x196035a7, 0x95ca1740, 0x23183b08,
+        0x022c219c, 0xc1ee9807, 0x7dbb2c9b, 0x611e9fc3,
+    },
+    /*  6 */ {
+        0x0b57f4bc, 0xcae2b192, 0xc6c9bc36, 0x2936df5e,
+        0xe11238bf, 0x7dea6482, 0x7b51f5d8, 0x55066379,
+        0x348a964c, 0x44ffe216, 0xdbdefbe1, 0x9fb3d576,
+        0x8d9d50e5, 0x0afa4001, 0x8aecb851, 0x15716484,
+    },
+    /*  7 */ {
+        0xfc5cde01, 0xe48ecaff, 0x0d715f26, 0x7ccd84e7,
+        0xf43e4391, 0xa2e8f483, 0xb21141ea, 0xeb5d7745,
+        0x731a3479, 0xcac917e2, 0x2844b645, 0x85f22cfe,
+        0x58006cee, 0x0990e6a1, 0xdbecc17b, 0xeafd72eb,
+    },
+    /*  8 */ {
+        0x313728be, 0x6cf20ffb, 0xa3c6b94a, 0x96439591,
+        0x44315fc5, 0x2736ff83, 0xa7849276, 0xa6d39677,
+        0xc357f5f4, 0xf2bab833, 0x2284059b, 0x824a920c,
+        0x2d27ecdf, 0x66b8babd, 0x9b0b8816, 0x674f8474,
+    },
+    /*  9 */ {
+        0x677c8a3e, 0x2df48c04, 0x0203a56b, 0x74e02f08,
+        0xb8c7fedb, 0x31855f7d, 0x72c9ddad, 0x4e769e76,
+        0xb824bbb0, 0xa4c36165, 0x3b9122a5, 0xfb9ae16f,
+        0x06947281, 0x1ec00572, 0xde830663, 0x42b99082,
+    },
+    /* 10 */ {
+        0xdda868b9, 0x6ef95150, 0x9c0ce131, 0xd1f89e79,
+        0x08a1c478, 0x7fdc1ca0, 0x1c6ce04d, 0x78878ef6,
+        0x1fe0d976, 0x9c62b912, 0xbde08d4f, 0x6ace570e,
+        0x12309def, 0xde53142c, 0x7b72c321, 0xb6cb3f5d,
+    },
+    /* 11 */ {
+        0xc31a3573, 0x7f991ed2, 0xd54fb496, 0x5b82dd5b,
+        0x812ffcae, 0x595c5220, 0x716b1287, 0x0c88bc4d,
+        0x5f48aca8, 0x3a57bf63, 0xdf2564f3, 0x7c8181f4,
+        0x9c04e6aa, 0x18d1b5b3, 0xf3901dc6, 0xdd5ddea3,
+    },
+    /* 12 */ {
+        0x3e72ad0c, 0xe96a79fb, 0x42ba792f, 0x43a0a28c,
+        0x083e49f3, 0xefe0a423, 0x6b317466, 0x68f344af,
+        0x3fb24d4a, 0xcdfe17db, 0x71f5c626, 0x668bfc22,
+        0x24d67ff3, 0x604ed93c, 0xf8540a20, 0x31b9c405,
+    },
+    /* 13 */ {
+        0xa2582e7f, 0xd36b4789, 0x4ec39c28, 0x0d1a1014,
+        0xedbad7a0, 0x663c62c3, 0x6f461db9, 0x4052bf4b,
+        0x188d25eb, 0x235a27c3, 0x99bfcc5b, 0xe724f339,
+        0x71d70cc8, 0x862be6bd, 0x90b0fc61, 0xfecf4d51,
+    },
+    /* 14 */ {
+        0xa1d4cfac, 0x74346c10, 0x8526a7a4, 0xafdf5cc0,
+        0xf62bff7a, 0x123202a8, 0xc802e41a, 0x1eddbae2,
+        0xd603f844, 0x8fa0af2d, 0x4c701917, 0x36e06b7e,
+        0x73db33a0, 0x0c45f452, 0x560ebcfc, 0x43104d86,
+    },
+    /* 15 */ {
+        0x0d1d78e5, 0x9615b511, 0x25c4744b, 0x66b0de32,
+        0x6aaf363a, 0x0a4a46fb, 0x84f7a21c, 0xb48e26b4,
+        0x21a01b2d, 0x06ebb0f6, 0x8b7b0f98, 0xc004e404,
+        0xfed6f668, 0x64131bcd, 0x4d4d3dab, 0xfac01540,
+    },
+};
+
+/* State of the running sum of the comb evaluation, in Jacobian coordinates. */
+struct comb_sum {
+    uECC_word_t x[NUM_ECC_WORDS];
+    uECC_word_t y[NUM_ECC_WORDS];
+    uECC_word_t z[NUM_ECC_WORDS];
+    int empty;
+};
+
+/* Gather the bits of one comb column of a scalar into a table index. */
+static unsigned int comb_index(const uECC_word_t *scalar, bitcount_t column)
+{
+    unsigned int index = 0;
+    int tooth;
+
+    for (tooth = BOOTUTIL_ECDSA_P256_COMB_TEETH - 1; tooth >= 0; tooth--) {
+        index = (index << 1) |
+                !!uECC_vli_testBit(scalar,
+                                   column + tooth * BOOTUTIL_ECDSA_P256_COMB_SPACING);
+    }
+
+    return index;
+}
+
+/*
+ * Add an affine point from a table to the sum.  Like uECC_verify(), this uses
+ * a co-Z addition, which does not handle the sum being equal to (or the
+ * negation of) the added point; for valid signatures that happens with
+ * negligible probability, and it can only make verification fail.
+ */
+static void comb_add(struct comb_sum *sum,
+                     const uECC_word_t (*table)[2 * NUM_ECC_WORDS],
+                     unsigned int index, uECC_Curve curve)
+{
+    uECC_word_t tx[NUM_ECC_WORDS];
+    uECC_word_t ty[NUM_ECC_WORDS];
+    uECC_word_t tz[NUM_ECC_WORDS];
+    const uECC_word_t *point;
+
+    if (index == 0) {
+        return;
+    }
+    point = table[index - 1];
+
+    if (sum->empty) {
+        uECC_vli_set(sum->x, point, NUM_ECC_WORDS);
+        uECC_vli_set(sum->y, point + NUM_ECC_WORDS, NUM_ECC_WORDS);
+        uECC_vli_clear(sum->z, NUM_ECC_WORDS);
+        sum->z[0] = 1;
+        sum->empty = 0;
+        return;
+    }
+
+    uECC_vli_set(tx, point, NUM_ECC_WORDS);
+    uECC_vli_set(ty, point + NUM_ECC_WORDS, NUM_ECC_WORDS);
+    apply_z(tx, ty, sum->z, curve);
+    uECC_vli_modSub(tz, sum->x, tx, curve->p, NUM_ECC_WORDS); /* Z = x2 - x1 */
+    XYcZ_add(tx, ty, sum->x, sum->y, curve);
+    uECC_vli_modMult_fast(sum->z, sum->z, tz, curve);
+}
+
+const struct bootutil_ecdsa_p256_comb *
+bootutil_ecdsa_p256_comb_find(uint8_t key_id)
+{
+    const struct bootutil_ecdsa_p256_comb *comb;
+    unsigned int len;
+    const uint8_t *key;
+
+    if (key_id >= bootutil_key_cnt) {
+        return NULL;
+    }
+    comb = bootutil_ecdsa_p256_combs[key_id];
+    if (comb == NULL) {
+        return NULL;
+    }
+
+    /*
+     * The uncompressed point is at the end of the SubjectPublicKeyInfo, so
+     * checking that the table belongs to the key needs no ASN.1 parsing.
+     */
+    key = bootutil_keys[key_id].key;
+    len = *bootutil_keys[key_id].len;
+    if (len < sizeof(comb->pubkey) + 1 ||
+        key[len - sizeof(comb->pubkey) - 1] != 0x04 ||
+        memcmp(&key[len - sizeof(comb->pubkey)], comb->pubkey,
+               sizeof(comb->pubkey)) != 0) {
+        return NULL;
+    }
+
+    return comb;
+}
+
+int bootutil_ecdsa_p256_comb_verify(const struct bootutil_ecdsa_p256_comb *comb,
+                                    const uint8_t *hash,
+                                    const uint8_t *signature)
+{
+    uECC_Curve curve = uECC_secp256r1();
+    uECC_word_t r[NUM_ECC_WORDS];
+    uECC_word_t s[NUM_ECC_WORDS];
+    uECC_word_t u1[NUM_ECC_WORDS];
+    uECC_word_t u2[NUM_ECC_WORDS];
+    uECC_word_t z[NUM_ECC_WORDS];
+    struct comb_sum sum;
+    bitcount_t column;
+
+    uECC_vli_bytesToNative(r, signature, NUM_ECC_BYTES);
+    uECC_vli_bytesToNative(s, signature + NUM_ECC_BYTES, NUM_ECC_BYTES);
+
+    /* r, s must be in [1, n - 1]. */
+    if (uECC_vli_isZero(r, NUM_ECC_WORDS) || uECC_vli_isZero(s, NUM_ECC_WORDS)) {
+        return -1;
+    }
+    if (uECC_vli_cmp_unsafe(curve->n, r, NUM_ECC_WORDS) != 1 ||
+        uECC_vli_cmp_unsafe(curve->n, s, NUM_ECC_WORDS) != 1) {
+        return -1;
+    }
+
+    /* u1 = e / s, u2 = r / s */
+    uECC_vli_modInv(z, s, curve->n, NUM_ECC_WORDS);
+    uECC_vli_bytesToNative(u1, hash, NUM_ECC_BYTES);
+    if (uECC_vli_cmp_unsafe(curve->n, u1, NUM_ECC_WORDS) != 1) {
+        uECC_vli_sub(u1, u1, curve->n, NUM_ECC_WORDS);
+    }
+    uECC_vli_modMult(u1, u1, z, curve->n, NUM_ECC_WORDS);
+    uECC_vli_modMult(u2, r, z, curve->n, NUM_ECC_WORDS);
+
+    /* u1 * G + u2 * Q, both combs sharing the doublings. */
+    sum.empty = 1;
+    for (column = BOOTUTIL_ECDSA_P256_COMB_SPACING - 1; column >= 0; column--) {
+        if (!sum.empty) {
+            curve->double_jacobian(sum.x, sum.y, sum.z, curve);
+        }
+        comb_add(&sum, comb_g, comb_index(u1, column), curve);
+        comb_add(&sum, comb->points, comb_index(u2, column), curve);
+    }
+    if (sum.empty) {
+        return -1;
+    }
+
+    uECC_vli_modInv(z, sum.z, curve->p, NUM_ECC_WORDS);
+    apply_z(sum.x, sum.y, z, curve);
+
+    /* v = x1 (mod n) */
+    if (uECC_vli_cmp_unsafe(curve->n, sum.x, NUM_ECC_WORDS) != 1) {
+        uECC_vli_sub(sum.x, sum.x, curve->n, NUM_ECC_WORDS);
+    }
+
+    /* Accept only if v == r. */
+    return uECC_vli_equal(sum.x, r, NUM_ECC_WORDS) == 0 ? 0 : -1;
+}
+
+#endif /* MCUBOOT_ECDSA_P256_COMB */
@@ -336,6 +336,16 @@ error:
     bootutil_hmac_sha256_drop(&hmac);
     return -1;
 }
+
+#if defined(__BOOTSIM__)
+/* Only for the simulator, which times hkdf() on its own. */
+int
+bootutil_sim_hkdf(uint8_t *ikm, uint16_t ikm_len, uint8_t *info,
+                  uint16_t info_len, uint8_t *okm, uint16_t *okm_len)
+{
+    return hkdf(ikm, ikm_len, info, info_len, okm, okm_len);
+}
+#endif
 #endif /* MCUBOOT_ENCRYPT_EC256 || MCUBOOT_ENCRYPT_X25519 */
 
 #if !defined(MCUBOOT_ENC_BUILTIN_KEY)
@@ -582,6 +592,88 @@ boot_decrypt_key(const uint8_t *buf, uint8_t *enckey)
 }
 #endif /* CONFIG_BOOT_ED25519_PSA */
 
+#if defined(MCUBOOT_ENC_KEY_CACHE)
+/*
+ * The keys unwrapped during a boot are kept in the state along with the
+ * digest of the ENC TLV they come from.  Loading the same TLV again, as done
+ * for every image in each pass of a multi-image boot or when a swap resumes,
+ * then skips the key exchange.
+ */
+static void
+boot_enc_cache_digest(const uint8_t *buf, uint8_t *digest)
+{
+    bootutil_sha_context sha;
+
+    bootutil_sha_init(&sha);
+    bootutil_sha_update(&sha, buf, BOOT_ENC_TLV_SIZE);
+    bootutil_sha_finish(&sha, digest);
+    bootutil_sha_drop(&sha);
+}
+
+/*
+ * Copy the cached key of the TLV digest to enckey, returns 0 if there is one.
+ * Every entry is compared in full, whether it matches or not.
+ */
+static int
+boot_enc_cache_get(struct boot_loader_state *state, const uint8_t *digest,
+                   uint8_t *enckey)
+{
+    struct boot_enc_key_cache *entry;
+    uint8_t diff;
+    int found = -1;
+    int i;
+    int j;
+
+    for (i = 0; i < BOOT_ENC_KEY_CACHE_SIZE; i++) {
+        entry = &state->enc_cache[i];
+        diff = entry->valid ^ 1;
+        for (j = 0; j < IMAGE_HASH_SIZE; j++) {
+            diff |= entry->digest[j] ^ digest[j];
+        }
+        if (diff == 0) {
+            found = i;
+        }
+    }
+
+    if (found < 0) {
+        return -1;
+    }
+
+    memcpy(enckey, state->enc_cache[found].key, BOOT_ENC_KEY_SIZE);
+
+    return 0;
+}
+
+static void
+boot_enc_cache_put(struct boot_loader_state *state, const uint8_t *digest,
+                   const uint8_t *enckey)
+{
+    struct boot_enc_key_cache *entry;
+
+    entry = &state->enc_cache[state->enc_cache_next];
+    state->enc_cache_next = (state->enc_cache_next + 1) % BOOT_ENC_KEY_CACHE_SIZE;
+
+    memcpy(entry->digest, digest, IMAGE_HASH_SIZE);
+    memcpy(entry->key, enckey, BOOT_ENC_KEY_SIZE);
+    entry->valid = 1;
+}
+
+/**
+ * Clears the keys cached by boot_enc_load(), at the end of the boot.
+ */
+void
+boot_enc_cache_zeroize(struct boot_loader_state *state)
+{
+    volatile uint8_t *p = (volatile uint8_t *)state->enc_cache;
+    size_t i;
+
+    for (i = 0; i < sizeof(state->enc_cache); i++) {
+        p[i] = 0;
+    }
+    state->enc_cache_next = 0;
+}
+#endif
+
 /*
  * Load encryption key.
  */
@@ -602,6 +694,9 @@ boot_enc_load(struct boot_loader_state *state, int slot,
     uint8_t *buf;
 #else
     uint8_t buf[BOOT_ENC_TLV_SIZE];
+#endif
+#if defined(MCUBOOT_ENC_KEY_CACHE)
+    uint8_t digest[IMAGE_HASH_SIZE];
 #endif
     int rc;
 
@@ -648,7 +743,22 @@ boot_enc_load(struct boot_loader_state *state, int slot,
         return -1;
     }
 
+#if defined(MCUBOOT_ENC_KEY_CACHE)
+    boot_enc_cache_digest(buf, digest);
+    if (boot_enc_cache_get(state, digest, bs->enckey[slot]) == 0) {
+        BOOT_LOG_DBG("boot_enc_load: cached key");
+        return 0;
+    }
+
+    rc = boot_decrypt_key(buf, bs->enckey[slot]);
+    if (rc == 0) {
+        boot_enc_cache_put(state, digest, bs->enckey[slot]);
+    }
+
+    return rc;
+#else
     return boot_decrypt_key(buf, bs->enckey[slot]);
+#endif
 }
 
 int
@@ -735,6 +845,35 @@ boot_enc_decrypt(struct enc_key_data *enc_state, int slot, uint32_t off,
     bootutil_aes_ctr_decrypt(&enc->aes_ctr, nonce, buf, sz, blk_off, buf);
 }
 
+#if defined(MCUBOOT_CRYPTO_ASYNC)
+/*
+ * Set up job to encrypt or decrypt, which is the same with AES-CTR, like
+ * boot_enc_encrypt() and boot_enc_decrypt().
+ */
+void
+boot_enc_job(struct enc_key_data *enc_state, int slot, uint32_t off,
+             uint32_t sz, uint32_t blk_off, uint8_t *buf,
+             struct bootutil_crypto_job *job)
+{
+    struct enc_key_data *enc = &enc_state[slot];
+    uint8_t *nonce = job->u.aes.counter;
+
+    memset(nonce, 0, 12);
+    off >>= 4;
+    nonce[12] = (uint8_t)(off >> 24);
+    nonce[13] = (uint8_t)(off >> 16);
+    nonce[14] = (uint8_t)(off >> 8);
+    nonce[15] = (uint8_t)off;
+
+    assert(enc->valid == 1);
+    job->op = BOOTUTIL_CRYPTO_JOB_AES_CTR;
+    job->buf = buf;
+    job->len = sz;
+    job->u.aes.ctx = &enc->aes_ctr;
+    job->u.aes.blk_off = blk_off;
+}
+#endif
+
 /**
  * Clears encrypted state after use.
  */
@@ -0,0 +1,32 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Software execution of the asynchronous flash jobs, see
+ * bootutil/flash_async.h.
+ */
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_FLASH_ASYNC)
+
+#include "bootutil/flash_async.h"
+#include "bootutil_priv.h"
+
+int
+bootutil_flash_job_run(struct bootutil_flash_job *job)
+{
+    switch (job->op) {
+    case BOOTUTIL_FLASH_JOB_ERASE:
+        return boot_erase_region(job->fa, job->off, job->len, false);
+    case BOOTUTIL_FLASH_JOB_WRITE:
+        return flash_area_write(job->fa, job->off, job->buf, job->len);
+    default:
+        return -1;
+    }
+}
+
+#endif /* MCUBOOT_FLASH_ASYNC */
@@ -0,0 +1,191 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * Tree hash of an image, see bootutil/hash_tree.h.
+ */
+
+#include <string.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_HASH_TREE)
+
+#if defined(MCUBOOT_SIGN_PURE)
+#error "MCUBOOT_HASH_TREE requires a signature over the image hash"
+#endif
+
+#include "bootutil/hash_tree.h"
+#include "bootutil_priv.h"
+
+#define HASH_TREE_LEAF      0x00
+#define HASH_TREE_NODE      0x01
+#define HASH_TREE_ROOT      0x02
+
+/* out = H(0x01 || left || right), out may be right. */
+static void
+hash_tree_node(const uint8_t *left, const uint8_t *right, uint8_t *out)
+{
+    bootutil_sha_context ctx;
+    const uint8_t prefix = HASH_TREE_NODE;
+
+    bootutil_sha_init(&ctx);
+    bootutil_sha_update(&ctx, &prefix, 1);
+    bootutil_sha_update(&ctx, left, IMAGE_HASH_SIZE);
+    bootutil_sha_update(&ctx, right, IMAGE_HASH_SIZE);
+    bootutil_sha_finish(&ctx, out);
+    bootutil_sha_drop(&ctx);
+}
+
+int
+bootutil_hash_tree_init(struct bootutil_hash_tree *tree, uint32_t leaf_size)
+{
+    if (leaf_size < (1u << BOOTUTIL_HASH_TREE_MIN_LEAF_LOG2) ||
+        leaf_size > (1u << BOOTUTIL_HASH_TREE_MAX_LEAF_LOG2) ||
+        (leaf_size & (leaf_size - 1)) != 0) {
+        return -1;
+    }
+
+    tree->leaf_size = leaf_size;
+    tree->leaves = 0;
+    tree->depth = 0;
+
+    return 0;
+}
+
+void
+bootutil_hash_tree_leaf_init(bootutil_sha_context *ctx)
+{
+    const uint8_t prefix = HASH_TREE_LEAF;
+
+    bootutil_sha_init(ctx);
+    bootutil_sha_update(ctx, &prefix, 1);
+}
+
+void
+bootutil_hash_tree_leaf(const void *data, uint32_t len, uint8_t *digest)
+{
+    bootutil_sha_context ctx;
+
+    bootutil_hash_tree_leaf_init(&ctx);
+    bootutil_sha_update(&ctx, data, len);
+    bootutil_sha_finish(&ctx, digest);
+    bootutil_sha_drop(&ctx);
+}
+
+/* Add a leaf digest, merging the full subtrees of the same size. */
+int
+bootutil_hash_tree_add_leaf(struct bootutil_hash_tree *tree,
+                            const uint8_t *digest)
+{
+    uint8_t node[IMAGE_HASH_SIZE];
+    uint32_t n;
+
+    /* Up to 2^BOOTUTIL_HASH_TREE_DEPTH leaves, the subtrees fit. */
+    if (tree->leaves >= (1u << BOOTUTIL_HASH_TREE_DEPTH)) {
+        return -1;
+    }
+
+    memcpy(node, digest, IMAGE_HASH_SIZE);
+
+    /* Every trailing one bit of the leaf count is a subtree of this size. */
+    for (n = tree->leaves; n & 1; n >>= 1) {
+        tree->depth--;
+        hash_tree_node(tree->subtrees[tree->depth], node, node);
+    }
+
+    memcpy(tree->subtrees[tree->depth], node, IMAGE_HASH_SIZE);
+    tree->depth++;
+    tree->leaves++;
+
+    return 0;
+}
+
+int
+bootutil_hash_tree_finish(struct bootutil_hash_tree *tree, uint8_t *root)
+{
+    bootutil_sha_context ctx;
+    uint8_t node[IMAGE_HASH_SIZE];
+    uint8_t hdr[5];
+    int i;
+
+    if (tree->leaves == 0) {
+        return -1;
+    }
+
+    /* Fold the subtrees from the smallest, it is the right of the others. */
+    memcpy(node, tree->subtrees[tree->depth - 1], IMAGE_HASH_SIZE);
+    for (i = (int)tree->depth - 2; i >= 0; i--) {
+        hash_tree_node(tree->subtrees[i], node, node);
+    }
+
+    hdr[0] = HASH_TREE_ROOT;
+    hdr[1] = (uint8_t)tree->leaf_size;
+    hdr[2] = (uint8_t)(tree->leaf_size >> 8);
+    hdr[3] = (uint8_t)(tree->leaf_size >> 16);
+    hdr[4] = (uint8_t)(tree->leaf_size >> 24);
+
+    bootutil_sha_init(&ctx);
+    bootutil_sha_update(&ctx, hdr, sizeof(hdr));
+    bootutil_sha_update(&ctx, node, IMAGE_HASH_SIZE);
+    bootutil_sha_finish(&ctx, root);
+    bootutil_sha_drop(&ctx);
+
+    return 0;
+}
+
+int
+bootutil_hash_tree_tlv_root(const struct image_header *hdr,
+                            const struct flash_area *fap, uint32_t off,
+                            uint16_t len, uint32_t *leaf_size, uint8_t *root)
+{
+    struct bootutil_hash_tree tree;
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint8_t buf[4];
+    uint32_t size;
+    uint32_t end;
+    int rc;
+
+#if !defined(MCUBOOT_RAM_LOAD)
+    (void)hdr;
+#endif
+
+    if (len < BOOTUTIL_HASH_TREE_TLV_LEN(1) ||
+        (len - 4) % IMAGE_HASH_SIZE != 0) {
+        return -1;
+    }
+
+    rc = LOAD_IMAGE_DATA(hdr, fap, off, buf, sizeof(buf));
+    if (rc != 0) {
+        return -1;
+    }
+
+    size = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+           ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    rc = bootutil_hash_tree_init(&tree, size);
+    if (rc != 0) {
+        return -1;
+    }
+
+    end = off + len;
+    for (off += 4; off < end; off += IMAGE_HASH_SIZE) {
+        rc = LOAD_IMAGE_DATA(hdr, fap, off, digest, sizeof(digest));
+        if (rc == 0) {
+            rc = bootutil_hash_tree_add_leaf(&tree, digest);
+        }
+        if (rc != 0) {
+            return -1;
+        }
+    }
+
+    if (leaf_size != NULL) {
+        *leaf_size = size;
+    }
+
+    return bootutil_hash_tree_finish(&tree, root);
+}
+
+#endif /* MCUBOOT_HASH_TREE */
@@ -37,6 +37,9 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #include "bootutil_priv.h"
 #include "bootutil/fault_injection_hardening.h"
 #include "bootutil/crypto/ecdsa.h"
+#if defined(MCUBOOT_ECDSA_P256_COMB)
+#include "bootutil/crypto/ecdsa_p256_comb.h"
+#endif
 
 #if !defined(MCUBOOT_BUILTIN_KEY)
 fih_ret
@@ -48,6 +51,10 @@ bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
     FIH_DECLARE(fih_rc, FIH_FAILURE);
     uint8_t *pubkey;
     uint8_t *end;
+#if defined(MCUBOOT_ECDSA_P256_COMB)
+    const struct bootutil_ecdsa_p256_comb *comb;
+    uint8_t signature[2 * NUM_ECC_BYTES];
+#endif
 
     BOOT_LOG_DBG("bootutil_verify_sig: ECDSA builtin key %d", key_id);
 
@@ -55,6 +62,24 @@ bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
     end = pubkey + *bootutil_keys[key_id].len;
     bootutil_ecdsa_init(&ctx);
 
+#if defined(MCUBOOT_ECDSA_P256_COMB)
+    /* Keys with a precomputed table need neither parsing nor the generic
+     * double-scalar multiplication. */
+    comb = bootutil_ecdsa_p256_comb_find(key_id);
+    if (comb != NULL) {
+        rc = -1;
+        if (hlen == BOOTUTIL_CRYPTO_ECDSA_P256_HASH_SIZE &&
+            bootutil_decode_sig(signature, sig, sig + slen) == 0) {
+            rc = bootutil_ecdsa_p256_comb_verify(comb, hash, signature);
+        }
+        fih_rc = fih_ret_encode_zero_equality(rc);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            FIH_SET(fih_rc, FIH_FAILURE);
+        }
+        goto out;
+    }
+#endif
+
     rc = bootutil_ecdsa_parse_public_key(&ctx, &pubkey, end);
     if (rc) {
         goto out;
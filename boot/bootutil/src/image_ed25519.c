@@ -24,6 +24,29 @@
 #include "bootutil/bootutil_log.h"
 #include "bootutil/crypto/sha.h"
 #include "bootutil_priv.h"
+#if defined(MCUBOOT_SIGN_PURE_FROM_FLASH) || defined(MCUBOOT_ED25519_COMB) || \
+    defined(MCUBOOT_BATCH_VERIFY)
+#include "bootutil/crypto/ed25519.h"
+#endif
+
+#if defined(MCUBOOT_ED25519_COMB)
+#if defined(CONFIG_BOOT_SIGNATURE_USING_KMU) || defined(MCUBOOT_HW_KEY) || \
+    defined(MCUBOOT_BUILTIN_KEY)
+#error "MCUBOOT_ED25519_COMB requires the keys to be built into the bootloader"
+#endif
+#if !defined(MCUBOOT_USE_TINYCRYPT) && !defined(MCUBOOT_USE_MBED_TLS)
+#error "MCUBOOT_ED25519_COMB requires the tinycrypt or Mbed TLS backend"
+#endif
+#endif
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+#if defined(CONFIG_BOOT_SIGNATURE_USING_KMU) || defined(MCUBOOT_BUILTIN_KEY)
+#error "MCUBOOT_BATCH_VERIFY requires the keys to be readable by the bootloader"
+#endif
+#if !defined(MCUBOOT_USE_TINYCRYPT) && !defined(MCUBOOT_USE_MBED_TLS)
+#error "MCUBOOT_BATCH_VERIFY requires the tinycrypt or Mbed TLS backend"
+#endif
+#endif
 
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
@@ -79,6 +102,65 @@ bootutil_import_key(uint8_t **cp, uint8_t *end)
 #endif /* !defined(MCUBOOT_KEY_IMPORT_BYPASS_ASN) */
 #endif
 
+/* Find the public key with the given index.
+ * Returns 0 and sets *pubkey on success, -1 if the key can not be used.
+ */
+static int
+bootutil_get_pubkey(uint8_t key_id, uint8_t **pubkey)
+{
+#if !defined(CONFIG_BOOT_SIGNATURE_USING_KMU)
+    uint8_t *end;
+#if !defined(MCUBOOT_KEY_IMPORT_BYPASS_ASN)
+    int rc;
+#endif
+
+    *pubkey = (uint8_t *)bootutil_keys[key_id].key;
+    end = *pubkey + *bootutil_keys[key_id].len;
+
+#if !defined(MCUBOOT_KEY_IMPORT_BYPASS_ASN)
+    rc = bootutil_import_key(pubkey, end);
+    if (rc) {
+        BOOT_LOG_DBG("bootutil_verify: import key failed %d", rc);
+        return -1;
+    }
+#else
+    /* Directly use the key contents from the ASN stream,
+     * these are the last NUM_ED25519_BYTES.
+     * There is no check whether this is the correct key,
+     * here, by the algorithm selected.
+     */
+    BOOT_LOG_DBG("bootutil_verify: bypass ASN1");
+    if (*bootutil_keys[key_id].len < NUM_ED25519_BYTES) {
+        return -1;
+    }
+
+    *pubkey = end - NUM_ED25519_BYTES;
+#endif
+
+#else
+    (void)key_id;
+    *pubkey = NULL;
+#endif
+
+    return 0;
+}
+
+#if defined(MCUBOOT_SIGN_PURE_FROM_FLASH) || defined(MCUBOOT_ED25519_COMB)
+/* Finish the verification, with the comb table of the key if it has one. */
+static int
+bootutil_verify_finish(struct ed25519_verify_ctx *ctx, uint8_t key_id)
+{
+#if defined(MCUBOOT_ED25519_COMB)
+    if (bootutil_ed25519_combs[key_id] != NULL) {
+        return ED25519_verify_finish_comb(ctx, bootutil_ed25519_combs[key_id]);
+    }
+#else
+    (void)key_id;
+#endif
+    return ED25519_verify_finish(ctx);
+}
+#endif
+
 /* Signature verification base function.
  * The function takes buffer of specified length and tries to verify
  * it against provided signature.
@@ -93,9 +175,6 @@ bootutil_verify(uint8_t *buf, uint32_t blen,
     int rc;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
     uint8_t *pubkey = NULL;
-#if !defined(CONFIG_BOOT_SIGNATURE_USING_KMU)
-    uint8_t *end;
-#endif
 
     BOOT_LOG_DBG("bootutil_verify: ED25519 key_id %d", (int)key_id);
 
@@ -106,35 +185,24 @@ bootutil_verify(uint8_t *buf, uint32_t blen,
         goto out;
     }
 
-#if !defined(CONFIG_BOOT_SIGNATURE_USING_KMU)
-    pubkey = (uint8_t *)bootutil_keys[key_id].key;
-    end = pubkey + *bootutil_keys[key_id].len;
-
-#if !defined(MCUBOOT_KEY_IMPORT_BYPASS_ASN)
-    rc = bootutil_import_key(&pubkey, end);
-    if (rc) {
-        BOOT_LOG_DBG("bootutil_verify: import key failed %d", rc);
-        FIH_SET(fih_rc, FIH_FAILURE);
-        goto out;
-    }
-#else
-    /* Directly use the key contents from the ASN stream,
-     * these are the last NUM_ED25519_BYTES.
-     * There is no check whether this is the correct key,
-     * here, by the algorithm selected.
-     */
-    BOOT_LOG_DBG("bootutil_verify: bypass ASN1");
-    if (*bootutil_keys[key_id].len < NUM_ED25519_BYTES) {
+    if (bootutil_get_pubkey(key_id, &pubkey) != 0) {
         FIH_SET(fih_rc, FIH_FAILURE);
         goto out;
     }
 
-    pubkey = end - NUM_ED25519_BYTES;
-#endif
-
-#endif
+#if defined(MCUBOOT_ED25519_COMB)
+    {
+        struct ed25519_verify_ctx ctx;
 
+        rc = ED25519_verify_init(&ctx, sig, pubkey);
+        if (rc != 0) {
+            ED25519_verify_update(&ctx, buf, blen);
+            rc = bootutil_verify_finish(&ctx, key_id);
+        }
+    }
+#else
     rc = ED25519_verify(buf, blen, sig, pubkey);
+#endif
 
     if (rc == 0) {
         /* if verify returns 0, there was an error. */
@@ -195,4 +263,166 @@ bootutil_verify_img(uint8_t *img, uint32_t size,
     FIH_RET(fih_rc);
 }
 
+#if defined(MCUBOOT_SIGN_PURE_FROM_FLASH)
+/* Image verification function for images that are not mapped to memory.
+ * The image is read from the flash area in pieces of tmp_buf_sz and fed
+ * to the signature check as it is read, so it is only read once and the
+ * RAM needed does not depend on the size of the image.
+ */
+fih_ret
+bootutil_verify_img_flash(const struct flash_area *fap, uint32_t img_off,
+                          uint32_t size, uint8_t *tmp_buf, uint32_t tmp_buf_sz,
+                          uint8_t *sig, size_t slen, uint8_t key_id)
+{
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    struct ed25519_verify_ctx ctx;
+    uint8_t *pubkey = NULL;
+    uint32_t off;
+    uint32_t blk_sz;
+    int rc;
+
+    BOOT_LOG_DBG("bootutil_verify_img_flash: ED25519 key_id %d", (int)key_id);
+
+    if (slen != EDDSA_SIGNATURE_LENGTH) {
+        BOOT_LOG_DBG("bootutil_verify_img_flash: expected slen %d, got %u",
+                     EDDSA_SIGNATURE_LENGTH, (unsigned int)slen);
+        goto out;
+    }
+
+    if (bootutil_get_pubkey(key_id, &pubkey) != 0) {
+        goto out;
+    }
+
+    if (!ED25519_verify_init(&ctx, sig, pubkey)) {
+        goto out;
+    }
+
+    for (off = 0; off < size; off += blk_sz) {
+        blk_sz = size - off;
+        if (blk_sz > tmp_buf_sz) {
+            blk_sz = tmp_buf_sz;
+        }
+
+        rc = flash_area_read(fap, img_off + off, tmp_buf, blk_sz);
+        if (rc) {
+            BOOT_LOG_DBG("bootutil_verify_img_flash: error %d reading %u %u",
+                         rc, (unsigned int)off, (unsigned int)blk_sz);
+            /* Finish anyway, to release the hash context. */
+            (void)ED25519_verify_finish(&ctx);
+            goto out;
+        }
+
+        ED25519_verify_update(&ctx, tmp_buf, blk_sz);
+    }
+
+    if (bootutil_verify_finish(&ctx, key_id)) {
+        FIH_SET(fih_rc, FIH_SUCCESS);
+    }
+
+out:
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_SIGN_PURE_FROM_FLASH */
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+void
+bootutil_verify_sig_batch_start(struct boot_loader_state *state)
+{
+    memset(state->batch, 0, sizeof(state->batch));
+}
+
+fih_ret
+bootutil_verify_sig_defer(struct boot_loader_state *state,
+                          uint8_t *hash, uint32_t hlen,
+                          uint8_t *sig, size_t slen,
+                          uint8_t key_id)
+{
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    BOOT_LOG_DBG("bootutil_verify_sig_defer: ED25519 key_id %d", (int)key_id);
+
+    if (hlen != IMAGE_HASH_SIZE || slen != EDDSA_SIGNATURE_LENGTH) {
+        BOOT_LOG_DBG("bootutil_verify_sig_defer: unexpected hlen %d or slen %u",
+                     hlen, (unsigned int)slen);
+        goto out;
+    }
+
+    state->batch[BOOT_CURR_IMG(state)].key_id = key_id;
+    memcpy(state->batch[BOOT_CURR_IMG(state)].hash, hash, IMAGE_HASH_SIZE);
+    memcpy(state->batch[BOOT_CURR_IMG(state)].sig, sig, EDDSA_SIGNATURE_LENGTH);
+    state->batch[BOOT_CURR_IMG(state)].pending = true;
+
+    FIH_SET(fih_rc, FIH_SUCCESS);
+out:
+    FIH_RET(fih_rc);
+}
+
+fih_ret
+bootutil_verify_sig_batch_finish(struct boot_loader_state *state)
+{
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    const uint8_t *messages[BOOT_IMAGE_NUMBER];
+    size_t message_lens[BOOT_IMAGE_NUMBER];
+    const uint8_t *signatures[BOOT_IMAGE_NUMBER];
+    const uint8_t *public_keys[BOOT_IMAGE_NUMBER];
+    uint8_t *pubkey;
+    size_t num = 0;
+    int image_index;
+    int rc = 0;
+
+    for (image_index = 0; image_index < BOOT_IMAGE_NUMBER; image_index++) {
+        if (!state->batch[image_index].pending) {
+            continue;
+        }
+        if (bootutil_get_pubkey(state->batch[image_index].key_id, &pubkey) != 0) {
+            /* Let the check below tell which image it is. */
+            num = 0;
+            break;
+        }
+
+        messages[num] = state->batch[image_index].hash;
+        message_lens[num] = IMAGE_HASH_SIZE;
+        signatures[num] = state->batch[image_index].sig;
+        public_keys[num] = pubkey;
+        num++;
+    }
+
+    BOOT_LOG_DBG("bootutil_verify_sig_batch_finish: %u signatures", (unsigned int)num);
+
+    if (num > 1) {
+        rc = ED25519_verify_batch(messages, message_lens, signatures,
+                                  public_keys, num);
+    }
+
+    if (rc == 1) {
+        FIH_SET(fih_rc, FIH_SUCCESS);
+        goto out;
+    }
+
+    /* A batch only tells that one of the signatures is invalid, check them
+     * one by one to find it.
+     */
+    for (image_index = 0; image_index < BOOT_IMAGE_NUMBER; image_index++) {
+        if (!state->batch[image_index].pending) {
+            continue;
+        }
+
+        FIH_CALL(bootutil_verify_sig, fih_rc, state->batch[image_index].hash,
+                 IMAGE_HASH_SIZE, state->batch[image_index].sig,
+                 EDDSA_SIGNATURE_LENGTH, state->batch[image_index].key_id);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+#if (BOOT_IMAGE_NUMBER > 1)
+            BOOT_CURR_IMG(state) = image_index;
+#endif
+            FIH_SET(fih_rc, FIH_FAILURE);
+            goto out;
+        }
+    }
+
+    FIH_SET(fih_rc, FIH_SUCCESS);
+out:
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_BATCH_VERIFY */
+
 #endif /* MCUBOOT_SIGN_ED25519 */
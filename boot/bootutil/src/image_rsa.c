@@ -47,6 +47,9 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #if !defined(MCUBOOT_USE_PSA_CRYPTO)
 
 #include "bootutil/crypto/sha.h"
+#if defined(MCUBOOT_RSA_MONT)
+#include "bootutil/crypto/rsa_mont.h"
+#endif
 
 /*
  * Constants for this particular constrained implementation of
@@ -115,36 +118,23 @@ pss_mgf1(uint8_t *mask, const uint8_t *hash)
 }
 
 /*
- * Validate an RSA signature, using RSA-PSS, as described in PKCS #1
- * v2.2, section 9.1.2, with many parameters required to have fixed
- * values. RSASSA-PSS-VERIFY RFC8017 section 8.1.2
+ * Check the encoded message em = sig^E mod N against the hash, as described
+ * in PKCS #1 v2.2, section 9.1.2, with many parameters required to have
+ * fixed values.
  */
 static fih_ret
-bootutil_cmp_rsasig(bootutil_rsa_context *ctx, uint8_t *hash, uint32_t hlen,
-  uint8_t *sig, size_t slen)
+bootutil_cmp_pss(const uint8_t *em, uint8_t *hash, uint32_t hlen)
 {
     bootutil_sha_context shactx;
-    uint8_t em[MBEDTLS_MPI_MAX_SIZE];
     uint8_t db_mask[PSS_MASK_LEN];
     uint8_t h2[PSS_HLEN];
     int i;
     FIH_DECLARE(fih_rc, FIH_FAILURE);
 
-    /* The caller has already verified that slen == bootutil_rsa_get_len(ctx) */
-    if (slen != PSS_EMLEN ||
-        PSS_EMLEN > MBEDTLS_MPI_MAX_SIZE) {
-        goto out;
-    }
-
     if (hlen != PSS_HLEN) {
         goto out;
     }
 
-    /* Apply RSAVP1 to produce em = sig^E mod N using the public key */
-    if (bootutil_rsa_public(ctx, sig, em)) {
-        goto out;
-    }
-
     /*
      * PKCS #1 v2.2, 9.1.2 EMSA-PSS-Verify
      *
@@ -238,6 +228,62 @@ out:
     FIH_RET(fih_rc);
 }
 
+/*
+ * Validate an RSA signature, using RSA-PSS, as described in PKCS #1
+ * v2.2, section 9.1.2, with many parameters required to have fixed
+ * values. RSASSA-PSS-VERIFY RFC8017 section 8.1.2
+ */
+static fih_ret
+bootutil_cmp_rsasig(bootutil_rsa_context *ctx, uint8_t *hash, uint32_t hlen,
+  uint8_t *sig, size_t slen)
+{
+    uint8_t em[MBEDTLS_MPI_MAX_SIZE];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    /* The caller has already verified that slen == bootutil_rsa_get_len(ctx) */
+    if (slen != PSS_EMLEN ||
+        PSS_EMLEN > MBEDTLS_MPI_MAX_SIZE) {
+        goto out;
+    }
+
+    /* Apply RSAVP1 to produce em = sig^E mod N using the public key */
+    if (bootutil_rsa_public(ctx, sig, em)) {
+        goto out;
+    }
+
+    FIH_CALL(bootutil_cmp_pss, fih_rc, em, hash, hlen);
+
+out:
+    FIH_RET(fih_rc);
+}
+
+#if defined(MCUBOOT_RSA_MONT)
+/*
+ * Same as bootutil_cmp_rsasig(), for a built-in key with precomputed
+ * Montgomery constants, which needs no Mbed TLS context.
+ */
+static fih_ret
+bootutil_cmp_rsasig_mont(const struct bootutil_rsa_mont *key, uint8_t *hash,
+  uint32_t hlen, uint8_t *sig, size_t slen)
+{
+    uint8_t em[PSS_EMLEN];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+
+    if (slen != PSS_EMLEN) {
+        goto out;
+    }
+
+    if (bootutil_rsa_mont_public(key, sig, em)) {
+        goto out;
+    }
+
+    FIH_CALL(bootutil_cmp_pss, fih_rc, em, hash, hlen);
+
+out:
+    FIH_RET(fih_rc);
+}
+#endif /* MCUBOOT_RSA_MONT */
+
 #else /* MCUBOOT_USE_PSA_CRYPTO */
 
 static fih_ret
@@ -272,6 +318,18 @@ bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig, size_t slen,
 
     BOOT_LOG_DBG("bootutil_verify_sig: RSA key_id %d", key_id);
 
+#if defined(MCUBOOT_RSA_MONT)
+    {
+        const struct bootutil_rsa_mont *mont = bootutil_rsa_mont_find(key_id);
+
+        if (mont != NULL) {
+            FIH_CALL(bootutil_cmp_rsasig_mont, fih_rc, mont, hash, hlen, sig,
+                     slen);
+            FIH_RET(fih_rc);
+        }
+    }
+#endif
+
     bootutil_rsa_init(&ctx);
 
     cp = (uint8_t *)bootutil_keys[key_id].key;
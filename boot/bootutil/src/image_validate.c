@@ -53,6 +53,12 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #ifdef MCUBOOT_ENC_IMAGES
 #include "bootutil/enc_key.h"
 #endif
+#if defined(MCUBOOT_HASH_TREE)
+#include "bootutil/hash_tree.h"
+#endif
+#if defined(MCUBOOT_CRYPTO_ASYNC)
+#include "bootutil/crypto/async.h"
+#endif
 #if defined(MCUBOOT_SIGN_RSA)
 #include "mbedtls/rsa.h"
 #endif
@@ -67,10 +73,292 @@ BOOT_LOG_MODULE_DECLARE(mcuboot);
 #include "bootutil_priv.h"
 
 #ifndef MCUBOOT_SIGN_PURE
+/*
+ * Hash of the image: the tree hash of bootutil/hash_tree.h if the image has
+ * an IMAGE_TLV_HASH_TREE, the linear SHA hash otherwise.
+ */
+struct bootutil_img_hash_ctx {
+#if defined(MCUBOOT_HASH_TREE)
+    /* Zero for the linear hash. */
+    uint32_t leaf_size;
+    /* Each leaf is checked against its digest in the TLV once hashed. */
+    const struct image_header *hdr;
+    const struct flash_area *fap;
+    uint32_t digests_off;
+    uint32_t leaves;
+    uint32_t leaf;
+    uint32_t fill;
+    uint8_t root[IMAGE_HASH_SIZE];
+#endif
+    /* The linear hash, or the hash of the current leaf. */
+    bootutil_sha_context sha;
+};
+
+#if defined(MCUBOOT_HASH_TREE)
+/*
+ * Find the IMAGE_TLV_HASH_TREE of an image of size bytes to hash and compute
+ * its root, or set the leaf size to 0 if it has the linear hash.  Returns -1
+ * if the TLV is not valid.
+ */
+static int
+bootutil_img_hash_tree_init(struct bootutil_img_hash_ctx *ctx,
+                            const struct image_header *hdr,
+                            const struct flash_area *fap,
+                            uint32_t start_off, uint32_t size)
+{
+    struct image_tlv_iter it;
+    uint32_t off;
+    uint16_t len;
+    int rc;
+
+    (void)start_off;
+#if defined(MCUBOOT_SWAP_USING_OFFSET)
+    it.start_off = start_off;
+#endif
+    ctx->leaf_size = 0;
+    rc = bootutil_tlv_iter_begin(&it, hdr, fap, IMAGE_TLV_HASH_TREE, false);
+    if (rc) {
+        return -1;
+    }
+
+    rc = bootutil_tlv_iter_next(&it, &off, &len, NULL);
+    if (rc < 0) {
+        return -1;
+    } else if (rc > 0) {
+        return 0;
+    }
+
+    /* The digests can't be in the protected TLVs they cover. */
+    if (bootutil_tlv_iter_is_prot(&it, off)) {
+        return -1;
+    }
+    rc = bootutil_hash_tree_tlv_root(hdr, fap, off, len, &ctx->leaf_size,
+                                     ctx->root);
+    if (rc) {
+        ctx->leaf_size = 0;
+        return -1;
+    }
+
+    ctx->leaves = BOOTUTIL_HASH_TREE_LEAVES(size, ctx->leaf_size);
+    if (len != BOOTUTIL_HASH_TREE_TLV_LEN(ctx->leaves)) {
+        ctx->leaf_size = 0;
+        return -1;
+    }
+
+    ctx->hdr = hdr;
+    ctx->fap = fap;
+    ctx->digests_off = off + 4;
+    ctx->leaf = 0;
+    ctx->fill = 0;
+
+    return 0;
+}
+
+/* Check the leaf just hashed against its digest in the TLV. */
+static int
+bootutil_img_hash_tree_check_leaf(struct bootutil_img_hash_ctx *ctx)
+{
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint8_t expected[IMAGE_HASH_SIZE];
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    int rc;
+
+    bootutil_sha_finish(&ctx->sha, digest);
+    bootutil_sha_drop(&ctx->sha);
+    ctx->fill = 0;
+
+    rc = LOAD_IMAGE_DATA(ctx->hdr, ctx->fap,
+                         ctx->digests_off + ctx->leaf * IMAGE_HASH_SIZE,
+                         expected, sizeof(expected));
+    if (rc) {
+        return -1;
+    }
+
+    FIH_CALL(boot_fih_memequal, fih_rc, digest, expected, sizeof(digest));
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        BOOT_LOG_DBG("bootutil_img_hash: leaf %u does not match its digest",
+                     (unsigned)ctx->leaf);
+        return -1;
+    }
+
+    ctx->leaf++;
+
+    return 0;
+}
+#endif
+
+static int
+bootutil_img_hash_init(struct bootutil_img_hash_ctx *ctx,
+                       const struct image_header *hdr,
+                       const struct flash_area *fap, uint32_t start_off,
+                       uint32_t size)
+{
+#if defined(MCUBOOT_HASH_TREE)
+    int rc;
+
+    rc = bootutil_img_hash_tree_init(ctx, hdr, fap, start_off, size);
+    if (rc || ctx->leaf_size != 0) {
+        return rc;
+    }
+#else
+    (void)hdr;
+    (void)fap;
+    (void)start_off;
+    (void)size;
+#endif
+
+    bootutil_sha_init(&ctx->sha);
+
+    return 0;
+}
+
+static int
+bootutil_img_hash_update(struct bootutil_img_hash_ctx *ctx, const void *data,
+                         uint32_t len)
+{
+#if defined(MCUBOOT_HASH_TREE)
+    const uint8_t *p = data;
+    uint32_t n;
+    int rc;
+
+    if (ctx->leaf_size != 0) {
+        while (len > 0) {
+            if (ctx->leaf >= ctx->leaves) {
+                return -1;
+            }
+            if (ctx->fill == 0) {
+                bootutil_hash_tree_leaf_init(&ctx->sha);
+            }
+
+            n = ctx->leaf_size - ctx->fill;
+            if (n > len) {
+                n = len;
+            }
+            bootutil_sha_update(&ctx->sha, p, n);
+            ctx->fill += n;
+            p += n;
+            len -= n;
+
+            if (ctx->fill == ctx->leaf_size) {
+                rc = bootutil_img_hash_tree_check_leaf(ctx);
+                if (rc) {
+                    return rc;
+                }
+            }
+        }
+
+        return 0;
+    }
+#endif
+
+    bootutil_sha_update(&ctx->sha, data, len);
+
+    return 0;
+}
+
+static int
+bootutil_img_hash_finish(struct bootutil_img_hash_ctx *ctx, uint8_t *output)
+{
+#if defined(MCUBOOT_HASH_TREE)
+    int rc;
+
+    if (ctx->leaf_size != 0) {
+        if (ctx->fill != 0) {
+            rc = bootutil_img_hash_tree_check_leaf(ctx);
+            if (rc) {
+                return rc;
+            }
+        }
+        if (ctx->leaf != ctx->leaves) {
+            return -1;
+        }
+
+        /* Every leaf matches its digest, the root of those is the hash. */
+        memcpy(output, ctx->root, IMAGE_HASH_SIZE);
+        return 0;
+    }
+#endif
+
+    /* Not all backends return 0 on success, there is no failure to report. */
+    (void)bootutil_sha_finish(&ctx->sha, output);
+
+    return 0;
+}
+
+static void
+bootutil_img_hash_drop(struct bootutil_img_hash_ctx *ctx)
+{
+#if defined(MCUBOOT_HASH_TREE)
+    if (ctx->leaf_size != 0) {
+        if (ctx->fill != 0) {
+            bootutil_sha_drop(&ctx->sha);
+            ctx->fill = 0;
+        }
+        return;
+    }
+#endif
+
+    bootutil_sha_drop(&ctx->sha);
+}
+
+#if defined(MCUBOOT_CRYPTO_ASYNC) && !defined(MCUBOOT_HASH_STORAGE_DIRECTLY) && \
+    !defined(MCUBOOT_RAM_LOAD)
+#define BOOTUTIL_IMG_HASH_ASYNC
+
+/* As in loader.c, the simulator runs a boot per thread. */
+#if !defined(__BOOTSIM__)
+#define TARGET_STATIC static
+#else
+#define TARGET_STATIC
+#endif
+
+/* The jobs queued on one of the two buffers of bootutil_img_hash(). */
+struct bootutil_img_hash_jobs {
+    /* Decryption and hash of the buffer. */
+    struct bootutil_crypto_job job[2];
+    int cnt;
+};
+
+static int
+bootutil_img_hash_submit(struct bootutil_img_hash_jobs *jobs)
+{
+    int rc;
+
+    rc = bootutil_crypto_async_submit(&jobs->job[jobs->cnt]);
+    if (rc == 0) {
+        jobs->cnt++;
+    }
+
+    return rc;
+}
+
+/* Wait for the jobs of a buffer, returns 0 or the first error. */
+static int
+bootutil_img_hash_wait(struct bootutil_img_hash_jobs *jobs)
+{
+    int rc = 0;
+    int job_rc;
+    int i;
+
+    for (i = 0; i < jobs->cnt; i++) {
+        job_rc = bootutil_crypto_async_wait(&jobs->job[i]);
+        if (rc == 0) {
+            rc = job_rc;
+        }
+    }
+    jobs->cnt = 0;
+
+    return rc;
+}
+#endif
+
 /*
  * Compute SHA hash over the image.
  * (SHA384 if ECDSA-P384 is being used,
- *  SHA256 otherwise).
+ *  SHA256 otherwise), or its tree hash.
+ *
+ * With MCUBOOT_CRYPTO_ASYNC, the linear hash and the decryption of a block
+ * run as jobs while the next block is read into the other buffer.
  */
 static int
 bootutil_img_hash(struct boot_loader_state *state,
@@ -82,9 +370,11 @@ bootutil_img_hash(struct boot_loader_state *state,
 #endif
                  )
 {
-    bootutil_sha_context sha_ctx;
+    struct bootutil_img_hash_ctx hash_ctx;
     uint32_t size;
     uint16_t hdr_size;
+    uint32_t start_off = 0;
+    int hash_rc;
     uint32_t blk_off;
     uint32_t tlv_off;
 #if !defined(MCUBOOT_HASH_STORAGE_DIRECTLY)
@@ -103,6 +393,14 @@ bootutil_img_hash(struct boot_loader_state *state,
 #if defined(MCUBOOT_SWAP_USING_OFFSET)
     uint32_t sector_off = 0;
 #endif
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+    TARGET_STATIC uint8_t async_buf[BOOT_TMPBUF_SZ] __attribute__((aligned(4)));
+    struct bootutil_img_hash_jobs jobs[2];
+    struct bootutil_crypto_job *job;
+    uint8_t *bufs[2];
+    int cur = 0;
+    bool async;
+#endif
 
 #if (BOOT_IMAGE_NUMBER == 1) || !defined(MCUBOOT_ENC_IMAGES) || \
     defined(MCUBOOT_RAM_LOAD)
@@ -147,16 +445,9 @@ bootutil_img_hash(struct boot_loader_state *state,
 #else
     sector_off = boot_get_state_secondary_offset(state, fap);
 #endif
+    start_off = sector_off;
 #endif
 
-    bootutil_sha_init(&sha_ctx);
-
-    /* in some cases (split image) the hash is seeded with data from
-     * the loader image */
-    if (seed && (seed_len > 0)) {
-        bootutil_sha_update(&sha_ctx, seed, seed_len);
-    }
-
     /* Hash is computed over image header and image itself. */
     size = hdr_size = hdr->ih_hdr_size;
     size += hdr->ih_img_size;
@@ -165,6 +456,24 @@ bootutil_img_hash(struct boot_loader_state *state,
     /* If protected TLVs are present they are also hashed. */
     size += hdr->ih_protect_tlv_size;
 
+    hash_rc = bootutil_img_hash_init(&hash_ctx, hdr, fap, start_off,
+                                     size + (seed != NULL && seed_len > 0 ?
+                                             (uint32_t)seed_len : 0));
+    if (hash_rc) {
+        BOOT_LOG_DBG("bootutil_img_hash: invalid hash tree TLV");
+        return hash_rc;
+    }
+
+    /* in some cases (split image) the hash is seeded with data from
+     * the loader image */
+    if (seed && (seed_len > 0)) {
+        hash_rc = bootutil_img_hash_update(&hash_ctx, seed, seed_len);
+        if (hash_rc) {
+            bootutil_img_hash_drop(&hash_ctx);
+            return hash_rc;
+        }
+    }
+
 #ifdef MCUBOOT_HASH_STORAGE_DIRECTLY
     /* No chunk loading, storage is mapped to address space and can
      * be directly given to hashing function.
@@ -174,18 +483,47 @@ bootutil_img_hash(struct boot_loader_state *state,
         base = 0;
     }
 
-    bootutil_sha_update(&sha_ctx, (void *)(base + flash_area_get_off(fap)), size);
+    hash_rc = bootutil_img_hash_update(&hash_ctx, (void *)(base + flash_area_get_off(fap)),
+                                       size);
 #else /* MCUBOOT_HASH_STORAGE_DIRECTLY */
 #ifdef MCUBOOT_RAM_LOAD
-    bootutil_sha_update(&sha_ctx,
-                        (void*)(IMAGE_RAM_BASE + hdr->ih_load_addr),
-                        size);
+    hash_rc = bootutil_img_hash_update(&hash_ctx,
+                                       (void*)(IMAGE_RAM_BASE + hdr->ih_load_addr),
+                                       size);
 #else
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+    /* The tree hash is not an update of a SHA context, it stays on the CPU. */
+    async = true;
+#if defined(MCUBOOT_HASH_TREE)
+    async = (hash_ctx.leaf_size == 0);
+#endif
+    if (async && tmp_buf_sz > sizeof(async_buf)) {
+        tmp_buf_sz = sizeof(async_buf);
+    }
+    bufs[0] = tmp_buf;
+    bufs[1] = async_buf;
+    jobs[0].cnt = 0;
+    jobs[1].cnt = 0;
+    rc = 0;
+#endif
     for (off = 0; off < size; off += blk_sz) {
         blk_sz = size - off;
         if (blk_sz > tmp_buf_sz) {
             blk_sz = tmp_buf_sz;
         }
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+        if (async) {
+            /* Take the buffer of two blocks ago back from its jobs. */
+            cur ^= 1;
+            tmp_buf = bufs[cur];
+            rc = bootutil_img_hash_wait(&jobs[cur]);
+            if (rc) {
+                (void)bootutil_img_hash_wait(&jobs[cur ^ 1]);
+                bootutil_img_hash_drop(&hash_ctx);
+                return rc;
+            }
+        }
+#endif
 #ifdef MCUBOOT_ENC_IMAGES
         /* The only data that is encrypted in an image is the payload;
          * both header and TLVs (when protected) are not.
@@ -205,7 +543,10 @@ bootutil_img_hash(struct boot_loader_state *state,
         rc = flash_area_read(fap, off, tmp_buf, blk_sz);
 #endif
         if (rc) {
-            bootutil_sha_drop(&sha_ctx);
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+            (void)bootutil_img_hash_wait(&jobs[cur ^ 1]);
+#endif
+            bootutil_img_hash_drop(&hash_ctx);
             BOOT_LOG_DBG("bootutil_img_validate Error %d reading data chunk %p %u %u",
                          rc, fap, off, blk_sz);
             return rc;
@@ -218,19 +559,59 @@ bootutil_img_hash(struct boot_loader_state *state,
 
             if (off >= hdr_size && off < tlv_off) {
                 blk_off = (off - hdr_size) & 0xf;
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+                if (async) {
+                    job = &jobs[cur].job[jobs[cur].cnt];
+                    boot_enc_job(enc_state, slot, off - hdr_size,
+                                 blk_sz, blk_off, tmp_buf, job);
+                    rc = bootutil_img_hash_submit(&jobs[cur]);
+                    if (rc) {
+                        break;
+                    }
+                } else
+#endif
                 boot_enc_decrypt(enc_state, slot, off - hdr_size,
                                  blk_sz, blk_off, tmp_buf);
             }
         }
 #endif
-        bootutil_sha_update(&sha_ctx, tmp_buf, blk_sz);
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+        if (async) {
+            job = &jobs[cur].job[jobs[cur].cnt];
+            job->op = BOOTUTIL_CRYPTO_JOB_SHA_UPDATE;
+            job->buf = tmp_buf;
+            job->len = blk_sz;
+            job->u.sha = &hash_ctx.sha;
+            rc = bootutil_img_hash_submit(&jobs[cur]);
+            if (rc) {
+                break;
+            }
+            continue;
+        }
+#endif
+        hash_rc = bootutil_img_hash_update(&hash_ctx, tmp_buf, blk_sz);
+        if (hash_rc) {
+            break;
+        }
     }
+#if defined(BOOTUTIL_IMG_HASH_ASYNC)
+    if (async) {
+        /* The older jobs first, then the ones of the last block. */
+        hash_rc = bootutil_img_hash_wait(&jobs[cur ^ 1]);
+        if (bootutil_img_hash_wait(&jobs[cur]) != 0 || hash_rc != 0 || rc != 0) {
+            bootutil_img_hash_drop(&hash_ctx);
+            return -1;
+        }
+    }
+#endif
 #endif /* MCUBOOT_RAM_LOAD */
 #endif /* MCUBOOT_HASH_STORAGE_DIRECTLY */
-    bootutil_sha_finish(&sha_ctx, hash_result);
-    bootutil_sha_drop(&sha_ctx);
+    if (hash_rc == 0) {
+        hash_rc = bootutil_img_hash_finish(&hash_ctx, hash_result);
+    }
+    bootutil_img_hash_drop(&hash_ctx);
 
-    return 0;
+    return hash_rc;
 }
 #endif
 
@@ -479,6 +860,9 @@ static const uint16_t allowed_unprot_tlvs[] = {
      IMAGE_TLV_SHA256,
      IMAGE_TLV_SHA384,
      IMAGE_TLV_SHA512,
+#if defined(MCUBOOT_HASH_TREE)
+     IMAGE_TLV_HASH_TREE,
+#endif
      IMAGE_TLV_RSA2048_PSS,
      IMAGE_TLV_ECDSA224,
      IMAGE_TLV_ECDSA_SIG,
@@ -730,6 +1114,30 @@ bootutil_img_validate(struct boot_loader_state *state,
             image_hash_valid = 1;
             break;
         }
+#if defined(MCUBOOT_HASH_TREE)
+        case IMAGE_TLV_HASH_TREE:
+        {
+            BOOT_LOG_DBG("bootutil_img_validate: IMAGE_TLV_HASH_TREE");
+            /* bootutil_img_hash() checked every leaf against its digest in
+             * this TLV and returned the root of those digests, which is left
+             * to the signature.  It is computed again from the TLV to be
+             * checked like the hash TLV.
+             */
+            rc = bootutil_hash_tree_tlv_root(hdr, fap, off, len, NULL, buf);
+            if (rc) {
+                goto out;
+            }
+
+            FIH_CALL(boot_fih_memequal, fih_rc, hash, buf, sizeof(hash));
+            if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+                FIH_SET(fih_rc, FIH_FAILURE);
+                goto out;
+            }
+
+            image_hash_valid = 1;
+            break;
+        }
+#endif /* MCUBOOT_HASH_TREE */
 #endif /* defined(EXPECTED_HASH_TLV) && !defined(MCUBOOT_SIGN_PURE) */
 #if !defined(CONFIG_BOOT_SIGNATURE_USING_KMU)
 #ifdef EXPECTED_KEY_TLV
@@ -784,8 +1192,29 @@ bootutil_img_validate(struct boot_loader_state *state,
                 goto out;
             }
 #ifndef MCUBOOT_SIGN_PURE
+#if defined(MCUBOOT_BATCH_VERIFY)
+            if (state != NULL && state->batch_verify) {
+                FIH_CALL(bootutil_verify_sig_defer, valid_signature, state, hash,
+                         sizeof(hash), buf, len, key_id);
+                key_id = -1;
+                break;
+            }
+#endif
             FIH_CALL(bootutil_verify_sig, valid_signature, hash, sizeof(hash),
                                                            buf, len, key_id);
+#elif defined(MCUBOOT_SIGN_PURE_FROM_FLASH)
+            /* Check signature on the image as it is read from the flash area,
+             * the range is header + image + protected tlvs.
+             */
+#if defined(MCUBOOT_SWAP_USING_OFFSET)
+            FIH_CALL(bootutil_verify_img_flash, valid_signature, fap, it.start_off,
+                     hdr->ih_hdr_size + hdr->ih_img_size + hdr->ih_protect_tlv_size,
+                     tmp_buf, tmp_buf_sz, buf, len, key_id);
+#else
+            FIH_CALL(bootutil_verify_img_flash, valid_signature, fap, 0,
+                     hdr->ih_hdr_size + hdr->ih_img_size + hdr->ih_protect_tlv_size,
+                     tmp_buf, tmp_buf_sz, buf, len, key_id);
+#endif
 #else
             /* Directly check signature on the image, by using the mapping of
              * a device to memory. The pointer is beginning of image in flash,
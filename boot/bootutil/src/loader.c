@@ -84,6 +84,13 @@ int pcd_version_cmp_net(const struct flash_area *fap, struct image_header *hdr);
 #include "bootutil/key_revocation.h"
 #endif
 
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+#include "bootutil/crypto/sha.h"
+#if defined(MCUBOOT_HASH_TREE)
+#include "bootutil/hash_tree.h"
+#endif
+#endif
+
 BOOT_LOG_MODULE_DECLARE(mcuboot);
 
 static struct boot_loader_state boot_data;
@@ -143,6 +150,26 @@ static const struct image_version mcuboot_s0_s1_image_version = {
 #define TARGET_STATIC
 #endif
 
+/*
+ * Boot phases, used by the simulator to tag the flash operations it traces
+ * with the part of the loader that issued them. These must be kept in sync
+ * with phase_name() in sim/simflash/src/trace.rs.
+ */
+#define BOOT_PHASE_NONE         0
+#define BOOT_PHASE_PREPARE      1   /* Sector layout, headers, swap status */
+#define BOOT_PHASE_RESUME       2   /* Completing an interrupted swap */
+#define BOOT_PHASE_VALIDATE     3   /* Determining and validating swap type */
+#define BOOT_PHASE_UPDATE       4   /* Swap, copy or revert */
+#define BOOT_PHASE_SELECT       5   /* Validating and selecting the image */
+
+#if defined(__BOOTSIM__)
+void sim_set_boot_phase(uint8_t image, uint8_t phase);
+#define BOOT_SET_PHASE(state, phase) \
+    sim_set_boot_phase(BOOT_CURR_IMG(state), (phase))
+#else
+#define BOOT_SET_PHASE(state, phase)
+#endif
+
 #if BOOT_MAX_ALIGN > 1024
 #define BUF_SZ BOOT_MAX_ALIGN
 #else
@@ -1059,6 +1086,19 @@ boot_is_header_valid(const struct image_header *hdr, const struct flash_area *fa
     }
 #endif
 
+#if !defined(MCUBOOT_DELTA_IMAGES)
+    if (IS_DELTA(hdr)) {
+        return false;
+    }
+#else
+    /* A delta image is only ever built from the secondary slot. */
+    if (IS_DELTA(hdr) &&
+        (flash_area_get_id(fap) != FLASH_AREA_IMAGE_SECONDARY(BOOT_CURR_IMG(state)) ||
+         IS_ENCRYPTED(hdr) || IS_COMPRESSED(hdr))) {
+        return false;
+    }
+#endif
+
     return true;
 }
 
@@ -1176,11 +1216,12 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
          * is erased.
          */
         if (slot != BOOT_PRIMARY_SLOT) {
+            boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
             swap_scramble_trailer_sectors(state, fap);
 
 #if defined(MCUBOOT_SWAP_USING_MOVE)
             if (bs->swap_type == BOOT_SWAP_TYPE_REVERT ||
-                boot_swap_type_multi(BOOT_CURR_IMG(state)) == BOOT_SWAP_TYPE_REVERT) {
+                boot_snapshot_swap_type(state) == BOOT_SWAP_TYPE_REVERT) {
                 const struct flash_area *fap_pri = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
 
                 assert(fap_pri != NULL);
@@ -1275,7 +1316,8 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
 #endif
         if (rc < 0 && boot_check_header_erased(state, BOOT_PRIMARY_SLOT)) {
             BOOT_LOG_ERR("insufficient version in secondary slot");
-            boot_scramble_slot(fap, slot);
+            boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
+            boot_scramble_slot(state, fap, slot);
             /* Image in the secondary slot does not satisfy version requirement.
              * Erase the image and continue booting from the primary slot.
              */
@@ -1292,13 +1334,20 @@ boot_validate_slot(struct boot_loader_state *state, int slot,
         if (FIH_EQ(fih_rc, FIH_BOOT_HOOK_REGULAR)) {
             FIH_CALL(boot_image_check, fih_rc, state, hdr, fap, bs);
         }
+#if defined(MCUBOOT_DELTA_IMAGES)
+        if (FIH_EQ(fih_rc, FIH_SUCCESS) && slot != BOOT_PRIMARY_SLOT &&
+            IS_DELTA(hdr) && boot_delta_check(state) != 0) {
+            fih_rc = FIH_FAILURE;
+        }
+#endif
     }
 #if defined(MCUBOOT_SWAP_USING_OFFSET)
 check_validity:
 #endif
     if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
         if ((slot != BOOT_PRIMARY_SLOT) || ARE_SLOTS_EQUIVALENT()) {
-            boot_scramble_slot(fap, slot);
+            boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
+            boot_scramble_slot(state, fap, slot);
             /* Image is invalid, erase it to prevent further unnecessary
              * attempts to validate and boot it.
              */
@@ -1390,7 +1439,8 @@ check_validity:
              *
              * Erase the image and continue booting from the primary slot.
              */
-            boot_scramble_slot(fap, slot);
+            boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
+            boot_scramble_slot(state, fap, slot);
             fih_rc = FIH_NO_BOOTABLE_IMAGE;
             goto out;
         }
@@ -1557,7 +1607,7 @@ static inline void sec_slot_mark_assigned(struct boot_loader_state *state)
  * This function is supposed to be called after boot_validated_swap_type()
  * iterates over all the images in context_boot_go().
  */
-static void sec_slot_cleanup_if_unusable(void)
+static void sec_slot_cleanup_if_unusable(struct boot_loader_state *state)
 {
     uint8_t idx;
 
@@ -1566,6 +1616,8 @@ static void sec_slot_cleanup_if_unusable(void)
             const struct flash_area *secondary_fa;
             int rc;
 
+            boot_snapshot_invalidate(state, idx);
+
             rc = flash_area_open(flash_area_id_from_multi_image_slot(idx, BOOT_SECONDARY_SLOT),
                                  &secondary_fa);
             if (!rc) {
@@ -1591,7 +1643,7 @@ static inline void sec_slot_touch(struct boot_loader_state *state)
 static inline void sec_slot_mark_assigned(struct boot_loader_state *state)
 {
 }
-static inline void sec_slot_cleanup_if_unusable(void)
+static inline void sec_slot_cleanup_if_unusable(struct boot_loader_state *state)
 {
 }
 #endif /* defined(CONFIG_MCUBOOT_CLEANUP_UNUSABLE_SECONDARY) &&\
@@ -1674,6 +1726,7 @@ boot_validated_swap_type(struct boot_loader_state *state,
 #endif
                 /* NSIB upgrade but for the wrong slot, must be erased */
                 BOOT_LOG_ERR("Image in slot is for wrong s0/s1 image");
+                boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
                 flash_area_erase(secondary_fa, 0, secondary_fa->fa_size);
                 sec_slot_untouch(state);
                 BOOT_LOG_ERR("Cleaned-up secondary slot of image %d", BOOT_CURR_IMG(state));
@@ -1693,7 +1746,7 @@ boot_validated_swap_type(struct boot_loader_state *state,
 
 #endif /* PM_S1_ADDRESS || PM_CPUNET_B0N_ADDRESS */
 
-    swap_type = boot_swap_type_multi(BOOT_CURR_IMG(state));
+    swap_type = boot_snapshot_swap_type(state);
     if (BOOT_IS_UPGRADE(swap_type)) {
         /* Boot loader wants to switch to the secondary slot.
          * Ensure image is valid.
@@ -1728,6 +1781,7 @@ boot_validated_swap_type(struct boot_loader_state *state,
                 swap_type = BOOT_SWAP_TYPE_FAIL;
             } else {
                 BOOT_LOG_INF("Done updating network core");
+                boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
 #if defined(MCUBOOT_SWAP_USING_SCRATCH) || defined(MCUBOOT_SWAP_USING_MOVE)
                 /* swap_erase_trailer_sectors is undefined if upgrade only
                  * method is used. There is no need to erase sectors, because
@@ -1850,21 +1904,40 @@ done:
  * Note that this function is intended for removing data not preparing device
  * for write.
  *
+ * With MCUBOOT_IMAGE_EXTENT, only the sectors of the image and of the trailer
+ * are scrambled, or the entire slot when the image header does not tell the
+ * size of the image.
+ *
+ * @param state     Boot loader status information.
  * @param fa        Pointer to flash area object for slot
  * @param slot      Slot the @p fa represents
  *
  * @return          0 on success; nonzero on failure.
  */
 int
-boot_scramble_slot(const struct flash_area *fa, int slot)
+boot_scramble_slot(struct boot_loader_state *state, const struct flash_area *fa, int slot)
 {
     size_t size;
     int ret = 0;
 
+    (void)state;
     (void)slot;
 
     /* Without minimal entire area needs to be scrambled */
 #if !defined(MCUBOOT_MINIMAL_SCRAMBLE)
+#if defined(MCUBOOT_IMAGE_EXTENT)
+    size_t off;
+
+    if (boot_image_scramble_sz(state, fa, slot, &size) == 0 &&
+        boot_trailer_scramble_offset(fa, 0, &off) == 0 && size < off) {
+        ret = boot_scramble_region(fa, 0, size, false);
+        if (ret < 0) {
+            return ret;
+        }
+
+        return boot_scramble_region(fa, off, (flash_area_get_size(fa) - off), true);
+    }
+#endif
     size = flash_area_get_size(fa);
     ret = boot_scramble_region(fa, 0, size, false);
 #else
@@ -1906,9 +1979,168 @@ static void like_mbedtls_zeroize(void *p, size_t n)
 }
 #endif
 
+#ifdef MCUBOOT_ENC_IMAGES
+/*
+ * Part of a chunk of a copy that is encrypted or decrypted: the payload, not
+ * the header or the TLVs.  Returns its size, with idx set to its start in
+ * the chunk and blk_off to its offset in the AES block.
+ */
+static uint32_t
+boot_copy_region_crypt_part(const struct image_header *hdr, uint32_t abs_off,
+                            uint32_t chunk_sz, uint16_t *idx, size_t *blk_off)
+{
+    uint32_t blk_sz;
+    uint32_t tlv_off;
+
+    if (abs_off < hdr->ih_hdr_size) {
+        /* do not decrypt header */
+        if (abs_off + chunk_sz > hdr->ih_hdr_size) {
+            /* The lower part of the chunk contains header data */
+            *blk_off = 0;
+            blk_sz = chunk_sz - (hdr->ih_hdr_size - abs_off);
+            *idx = hdr->ih_hdr_size  - abs_off;
+        } else {
+            /* The chunk contains exclusively header data */
+            return 0; /* nothing to decrypt */
+        }
+    } else {
+        *idx = 0;
+        blk_sz = chunk_sz;
+        *blk_off = (abs_off - hdr->ih_hdr_size) & 0xf;
+    }
+
+    tlv_off = BOOT_TLV_OFF(hdr);
+    if (abs_off + chunk_sz > tlv_off) {
+        /* do not decrypt TLVs */
+        if (abs_off >= tlv_off) {
+            blk_sz = 0;
+        } else {
+            blk_sz = tlv_off - abs_off;
+        }
+    }
+
+    return blk_sz;
+}
+#endif
+
+#if defined(MCUBOOT_ENC_IMAGES) && defined(MCUBOOT_CRYPTO_ASYNC)
+/*
+ * boot_copy_region() of a region that is encrypted or decrypted on the way:
+ * the AES of a chunk runs as a job while the next chunk is read into the
+ * other buffer, and the chunk is written once its job is complete.
+ */
+static int
+boot_copy_region_async(struct boot_loader_state *state,
+                       const struct flash_area *fap_src,
+                       const struct flash_area *fap_dst,
+                       uint32_t off_src, uint32_t off_dst, uint32_t sz,
+                       uint32_t abs_start, const struct image_header *hdr,
+                       int source_slot, uint8_t *buf)
+{
+    TARGET_STATIC uint8_t async_buf[BUF_SZ] __attribute__((aligned(4)));
+    struct bootutil_crypto_job jobs[2];
+    uint8_t *bufs[2];
+    uint32_t chunk_off[2];
+    uint32_t chunk_len[2] = { 0, 0 };
+    bool queued[2] = { false, false };
+    uint32_t bytes_read = 0;
+    uint32_t abs_off;
+    uint32_t blk_sz;
+    size_t blk_off;
+    uint16_t idx;
+    int cur = 0;
+    int rc = 0;
+    int i;
+
+    bufs[0] = buf;
+    bufs[1] = async_buf;
+
+    while (bytes_read < sz || chunk_len[0] != 0 || chunk_len[1] != 0) {
+        if (bytes_read < sz) {
+            chunk_len[cur] = sz - bytes_read;
+            if (chunk_len[cur] > BUF_SZ) {
+                chunk_len[cur] = BUF_SZ;
+            }
+            chunk_off[cur] = bytes_read;
+
+            rc = flash_area_read(fap_src, off_src + bytes_read, bufs[cur],
+                                 chunk_len[cur]);
+            if (rc != 0) {
+                rc = BOOT_EFLASH;
+                break;
+            }
+
+            abs_off = abs_start + bytes_read;
+            blk_sz = boot_copy_region_crypt_part(hdr, abs_off, chunk_len[cur],
+                                                 &idx, &blk_off);
+            if (blk_sz > 0) {
+                boot_enc_job(BOOT_CURR_ENC(state), source_slot,
+                             (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
+                             blk_off, &bufs[cur][idx], &jobs[cur]);
+                rc = bootutil_crypto_async_submit(&jobs[cur]);
+                if (rc != 0) {
+                    rc = BOOT_EBADIMAGE;
+                    break;
+                }
+                queued[cur] = true;
+            }
+
+            bytes_read += chunk_len[cur];
+        }
+
+        /* Write the chunk read before this one. */
+        cur ^= 1;
+        if (chunk_len[cur] != 0) {
+            if (queued[cur]) {
+                queued[cur] = false;
+                rc = bootutil_crypto_async_wait(&jobs[cur]);
+                if (rc != 0) {
+                    rc = BOOT_EBADIMAGE;
+                    break;
+                }
+            }
+
+            rc = flash_area_write(fap_dst, off_dst + chunk_off[cur], bufs[cur],
+                                  chunk_len[cur]);
+            if (rc != 0) {
+                rc = BOOT_EFLASH;
+                break;
+            }
+            chunk_len[cur] = 0;
+
+            MCUBOOT_WATCHDOG_FEED();
+        }
+    }
+
+    /* No job may be left on the buffers. */
+    for (i = 0; i < 2; i++) {
+        if (queued[i]) {
+            (void)bootutil_crypto_async_wait(&jobs[i]);
+        }
+    }
+
+    return rc;
+}
+#endif
+
+#if defined(MCUBOOT_FLASH_ASYNC)
+/* Wait for the erase of boot_erase_region_for_copy(), if still queued. */
+static int
+boot_erase_region_wait(struct boot_loader_state *state)
+{
+    if (!state->erase_queued) {
+        return 0;
+    }
+
+    state->erase_queued = false;
+    return bootutil_flash_async_wait(&state->erase_job);
+}
+#endif
+
 /**
  * Copies the contents of one flash region to another.  You must erase the
- * destination region prior to calling this function.
+ * destination region prior to calling this function, or have
+ * boot_erase_region_for_copy() do it.
  *
  * @param flash_area_id_src     The ID of the source flash area.
  * @param flash_area_id_dst     The ID of the destination flash area.
@@ -1940,7 +2172,6 @@ boot_copy_region(struct boot_loader_state *state,
     int rc;
 #ifdef MCUBOOT_ENC_IMAGES
     uint32_t off = off_dst;
-    uint32_t tlv_off;
     size_t blk_off;
     struct image_header *hdr;
     uint16_t idx;
@@ -1965,6 +2196,14 @@ boot_copy_region(struct boot_loader_state *state,
 #endif
 
     TARGET_STATIC uint8_t buf[BUF_SZ] __attribute__((aligned(4)));
+    uint8_t *chunk = buf;
+#if defined(MCUBOOT_FLASH_ASYNC)
+    TARGET_STATIC uint8_t flash_async_buf[BUF_SZ] __attribute__((aligned(4)));
+    struct bootutil_flash_job write_job;
+    bool write_queued = false;
+    /* The writes run while the next chunk is read from another device. */
+    bool overlap = bootutil_flash_async_concurrent(fap_dst, fap_src);
+#endif
 
 #ifdef MCUBOOT_ENC_IMAGES
     encrypted_src = (flash_area_get_id(fap_src) != FLASH_AREA_IMAGE_PRIMARY(image_index));
@@ -1992,12 +2231,42 @@ boot_copy_region(struct boot_loader_state *state,
     hdr = boot_img_hdr(state, BOOT_SECONDARY_SLOT);
 
     if (MUST_DECOMPRESS(fap_src, BOOT_CURR_IMG(state), hdr)) {
+#if defined(MCUBOOT_FLASH_ASYNC)
+        if (boot_erase_region_wait(state) != 0) {
+            return BOOT_EFLASH;
+        }
+#endif
         /* Use alternative function for compressed images */
         return boot_copy_region_decompress(state, fap_src, fap_dst, off_src, off_dst, sz, buf,
                                            BUF_SZ);
     }
 #endif
 
+#if defined(MCUBOOT_ENC_IMAGES) && defined(MCUBOOT_CRYPTO_ASYNC)
+    if (!only_copy && IS_ENCRYPTED(hdr)) {
+#if defined(MCUBOOT_FLASH_ASYNC)
+        if (boot_erase_region_wait(state) != 0) {
+            return BOOT_EFLASH;
+        }
+#endif
+#if defined(MCUBOOT_SWAP_USING_OFFSET)
+        return boot_copy_region_async(state, fap_src, fap_dst, off_src, off_dst,
+                                      sz, off - sector_off, hdr, source_slot,
+                                      buf);
+#else
+        return boot_copy_region_async(state, fap_src, fap_dst, off_src, off_dst,
+                                      sz, off, hdr, source_slot, buf);
+#endif
+    }
+#endif
+
+#if defined(MCUBOOT_FLASH_ASYNC)
+    if (!overlap && boot_erase_region_wait(state) != 0) {
+        return BOOT_EFLASH;
+    }
+#endif
+
+    rc = 0;
     bytes_copied = 0;
     while (bytes_copied < sz) {
         if (sz - bytes_copied > sizeof buf) {
@@ -2006,9 +2275,10 @@ boot_copy_region(struct boot_loader_state *state,
             chunk_sz = sz - bytes_copied;
         }
 
-        rc = flash_area_read(fap_src, off_src + bytes_copied, buf, chunk_sz);
+        rc = flash_area_read(fap_src, off_src + bytes_copied, chunk, chunk_sz);
         if (rc != 0) {
-            return BOOT_EFLASH;
+            rc = BOOT_EFLASH;
+            break;
         }
 
 #ifdef MCUBOOT_ENC_IMAGES
@@ -2020,50 +2290,58 @@ boot_copy_region(struct boot_loader_state *state,
 #else
             uint32_t abs_off = off + bytes_copied;
 #endif
-            if (abs_off < hdr->ih_hdr_size) {
-                /* do not decrypt header */
-                if (abs_off + chunk_sz > hdr->ih_hdr_size) {
-                    /* The lower part of the chunk contains header data */
-                    blk_off = 0;
-                    blk_sz = chunk_sz - (hdr->ih_hdr_size - abs_off);
-                    idx = hdr->ih_hdr_size  - abs_off;
-                } else {
-                    /* The chunk contains exclusively header data */
-                    blk_sz = 0; /* nothing to decrypt */
-                }
-            } else {
-                idx = 0;
-                blk_sz = chunk_sz;
-                blk_off = (abs_off - hdr->ih_hdr_size) & 0xf;
-            }
-
+            blk_sz = boot_copy_region_crypt_part(hdr, abs_off, chunk_sz, &idx,
+                                                 &blk_off);
             if (blk_sz > 0)
             {
-                tlv_off = BOOT_TLV_OFF(hdr);
-                if (abs_off + chunk_sz > tlv_off) {
-                    /* do not decrypt TLVs */
-                    if (abs_off >= tlv_off) {
-                        blk_sz = 0;
-                    } else {
-                        blk_sz = tlv_off - abs_off;
-                    }
-                }
                 if (source_slot == 0) {
                     boot_enc_encrypt(BOOT_CURR_ENC(state), source_slot,
                             (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
-                            blk_off, &buf[idx]);
+                            blk_off, &chunk[idx]);
                 } else {
                     boot_enc_decrypt(BOOT_CURR_ENC(state), source_slot,
                             (abs_off + idx) - hdr->ih_hdr_size, blk_sz,
-                            blk_off, &buf[idx]);
+                            blk_off, &chunk[idx]);
                 }
             }
         }
 #endif
 
-        rc = flash_area_write(fap_dst, off_dst + bytes_copied, buf, chunk_sz);
+#if defined(MCUBOOT_FLASH_ASYNC)
+        if (overlap) {
+            /* The other buffer is free once the write queued from it is. */
+            if (write_queued) {
+                write_queued = false;
+                rc = bootutil_flash_async_wait(&write_job);
+                if (rc != 0) {
+                    rc = BOOT_EFLASH;
+                    break;
+                }
+            }
+
+            write_job.op = BOOTUTIL_FLASH_JOB_WRITE;
+            write_job.fa = fap_dst;
+            write_job.off = off_dst + bytes_copied;
+            write_job.buf = chunk;
+            write_job.len = chunk_sz;
+            if (bootutil_flash_async_submit(&write_job) == 0) {
+                write_queued = true;
+                chunk = (chunk == buf) ? flash_async_buf : buf;
+            } else {
+                rc = boot_erase_region_wait(state);
+                if (rc == 0) {
+                    rc = flash_area_write(fap_dst, off_dst + bytes_copied, chunk,
+                                          chunk_sz);
+                }
+            }
+        } else
+#endif
+        {
+            rc = flash_area_write(fap_dst, off_dst + bytes_copied, chunk, chunk_sz);
+        }
         if (rc != 0) {
-            return BOOT_EFLASH;
+            rc = BOOT_EFLASH;
+            break;
         }
 
         bytes_copied += chunk_sz;
@@ -2071,13 +2349,402 @@ boot_copy_region(struct boot_loader_state *state,
         MCUBOOT_WATCHDOG_FEED();
     }
 
+#if defined(MCUBOOT_FLASH_ASYNC)
+    /* Nothing of the copy may be left running once it returns. */
+    if (write_queued && bootutil_flash_async_wait(&write_job) != 0) {
+        rc = BOOT_EFLASH;
+    }
+    if (boot_erase_region_wait(state) != 0) {
+        rc = BOOT_EFLASH;
+    }
+#endif
+
+    return rc;
+}
+
+/**
+ * Erases the destination of the boot_copy_region() from fap_src that
+ * follows.  With MCUBOOT_FLASH_ASYNC the erase is queued when the two areas
+ * are on different devices, and runs while the copy reads its first chunk;
+ * the copy waits for it before it returns.
+ *
+ * @param fap                   The flash_area containing the region to erase.
+ * @param off                   The offset within the flash area to start the
+ *                              erase.
+ * @param sz                    The number of bytes to erase.
+ * @param fap_src               The flash_area the copy reads from.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+int
+boot_erase_region_for_copy(struct boot_loader_state *state,
+                           const struct flash_area *fap, uint32_t off, uint32_t sz,
+                           const struct flash_area *fap_src)
+{
+#if defined(MCUBOOT_FLASH_ASYNC)
+    int rc;
+
+    rc = boot_erase_region_wait(state);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (bootutil_flash_async_concurrent(fap, fap_src)) {
+        state->erase_job.op = BOOTUTIL_FLASH_JOB_ERASE;
+        state->erase_job.fa = fap;
+        state->erase_job.off = off;
+        state->erase_job.buf = NULL;
+        state->erase_job.len = sz;
+        if (bootutil_flash_async_submit(&state->erase_job) == 0) {
+            state->erase_queued = true;
+            return 0;
+        }
+    }
+#else
+    (void)state;
+    (void)fap_src;
+#endif
+
+    return boot_erase_region(fap, off, sz, false);
+}
+
+#if defined(MCUBOOT_OVERWRITE_ONLY) || defined(MCUBOOT_BOOTSTRAP)
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+/*
+ * Progress of an overwrite upgrade.  Once a chunk of the primary slot is
+ * erased and written it is confirmed by setting the status entry of the
+ * index of its first sector in the trailer of the secondary slot, which the
+ * copy does not touch.  The entries hold for the image whose hash is recorded
+ * past the last of them, before the first one is set.  They go away with the
+ * sectors of the secondary slot from its status area on, once the upgrade is
+ * complete.
+ */
+static inline uint32_t
+boot_overwrite_progress_off(const struct flash_area *fap, size_t sect)
+{
+    return boot_status_off(fap) + sect * flash_area_align(fap);
+}
+
+/* Past the entries, the status area has room for BOOT_STATUS_STATE_COUNT
+ * of them per sector.
+ */
+static inline uint32_t
+boot_overwrite_hash_off(const struct flash_area *fap)
+{
+    return boot_overwrite_progress_off(fap, BOOT_STATUS_MAX_ENTRIES);
+}
+
+static bool
+boot_overwrite_progress_is_set(const struct flash_area *fap, size_t sect)
+{
+    uint8_t flag;
+
+    return flash_area_read(fap, boot_overwrite_progress_off(fap, sect),
+                           &flag, sizeof(flag)) == 0 && flag == BOOT_FLAG_SET;
+}
+
+/*
+ * Read the hash of the image in the secondary slot from its TLVs: the root of
+ * its hash tree, or its hash.
+ */
+static int
+boot_overwrite_image_hash(struct boot_loader_state *state, uint8_t *hash)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    struct image_tlv_iter it;
+    uint32_t off;
+    uint16_t len;
+    uint16_t type;
+    int rc;
+
+    rc = bootutil_tlv_iter_begin(&it, boot_img_hdr(state, BOOT_SECONDARY_SLOT),
+                                 fap, IMAGE_TLV_ANY, false);
+    if (rc != 0) {
+        return -1;
+    }
+
+    while (bootutil_tlv_iter_next(&it, &off, &len, &type) == 0) {
+#if defined(MCUBOOT_HASH_TREE)
+        if (type == IMAGE_TLV_HASH_TREE) {
+            return bootutil_hash_tree_tlv_root(boot_img_hdr(state, BOOT_SECONDARY_SLOT),
+                                               fap, off, len, NULL, hash);
+        }
+#endif
+        if (type == EXPECTED_HASH_TLV && len == IMAGE_HASH_SIZE) {
+            return flash_area_read(fap, off, hash, IMAGE_HASH_SIZE);
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Tell whether the entries hold for the image in the secondary slot.  With no
+ * hash recorded and no entry set yet, its hash is recorded first.  Entries
+ * left by an upgrade to another image, or by one that could not record its
+ * hash, cannot be cleared here: the copy is then not resumable.
+ */
+static bool
+boot_overwrite_progress_start(struct boot_loader_state *state, size_t sect_count)
+{
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
+    uint8_t buf[ALIGN_UP(IMAGE_HASH_SIZE, BOOT_MAX_ALIGN)];
+    uint8_t hash[IMAGE_HASH_SIZE];
+    uint8_t flag;
+    uint32_t off;
+    size_t sect;
+
+    off = boot_overwrite_hash_off(fap);
+    if (boot_overwrite_image_hash(state, hash) != 0 ||
+        flash_area_read(fap, off, buf, sizeof(hash)) != 0) {
+        return false;
+    }
+
+    if (memcmp(buf, hash, sizeof(hash)) == 0) {
+        return true;
+    }
+
+    if (!bootutil_buffer_is_erased(fap, buf, sizeof(hash))) {
+        return false;
+    }
+
+    for (sect = 0; sect < sect_count; sect++) {
+        if (flash_area_read(fap, boot_overwrite_progress_off(fap, sect),
+                            &flag, sizeof(flag)) != 0 ||
+            !bootutil_buffer_is_erased(fap, &flag, sizeof(flag))) {
+            return false;
+        }
+    }
+
+    memset(buf, flash_area_erased_val(fap), sizeof(buf));
+    memcpy(buf, hash, sizeof(hash));
+
+    return flash_area_write(fap, off, buf,
+                            ALIGN_UP(sizeof(hash), flash_area_align(fap))) == 0;
+}
+#endif /* MCUBOOT_OVERWRITE_ONLY_RESUME */
+
+/*
+ * Index of the sector after the chunk of the primary slot that starts with
+ * sector sect: the next one or, with MCUBOOT_FLASH_ERASE_RANGE, the first one
+ * past the largest erase block of the device that holds sect.
+ */
+static size_t
+boot_copy_chunk_end(struct boot_loader_state *state, size_t sect,
+                    size_t sect_count, uint32_t copy_end)
+{
+#if defined(MCUBOOT_FLASH_ERASE_RANGE)
+    const struct flash_area *fap = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
+    uint32_t blocks;
+    uint32_t block;
+    uint32_t off;
+
+    blocks = flash_area_erase_blocks(fap);
+    for (block = 1u << 31; block != 0 && (blocks & block) == 0; block >>= 1) {
+    }
+
+    if (block != 0) {
+        for (sect++; sect < sect_count; sect++) {
+            off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, sect);
+            if (off >= copy_end || ((flash_area_get_off(fap) + off) & (block - 1)) == 0) {
+                break;
+            }
+        }
+        return sect;
+    }
+#else
+    (void)state;
+    (void)sect_count;
+    (void)copy_end;
+#endif
+
+    return sect + 1;
+}
+
+/**
+ * Copies the secondary slot to the primary slot one chunk at a time: each
+ * chunk is erased and then written before the next one is erased, so that
+ * the primary slot is not left blank for the time of the whole erase.  With
+ * MCUBOOT_OVERWRITE_ONLY_RESUME, the copy starts from the first chunk that
+ * an interrupted upgrade did not confirm.  With MCUBOOT_DELTA_IMAGES, a
+ * delta image is built first and its target is copied instead.
+ *
+ * @param size                  Where to store the number of bytes copied.
+ *
+ * @return                      0 on success; nonzero on failure.
+ */
+static int
+boot_copy_image_chunks(struct boot_loader_state *state,
+                       const struct flash_area *fap_primary_slot,
+                       const struct flash_area *fap_secondary_slot,
+                       size_t *size)
+{
+    size_t sect_count;
+    size_t sect;
+    size_t next;
+    uint32_t copy_end;
+    uint32_t src_off;
+    uint32_t off;
+    uint32_t sz;
+    int rc;
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST) || defined(MCUBOOT_OVERWRITE_ONLY_RESUME) || \
+    defined(MCUBOOT_DELTA_IMAGES)
+    uint32_t src_size = 0;
+#endif
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST) || defined(MCUBOOT_DELTA_IMAGES)
+    bool image_only = false;
+#endif
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    size_t confirmed = 0;
+    bool resumable;
+#endif
+
+#if defined(MCUBOOT_SWAP_USING_OFFSET)
+    src_off = boot_img_sector_size(state, BOOT_SECONDARY_SLOT, 0);
+#else
+    src_off = 0;
+#endif
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST) || defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    rc = boot_read_image_size(state, BOOT_SECONDARY_SLOT, &src_size);
+    if (rc != 0) {
+        return BOOT_EBADIMAGE;
+    }
+#endif
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
+    image_only = true;
+#endif
+
+#if defined(MCUBOOT_DELTA_IMAGES)
+    if (IS_DELTA(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
+        /* Only the target is copied, the slot past it holds the delta image
+         * at best.
+         */
+        rc = boot_delta_apply(state, &src_off, &src_size);
+        if (rc != 0) {
+            return rc;
+        }
+        image_only = true;
+    }
+#endif
+
+    copy_end = flash_area_get_size(fap_primary_slot);
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST) || defined(MCUBOOT_DELTA_IMAGES)
+    if (image_only && ALIGN_UP(src_size, BOOT_WRITE_SZ(state)) < copy_end) {
+        copy_end = ALIGN_UP(src_size, BOOT_WRITE_SZ(state));
+    }
+#endif
+
+    sect_count = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT);
+    sect = 0;
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    /* Without room for the status entries next to the image, the copy
+     * starts over if it is interrupted.
+     */
+    resumable = (src_off + src_size <= boot_status_off(fap_secondary_slot)) &&
+                boot_overwrite_progress_start(state, sect_count);
+    if (resumable && boot_overwrite_progress_is_set(fap_secondary_slot, 0)) {
+        while (sect < sect_count) {
+            next = boot_copy_chunk_end(state, sect, sect_count, copy_end);
+            if (!boot_overwrite_progress_is_set(fap_secondary_slot, sect) ||
+                next >= sect_count ||
+                boot_img_sector_off(state, BOOT_PRIMARY_SLOT, next) >= copy_end) {
+                /* Once all the chunks are confirmed the last one is copied
+                 * again, it may hold the primary slot's trailer that was
+                 * written after it.
+                 */
+                break;
+            }
+            sect = next;
+        }
+        confirmed = sect;
+        BOOT_LOG_INF("Image %d resuming the copy at 0x%lx",
+                     BOOT_CURR_IMG(state),
+                     (unsigned long)boot_img_sector_off(state, BOOT_PRIMARY_SLOT, sect));
+    }
+#endif
+
+    BOOT_LOG_INF("Image %d copying the secondary slot to the primary slot: 0x%lx bytes",
+                 BOOT_CURR_IMG(state), (unsigned long)copy_end);
+
+    while (sect < sect_count) {
+        off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, sect);
+        if (off >= copy_end) {
+            break;
+        }
+
+        next = boot_copy_chunk_end(state, sect, sect_count, copy_end);
+        if (next < sect_count) {
+            sz = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, next) - off;
+        } else {
+            sz = flash_area_get_size(fap_primary_slot) - off;
+        }
+
+        rc = boot_erase_region_for_copy(state, fap_primary_slot, off, sz,
+                                        fap_secondary_slot);
+        if (rc != 0) {
+            return BOOT_EFLASH;
+        }
+
+        if (sz > copy_end - off) {
+            sz = copy_end - off;
+        }
+        rc = BOOT_COPY_REGION(state, fap_secondary_slot, fap_primary_slot,
+                              src_off + off, off, sz, 0);
+        if (rc != 0) {
+            return rc;
+        }
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+        if (resumable && (sect > confirmed ||
+                          !boot_overwrite_progress_is_set(fap_secondary_slot, sect))) {
+            rc = boot_write_trailer_flag(fap_secondary_slot,
+                                         boot_overwrite_progress_off(fap_secondary_slot, sect),
+                                         BOOT_FLAG_SET);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+#endif
+
+        sect = next;
+    }
+
+#if defined(MCUBOOT_OVERWRITE_ONLY_FAST) || defined(MCUBOOT_DELTA_IMAGES)
+    if (image_only) {
+        /* The sectors of the primary slot's trailer past the image. */
+        off = boot_status_off(fap_primary_slot);
+        for (next = 0; next < sect_count; next++) {
+            if (boot_img_sector_off(state, BOOT_PRIMARY_SLOT, next) +
+                boot_img_sector_size(state, BOOT_PRIMARY_SLOT, next) > off) {
+                break;
+            }
+        }
+        if (next < sect) {
+            next = sect;
+        }
+        if (next < sect_count) {
+            off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, next);
+            rc = boot_erase_region(fap_primary_slot, off,
+                                   flash_area_get_size(fap_primary_slot) - off, false);
+            if (rc != 0) {
+                return BOOT_EFLASH;
+            }
+        }
+    }
+#endif
+
+    *size = copy_end;
+
     return 0;
 }
 
 /**
  * Overwrite primary slot with the image contained in the secondary slot.
  * If a prior copy operation was interrupted by a system reset, this function
- * redos the copy.
+ * redos the copy, or with MCUBOOT_OVERWRITE_ONLY_RESUME resumes it.
  *
  * @param bs                    The current boot status.  This function reads
  *                                  this struct to determine if it is resuming
@@ -2087,39 +2754,22 @@ boot_copy_region(struct boot_loader_state *state,
  *
  * @return                      0 on success; nonzero on failure.
  */
-#if defined(MCUBOOT_OVERWRITE_ONLY) || defined(MCUBOOT_BOOTSTRAP)
 static int
 boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
 {
-    size_t sect_count;
-    size_t sect;
     int rc;
     size_t size;
-    size_t this_size;
     size_t last_sector;
+    uint32_t trailer_off;
     const struct flash_area *fap_primary_slot;
     const struct flash_area *fap_secondary_slot;
     uint8_t image_index;
 
-#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
-    uint32_t sector;
-    uint32_t trailer_sz;
-    uint32_t off;
-    uint32_t sz;
-#endif
-
     (void)bs;
 
-#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
-    uint32_t src_size = 0;
-    rc = boot_read_image_size(state, BOOT_SECONDARY_SLOT, &src_size);
-    assert(rc == 0);
-#endif
-
     image_index = BOOT_CURR_IMG(state);
 
     BOOT_LOG_INF("Image %d upgrade secondary slot -> primary slot", image_index);
-    BOOT_LOG_INF("Erasing the primary slot");
 
     fap_primary_slot = BOOT_IMG_AREA(state, BOOT_PRIMARY_SLOT);
     assert(fap_primary_slot != NULL);
@@ -2127,37 +2777,6 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     fap_secondary_slot = BOOT_IMG_AREA(state, BOOT_SECONDARY_SLOT);
     assert(fap_secondary_slot != NULL);
 
-    sect_count = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT);
-    for (sect = 0, size = 0; sect < sect_count; sect++) {
-        this_size = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, sect);
-        rc = boot_erase_region(fap_primary_slot, size, this_size, false);
-        assert(rc == 0);
-
-#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
-        if ((size + this_size) >= src_size) {
-            size += src_size - size;
-            size += BOOT_WRITE_SZ(state) - (size % BOOT_WRITE_SZ(state));
-            break;
-        }
-#endif
-
-        size += this_size;
-    }
-
-#if defined(MCUBOOT_OVERWRITE_ONLY_FAST)
-    trailer_sz = boot_trailer_sz(BOOT_WRITE_SZ(state));
-    sector = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT) - 1;
-    sz = 0;
-    do {
-        sz += boot_img_sector_size(state, BOOT_PRIMARY_SLOT, sector);
-        off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, sector);
-        sector--;
-    } while (sz < trailer_sz);
-
-    rc = boot_erase_region(fap_primary_slot, off, sz, false);
-    assert(rc == 0);
-#endif
-
 #ifdef MCUBOOT_ENC_IMAGES
     if (IS_ENCRYPTED(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
 #if defined(MCUBOOT_SWAP_USING_OFFSET) && defined(MCUBOOT_SERIAL_RECOVERY)
@@ -2179,14 +2798,8 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     }
 #endif
 
-    BOOT_LOG_INF("Image %d copying the secondary slot to the primary slot: 0x%zx bytes",
-                 image_index, size);
-#if defined(MCUBOOT_SWAP_USING_OFFSET)
-    rc = BOOT_COPY_REGION(state, fap_secondary_slot, fap_primary_slot,
-                          boot_img_sector_size(state, BOOT_SECONDARY_SLOT, 0), 0, size, 0);
-#else
-    rc = boot_copy_region(state, fap_secondary_slot, fap_primary_slot, 0, 0, size);
-#endif
+    rc = boot_copy_image_chunks(state, fap_primary_slot, fap_secondary_slot,
+                                &size);
     if (rc != 0) {
         return rc;
     }
@@ -2196,6 +2809,14 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
     if (rc != 0) {
         return rc;
     }
+#elif defined(MCUBOOT_DELTA_IMAGES)
+    /* The secondary slot's trailer was not copied with the target. */
+    if (IS_DELTA(boot_img_hdr(state, BOOT_SECONDARY_SLOT))) {
+        rc = boot_write_magic(fap_primary_slot);
+        if (rc != 0) {
+            return rc;
+        }
+    }
 #endif
 
     rc = BOOT_HOOK_CALL(boot_copy_region_post_hook, 0, BOOT_CURR_IMG(state),
@@ -2231,12 +2852,21 @@ boot_copy_image(struct boot_loader_state *state, struct boot_status *bs)
 #endif
 
     last_sector = boot_img_num_sectors(state, BOOT_SECONDARY_SLOT) - 1;
+#if defined(MCUBOOT_OVERWRITE_ONLY_RESUME)
+    /* The progress entries and the hash past them may span more than the
+     * last sector: all the sectors from the status area on go.
+     */
+    while (last_sector > 0 &&
+           boot_img_sector_off(state, BOOT_SECONDARY_SLOT, last_sector) >
+           boot_status_off(fap_secondary_slot)) {
+        last_sector--;
+    }
+#endif
+    trailer_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, last_sector);
     BOOT_LOG_DBG("erasing secondary trailer");
-    rc = boot_scramble_region(fap_secondary_slot,
-                              boot_img_sector_off(state, BOOT_SECONDARY_SLOT,
-                                    last_sector),
-                              boot_img_sector_size(state, BOOT_SECONDARY_SLOT,
-                                    last_sector), false);
+    rc = boot_scramble_region(fap_secondary_slot, trailer_off,
+                              flash_area_get_size(fap_secondary_slot) - trailer_off,
+                              false);
     assert(rc == 0);
 
     /* TODO: Perhaps verify the primary slot's signature again? */
@@ -2501,6 +3131,8 @@ boot_complete_partial_swap(struct boot_loader_state *state,
 {
     int rc;
 
+    boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
+
     /* Determine the type of swap operation being resumed from the
      * `swap-type` trailer field.
      */
@@ -2618,6 +3250,8 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
     int max_size;
 #endif
 
+    BOOT_SET_PHASE(state, BOOT_PHASE_PREPARE);
+
     /* Determine the sector layout of the image slots and scratch area. */
     rc = boot_read_sectors(state);
     if (rc != 0) {
@@ -2634,6 +3268,9 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
         }
     }
 
+    /* Read the trailers of both slots once, for all that follows. */
+    boot_snapshot_fill(state);
+
     /* Attempt to read an image header from each slot. */
     rc = boot_read_image_headers(state, false, NULL);
     if (rc != 0) {
@@ -2710,6 +3347,7 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
             /* Determine the type of swap operation being resumed from the
              * `swap-type` trailer field.
              */
+            BOOT_SET_PHASE(state, BOOT_PHASE_RESUME);
             rc = boot_complete_partial_swap(state, bs);
             assert(rc == 0);
 #endif
@@ -2734,6 +3372,7 @@ boot_prepare_image_for_update(struct boot_loader_state *state,
             BOOT_SWAP_TYPE(state) = BOOT_SWAP_TYPE_NONE;
         } else {
             /* There was no partial swap, determine swap type. */
+            BOOT_SET_PHASE(state, BOOT_PHASE_VALIDATE);
             if (bs->swap_type == BOOT_SWAP_TYPE_NONE) {
                 BOOT_SWAP_TYPE(state) = boot_validated_swap_type(state, bs);
             } else {
@@ -2798,12 +3437,14 @@ boot_update_hw_rollback_protection(struct boot_loader_state *state)
 {
 #ifdef MCUBOOT_HW_ROLLBACK_PROT
     int rc;
-    uint8_t image_index;
     struct boot_swap_state swap_state;
 
-    image_index = BOOT_CURR_IMG(state);
-
-    rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_PRIMARY(image_index), &swap_state);
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    rc = boot_snapshot_swap_state(state, BOOT_PRIMARY_SLOT, &swap_state);
+#else
+    rc = boot_read_swap_state_by_id(FLASH_AREA_IMAGE_PRIMARY(BOOT_CURR_IMG(state)),
+                                    &swap_state);
+#endif
     if (rc != 0) {
         return rc;
     }
@@ -2897,7 +3538,7 @@ check_downgrade_prevention(struct boot_loader_state *state)
     if (rc < 0) {
         /* Image in slot 0 prevents downgrade, delete image in slot 1 */
         BOOT_LOG_INF("Image %d in slot 1 erased due to downgrade prevention", BOOT_CURR_IMG(state));
-        boot_scramble_slot(BOOT_IMG_AREA(state, 1), BOOT_SECONDARY_SLOT);
+        boot_scramble_slot(state, BOOT_IMG_AREA(state, 1), BOOT_SECONDARY_SLOT);
     } else {
         rc = 0;
     }
@@ -3013,7 +3654,7 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
     }
 
     /* cleanup secondary slots which were recognized unusable*/
-    sec_slot_cleanup_if_unusable();
+    sec_slot_cleanup_if_unusable(state);
 
 #if (BOOT_IMAGE_NUMBER > 1)
     if (has_upgrade) {
@@ -3062,6 +3703,12 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
 
         /* Set the previously determined swap type */
         bs.swap_type = BOOT_SWAP_TYPE(state);
+        BOOT_SET_PHASE(state, BOOT_PHASE_UPDATE);
+
+        if (BOOT_SWAP_TYPE(state) != BOOT_SWAP_TYPE_NONE) {
+            /* The slots are written from here on. */
+            boot_snapshot_invalidate(state, BOOT_CURR_IMG(state));
+        }
 
         switch (BOOT_SWAP_TYPE(state)) {
         case BOOT_SWAP_TYPE_NONE:
@@ -3124,6 +3771,12 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
      * have been re-validated.
      */
     FIH_SET(fih_cnt, 0);
+#if defined(MCUBOOT_BATCH_VERIFY)
+    /* Only hash the images in this loop; their signatures are verified
+     * together after it, before anything else is done with the images.
+     */
+    bootutil_verify_sig_batch_start(state);
+#endif
     IMAGES_ITER(BOOT_CURR_IMG(state)) {
 #if BOOT_IMAGE_NUMBER > 1
         /* Hardenned to prevent from skipping check of a given image,
@@ -3136,6 +3789,7 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
             continue;
         }
 #endif
+        BOOT_SET_PHASE(state, BOOT_PHASE_SELECT);
         if (BOOT_SWAP_TYPE(state) != BOOT_SWAP_TYPE_NONE) {
             /* Attempt to read an image header from each slot. Ensure that image
              * headers in slots are aligned with headers in boot_data.
@@ -3171,7 +3825,13 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
         if (!image_validated_by_nsib)
 #endif
         {
+#if defined(MCUBOOT_BATCH_VERIFY)
+            state->batch_verify = true;
+#endif
             FIH_CALL(boot_validate_slot, fih_rc, state, BOOT_PRIMARY_SLOT, NULL, 0);
+#if defined(MCUBOOT_BATCH_VERIFY)
+            state->batch_verify = false;
+#endif
             /* Check for all possible values is redundant in normal operation it
              * is meant to prevent FI attack.
              */
@@ -3197,6 +3857,38 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
         }
 #endif /* MCUBOOT_VALIDATE_PRIMARY_SLOT */
 
+#if defined(MCUBOOT_BATCH_VERIFY)
+        ++fih_cnt;
+    }
+    if (FIH_NOT_EQ(fih_cnt, BOOT_IMAGE_NUMBER)) {
+        FIH_PANIC;
+    }
+
+    FIH_CALL(bootutil_verify_sig_batch_finish, fih_rc, state);
+    if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+        BOOT_LOG_ERR("Image in the primary slot is not valid!; Image=%u",
+                     BOOT_CURR_IMG(state));
+        FIH_SET(fih_rc, FIH_FAILURE);
+        goto out;
+    }
+
+    FIH_SET(fih_cnt, 0);
+    IMAGES_ITER(BOOT_CURR_IMG(state)) {
+#if BOOT_IMAGE_NUMBER > 1
+        volatile bool tmp_img_mask;
+        FIH_SET(tmp_img_mask, state->img_mask[BOOT_CURR_IMG(state)]);
+        if (FIH_EQ(tmp_img_mask, true)) {
+            ++fih_cnt;
+            continue;
+        }
+#endif
+
+#ifdef PM_S1_ADDRESS
+        bool image_validated_by_nsib = BOOT_CURR_IMG(state) ==
+                                       CONFIG_MCUBOOT_MCUBOOT_IMAGE_NUMBER;
+#endif
+#endif /* MCUBOOT_BATCH_VERIFY */
+
 #ifdef PM_S1_ADDRESS
         if (!image_validated_by_nsib)
 #endif
@@ -3224,6 +3916,7 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
         FIH_PANIC;
     }
 
+    BOOT_SET_PHASE(state, BOOT_PHASE_NONE);
     fill_rsp(state, rsp);
 
     fih_rc = FIH_SUCCESS;
@@ -3245,6 +3938,9 @@ out:
 #else
     memset(&bs, 0, sizeof(struct boot_status));
 #endif
+#if defined(MCUBOOT_ENC_IMAGES) && defined(MCUBOOT_ENC_KEY_CACHE)
+    boot_enc_cache_zeroize(state);
+#endif
 
     close_all_flash_areas(state);
     FIH_RET(fih_rc);
@@ -3483,7 +4179,11 @@ boot_select_or_erase(struct boot_loader_state *state)
          */
         BOOT_LOG_DBG("Erasing faulty image in the %s slot.",
                      (active_slot == BOOT_PRIMARY_SLOT) ? "primary" : "secondary");
+#if defined(MCUBOOT_IMAGE_EXTENT)
+        rc = boot_scramble_slot(state, fap, active_slot);
+#else
         rc = boot_scramble_region(fap, 0, flash_area_get_size(fap), false);
+#endif
         assert(rc == 0);
         rc = -1;
     } else {
@@ -3828,6 +4528,9 @@ context_boot_go(struct boot_loader_state *state, struct boot_rsp *rsp)
     fill_rsp(state, rsp);
 
 out:
+#if defined(MCUBOOT_ENC_IMAGES) && defined(MCUBOOT_ENC_KEY_CACHE)
+    boot_enc_cache_zeroize(state);
+#endif
     close_all_flash_areas(state);
 
     if (rc != 0) {
@@ -0,0 +1,198 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * RSA public operation with precomputed Montgomery constants of the
+ * built-in keys, see bootutil/crypto/rsa_mont.h.
+ */
+
+#include <string.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_RSA_MONT)
+
+#if !defined(MCUBOOT_SIGN_RSA) || defined(MCUBOOT_USE_PSA_CRYPTO)
+#error "MCUBOOT_RSA_MONT requires RSA signatures without PSA Crypto"
+#endif
+#if defined(MCUBOOT_HW_KEY) || defined(MCUBOOT_BUILTIN_KEY)
+#error "MCUBOOT_RSA_MONT requires the public keys to be built in"
+#endif
+
+#include "bootutil/sign_key.h"
+#include "bootutil/crypto/rsa_mont.h"
+
+#define RSA_MONT_BYTES  (MCUBOOT_SIGN_RSA_LEN / 8)
+
+/* Only public exponent the constants are made for. */
+static const uint8_t rsa_mont_e_der[] = { 0x02, 0x03, 0x01, 0x00, 0x01 };
+
+/* Value of limb i of a big endian number of RSA_MONT_BYTES bytes. */
+static uint32_t
+rsa_mont_get_limb(const uint8_t *be, int i)
+{
+    const uint8_t *p = &be[RSA_MONT_BYTES - 4 * (i + 1)];
+
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* Returns a < b. */
+static int
+rsa_mont_less(const uint32_t *a, const uint32_t *b)
+{
+    int i;
+
+    for (i = BOOTUTIL_RSA_MONT_LIMBS - 1; i >= 0; i--) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i];
+        }
+    }
+
+    return 0;
+}
+
+/* r = a - b, for a >= b. */
+static void
+rsa_mont_sub(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+    uint64_t borrow = 0;
+    uint64_t d;
+    int i;
+
+    for (i = 0; i < BOOTUTIL_RSA_MONT_LIMBS; i++) {
+        d = (uint64_t)a[i] - b[i] - borrow;
+        r[i] = (uint32_t)d;
+        borrow = (d >> 32) & 1;
+    }
+}
+
+/*
+ * r = a * b / R mod n, with a, b < n, using coarsely integrated operand
+ * scanning.  r may be the same as a or b.
+ */
+static void
+rsa_mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b,
+             const struct bootutil_rsa_mont *key)
+{
+    uint32_t t[BOOTUTIL_RSA_MONT_LIMBS + 2];
+    uint64_t c;
+    uint32_t m;
+    int i;
+    int j;
+
+    memset(t, 0, sizeof(t));
+
+    for (i = 0; i < BOOTUTIL_RSA_MONT_LIMBS; i++) {
+        c = 0;
+        for (j = 0; j < BOOTUTIL_RSA_MONT_LIMBS; j++) {
+            c += (uint64_t)a[j] * b[i] + t[j];
+            t[j] = (uint32_t)c;
+            c >>= 32;
+        }
+        c += t[BOOTUTIL_RSA_MONT_LIMBS];
+        t[BOOTUTIL_RSA_MONT_LIMBS] = (uint32_t)c;
+        t[BOOTUTIL_RSA_MONT_LIMBS + 1] = (uint32_t)(c >> 32);
+
+        /* Add m * n so the lowest limb becomes zero, and drop it. */
+        m = t[0] * key->n0inv;
+        c = ((uint64_t)m * key->n[0] + t[0]) >> 32;
+        for (j = 1; j < BOOTUTIL_RSA_MONT_LIMBS; j++) {
+            c += (uint64_t)m * key->n[j] + t[j];
+            t[j - 1] = (uint32_t)c;
+            c >>= 32;
+        }
+        c += t[BOOTUTIL_RSA_MONT_LIMBS];
+        t[BOOTUTIL_RSA_MONT_LIMBS - 1] = (uint32_t)c;
+        t[BOOTUTIL_RSA_MONT_LIMBS] = t[BOOTUTIL_RSA_MONT_LIMBS + 1] +
+                                     (uint32_t)(c >> 32);
+    }
+
+    /* The result is less than 2n. */
+    if (t[BOOTUTIL_RSA_MONT_LIMBS] != 0 || !rsa_mont_less(t, key->n)) {
+        rsa_mont_sub(r, t, key->n);
+    } else {
+        memcpy(r, t, BOOTUTIL_RSA_MONT_LIMBS * sizeof(uint32_t));
+    }
+}
+
+const struct bootutil_rsa_mont *
+bootutil_rsa_mont_find(uint8_t key_id)
+{
+    const struct bootutil_rsa_mont *mont;
+    unsigned int len;
+    const uint8_t *key;
+    const uint8_t *n;
+    int i;
+
+    if (key_id >= bootutil_key_cnt) {
+        return NULL;
+    }
+    mont = bootutil_rsa_monts[key_id];
+    if (mont == NULL) {
+        return NULL;
+    }
+
+    /*
+     * The key is an RSAPublicKey, which ends with the modulus and the
+     * exponent, so checking that the constants belong to the key needs no
+     * ASN.1 parsing.  The modulus has its top bit set, so it is encoded
+     * with a leading zero.
+     */
+    key = bootutil_keys[key_id].key;
+    len = *bootutil_keys[key_id].len;
+    if (len < sizeof(rsa_mont_e_der) + RSA_MONT_BYTES + 1 ||
+        memcmp(&key[len - sizeof(rsa_mont_e_der)], rsa_mont_e_der,
+               sizeof(rsa_mont_e_der)) != 0) {
+        return NULL;
+    }
+
+    n = &key[len - sizeof(rsa_mont_e_der) - RSA_MONT_BYTES];
+    if (n[-1] != 0 || (n[0] & 0x80) == 0) {
+        return NULL;
+    }
+    for (i = 0; i < BOOTUTIL_RSA_MONT_LIMBS; i++) {
+        if (rsa_mont_get_limb(n, i) != mont->n[i]) {
+            return NULL;
+        }
+    }
+
+    return mont;
+}
+
+int
+bootutil_rsa_mont_public(const struct bootutil_rsa_mont *key,
+                         const uint8_t *sig, uint8_t *em)
+{
+    uint32_t x[BOOTUTIL_RSA_MONT_LIMBS];
+    uint32_t y[BOOTUTIL_RSA_MONT_LIMBS];
+    int i;
+
+    for (i = 0; i < BOOTUTIL_RSA_MONT_LIMBS; i++) {
+        x[i] = rsa_mont_get_limb(sig, i);
+    }
+    if (!rsa_mont_less(x, key->n)) {
+        return -1;
+    }
+
+    /* y = x * R, then x^(2^16) * R, then x^65537. */
+    rsa_mont_mul(y, x, key->rr, key);
+    for (i = 0; i < 16; i++) {
+        rsa_mont_mul(y, y, y, key);
+    }
+    rsa_mont_mul(y, y, x, key);
+
+    for (i = 0; i < BOOTUTIL_RSA_MONT_LIMBS; i++) {
+        em[RSA_MONT_BYTES - 4 * i - 4] = (uint8_t)(y[i] >> 24);
+        em[RSA_MONT_BYTES - 4 * i - 3] = (uint8_t)(y[i] >> 16);
+        em[RSA_MONT_BYTES - 4 * i - 2] = (uint8_t)(y[i] >> 8);
+        em[RSA_MONT_BYTES - 4 * i - 1] = (uint8_t)y[i];
+    }
+
+    return 0;
+}
+
+#endif /* MCUBOOT_RSA_MONT */
@@ -0,0 +1,656 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ */
+
+/*
+ * In-tree SHA-2 hashes, see bootutil/crypto/sha_kernel.h.
+ */
+
+#include <string.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+
+#if defined(MCUBOOT_SHA_KERNEL)
+
+#include "bootutil/crypto/sha_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA_KERNEL_SHANI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_FEATURE_SHA2) && (defined(__aarch64__) || defined(__ARM_NEON))
+#define SHA_KERNEL_ARMV8
+#include <arm_neon.h>
+#endif
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t sha512_k[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint64_t sha384_iv[8] = {
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL,
+    0x152fecd8f70e5939ULL, 0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL,
+    0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+};
+
+static const uint64_t sha512_iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+    0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+#define ROTR32(x, n)    (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROTR64(x, n)    (((x) >> (n)) | ((x) << (64 - (n))))
+#define CH(x, y, z)     ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z)    (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define SHA256_S0(x)    (ROTR32(x, 2) ^ ROTR32(x, 13) ^ ROTR32(x, 22))
+#define SHA256_S1(x)    (ROTR32(x, 6) ^ ROTR32(x, 11) ^ ROTR32(x, 25))
+#define SHA256_s0(x)    (ROTR32(x, 7) ^ ROTR32(x, 18) ^ ((x) >> 3))
+#define SHA256_s1(x)    (ROTR32(x, 17) ^ ROTR32(x, 19) ^ ((x) >> 10))
+
+#define SHA512_S0(x)    (ROTR64(x, 28) ^ ROTR64(x, 34) ^ ROTR64(x, 39))
+#define SHA512_S1(x)    (ROTR64(x, 14) ^ ROTR64(x, 18) ^ ROTR64(x, 41))
+#define SHA512_s0(x)    (ROTR64(x, 1) ^ ROTR64(x, 8) ^ ((x) >> 7))
+#define SHA512_s1(x)    (ROTR64(x, 19) ^ ROTR64(x, 61) ^ ((x) >> 6))
+
+/*
+ * Word i of the message schedule, kept in the 16 words of w.  With a
+ * constant i, as in the unrolled rounds, the test is folded away.
+ */
+#define SHA_W(w, i, s0, s1)                                                 \
+    ((i) < 16 ? (w)[(i) & 15] :                                             \
+     ((w)[(i) & 15] += s1((w)[((i) - 2) & 15]) + (w)[((i) - 7) & 15] +      \
+                       s0((w)[((i) - 15) & 15])))
+
+/*
+ * Round i, with the working variables named in their order for this round.
+ * Only d and h change, the next round takes h as a.
+ */
+#define SHA_ROUND(a, b, c, d, e, f, g, h, i, type, k, S0, S1, s0, s1)       \
+    do {                                                                    \
+        type t1_ = (h) + S1(e) + CH(e, f, g) + (k)[i] +                     \
+                   SHA_W(w, i, s0, s1);                                     \
+        (d) += t1_;                                                         \
+        (h) = t1_ + S0(a) + MAJ(a, b, c);                                   \
+    } while (0)
+
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i)                             \
+    SHA_ROUND(a, b, c, d, e, f, g, h, i, uint32_t, sha256_k,                \
+              SHA256_S0, SHA256_S1, SHA256_s0, SHA256_s1)
+
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, i)                             \
+    SHA_ROUND(a, b, c, d, e, f, g, h, i, uint64_t, sha512_k,                \
+              SHA512_S0, SHA512_S1, SHA512_s0, SHA512_s1)
+
+/* Eight rounds from i, after which the variables are back in place. */
+#define SHA_ROUND8(ROUND, i)                                                \
+    do {                                                                    \
+        ROUND(a, b, c, d, e, f, g, h, (i) + 0);                             \
+        ROUND(h, a, b, c, d, e, f, g, (i) + 1);                             \
+        ROUND(g, h, a, b, c, d, e, f, (i) + 2);                             \
+        ROUND(f, g, h, a, b, c, d, e, (i) + 3);                             \
+        ROUND(e, f, g, h, a, b, c, d, (i) + 4);                             \
+        ROUND(d, e, f, g, h, a, b, c, (i) + 5);                             \
+        ROUND(c, d, e, f, g, h, a, b, (i) + 6);                             \
+        ROUND(b, c, d, e, f, g, h, a, (i) + 7);                             \
+    } while (0)
+
+static uint32_t
+sha_get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t
+sha_get_be64(const uint8_t *p)
+{
+    return ((uint64_t)sha_get_be32(p) << 32) | sha_get_be32(p + 4);
+}
+
+static void
+sha_put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void
+sha_put_be64(uint8_t *p, uint64_t v)
+{
+    sha_put_be32(p, (uint32_t)(v >> 32));
+    sha_put_be32(p + 4, (uint32_t)v);
+}
+
+static void
+sha256_blocks_c(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    uint32_t w[16];
+    uint32_t a, b, c, d, e, f, g, h;
+    int i;
+#if !defined(MCUBOOT_SHA_KERNEL_UNROLL)
+    uint32_t t;
+#endif
+
+    for (; blocks > 0; blocks--, data += BOOTUTIL_SHA256_BLOCK_SIZE) {
+        for (i = 0; i < 16; i++) {
+            w[i] = sha_get_be32(data + 4 * i);
+        }
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+#if defined(MCUBOOT_SHA_KERNEL_UNROLL)
+        SHA_ROUND8(SHA256_ROUND, 0);
+        SHA_ROUND8(SHA256_ROUND, 8);
+        SHA_ROUND8(SHA256_ROUND, 16);
+        SHA_ROUND8(SHA256_ROUND, 24);
+        SHA_ROUND8(SHA256_ROUND, 32);
+        SHA_ROUND8(SHA256_ROUND, 40);
+        SHA_ROUND8(SHA256_ROUND, 48);
+        SHA_ROUND8(SHA256_ROUND, 56);
+        (void)i;
+#else
+        for (i = 0; i < 64; i++) {
+            SHA256_ROUND(a, b, c, d, e, f, g, h, i);
+            t = h;
+            h = g;
+            g = f;
+            f = e;
+            e = d;
+            d = c;
+            c = b;
+            b = a;
+            a = t;
+        }
+#endif
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+static void
+sha512_blocks_c(uint64_t state[8], const uint8_t *data, size_t blocks)
+{
+    uint64_t w[16];
+    uint64_t a, b, c, d, e, f, g, h;
+    int i;
+#if !defined(MCUBOOT_SHA_KERNEL_UNROLL)
+    uint64_t t;
+#endif
+
+    for (; blocks > 0; blocks--, data += BOOTUTIL_SHA512_BLOCK_SIZE) {
+        for (i = 0; i < 16; i++) {
+            w[i] = sha_get_be64(data + 8 * i);
+        }
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+#if defined(MCUBOOT_SHA_KERNEL_UNROLL)
+        SHA_ROUND8(SHA512_ROUND, 0);
+        SHA_ROUND8(SHA512_ROUND, 8);
+        SHA_ROUND8(SHA512_ROUND, 16);
+        SHA_ROUND8(SHA512_ROUND, 24);
+        SHA_ROUND8(SHA512_ROUND, 32);
+        SHA_ROUND8(SHA512_ROUND, 40);
+        SHA_ROUND8(SHA512_ROUND, 48);
+        SHA_ROUND8(SHA512_ROUND, 56);
+        SHA_ROUND8(SHA512_ROUND, 64);
+        SHA_ROUND8(SHA512_ROUND, 72);
+        (void)i;
+#else
+        for (i = 0; i < 80; i++) {
+            SHA512_ROUND(a, b, c, d, e, f, g, h, i);
+            t = h;
+            h = g;
+            g = f;
+            f = e;
+            e = d;
+            d = c;
+            c = b;
+            b = a;
+            a = t;
+        }
+#endif
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+static const struct bootutil_sha_kernel sha_kernel_c = {
+#if defined(MCUBOOT_SHA_KERNEL_UNROLL)
+    .name = "c-unrolled",
+#else
+    .name = "c",
+#endif
+    .supported = NULL,
+    .sha256_blocks = sha256_blocks_c,
+    .sha512_blocks = sha512_blocks_c,
+};
+
+#if defined(SHA_KERNEL_SHANI)
+static int
+sha_shani_supported(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    /* SSSE3 and SSE4.1 are needed as well, for the shuffles and blends. */
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+        (ecx & (1u << 9)) == 0 || (ecx & (1u << 19)) == 0) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+
+    return (ebx & (1u << 29)) != 0;
+}
+
+/*
+ * The state is kept as ABEF and CDGH in two registers.  Each
+ * _mm_sha256rnds2_epu32() does two rounds, with the next four words of the
+ * schedule computed by _mm_sha256msg1_epu32() and _mm_sha256msg2_epu32().
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void
+sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                         0x0405060700010203ULL);
+    __m128i state0, state1, save0, save1;
+    __m128i msg[4];
+    __m128i tmp;
+    int i;
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; blocks > 0; blocks--, data += BOOTUTIL_SHA256_BLOCK_SIZE) {
+        save0 = state0;
+        save1 = state1;
+
+        for (i = 0; i < 16; i++) {
+            if (i < 4) {
+                msg[i] = _mm_shuffle_epi8(
+                    _mm_loadu_si128((const __m128i *)(data + 16 * i)), bswap);
+            } else {
+                /* W[t - 16] + s0(W[t - 15]) + W[t - 7], then s1(W[t - 2]). */
+                tmp = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(msg[(i + 3) & 3],
+                                                         msg[(i + 2) & 3], 4));
+                msg[i & 3] = _mm_sha256msg2_epu32(tmp, msg[(i + 3) & 3]);
+            }
+
+            tmp = _mm_add_epi32(msg[i & 3],
+                                _mm_loadu_si128((const __m128i *)&sha256_k[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, tmp);
+            tmp = _mm_shuffle_epi32(tmp, 0x0e);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, tmp);
+        }
+
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+static const struct bootutil_sha_kernel sha_kernel_shani = {
+    .name = "x86-sha-ni",
+    .supported = sha_shani_supported,
+    .sha256_blocks = sha256_blocks_shani,
+    .sha512_blocks = NULL,
+};
+#endif /* SHA_KERNEL_SHANI */
+
+#if defined(SHA_KERNEL_ARMV8)
+/*
+ * The state is kept as ABCD and EFGH in two registers.  Each
+ * vsha256hq_u32()/vsha256h2q_u32() pair does four rounds, with the next four
+ * words of the schedule computed by vsha256su0q_u32() and vsha256su1q_u32().
+ */
+static void
+sha256_blocks_armv8(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    uint32x4_t state0, state1, save0, save1;
+    uint32x4_t msg[4];
+    uint32x4_t tmp, tmp2;
+    int i;
+
+    state0 = vld1q_u32(&state[0]);
+    state1 = vld1q_u32(&state[4]);
+
+    for (; blocks > 0; blocks--, data += BOOTUTIL_SHA256_BLOCK_SIZE) {
+        save0 = state0;
+        save1 = state1;
+
+        for (i = 0; i < 4; i++) {
+            msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+
+        for (i = 0; i < 16; i++) {
+            tmp = vaddq_u32(msg[i & 3], vld1q_u32(&sha256_k[4 * i]));
+            if (i < 12) {
+                msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3],
+                                                             msg[(i + 1) & 3]),
+                                             msg[(i + 2) & 3], msg[(i + 3) & 3]);
+            }
+            tmp2 = state0;
+            state0 = vsha256hq_u32(state0, state1, tmp);
+            state1 = vsha256h2q_u32(state1, tmp2, tmp);
+        }
+
+        state0 = vaddq_u32(state0, save0);
+        state1 = vaddq_u32(state1, save1);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+
+static const struct bootutil_sha_kernel sha_kernel_armv8 = {
+    .name = "armv8-ce",
+    .supported = NULL,
+    .sha256_blocks = sha256_blocks_armv8,
+    .sha512_blocks = NULL,
+};
+#endif /* SHA_KERNEL_ARMV8 */
+
+const struct bootutil_sha_kernel *const bootutil_sha_kernels[] = {
+    &sha_kernel_c,
+#if defined(SHA_KERNEL_SHANI)
+    &sha_kernel_shani,
+#endif
+#if defined(SHA_KERNEL_ARMV8)
+    &sha_kernel_armv8,
+#endif
+};
+const int bootutil_sha_kernel_cnt =
+    sizeof(bootutil_sha_kernels) / sizeof(bootutil_sha_kernels[0]);
+
+static const struct bootutil_sha_kernel *sha_kernel;
+
+static int
+sha_kernel_supported(const struct bootutil_sha_kernel *kernel)
+{
+    return kernel->supported == NULL || kernel->supported();
+}
+
+int
+bootutil_sha_kernel_select(int index)
+{
+    if (index == -1) {
+        /* The default one is picked again on next use. */
+        sha_kernel = NULL;
+        return 0;
+    }
+
+    if (index < 0 || index >= bootutil_sha_kernel_cnt ||
+        !sha_kernel_supported(bootutil_sha_kernels[index])) {
+        return -1;
+    }
+
+    sha_kernel = bootutil_sha_kernels[index];
+    return 0;
+}
+
+static const struct bootutil_sha_kernel *
+sha_kernel_get(void)
+{
+    int i;
+
+    if (sha_kernel == NULL) {
+        for (i = bootutil_sha_kernel_cnt - 1; i >= 0; i--) {
+            if (sha_kernel_supported(bootutil_sha_kernels[i])) {
+                sha_kernel = bootutil_sha_kernels[i];
+                break;
+            }
+        }
+    }
+
+    return sha_kernel;
+}
+
+static void
+sha256_blocks(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    sha_kernel_get()->sha256_blocks(state, data, blocks);
+}
+
+static void
+sha512_blocks(uint64_t state[8], const uint8_t *data, size_t blocks)
+{
+    const struct bootutil_sha_kernel *kernel = sha_kernel_get();
+
+    if (kernel->sha512_blocks != NULL) {
+        kernel->sha512_blocks(state, data, blocks);
+    } else {
+        sha512_blocks_c(state, data, blocks);
+    }
+}
+
+void
+bootutil_sha256_init(struct bootutil_sha256_ctx *ctx)
+{
+    memcpy(ctx->state, sha256_iv, sizeof(ctx->state));
+    ctx->len = 0;
+}
+
+void
+bootutil_sha256_update(struct bootutil_sha256_ctx *ctx, const void *data,
+                       size_t len)
+{
+    const uint8_t *p = data;
+    size_t used = ctx->len % BOOTUTIL_SHA256_BLOCK_SIZE;
+    size_t n;
+
+    ctx->len += len;
+
+    /* Complete the block started by the previous updates. */
+    if (used != 0) {
+        n = BOOTUTIL_SHA256_BLOCK_SIZE - used;
+        if (n > len) {
+            memcpy(&ctx->buf[used], p, len);
+            return;
+        }
+        memcpy(&ctx->buf[used], p, n);
+        sha256_blocks(ctx->state, ctx->buf, 1);
+        p += n;
+        len -= n;
+    }
+
+    n = len / BOOTUTIL_SHA256_BLOCK_SIZE;
+    if (n > 0) {
+        sha256_blocks(ctx->state, p, n);
+        p += n * BOOTUTIL_SHA256_BLOCK_SIZE;
+        len -= n * BOOTUTIL_SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(ctx->buf, p, len);
+}
+
+void
+bootutil_sha256_finish(struct bootutil_sha256_ctx *ctx, uint8_t *output)
+{
+    size_t used = ctx->len % BOOTUTIL_SHA256_BLOCK_SIZE;
+    int i;
+
+    ctx->buf[used++] = 0x80;
+    if (used > BOOTUTIL_SHA256_BLOCK_SIZE - 8) {
+        memset(&ctx->buf[used], 0, BOOTUTIL_SHA256_BLOCK_SIZE - used);
+        sha256_blocks(ctx->state, ctx->buf, 1);
+        used = 0;
+    }
+    memset(&ctx->buf[used], 0, BOOTUTIL_SHA256_BLOCK_SIZE - 8 - used);
+    sha_put_be64(&ctx->buf[BOOTUTIL_SHA256_BLOCK_SIZE - 8], ctx->len << 3);
+    sha256_blocks(ctx->state, ctx->buf, 1);
+
+    for (i = 0; i < 8; i++) {
+        sha_put_be32(&output[4 * i], ctx->state[i]);
+    }
+}
+
+void
+bootutil_sha384_init(struct bootutil_sha512_ctx *ctx)
+{
+    memcpy(ctx->state, sha384_iv, sizeof(ctx->state));
+    ctx->len = 0;
+    ctx->digest_len = 48;
+}
+
+void
+bootutil_sha512_init(struct bootutil_sha512_ctx *ctx)
+{
+    memcpy(ctx->state, sha512_iv, sizeof(ctx->state));
+    ctx->len = 0;
+    ctx->digest_len = 64;
+}
+
+void
+bootutil_sha512_update(struct bootutil_sha512_ctx *ctx, const void *data,
+                       size_t len)
+{
+    const uint8_t *p = data;
+    size_t used = ctx->len % BOOTUTIL_SHA512_BLOCK_SIZE;
+    size_t n;
+
+    ctx->len += len;
+
+    if (used != 0) {
+        n = BOOTUTIL_SHA512_BLOCK_SIZE - used;
+        if (n > len) {
+            memcpy(&ctx->buf[used], p, len);
+            return;
+        }
+        memcpy(&ctx->buf[used], p, n);
+        sha512_blocks(ctx->state, ctx->buf, 1);
+        p += n;
+        len -= n;
+    }
+
+    n = len / BOOTUTIL_SHA512_BLOCK_SIZE;
+    if (n > 0) {
+        sha512_blocks(ctx->state, p, n);
+        p += n * BOOTUTIL_SHA512_BLOCK_SIZE;
+        len -= n * BOOTUTIL_SHA512_BLOCK_SIZE;
+    }
+
+    memcpy(ctx->buf, p, len);
+}
+
+void
+bootutil_sha512_finish(struct bootutil_sha512_ctx *ctx, uint8_t *output)
+{
+    size_t used = ctx->len % BOOTUTIL_SHA512_BLOCK_SIZE;
+    uint8_t digest[64];
+    int i;
+
+    ctx->buf[used++] = 0x80;
+    if (used > BOOTUTIL_SHA512_BLOCK_SIZE - 16) {
+        memset(&ctx->buf[used], 0, BOOTUTIL_SHA512_BLOCK_SIZE - used);
+        sha512_blocks(ctx->state, ctx->buf, 1);
+        used = 0;
+    }
+    /* The length in bits takes 128 bits, the upper half of which is zero. */
+    memset(&ctx->buf[used], 0, BOOTUTIL_SHA512_BLOCK_SIZE - 8 - used);
+    sha_put_be64(&ctx->buf[BOOTUTIL_SHA512_BLOCK_SIZE - 8], ctx->len << 3);
+    sha512_blocks(ctx->state, ctx->buf, 1);
+
+    for (i = 0; i < 8; i++) {
+        sha_put_be64(&digest[8 * i], ctx->state[i]);
+    }
+    memcpy(output, digest, ctx->digest_len);
+}
+
+#endif /* MCUBOOT_SHA_KERNEL */
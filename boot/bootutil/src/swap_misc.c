@@ -123,28 +123,8 @@ swap_status_init(const struct boot_loader_state *state,
                               &swap_state);
     assert(rc == 0);
 
-    if (bs->swap_type != BOOT_SWAP_TYPE_NONE) {
-        rc = boot_write_swap_info(fap, bs->swap_type, image_index);
-        assert(rc == 0);
-    }
-
-    if (swap_state.image_ok == BOOT_FLAG_SET) {
-        rc = boot_write_image_ok(fap);
-        assert(rc == 0);
-    }
-
-    rc = boot_write_swap_size(fap, bs->swap_size);
-    assert(rc == 0);
-
-#ifdef MCUBOOT_ENC_IMAGES
-    rc = boot_write_enc_key(fap, 0, bs);
-    assert(rc == 0);
-
-    rc = boot_write_enc_key(fap, 1, bs);
-    assert(rc == 0);
-#endif
-
-    rc = boot_write_magic(fap);
+    rc = boot_write_trailer_info(fap, bs->swap_type, image_index,
+                                 swap_state.image_ok == BOOT_FLAG_SET, bs);
     assert(rc == 0);
 
     return 0;
@@ -156,6 +136,9 @@ swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
     const struct flash_area *fap;
     uint32_t off;
     uint8_t swap_info;
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    struct boot_swap_state swap_state;
+#endif
     int rc;
 
     bs->source = swap_status_source(state);
@@ -181,6 +164,15 @@ swap_read_status(struct boot_loader_state *state, struct boot_status *bs)
     assert(fap != NULL);
 
     rc = swap_read_status_bytes(fap, state, bs);
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    if (rc == 0 && bs->source == BOOT_STATUS_SOURCE_PRIMARY_SLOT) {
+        rc = boot_snapshot_swap_state(state, BOOT_PRIMARY_SLOT, &swap_state);
+        if (rc == 0) {
+            bs->swap_type = swap_state.swap_type;
+        }
+        goto done;
+    }
+#endif
     if (rc == 0) {
         off = boot_swap_info_off(fap);
         rc = flash_area_read(fap, off, &swap_info, sizeof swap_info);
@@ -68,6 +68,58 @@ find_last_idx(struct boot_loader_state *state, uint32_t swap_size)
     return last_idx;
 }
 
+/*
+ * Index of the first sector of the primary slot that holds the trailer.
+ */
+static uint32_t
+find_first_trailer_idx(struct boot_loader_state *state)
+{
+    uint32_t sector_sz;
+    uint32_t sz;
+    uint32_t trailer_sz;
+    uint32_t first_trailer_idx;
+
+    sector_sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+    trailer_sz = boot_trailer_sz(BOOT_WRITE_SZ(state));
+    first_trailer_idx = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT) - 1;
+    sz = 0;
+    while (1) {
+        sz += sector_sz;
+        if (sz >= trailer_sz) {
+            break;
+        }
+        first_trailer_idx--;
+    }
+
+    return first_trailer_idx;
+}
+
+/*
+ * Number of sectors moved or swapped by each step of a swap of last_idx
+ * sectors, which is also how far up the image is moved in the primary slot:
+ * MCUBOOT_SWAP_MOVE_BATCH_SECTORS, or less when there are fewer free sectors
+ * between the image and the trailer.  It only depends on the swap size and on
+ * the layout of the primary slot, so that a resumed swap runs the same steps.
+ */
+static uint32_t
+find_batch_sectors(struct boot_loader_state *state, uint32_t last_idx)
+{
+    uint32_t first_trailer_idx;
+    uint32_t batch;
+
+    batch = MCUBOOT_SWAP_MOVE_BATCH_SECTORS;
+    if (batch > 1) {
+        first_trailer_idx = find_first_trailer_idx(state);
+        if (first_trailer_idx <= last_idx) {
+            batch = 1;
+        } else if (first_trailer_idx - last_idx < batch) {
+            batch = first_trailer_idx - last_idx;
+        }
+    }
+
+    return batch;
+}
+
 int
 boot_read_image_header(struct boot_loader_state *state, int slot,
                        struct image_header *out_hdr, struct boot_status *bs)
@@ -76,6 +128,8 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     uint32_t off;
     uint32_t sz;
     uint32_t last_idx;
+    uint32_t batch;
+    uint32_t steps;
     uint32_t swap_size;
     int rc;
 
@@ -92,16 +146,18 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
         }
 
         last_idx = find_last_idx(state, swap_size);
-        sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0);
+        batch = find_batch_sectors(state, last_idx);
+        steps = (last_idx + batch - 1) / batch;
+        sz = boot_img_sector_size(state, BOOT_PRIMARY_SLOT, 0) * batch;
 
         /*
          * Find the correct offset or slot where the image header is expected to
          * be found for the steps where it is moved or swapped.
          */
-        if (bs->op == BOOT_STATUS_OP_MOVE && slot == 0 && bs->idx > last_idx) {
+        if (bs->op == BOOT_STATUS_OP_MOVE && slot == 0 && bs->idx > steps) {
             off = sz;
         } else if (bs->op == BOOT_STATUS_OP_SWAP) {
-            if (bs->idx > 1 && bs->idx <= last_idx) {
+            if (bs->idx > 1 && bs->idx <= steps) {
                 slot = (slot == 0) ? 1 : 0;
             } else if (bs->idx == 1) {
                 if (slot == 0) {
@@ -327,22 +383,13 @@ swap_status_source(struct boot_loader_state *state)
     struct boot_swap_state state_primary_slot;
     struct boot_swap_state state_secondary_slot;
     int rc;
-    uint8_t image_index;
-
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
-#endif
 
-    image_index = BOOT_CURR_IMG(state);
-
-    rc = boot_read_swap_state(state->imgs[image_index][BOOT_PRIMARY_SLOT].area,
-                              &state_primary_slot);
+    rc = boot_snapshot_swap_state(state, BOOT_PRIMARY_SLOT, &state_primary_slot);
     assert(rc == 0);
 
     BOOT_LOG_SWAP_STATE("Primary image", &state_primary_slot);
 
-    rc = boot_read_swap_state(state->imgs[image_index][BOOT_SECONDARY_SLOT].area,
-                              &state_secondary_slot);
+    rc = boot_snapshot_swap_state(state, BOOT_SECONDARY_SLOT, &state_secondary_slot);
     assert(rc == 0);
 
     BOOT_LOG_SWAP_STATE("Secondary image", &state_secondary_slot);
@@ -360,10 +407,10 @@ swap_status_source(struct boot_loader_state *state)
 }
 
 /*
- * "Moves" the sector located at idx - 1 to idx.
+ * "Moves" the sz bytes of sectors located at idx up to idx + batch.
  */
 static void
-boot_move_sector_up(int idx, uint32_t sz, struct boot_loader_state *state,
+boot_move_sector_up(int idx, uint32_t batch, uint32_t sz, struct boot_loader_state *state,
         struct boot_status *bs, const struct flash_area *fap_pri,
         const struct flash_area *fap_sec)
 {
@@ -377,8 +424,8 @@ boot_move_sector_up(int idx, uint32_t sz, struct boot_loader_state *state,
      */
 
     /* Calculate offset from start of image area. */
-    new_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx);
-    old_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx - 1);
+    new_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx + batch);
+    old_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx);
 
     if (bs->idx == BOOT_STATUS_IDX_0) {
         if (bs->source != BOOT_STATUS_SOURCE_PRIMARY_SLOT) {
@@ -409,8 +456,12 @@ boot_move_sector_up(int idx, uint32_t sz, struct boot_loader_state *state,
     BOOT_STATUS_ASSERT(rc == 0);
 }
 
+/*
+ * Swaps the sz bytes of sectors located at idx in the secondary slot with
+ * the ones moved up to idx + batch in the primary slot.
+ */
 static void
-boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
+boot_swap_sectors(int idx, uint32_t batch, uint32_t sz, struct boot_loader_state *state,
         struct boot_status *bs, const struct flash_area *fap_pri,
         const struct flash_area *fap_sec)
 {
@@ -419,12 +470,12 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     uint32_t sec_off;
     int rc;
 
-    pri_up_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx);
-    pri_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx - 1);
-    sec_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx - 1);
+    pri_up_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx + batch);
+    pri_off = boot_img_sector_off(state, BOOT_PRIMARY_SLOT, idx);
+    sec_off = boot_img_sector_off(state, BOOT_SECONDARY_SLOT, idx);
 
     if (bs->state == BOOT_STATUS_STATE_0) {
-        rc = boot_erase_region(fap_pri, pri_off, sz, false);
+        rc = boot_erase_region_for_copy(state, fap_pri, pri_off, sz, fap_sec);
         assert(rc == 0);
 
         rc = boot_copy_region(state, fap_sec, fap_pri, sec_off, pri_off, sz);
@@ -436,7 +487,7 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     }
 
     if (bs->state == BOOT_STATUS_STATE_1) {
-        rc = boot_erase_region(fap_sec, sec_off, sz, false);
+        rc = boot_erase_region_for_copy(state, fap_sec, sec_off, sz, fap_pri);
         assert(rc == 0);
 
         rc = boot_copy_region(state, fap_pri, fap_sec, pri_up_off, sec_off, sz);
@@ -502,12 +553,13 @@ void
 swap_run(struct boot_loader_state *state, struct boot_status *bs,
          uint32_t copy_size)
 {
-    uint32_t sz;
     uint32_t sector_sz;
     uint32_t idx;
-    uint32_t trailer_sz;
+    uint32_t n;
+    uint32_t step;
     uint32_t first_trailer_idx;
     uint32_t last_idx;
+    uint32_t batch;
     const struct flash_area *fap_pri;
     const struct flash_area *fap_sec;
 
@@ -520,17 +572,7 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
      * When starting a new swap upgrade, check that there is enough space.
      */
     if (boot_status_is_reset(bs)) {
-        sz = 0;
-        trailer_sz = boot_trailer_sz(BOOT_WRITE_SZ(state));
-        first_trailer_idx = boot_img_num_sectors(state, BOOT_PRIMARY_SLOT) - 1;
-
-        while (1) {
-            sz += sector_sz;
-            if  (sz >= trailer_sz) {
-                break;
-            }
-            first_trailer_idx--;
-        }
+        first_trailer_idx = find_first_trailer_idx(state);
 
         if (last_idx >= first_trailer_idx) {
             BOOT_LOG_WRN("Not enough free space to run swap upgrade");
@@ -550,25 +592,40 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
 
     fixup_revert(state, bs, fap_sec);
 
+    /*
+     * Each step moves, and then swaps, up to batch sectors, with one status
+     * entry for all of them.  The image is moved up by batch sectors, so that
+     * the sectors of a step never overlap with the ones it copies to.
+     */
+    batch = find_batch_sectors(state, last_idx);
+
     if (bs->op == BOOT_STATUS_OP_MOVE) {
+        /* From the top of the image down. */
         idx = last_idx;
+        step = BOOT_STATUS_IDX_0;
         while (idx > 0) {
-            if (idx <= (last_idx - bs->idx + 1)) {
-                boot_move_sector_up(idx, sector_sz, state, bs, fap_pri, fap_sec);
+            n = (idx < batch) ? idx : batch;
+            idx -= n;
+            if (step >= bs->idx) {
+                boot_move_sector_up(idx, batch, n * sector_sz, state, bs, fap_pri, fap_sec);
             }
-            idx--;
+            step++;
         }
         bs->idx = BOOT_STATUS_IDX_0;
     }
 
     bs->op = BOOT_STATUS_OP_SWAP;
 
-    idx = 1;
-    while (idx <= last_idx) {
-        if (idx >= bs->idx) {
-            boot_swap_sectors(idx, sector_sz, state, bs, fap_pri, fap_sec);
+    /* From the bottom of the image up. */
+    idx = 0;
+    step = BOOT_STATUS_IDX_0;
+    while (idx < last_idx) {
+        n = (last_idx - idx < batch) ? last_idx - idx : batch;
+        if (step >= bs->idx) {
+            boot_swap_sectors(idx, batch, n * sector_sz, state, bs, fap_pri, fap_sec);
         }
-        idx++;
+        idx += n;
+        step++;
     }
 }
 
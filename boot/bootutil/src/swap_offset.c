@@ -96,7 +96,7 @@ int boot_read_image_header(struct boot_loader_state *state, int slot,
         fap = BOOT_IMG_AREA(state, slot);
 
         if (slot == BOOT_SECONDARY_SLOT &&
-            boot_swap_type_multi(BOOT_CURR_IMG(state)) != BOOT_SWAP_TYPE_REVERT) {
+            boot_snapshot_swap_type(state) != BOOT_SWAP_TYPE_REVERT) {
             off = boot_img_sector_size(state, BOOT_SECONDARY_SLOT, 0);
         }
     } else {
@@ -117,7 +117,7 @@ int boot_read_image_header(struct boot_loader_state *state, int slot,
              * be found for the steps where it is moved or swapped.
              */
             if (bs->swap_type == BOOT_SWAP_TYPE_REVERT ||
-                boot_swap_type_multi(BOOT_CURR_IMG(state)) == BOOT_SWAP_TYPE_REVERT) {
+                boot_snapshot_swap_type(state) == BOOT_SWAP_TYPE_REVERT) {
                 if (slot == 0) {
                     if (((bs->idx - BOOT_STATUS_IDX_0) > last_idx ||
                          ((bs->idx - BOOT_STATUS_IDX_0) == last_idx &&
@@ -166,7 +166,7 @@ int boot_read_image_header(struct boot_loader_state *state, int slot,
             fap = BOOT_IMG_AREA(state, slot);
 
             if (bs->swap_type == BOOT_SWAP_TYPE_REVERT ||
-                boot_swap_type_multi(BOOT_CURR_IMG(state)) == BOOT_SWAP_TYPE_REVERT) {
+                boot_snapshot_swap_type(state) == BOOT_SWAP_TYPE_REVERT) {
                 off = 0;
             }
             else if (slot == BOOT_SECONDARY_SLOT) {
@@ -185,7 +185,7 @@ int boot_read_image_header(struct boot_loader_state *state, int slot,
 
     if (check_other_sector == true && out_hdr->ih_magic != IMAGE_MAGIC &&
         slot == BOOT_SECONDARY_SLOT) {
-        if (boot_swap_type_multi(BOOT_CURR_IMG(state)) != BOOT_SWAP_TYPE_REVERT) {
+        if (boot_snapshot_swap_type(state) != BOOT_SWAP_TYPE_REVERT) {
             off = 0;
         } else {
             off = boot_img_sector_size(state, BOOT_SECONDARY_SLOT, 0);
@@ -388,20 +388,12 @@ int swap_status_source(struct boot_loader_state *state)
     struct boot_swap_state state_primary_slot;
     struct boot_swap_state state_secondary_slot;
     int rc;
-    uint8_t image_index;
 
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
-#endif
-
-    image_index = BOOT_CURR_IMG(state);
-    rc = boot_read_swap_state(state->imgs[image_index][BOOT_PRIMARY_SLOT].area,
-                              &state_primary_slot);
+    rc = boot_snapshot_swap_state(state, BOOT_PRIMARY_SLOT, &state_primary_slot);
     assert(rc == 0);
     BOOT_LOG_SWAP_STATE("Primary image", &state_primary_slot);
 
-    rc = boot_read_swap_state(state->imgs[image_index][BOOT_SECONDARY_SLOT].area,
-                              &state_secondary_slot);
+    rc = boot_snapshot_swap_state(state, BOOT_SECONDARY_SLOT, &state_secondary_slot);
     assert(rc == 0);
     BOOT_LOG_SWAP_STATE("Secondary image", &state_secondary_slot);
 
@@ -438,7 +430,7 @@ static void boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *st
         } else {
             /* Copy from slot 0 X to slot 1 X */
             BOOT_LOG_DBG("Erasing secondary 0x%x of 0x%x", sec_off, sz);
-            rc = boot_erase_region(fap_sec, sec_off, sz, false);
+            rc = boot_erase_region_for_copy(state, fap_sec, sec_off, sz, fap_pri);
             assert(rc == 0);
 
             BOOT_LOG_DBG("Copying primary 0x%x -> secondary 0x%x of 0x%x", pri_off, sec_off, sz);
@@ -458,7 +450,7 @@ static void boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *st
         } else {
             /* Erase slot 0 X */
             BOOT_LOG_DBG("Erasing primary 0x%x of 0x%x", pri_off, sz);
-            rc = boot_erase_region(fap_pri, pri_off, sz, false);
+            rc = boot_erase_region_for_copy(state, fap_pri, pri_off, sz, fap_sec);
             assert(rc == 0);
 
             /* Copy from slot 1 (X + 1) to slot 0 X */
@@ -499,7 +491,7 @@ static void boot_swap_sectors_revert(int idx, uint32_t sz, struct boot_loader_st
         } else {
             /* Copy from slot 0 X to slot 1 X */
             BOOT_LOG_DBG("Erasing secondary 0x%x of 0x%x", sec_off, sz);
-            rc = boot_erase_region(fap_sec, sec_off, sz, false);
+            rc = boot_erase_region_for_copy(state, fap_sec, sec_off, sz, fap_pri);
             assert(rc == 0);
 
             BOOT_LOG_DBG("Copying primary 0x%x -> secondary 0x%x of 0x%x", pri_off, sec_off, sz);
@@ -519,7 +511,7 @@ static void boot_swap_sectors_revert(int idx, uint32_t sz, struct boot_loader_st
         } else {
             /* Erase slot 0 X */
             BOOT_LOG_DBG("Erasing primary 0x%x of 0x%x", pri_off, sz);
-            rc = boot_erase_region(fap_pri, pri_off, sz, false);
+            rc = boot_erase_region_for_copy(state, fap_pri, pri_off, sz, fap_sec);
             assert(rc == 0);
 
             /* Copy from slot 1 (X + 1) to slot 0 X */
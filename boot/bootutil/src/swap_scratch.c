@@ -492,15 +492,8 @@ swap_status_source(struct boot_loader_state *state)
     int rc;
     size_t i;
     uint8_t source;
-    uint8_t image_index;
-
-#if (BOOT_IMAGE_NUMBER == 1)
-    (void)state;
-#endif
 
-    image_index = BOOT_CURR_IMG(state);
-    rc = boot_read_swap_state(state->imgs[image_index][BOOT_PRIMARY_SLOT].area,
-                              &state_primary_slot);
+    rc = boot_snapshot_swap_state(state, BOOT_PRIMARY_SLOT, &state_primary_slot);
     assert(rc == 0);
 
 #if MCUBOOT_SWAP_USING_SCRATCH
@@ -677,20 +670,96 @@ find_swap_count(const struct boot_loader_state *state, uint32_t copy_size)
     return swap_count;
 }
 
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+/*
+ * The steps of a swap after the first one use the scratch area in turns: each
+ * one starts where the previous one ended, on a sector boundary, and the
+ * first of them starts at the sector holding copy_size modulo the size of the
+ * scratch area.  The offsets only depend on the swap size, which is kept in
+ * the trailer until the swap is complete, so a resumed swap finds the data of
+ * the step it resumes.  A step that does not fit before the end of the
+ * scratch area starts at its beginning.
+ */
+static uint32_t
+boot_scratch_first_off(const struct boot_loader_state *state, uint32_t copy_size)
+{
+    const struct flash_area *fap_scratch = state->scratch.area;
+    struct flash_sector sector;
+
+    if (flash_area_get_sector(fap_scratch, copy_size % flash_area_get_size(fap_scratch),
+                              &sector) != 0) {
+        return 0;
+    }
+
+    return flash_sector_get_off(&sector);
+}
+
+static uint32_t
+boot_scratch_next_off(const struct boot_loader_state *state, uint32_t sz,
+                      uint32_t *next_off)
+{
+    const struct flash_area *fap_scratch = state->scratch.area;
+    struct flash_sector sector;
+    uint32_t off;
+
+    off = *next_off;
+    if (off + sz > flash_area_get_size(fap_scratch)) {
+        off = 0;
+    }
+
+    if (flash_area_get_sector(fap_scratch, off + sz - 1, &sector) != 0) {
+        *next_off = 0;
+        return 0;
+    }
+
+    *next_off = flash_sector_get_off(&sector) + flash_sector_get_size(&sector);
+    return off;
+}
+
+/* Offset in the scratch area of the step swap_idx of a swap of copy_size. */
+static uint32_t
+boot_scratch_step_off(const struct boot_loader_state *state, uint32_t copy_size,
+                      uint32_t swap_idx)
+{
+    uint32_t next_off;
+    uint32_t off;
+    uint32_t sz;
+    uint32_t i;
+    int first_sector_idx;
+    int last_sector_idx;
+
+    last_sector_idx = find_last_sector_idx(state, copy_size);
+    next_off = boot_scratch_first_off(state, copy_size);
+    off = 0;
+
+    for (i = 0; i <= swap_idx && last_sector_idx >= 0; i++) {
+        sz = boot_copy_sz(state, last_sector_idx, &first_sector_idx);
+        if (i != 0) {
+            off = boot_scratch_next_off(state, sz, &next_off);
+        }
+        last_sector_idx = first_sector_idx - 1;
+    }
+
+    return off;
+}
+#endif
+
 /**
  * Swaps the contents of two flash regions within the two image slots.
  *
  * @param idx                   The index of the first sector in the range of
  *                                  sectors being swapped.
  * @param sz                    The number of bytes to swap.
+ * @param scratch_off           The offset in the scratch area of the copy of
+ *                                  the region; 0 for the first step.
  * @param bs                    The current boot status.  This struct gets
  *                                  updated according to the outcome.
  *
  * @return                      0 on success; nonzero on failure.
  */
 static void
-boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
-        struct boot_status *bs)
+boot_swap_sectors(int idx, uint32_t sz, uint32_t scratch_off,
+        struct boot_loader_state *state, struct boot_status *bs)
 {
     const struct flash_area *fap_primary_slot;
     const struct flash_area *fap_secondary_slot;
@@ -759,8 +828,17 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
     bs->use_scratch = (bs->idx == BOOT_STATUS_IDX_0 && copy_sz != sz);
 
     if (bs->state == BOOT_STATUS_STATE_0) {
-        BOOT_LOG_DBG("erasing scratch area");
-        rc = boot_erase_region(fap_scratch, 0, flash_area_get_size(fap_scratch), false);
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+        if (bs->idx != BOOT_STATUS_IDX_0) {
+            /* Only the sectors this step writes to. */
+            BOOT_LOG_DBG("erasing scratch area at 0x%x", scratch_off);
+            rc = boot_erase_region(fap_scratch, scratch_off, copy_sz, false);
+        } else
+#endif
+        {
+            BOOT_LOG_DBG("erasing scratch area");
+            rc = boot_erase_region(fap_scratch, 0, flash_area_get_size(fap_scratch), false);
+        }
         assert(rc == 0);
 
         if (bs->idx == BOOT_STATUS_IDX_0) {
@@ -790,7 +868,7 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
         }
 
         rc = boot_copy_region(state, fap_secondary_slot, fap_scratch,
-                              img_off, 0, copy_sz);
+                              img_off, scratch_off, copy_sz);
         assert(rc == 0);
 
         rc = boot_write_status(state, bs);
@@ -826,7 +904,8 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
         }
 
         if (erase_sz > 0) {
-            rc = boot_erase_region(fap_secondary_slot, img_off, erase_sz, false);
+            rc = boot_erase_region_for_copy(state, fap_secondary_slot, img_off, erase_sz,
+                                            fap_primary_slot);
             assert(rc == 0);
         }
 
@@ -859,7 +938,8 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
         }
 
         if (erase_sz > 0) {
-            rc = boot_erase_region(fap_primary_slot, img_off, erase_sz, false);
+            rc = boot_erase_region_for_copy(state, fap_primary_slot, img_off, erase_sz,
+                                            fap_scratch);
             assert(rc == 0);
         }
 
@@ -867,7 +947,7 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
          * this copy (copy_sz was truncated earlier).
          */
         rc = boot_copy_region(state, fap_scratch, fap_primary_slot,
-                              0, img_off, copy_sz);
+                              scratch_off, img_off, copy_sz);
         assert(rc == 0);
 
         if (bs->use_scratch) {
@@ -882,28 +962,9 @@ boot_swap_sectors(int idx, uint32_t sz, struct boot_loader_state *state,
             rc = boot_read_swap_state(fap_scratch, &swap_state);
             assert(rc == 0);
 
-            if (swap_state.image_ok == BOOT_FLAG_SET) {
-                rc = boot_write_image_ok(fap_primary_slot);
-                assert(rc == 0);
-            }
-
-            if (swap_state.swap_type != BOOT_SWAP_TYPE_NONE) {
-                rc = boot_write_swap_info(fap_primary_slot,
-                        swap_state.swap_type, image_index);
-                assert(rc == 0);
-            }
-
-            rc = boot_write_swap_size(fap_primary_slot, bs->swap_size);
-            assert(rc == 0);
-
-#ifdef MCUBOOT_ENC_IMAGES
-            rc = boot_write_enc_key(fap_primary_slot, 0, bs);
-            assert(rc == 0);
-
-            rc = boot_write_enc_key(fap_primary_slot, 1, bs);
-            assert(rc == 0);
-#endif
-            rc = boot_write_magic(fap_primary_slot);
+            rc = boot_write_trailer_info(fap_primary_slot, swap_state.swap_type,
+                                         image_index,
+                                         swap_state.image_ok == BOOT_FLAG_SET, bs);
             assert(rc == 0);
         }
 
@@ -940,16 +1001,32 @@ swap_run(struct boot_loader_state *state, struct boot_status *bs,
     int first_sector_idx;
     int last_sector_idx;
     uint32_t swap_idx;
+    uint32_t scratch_off = 0;
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+    uint32_t scratch_next_off;
+#endif
 
     BOOT_LOG_INF("Starting swap using scratch algorithm.");
 
     last_sector_idx = find_last_sector_idx(state, copy_size);
 
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+    scratch_next_off = boot_scratch_first_off(state, copy_size);
+#endif
+
     swap_idx = 0;
     while (last_sector_idx >= 0) {
         sz = boot_copy_sz(state, last_sector_idx, &first_sector_idx);
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+        /* The first step keeps the start of the scratch area, whose end may
+         * hold the swap status.
+         */
+        if (swap_idx != 0) {
+            scratch_off = boot_scratch_next_off(state, sz, &scratch_next_off);
+        }
+#endif
         if (swap_idx >= (bs->idx - BOOT_STATUS_IDX_0)) {
-            boot_swap_sectors(first_sector_idx, sz, state, bs);
+            boot_swap_sectors(first_sector_idx, sz, scratch_off, state, bs);
         }
 
         last_sector_idx = first_sector_idx - 1;
@@ -1080,6 +1157,7 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
     uint32_t swap_count;
     uint32_t swap_size;
 #endif
+    uint32_t hdr_off = 0;
     int hdr_slot;
     int rc = 0;
 
@@ -1128,6 +1206,9 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
                  * scratch area.
                  */
                 hdr_slot = BOOT_NUM_SLOTS;
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+                hdr_off = boot_scratch_step_off(state, swap_size, swap_count - 1);
+#endif
             } else if (slot == BOOT_PRIMARY_SLOT && bs->state >= BOOT_STATUS_STATE_2) {
                 /* After BOOT_STATUS_STATE_2, the primary image's header has been moved to the
                  * secondary slot.
@@ -1147,7 +1228,7 @@ boot_read_image_header(struct boot_loader_state *state, int slot,
 #endif
     assert(fap != NULL);
 
-    rc = flash_area_read(fap, 0, out_hdr, sizeof *out_hdr);
+    rc = flash_area_read(fap, hdr_off, out_hdr, sizeof *out_hdr);
 
     if (rc != 0) {
         rc = BOOT_EFLASH;
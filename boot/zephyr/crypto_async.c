@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Driver of the asynchronous crypto jobs of bootutil/crypto/async.h that runs
+ * them on a thread, so that they proceed while the boot thread waits for the
+ * flash.  A port with a hash/AES engine provides its own driver instead.
+ */
+
+#include <zephyr/kernel.h>
+
+#include "bootutil/crypto/async.h"
+
+#define CRYPTO_ASYNC_QUEUE_LEN 4
+
+K_MSGQ_DEFINE(crypto_async_queue, sizeof(struct bootutil_crypto_job *),
+              CRYPTO_ASYNC_QUEUE_LEN, sizeof(void *));
+static K_MUTEX_DEFINE(crypto_async_lock);
+static K_CONDVAR_DEFINE(crypto_async_complete);
+
+static void crypto_async_thread(void *p1, void *p2, void *p3)
+{
+    struct bootutil_crypto_job *job;
+    int rc;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    for (;;) {
+        k_msgq_get(&crypto_async_queue, &job, K_FOREVER);
+
+        rc = bootutil_crypto_job_run(job);
+
+        k_mutex_lock(&crypto_async_lock, K_FOREVER);
+        job->rc = rc;
+        job->done = true;
+        k_condvar_broadcast(&crypto_async_complete);
+        k_mutex_unlock(&crypto_async_lock);
+    }
+}
+
+K_THREAD_DEFINE(crypto_async_tid, CONFIG_BOOT_CRYPTO_ASYNC_THREAD_STACK_SIZE,
+                crypto_async_thread, NULL, NULL, NULL,
+                CONFIG_BOOT_CRYPTO_ASYNC_THREAD_PRIORITY, 0, 0);
+
+int bootutil_crypto_async_submit(struct bootutil_crypto_job *job)
+{
+    job->done = false;
+
+    return k_msgq_put(&crypto_async_queue, &job, K_FOREVER);
+}
+
+bool bootutil_crypto_async_poll(struct bootutil_crypto_job *job)
+{
+    return job->done;
+}
+
+int bootutil_crypto_async_wait(struct bootutil_crypto_job *job)
+{
+    k_mutex_lock(&crypto_async_lock, K_FOREVER);
+    while (!job->done) {
+        k_condvar_wait(&crypto_async_complete, &crypto_async_lock, K_FOREVER);
+    }
+    k_mutex_unlock(&crypto_async_lock);
+
+    return job->rc;
+}
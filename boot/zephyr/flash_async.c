@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Driver of the asynchronous flash jobs of bootutil/flash_async.h that runs
+ * them on a thread, so that a flash device is erased or written while the
+ * boot thread reads another one.  A port that drives its flash controllers
+ * on its own provides its own driver instead.
+ */
+
+#include <zephyr/kernel.h>
+
+#include "bootutil/flash_async.h"
+
+#define FLASH_ASYNC_QUEUE_LEN 4
+
+K_MSGQ_DEFINE(flash_async_queue, sizeof(struct bootutil_flash_job *),
+              FLASH_ASYNC_QUEUE_LEN, sizeof(void *));
+static K_MUTEX_DEFINE(flash_async_lock);
+static K_CONDVAR_DEFINE(flash_async_complete);
+
+static void flash_async_thread(void *p1, void *p2, void *p3)
+{
+    struct bootutil_flash_job *job;
+    int rc;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    for (;;) {
+        k_msgq_get(&flash_async_queue, &job, K_FOREVER);
+
+        rc = bootutil_flash_job_run(job);
+
+        k_mutex_lock(&flash_async_lock, K_FOREVER);
+        job->rc = rc;
+        job->done = true;
+        k_condvar_broadcast(&flash_async_complete);
+        k_mutex_unlock(&flash_async_lock);
+    }
+}
+
+K_THREAD_DEFINE(flash_async_tid, CONFIG_BOOT_FLASH_ASYNC_THREAD_STACK_SIZE,
+                flash_async_thread, NULL, NULL, NULL,
+                CONFIG_BOOT_FLASH_ASYNC_THREAD_PRIORITY, 0, 0);
+
+bool bootutil_flash_async_concurrent(const struct flash_area *fa_job,
+                                     const struct flash_area *fa_read)
+{
+    return fa_job->fa_dev != fa_read->fa_dev;
+}
+
+int bootutil_flash_async_submit(struct bootutil_flash_job *job)
+{
+    job->done = false;
+
+    return k_msgq_put(&flash_async_queue, &job, K_FOREVER);
+}
+
+bool bootutil_flash_async_poll(struct bootutil_flash_job *job)
+{
+    return job->done;
+}
+
+int bootutil_flash_async_wait(struct bootutil_flash_job *job)
+{
+    k_mutex_lock(&flash_async_lock, K_FOREVER);
+    while (!job->done) {
+        k_condvar_wait(&flash_async_complete, &flash_async_lock, K_FOREVER);
+    }
+    k_mutex_unlock(&flash_async_lock);
+
+    return job->rc;
+}
@@ -186,3 +186,50 @@ int flash_area_get_sector(const struct flash_area *fap, off_t off,
 
     return rc;
 }
+
+#if defined(CONFIG_BOOT_FLASH_ERASE_RANGE)
+uint32_t flash_area_erase_blocks(const struct flash_area *fa)
+{
+    (void)fa;
+    return CONFIG_BOOT_FLASH_ERASE_BLOCKS;
+}
+
+int flash_area_erase_range(const struct flash_area *fa, uint32_t off, uint32_t len)
+{
+    struct flash_pages_info first;
+    struct flash_pages_info last;
+    off_t dev_off;
+    int rc;
+
+    /* Only one of the erase blocks, aligned to its size on the device. */
+    if (len == 0 || (len & (len - 1)) != 0 ||
+        (CONFIG_BOOT_FLASH_ERASE_BLOCKS & len) == 0 ||
+        off > fa->fa_size || len > fa->fa_size - off) {
+        return -EINVAL;
+    }
+
+    dev_off = fa->fa_off + off;
+    if ((dev_off & (len - 1)) != 0) {
+        return -EINVAL;
+    }
+
+    /* The block must start and end on page boundaries of the device. */
+    rc = flash_get_page_info_by_offs(fa->fa_dev, dev_off, &first);
+    if (rc == 0) {
+        rc = flash_get_page_info_by_offs(fa->fa_dev, dev_off + len - 1, &last);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (first.start_offset != dev_off ||
+        last.start_offset + last.size != dev_off + len) {
+        return -EINVAL;
+    }
+
+    /* A single erase of the block, which drivers with block erase
+     * commands, such as spi_nor, issue as one command.
+     */
+    return flash_erase(fa->fa_dev, dev_off, len);
+}
+#endif
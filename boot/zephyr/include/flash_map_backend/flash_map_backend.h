@@ -107,6 +107,18 @@ static inline uint32_t flash_sector_get_size(const struct flash_sector *fs)
 int flash_area_get_sector(const struct flash_area *fa, off_t off,
                           struct flash_sector *fs);
 
+/* Erase block sizes of the device of the flash area, besides its pages, as a
+ * mask of powers of two, with CONFIG_BOOT_FLASH_ERASE_RANGE.
+ */
+uint32_t flash_area_erase_blocks(const struct flash_area *fa);
+
+/* Erase len bytes at off within the flash area, which are one of its erase
+ * blocks.
+ *
+ * Returns 0 on success, negative errno code on failure.
+ */
+int flash_area_erase_range(const struct flash_area *fa, uint32_t off, uint32_t len);
+
 
 #if defined(CONFIG_MCUBOOT)
 static inline bool flash_area_erase_required(const struct flash_area *fa)
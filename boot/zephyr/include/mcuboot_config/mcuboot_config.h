@@ -38,6 +38,22 @@
 #define MCUBOOT_KEY_IMPORT_BYPASS_ASN
 #endif
 
+#ifdef CONFIG_BOOT_ECDSA_P256_COMB
+#define MCUBOOT_ECDSA_P256_COMB
+#endif
+
+#ifdef CONFIG_BOOT_ED25519_COMB
+#define MCUBOOT_ED25519_COMB
+#endif
+
+#ifdef CONFIG_BOOT_RSA_MONT
+#define MCUBOOT_RSA_MONT
+#endif
+
+#ifdef CONFIG_BOOT_BATCH_VERIFY
+#define MCUBOOT_BATCH_VERIFY
+#endif
+
 #ifdef CONFIG_BOOT_USE_MBEDTLS
 #define MCUBOOT_USE_MBED_TLS
 #elif defined(CONFIG_BOOT_USE_TINYCRYPT)
@@ -61,6 +77,22 @@
 #define MCUBOOT_SHA256
 #endif
 
+#ifdef CONFIG_BOOT_SHA_KERNEL
+#define MCUBOOT_SHA_KERNEL
+#endif
+
+#ifdef CONFIG_BOOT_SHA_KERNEL_UNROLL
+#define MCUBOOT_SHA_KERNEL_UNROLL
+#endif
+
+#ifdef CONFIG_BOOT_HASH_TREE
+#define MCUBOOT_HASH_TREE
+#endif
+
+#ifdef CONFIG_BOOT_CRYPTO_ASYNC
+#define MCUBOOT_CRYPTO_ASYNC
+#endif
+
 /* Zephyr, regardless of C library used, provides snprintf */
 #define MCUBOOT_USE_SNPRINTF 1
 
@@ -81,6 +113,10 @@
 #define MCUBOOT_OVERWRITE_ONLY_FAST
 #endif
 
+#ifdef CONFIG_BOOT_UPGRADE_ONLY_RESUME
+#define MCUBOOT_OVERWRITE_ONLY_RESUME
+#endif
+
 #ifdef CONFIG_SINGLE_APPLICATION_SLOT
 #define MCUBOOT_SINGLE_APPLICATION_SLOT 1
 #define MCUBOOT_IMAGE_NUMBER    1
@@ -88,6 +124,7 @@
 
 #ifdef CONFIG_BOOT_SWAP_USING_MOVE
 #define MCUBOOT_SWAP_USING_MOVE 1
+#define MCUBOOT_SWAP_MOVE_BATCH_SECTORS CONFIG_BOOT_SWAP_USING_MOVE_BATCH_SECTORS
 #endif
 
 #ifdef CONFIG_BOOT_SWAP_USING_OFFSET
@@ -159,6 +196,10 @@
 #define MCUBOOT_ENCRYPT_X25519
 #endif
 
+#ifdef CONFIG_BOOT_ENC_KEY_CACHE
+#define MCUBOOT_ENC_KEY_CACHE
+#endif
+
 /* Support for HMAC/HKDF using SHA512; this is used in key exchange where
  * HKDF is used for key expansion and HMAC is used for key verification.
  */
@@ -170,6 +211,14 @@
 #define MCUBOOT_DECOMPRESS_IMAGES
 #endif
 
+#ifdef CONFIG_BOOT_DELTA_IMAGES
+#define MCUBOOT_DELTA_IMAGES
+#endif
+
+#ifdef CONFIG_BOOT_SLOT_SNAPSHOT
+#define MCUBOOT_SLOT_SNAPSHOT
+#endif
+
 /* Invoke hashing functions directly on storage device. This requires the device
  * be able to map storage to address space or RAM.
  */
@@ -334,6 +383,18 @@
 #define MCUBOOT_SUPPORT_DEV_WITH_ERASE
 #endif
 
+#ifdef CONFIG_BOOT_FLASH_ERASE_RANGE
+#define MCUBOOT_FLASH_ERASE_RANGE
+#endif
+
+#ifdef CONFIG_BOOT_FLASH_ASYNC
+#define MCUBOOT_FLASH_ASYNC
+#endif
+
+#ifdef CONFIG_BOOT_SCRATCH_WEAR_LEVELING
+#define MCUBOOT_SCRATCH_WEAR_LEVELING
+#endif
+
 /*
  * MCUboot often calls erase on device just to remove data or make application
  * image not recognizable. In such instances it may be faster to just remove
@@ -343,6 +404,10 @@
 #define MCUBOOT_MINIMAL_SCRAMBLE
 #endif
 
+#ifdef CONFIG_BOOT_IMAGE_EXTENT
+#define MCUBOOT_IMAGE_EXTENT
+#endif
+
 /*
  * Enabling this option uses newer flash map APIs. This saves RAM and
  * avoids deprecated API usage.
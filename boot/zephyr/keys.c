@@ -28,6 +28,18 @@
  */
 #include <mcuboot_config/mcuboot_config.h>
 
+#if defined(MCUBOOT_ECDSA_P256_COMB)
+#include <bootutil/crypto/ecdsa_p256_comb.h>
+#endif
+
+#if defined(MCUBOOT_ED25519_COMB)
+#include <bootutil/crypto/ed25519.h>
+#endif
+
+#if defined(MCUBOOT_RSA_MONT)
+#include <bootutil/crypto/rsa_mont.h>
+#endif
+
 #if !defined(MCUBOOT_HW_KEY)
 #if defined(MCUBOOT_SIGN_RSA) || defined(MCUBOOT_SIGN_EC256) || defined(MCUBOOT_SIGN_ED25519)
 #define HAVE_KEYS
@@ -64,6 +76,30 @@ const struct bootutil_key bootutil_keys[] = {
     },
 };
 const int bootutil_key_cnt = 1;
+
+#if defined(MCUBOOT_ECDSA_P256_COMB)
+/* Autogenerated along with ecdsa_pub_key, see imgtool's lang-c-comb. */
+extern const struct bootutil_ecdsa_p256_comb ecdsa_pub_key_comb;
+const struct bootutil_ecdsa_p256_comb *const bootutil_ecdsa_p256_combs[] = {
+    &ecdsa_pub_key_comb,
+};
+#endif
+
+#if defined(MCUBOOT_ED25519_COMB)
+/* Autogenerated along with ed25519_pub_key, see imgtool's lang-c-comb. */
+extern const struct ed25519_comb ed25519_pub_key_comb;
+const struct ed25519_comb *const bootutil_ed25519_combs[] = {
+    &ed25519_pub_key_comb,
+};
+#endif
+
+#if defined(MCUBOOT_RSA_MONT)
+/* Autogenerated along with rsa_pub_key, see imgtool's lang-c-mont. */
+extern const struct bootutil_rsa_mont rsa_pub_key_mont;
+const struct bootutil_rsa_mont *const bootutil_rsa_monts[] = {
+    &rsa_pub_key_mont,
+};
+#endif
 #endif /* HAVE_KEYS */
 #else
 unsigned int pub_key_len;
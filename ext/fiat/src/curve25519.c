@@ -31,6 +31,7 @@
 #include <stdint.h>
 
 #include <bootutil/bootutil_public.h>
+#include <bootutil/crypto/ed25519.h>
 
 #if defined(MCUBOOT_USE_MBED_TLS)
 #include <mbedtls/platform_util.h>
@@ -593,7 +594,9 @@ void x25519_ge_sub(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q) {
   fe_add(&r->T, &trZ, &trT);
 }
 
-static void slide(signed char *r, const uint8_t *a) {
+// Recode a into odd digits of at most max in absolute value, with runs of
+// zeros between them.
+static void slide_window(signed char *r, const uint8_t *a, int max) {
   int i;
   int b;
   int k;
@@ -606,10 +609,10 @@ static void slide(signed char *r, const uint8_t *a) {
     if (r[i]) {
       for (b = 1; b <= 6 && i + b < 256; ++b) {
         if (r[i + b]) {
-          if (r[i] + (r[i + b] << b) <= 15) {
+          if (r[i] + (r[i + b] << b) <= max) {
             r[i] += r[i + b] << b;
             r[i + b] = 0;
-          } else if (r[i] - (r[i + b] << b) >= -15) {
+          } else if (r[i] - (r[i + b] << b) >= -max) {
             r[i] -= r[i + b] << b;
             for (k = i + b; k < 256; ++k) {
               if (!r[k]) {
@@ -627,6 +630,10 @@ static void slide(signed char *r, const uint8_t *a) {
   }
 }
 
+static void slide(signed char *r, const uint8_t *a) {
+  slide_window(r, a, 15);
+}
+
 // r = a * A + b * B
 // where a = a[0]+256*a[1]+...+256^31 a[31].
 // and b = b[0]+256*b[1]+...+256^31 b[31].
@@ -1049,24 +1056,60 @@ void x25519_sc_reduce(uint8_t s[64]) {
   s[31] = s11 >> 17;
 }
 
-int ED25519_verify(const uint8_t *message, size_t message_len,
-                   const uint8_t signature[64], const uint8_t public_key[32]) {
-  ge_p3 A;
-  if ((signature[63] & 224) != 0 ||
-      !x25519_ge_frombytes_vartime(&A, public_key)) {
+// SHA-512 with the backend selected for the build, in ctx->sha.
+static void ed25519_sha512_starts(struct ed25519_verify_ctx *ctx) {
+#if defined(MCUBOOT_USE_MBED_TLS)
+  int ret;
+
+  mbedtls_sha512_init(&ctx->sha);
+  ret = mbedtls_sha512_starts_ret(&ctx->sha, 0);
+  assert(ret == 0);
+#else
+  int rc;
+
+  rc = tc_sha512_init(&ctx->sha);
+  assert(rc == TC_CRYPTO_SUCCESS);
+#endif
+}
+
+static void ed25519_sha512_update(struct ed25519_verify_ctx *ctx,
+                                  const uint8_t *data, size_t len) {
+#if defined(MCUBOOT_USE_MBED_TLS)
+  int ret;
+
+  ret = mbedtls_sha512_update_ret(&ctx->sha, data, len);
+  assert(ret == 0);
+#else
+  int rc;
+
+  rc = tc_sha512_update(&ctx->sha, data, len);
+  assert(rc == TC_CRYPTO_SUCCESS);
+#endif
+}
+
+static void ed25519_sha512_finish(struct ed25519_verify_ctx *ctx,
+                                  uint8_t out[SHA512_DIGEST_LENGTH]) {
+#if defined(MCUBOOT_USE_MBED_TLS)
+  int ret;
+
+  ret = mbedtls_sha512_finish_ret(&ctx->sha, out);
+  assert(ret == 0);
+  mbedtls_sha512_free(&ctx->sha);
+#else
+  int rc;
+
+  rc = tc_sha512_final(out, &ctx->sha);
+  assert(rc == TC_CRYPTO_SUCCESS);
+#endif
+}
+
+int ED25519_verify_init(struct ed25519_verify_ctx *ctx,
+                        const uint8_t signature[64],
+                        const uint8_t public_key[32]) {
+  if ((signature[63] & 224) != 0) {
     return 0;
   }
 
-  fe_loose t;
-  fe_neg(&t, &A.X);
-  fe_carry(&A.X, &t);
-  fe_neg(&t, &A.T);
-  fe_carry(&A.T, &t);
-
-  uint8_t pkcopy[32];
-  memcpy(pkcopy, public_key, 32);
-  uint8_t rcopy[32];
-  memcpy(rcopy, signature, 32);
   union {
     uint64_t u64[4];
     uint8_t u8[32];
@@ -1093,58 +1136,367 @@ int ED25519_verify(const uint8_t *message, size_t message_len,
     }
   }
 
-#if defined(MCUBOOT_USE_MBED_TLS)
+  memcpy(ctx->signature, signature, sizeof(ctx->signature));
+  memcpy(ctx->public_key, public_key, sizeof(ctx->public_key));
 
-  mbedtls_sha512_context ctx;
-  int ret;
+  ed25519_sha512_starts(ctx);
+  ed25519_sha512_update(ctx, signature, 32);
+  ed25519_sha512_update(ctx, public_key, 32);
 
-  mbedtls_sha512_init(&ctx);
+  return 1;
+}
 
-  ret = mbedtls_sha512_starts_ret(&ctx, 0);
-  assert(ret == 0);
+void ED25519_verify_update(struct ed25519_verify_ctx *ctx,
+                           const uint8_t *data, size_t len) {
+  ed25519_sha512_update(ctx, data, len);
+}
 
-  ret = mbedtls_sha512_update_ret(&ctx, signature, 32);
-  assert(ret == 0);
-  ret = mbedtls_sha512_update_ret(&ctx, public_key, 32);
-  assert(ret == 0);
-  ret = mbedtls_sha512_update_ret(&ctx, message, message_len);
-  assert(ret == 0);
+// Finish the SHA-512 of R || A || M and reduce it to the scalar h.
+static void ed25519_verify_digest(struct ed25519_verify_ctx *ctx,
+                                  uint8_t h[SHA512_DIGEST_LENGTH]) {
+  ed25519_sha512_finish(ctx, h);
+  x25519_sc_reduce(h);
+}
 
+int ED25519_verify_finish(struct ed25519_verify_ctx *ctx) {
   uint8_t h[SHA512_DIGEST_LENGTH];
-  ret = mbedtls_sha512_finish_ret(&ctx, h);
-  assert(ret == 0);
-  mbedtls_sha512_free(&ctx);
+  ed25519_verify_digest(ctx, h);
 
-#else
+  ge_p3 A;
+  if (!x25519_ge_frombytes_vartime(&A, ctx->public_key)) {
+    return 0;
+  }
 
-  struct tc_sha512_state_struct s;
-  int rc;
+  fe_loose t;
+  fe_neg(&t, &A.X);
+  fe_carry(&A.X, &t);
+  fe_neg(&t, &A.T);
+  fe_carry(&A.T, &t);
 
-  rc = tc_sha512_init(&s);
-  assert(rc == TC_CRYPTO_SUCCESS);
+  ge_p2 R;
+  ge_double_scalarmult_vartime(&R, h, &A, ctx->signature + 32);
 
-  rc = tc_sha512_update(&s, signature, 32);
-  assert(rc == TC_CRYPTO_SUCCESS);
-  rc = tc_sha512_update(&s, public_key, 32);
-  assert(rc == TC_CRYPTO_SUCCESS);
-  rc = tc_sha512_update(&s, message, message_len);
-  assert(rc == TC_CRYPTO_SUCCESS);
+  uint8_t rcheck[32];
+  x25519_ge_tobytes(rcheck, &R);
 
-  uint8_t h[TC_SHA512_DIGEST_SIZE];
-  rc = tc_sha512_final(h, &s);
-  assert(rc == TC_CRYPTO_SUCCESS);
+  return CRYPTO_memcmp(rcheck, ctx->signature, sizeof(rcheck)) == 0;
+}
+
+#if defined(MCUBOOT_ED25519_COMB) || defined(MCUBOOT_BATCH_VERIFY)
+// Add or subtract the precomputed point selected by a sliding window digit.
+static void ge_madd_digit(ge_p1p1 *t, const ge_precomp *table,
+                          signed char digit) {
+  ge_p3 u;
 
+  if (digit > 0) {
+    x25519_ge_p1p1_to_p3(&u, t);
+    ge_madd(t, &u, &table[digit / 2]);
+  } else if (digit < 0) {
+    x25519_ge_p1p1_to_p3(&u, t);
+    ge_msub(t, &u, &table[(-digit) / 2]);
+  }
+}
 #endif
 
-  x25519_sc_reduce(h);
+#if defined(MCUBOOT_ED25519_COMB)
+// r = a * A + b * B, where the tables hold the odd multiples of A and of
+// 2^128 * A. Each scalar is split into its low and high 128 bits, so the
+// four products share only 129 doublings.
+static void ge_comb_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
+                                       const ge_precomp Ai[2][8],
+                                       const uint8_t *b) {
+  signed char slides[4][256];
+  const ge_precomp *tables[4] = { Ai[0], Ai[1], Bi, Bi128 };
+  uint8_t half[32];
+  ge_p1p1 t;
+  int i;
+  int j;
+
+  // The sliding windows may carry one bit past each half.
+  memset(half + 16, 0, 16);
+  memcpy(half, a, 16);
+  slide(slides[0], half);
+  memcpy(half, a + 16, 16);
+  slide(slides[1], half);
+  memcpy(half, b, 16);
+  slide(slides[2], half);
+  memcpy(half, b + 16, 16);
+  slide(slides[3], half);
+
+  ge_p2_0(r);
+
+  for (i = 128; i >= 0; --i) {
+    if (slides[0][i] || slides[1][i] || slides[2][i] || slides[3][i]) {
+      break;
+    }
+  }
 
+  for (; i >= 0; --i) {
+    ge_p2_dbl(&t, r);
+
+    for (j = 0; j < 4; j++) {
+      ge_madd_digit(&t, tables[j], slides[j][i]);
+    }
+
+    x25519_ge_p1p1_to_p2(r, &t);
+  }
+}
+
+int ED25519_verify_finish_comb(struct ed25519_verify_ctx *ctx,
+                               const struct ed25519_comb *comb) {
+  if (memcmp(comb->public_key, ctx->public_key, sizeof(ctx->public_key))) {
+    return ED25519_verify_finish(ctx);
+  }
+
+  uint8_t h[SHA512_DIGEST_LENGTH];
+  ed25519_verify_digest(ctx, h);
+
+  // struct ed25519_comb keeps the points as the limbs of ge_precomp.
   ge_p2 R;
-  ge_double_scalarmult_vartime(&R, h, &A, scopy.u8);
+  ge_comb_scalarmult_vartime(&R, h, (const ge_precomp (*)[8])comb->points,
+                             ctx->signature + 32);
 
   uint8_t rcheck[32];
   x25519_ge_tobytes(rcheck, &R);
 
-  return CRYPTO_memcmp(rcheck, rcopy, sizeof(rcheck)) == 0;
+  return CRYPTO_memcmp(rcheck, ctx->signature, sizeof(rcheck)) == 0;
+}
+#endif
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+// Each point of a batch keeps P, 3P, 5P and 7P, for width-4 sliding windows.
+// That is half of what ge_double_scalarmult_vartime() keeps for A, as a batch
+// has two points per signature.
+#define BATCH_POINTS 4
+
+// Add or subtract the cached point selected by a sliding window digit.
+static void ge_add_digit(ge_p1p1 *t, const ge_cached *table,
+                         signed char digit) {
+  ge_p3 u;
+
+  if (digit > 0) {
+    x25519_ge_p1p1_to_p3(&u, t);
+    x25519_ge_add(t, &u, &table[digit / 2]);
+  } else if (digit < 0) {
+    x25519_ge_p1p1_to_p3(&u, t);
+    x25519_ge_sub(t, &u, &table[(-digit) / 2]);
+  }
+}
+
+// h = -h
+static void ge_p3_neg(ge_p3 *h) {
+  fe_loose t;
+
+  fe_neg(&t, &h->X);
+  fe_carry(&h->X, &t);
+  fe_neg(&t, &h->T);
+  fe_carry(&h->T, &t);
+}
+
+// Same as x25519_ge_frombytes_vartime(), but only for the encoding that
+// x25519_ge_tobytes() gives. ED25519_verify() compares R in that encoding,
+// so a batch must reject the others as well.
+static int ge_frombytes_canonical(ge_p3 *h, const uint8_t s[32]) {
+  uint8_t check[32];
+
+  if (!x25519_ge_frombytes_vartime(h, s)) {
+    return 0;
+  }
+
+  fe_tobytes(check, &h->Y);
+  check[31] |= fe_isnegative(&h->X) << 7;
+  return CRYPTO_memcmp(check, s, sizeof(check)) == 0;
+}
+
+// Ai[i] = (2i + 1) * A
+static void ge_odd_multiples(ge_cached Ai[BATCH_POINTS], const ge_p3 *A) {
+  ge_p1p1 t;
+  ge_p3 A2;
+  ge_p3 u;
+  int i;
+
+  x25519_ge_p3_to_cached(&Ai[0], A);
+  ge_p3_dbl(&t, A);
+  x25519_ge_p1p1_to_p3(&A2, &t);
+  for (i = 1; i < BATCH_POINTS; i++) {
+    x25519_ge_add(&t, &A2, &Ai[i - 1]);
+    x25519_ge_p1p1_to_p3(&u, &t);
+    x25519_ge_p3_to_cached(&Ai[i], &u);
+  }
+}
+
+// acc += a * b, where a has 16 bytes and b 32 bytes, all little endian. The
+// result is left for x25519_sc_reduce().
+static void sc_muladd_wide(uint8_t acc[64], const uint8_t a[16],
+                           const uint8_t b[32]) {
+  uint32_t carry;
+  int i;
+  int j;
+
+  for (i = 0; i < 16; i++) {
+    carry = 0;
+    for (j = 0; j < 32; j++) {
+      carry += acc[i + j] + (uint32_t)a[i] * b[j];
+      acc[i + j] = (uint8_t)carry;
+      carry >>= 8;
+    }
+    for (j = i + 32; carry != 0 && j < 64; j++) {
+      carry += acc[j];
+      acc[j] = (uint8_t)carry;
+      carry >>= 8;
+    }
+  }
+}
+
+// The per-chunk state, about 8 KiB with ED25519_BATCH_MAX of 4: the digests,
+// the 128-bit coefficients, the signed digits of the scalars and the tables
+// of odd multiples of the points.
+struct ed25519_batch_scratch {
+  uint8_t h[ED25519_BATCH_MAX][SHA512_DIGEST_LENGTH];
+  uint8_t z[ED25519_BATCH_MAX][32];
+  signed char slides[1 + 2 * ED25519_BATCH_MAX][256];
+  ge_cached tables[2 * ED25519_BATCH_MAX][BATCH_POINTS];
+};
+
+// Check up to ED25519_BATCH_MAX signatures with a random linear combination
+// of their verification equations,
+//
+//   [sum z_i * s_i]B + sum [z_i * h_i](-A_i) + sum [z_i](-R_i) == 0
+//
+// which is a single multi-scalar multiplication with 256 doublings shared by
+// all the signatures. The 128-bit z_i are derived from a hash of all the
+// signatures, keys and h_i, so they are only known once the signatures are
+// fixed.
+static int ed25519_verify_batch_chunk(struct ed25519_batch_scratch *scratch,
+                                      const uint8_t *const messages[],
+                                      const size_t message_lens[],
+                                      const uint8_t *const signatures[],
+                                      const uint8_t *const public_keys[],
+                                      size_t num) {
+  static const uint8_t identity[32] = {1};
+  struct ed25519_verify_ctx ctx;
+  uint8_t (*h)[SHA512_DIGEST_LENGTH] = scratch->h;
+  uint8_t (*z)[32] = scratch->z;
+  uint8_t seed[SHA512_DIGEST_LENGTH];
+  uint8_t wide[SHA512_DIGEST_LENGTH];
+  uint8_t index;
+  signed char (*slides)[256] = scratch->slides;
+  ge_cached (*tables)[BATCH_POINTS] = scratch->tables;
+  ge_p3 P;
+  ge_p2 r;
+  ge_p1p1 t;
+  size_t i;
+  int j;
+
+  // h_i = H(R_i || A_i || M_i). This also rejects s_i outside [0, order).
+  for (i = 0; i < num; i++) {
+    if (!ED25519_verify_init(&ctx, signatures[i], public_keys[i])) {
+      return 0;
+    }
+    ED25519_verify_update(&ctx, messages[i], message_lens[i]);
+    ed25519_verify_digest(&ctx, h[i]);
+  }
+
+  ed25519_sha512_starts(&ctx);
+  for (i = 0; i < num; i++) {
+    ed25519_sha512_update(&ctx, signatures[i], 64);
+    ed25519_sha512_update(&ctx, public_keys[i], 32);
+    ed25519_sha512_update(&ctx, h[i], 32);
+  }
+  ed25519_sha512_finish(&ctx, seed);
+
+  for (i = 0; i < num; i++) {
+    index = (uint8_t)i;
+    ed25519_sha512_starts(&ctx);
+    ed25519_sha512_update(&ctx, seed, sizeof(seed));
+    ed25519_sha512_update(&ctx, &index, 1);
+    ed25519_sha512_finish(&ctx, wide);
+    memset(z[i], 0, sizeof(z[i]));
+    memcpy(z[i], wide, 16);
+  }
+
+  memset(wide, 0, sizeof(wide));
+  for (i = 0; i < num; i++) {
+    sc_muladd_wide(wide, z[i], signatures[i] + 32);
+  }
+  x25519_sc_reduce(wide);
+  slide(slides[0], wide);
+
+  for (i = 0; i < num; i++) {
+    memset(wide, 0, sizeof(wide));
+    sc_muladd_wide(wide, z[i], h[i]);
+    x25519_sc_reduce(wide);
+    slide_window(slides[1 + 2 * i], wide, 2 * BATCH_POINTS - 1);
+    slide_window(slides[2 + 2 * i], z[i], 2 * BATCH_POINTS - 1);
+
+    if (!x25519_ge_frombytes_vartime(&P, public_keys[i])) {
+      return 0;
+    }
+    ge_p3_neg(&P);
+    ge_odd_multiples(tables[2 * i], &P);
+
+    if (!ge_frombytes_canonical(&P, signatures[i])) {
+      return 0;
+    }
+    ge_p3_neg(&P);
+    ge_odd_multiples(tables[2 * i + 1], &P);
+  }
+
+  ge_p2_0(&r);
+
+  for (j = 255; j >= 0; --j) {
+    ge_p2_dbl(&t, &r);
+
+    ge_madd_digit(&t, Bi, slides[0][j]);
+    for (i = 0; i < 2 * num; i++) {
+      ge_add_digit(&t, tables[i], slides[1 + i][j]);
+    }
+
+    x25519_ge_p1p1_to_p2(&r, &t);
+  }
+
+  x25519_ge_tobytes(wide, &r);
+  return CRYPTO_memcmp(wide, identity, sizeof(identity)) == 0;
+}
+
+int ED25519_verify_batch(const uint8_t *const messages[],
+                         const size_t message_lens[],
+                         const uint8_t *const signatures[],
+                         const uint8_t *const public_keys[], size_t num) {
+#if !defined(__BOOTSIM__)
+  // Kept off the stack of the bootloader, which is single threaded. The
+  // simulator runs boots on several threads, so it uses its own stack.
+  static struct ed25519_batch_scratch scratch;
+#else
+  struct ed25519_batch_scratch scratch;
+#endif
+  size_t n;
+  int valid = 1;
+
+  for (; num > 0 && valid; num -= n) {
+    n = num < ED25519_BATCH_MAX ? num : ED25519_BATCH_MAX;
+    valid = ed25519_verify_batch_chunk(&scratch, messages, message_lens,
+                                       signatures, public_keys, n);
+    messages += n;
+    message_lens += n;
+    signatures += n;
+    public_keys += n;
+  }
+
+  memset(&scratch, 0, sizeof(scratch));
+  return valid;
+}
+#endif
+
+int ED25519_verify(const uint8_t *message, size_t message_len,
+                   const uint8_t signature[64], const uint8_t public_key[32]) {
+  struct ed25519_verify_ctx ctx;
+
+  if (!ED25519_verify_init(&ctx, signature, public_key)) {
+    return 0;
+  }
+  ED25519_verify_update(&ctx, message, message_len);
+  return ED25519_verify_finish(&ctx);
 }
 
 static void fe_cswap(fe *f, fe *g, fe_limb_t b) {
@@ -105,3 +105,75 @@ static const ge_precomp Bi[8] = {
           17317989, 34647629, 21263748}},
     },
 };
+
+#if defined(MCUBOOT_ED25519_COMB)
+// The odd multiples of 2^128*B, for ED25519_verify_finish_comb(). Generated
+// with ed25519_comb_table() of imgtool's keys/ed25519.py.
+// Bi128[i] = (2*i+1)*2^128*B
+static const ge_precomp Bi128[8] = {
+    {
+        {{11374242, 12660715, 17861383, 21013599, 10935567, 1099227, 53222788,
+          24462691, 39381819, 11358503}},
+        {{54378055, 10311866, 1510375, 10778093, 64989409, 24408729, 32676002,
+          11149336, 40985213, 4985767}},
+        {{48012542, 341146, 60911379, 33315398, 15756972, 24757770, 66125820,
+          13794113, 47694557, 17933176}},
+    },
+    {
+        {{17747446, 10039260, 19368299, 29503841, 46478228, 17513145, 31992682,
+          17696456, 37848500, 28042460}},
+        {{31932008, 28568291, 47496481, 16366579, 22023614, 88450, 11371999,
+          29810185, 4882241, 22927527}},
+        {{29796488, 37186, 19818052, 10115756, 55279832, 3352735, 18551198,
+          3272828, 61917932, 29392022}},
+    },
+    {
+        {{28425966, 27718999, 66531773, 28857233, 52891308, 6870929, 7921550,
+          26986645, 26333139, 14267664}},
+        {{56041645, 11871230, 27385719, 22994888, 62522949, 22365119, 10004785,
+          24844944, 45347639, 8930323}},
+        {{45911060, 17158396, 25654215, 31829035, 12282011, 11008919, 1541940,
+          4757911, 40617363, 17145491}},
+    },
+    {
+        {{24579768, 3711570, 1342322, 22374306, 40103728, 14124955, 44564335,
+          14074918, 21964432, 8235257}},
+        {{60580251, 31142934, 9442965, 27628844, 12025639, 32067012, 64127349,
+          31885225, 13006805, 2355433}},
+        {{50803946, 19949172, 60476436, 28412082, 16974358, 22643349, 27202043,
+          1719366, 1141648, 20758196}},
+    },
+    {
+        {{37210315, 10468803, 55519480, 9292687, 52808360, 17552182, 21586883,
+          945403, 11163707, 15669892}},
+        {{31206520, 15824593, 16020985, 1311600, 11901613, 18681950, 17190048,
+          20972874, 36367312, 16736695}},
+        {{57913035, 17785021, 13803590, 19987782, 53527313, 27679244, 51081104,
+          8751993, 57229443, 21797682}},
+    },
+    {
+        {{13818433, 33318056, 61724740, 27489984, 64579957, 29864077, 41055840,
+          6764058, 21868286, 20265729}},
+        {{30168086, 8879691, 8082410, 20908532, 49048412, 1925828, 36719081,
+          18852706, 45403594, 13481125}},
+        {{20368198, 29299801, 56989850, 18531975, 6143432, 18332713, 22947777,
+          26680478, 52840559, 5738077}},
+    },
+    {
+        {{63338752, 21992361, 57848361, 10016489, 45383174, 5115819, 23891454,
+          31807629, 41897809, 9032829}},
+        {{1787335, 11391558, 5886665, 12683293, 60262716, 18956364, 47438617,
+          31589710, 22825755, 12694491}},
+        {{33951444, 14270088, 4920710, 22678367, 26741607, 22171118, 23619815,
+          25557760, 19219336, 29816249}},
+    },
+    {
+        {{61220352, 828559, 66089103, 13184163, 25007774, 21496788, 6882751,
+          29070952, 62931443, 26042728}},
+        {{21329464, 2335990, 20644175, 1930420, 56815309, 32391427, 15310865,
+          28790024, 54737184, 4184911}},
+        {{26287248, 13875740, 41814500, 13003275, 7041512, 17215295, 42960689,
+          20033689, 37163595, 12870103}},
+    },
+};
+#endif
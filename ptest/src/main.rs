@@ -9,12 +9,19 @@
 //!
 //! For now, we assume all of the features are listed under
 //! jobs->environment->strategy->matric->features
+//!
+//! Each feature set is run once, even if it appears several times in the matrix (possibly with
+//! the features in a different order), so that its build is shared.  A fixed pool of workers takes
+//! jobs from a single queue, which is ordered so that the jobs that took the longest on previous
+//! runs start first.  Job durations are recorded in a history file, and a timing report is printed
+//! at the end of the run.
 
 use chrono::Local;
 use clap::{Parser, Subcommand};
 use log::{debug, error, warn};
 use std::{
-    collections::HashSet,
+    cmp::Ordering,
+    collections::{BTreeMap, HashSet, VecDeque},
     env,
     fs::{self, OpenOptions},
     io::{ErrorKind, stdout, Write},
@@ -25,9 +32,8 @@ use std::{
         Mutex,
     },
     thread,
-    time::Duration,
+    time::{Duration, Instant},
 };
-use std_semaphore::Semaphore;
 use yaml_rust::{
     Yaml,
     YamlLoader,
@@ -43,9 +49,6 @@ fn main() -> Result<()> {
     let workflow_text = fs::read_to_string(&args.workflow)?;
     let workflow = YamlLoader::load_from_str(&workflow_text)?;
 
-    let ncpus = num_cpus::get();
-    let limiter = Arc::new(Semaphore::new(ncpus as isize));
-
     let matrix = Matrix::from_yaml(&workflow);
 
     let matrix = if args.test.len() == 0 { matrix } else {
@@ -60,8 +63,23 @@ fn main() -> Result<()> {
         Commands::Run => (),
     }
 
-    let mut children = vec![];
-    let state = State::new(matrix.envs.len());
+    let mut history = History::load(&args.history);
+
+    // Start the longest jobs first, so that the run doesn't end waiting on a single long job.
+    // Jobs that haven't been timed yet are assumed to be long.
+    let mut envs = matrix.envs;
+    envs.sort_by(|a, b| {
+        let ta = history.estimate(a).unwrap_or(f64::INFINITY);
+        let tb = history.estimate(b).unwrap_or(f64::INFINITY);
+        tb.partial_cmp(&ta).unwrap_or(Ordering::Equal)
+    });
+
+    let njobs = envs.len();
+    let nworkers = args.jobs.unwrap_or_else(num_cpus::get).max(1).min(njobs.max(1));
+    let queue = Arc::new(Mutex::new(envs.into_iter().collect::<VecDeque<_>>()));
+    let timings = Arc::new(Mutex::new(vec![]));
+
+    let state = State::new(njobs);
     let st2 = state.clone();
     let _status = thread::spawn(move || {
         loop {
@@ -69,28 +87,135 @@ fn main() -> Result<()> {
             st2.lock().unwrap().status();
         }
     });
-    for env in matrix.envs {
-        let state = state.clone();
-        let limiter = limiter.clone();
 
-        let child = thread::spawn(move || {
-            let _run = limiter.access();
-            state.lock().unwrap().start(&env);
-            let out = env.run();
-            state.lock().unwrap().done(&env, out);
+    let start = Instant::now();
+    let mut workers = vec![];
+    for _ in 0..nworkers {
+        let state = state.clone();
+        let queue = queue.clone();
+        let timings = timings.clone();
+
+        // Each worker takes the next job as soon as it is idle, until the queue is empty.
+        let worker = thread::spawn(move || {
+            loop {
+                let env = match queue.lock().unwrap().pop_front() {
+                    Some(env) => env,
+                    None => break,
+                };
+                state.lock().unwrap().start(&env);
+                let job_start = Instant::now();
+                let out = env.run();
+                let elapsed = job_start.elapsed();
+                let success = out.as_ref().map(|o| o.success).unwrap_or(false);
+                state.lock().unwrap().done(&env, out);
+                timings.lock().unwrap().push(JobTiming {
+                    key: env.key(),
+                    elapsed,
+                    success,
+                });
+            }
         });
-        children.push(child);
+        workers.push(worker);
     }
 
-    for child in children {
-        child.join().unwrap();
+    for worker in workers {
+        worker.join().unwrap();
     }
+    let wall = start.elapsed();
 
     println!();
 
+    let timings = timings.lock().unwrap();
+    report(&timings, &history, wall, nworkers);
+
+    for t in timings.iter() {
+        history.update(&t.key, t.elapsed);
+    }
+    if let Err(err) = history.save() {
+        warn!("Unable to save job durations to {:?}: {:?}", history.path, err);
+    }
+
     Ok(())
 }
 
+/// The time taken by a single job.
+struct JobTiming {
+    key: String,
+    elapsed: Duration,
+    success: bool,
+}
+
+/// Print each job's run time, longest first, along with the estimate it was scheduled with.
+fn report(timings: &[JobTiming], history: &History, wall: Duration, nworkers: usize) {
+    let mut sorted: Vec<_> = timings.iter().collect();
+    sorted.sort_by(|a, b| b.elapsed.cmp(&a.elapsed));
+
+    println!("{:>8} {:>8}  {:7}  {}", "time", "previous", "result", "features");
+    for t in &sorted {
+        let previous = match history.times.get(&t.key) {
+            Some(secs) => format!("{:.1}", secs),
+            None => "-".to_string(),
+        };
+        println!("{:>8.1} {:>8}  {:7}  {}", t.elapsed.as_secs_f64(), previous,
+            if t.success { "ok" } else { "FAILED" }, t.key);
+    }
+
+    let busy: f64 = timings.iter().map(|t| t.elapsed.as_secs_f64()).sum();
+    println!("{} jobs on {} workers: {:.1}s wall clock, {:.1}s total job time",
+        timings.len(), nworkers, wall.as_secs_f64(), busy);
+}
+
+/// The durations of previous runs of each feature set, keyed by `FeatureSet::key`.  Stored as
+/// lines of "seconds features".
+struct History {
+    path: String,
+    times: BTreeMap<String, f64>,
+}
+
+impl History {
+    /// Load the history, starting with an empty one if the file doesn't exist yet.
+    fn load(path: &str) -> History {
+        let mut times = BTreeMap::new();
+        match fs::read_to_string(path) {
+            Ok(text) => {
+                for line in text.lines() {
+                    let mut parts = line.splitn(2, ' ');
+                    let secs = parts.next().and_then(|s| s.parse::<f64>().ok());
+                    match (secs, parts.next()) {
+                        (Some(secs), Some(key)) => {
+                            times.insert(key.to_string(), secs);
+                        }
+                        _ => warn!("Ignoring malformed line in {:?}: {:?}", path, line),
+                    }
+                }
+            }
+            Err(ref err) if err.kind() == ErrorKind::NotFound => (),
+            Err(err) => warn!("Unable to read {:?}: {:?}", path, err),
+        }
+        History {
+            path: path.to_string(),
+            times,
+        }
+    }
+
+    fn estimate(&self, fs: &FeatureSet) -> Option<f64> {
+        self.times.get(&fs.key()).cloned()
+    }
+
+    fn update(&mut self, key: &str, elapsed: Duration) {
+        self.times.insert(key.to_string(), elapsed.as_secs_f64());
+    }
+
+    fn save(&self) -> Result<()> {
+        let mut text = String::new();
+        for (key, secs) in &self.times {
+            text.push_str(&format!("{:.1} {}\n", secs, key));
+        }
+        fs::write(&self.path, text)?;
+        Ok(())
+    }
+}
+
 /// The main Cli.
 #[derive(Debug, Parser)]
 #[command(name = "ptest")]
@@ -104,6 +229,14 @@ struct Cli {
     #[arg(short, long)]
     test: Vec<usize>,
 
+    /// The number of jobs to run at once (defaults to the number of CPUs).
+    #[arg(short, long)]
+    jobs: Option<usize>,
+
+    /// File recording how long each job took, used to start the longest jobs first.
+    #[arg(long, default_value = "ptest-durations.txt")]
+    history: String,
+
     #[command(subcommand)]
     command: Commands,
 }
@@ -239,11 +372,14 @@ impl Matrix {
                     envs.push(fset);
                 } else {
                     // Break each test up so we can run more in
-                    // parallel.
+                    // parallel.  Feature sets that only differ in the
+                    // order of the features are the same build, so only
+                    // run them once.
                     let env = fset.env.clone();
                     for val in fset.values {
-                        if !all_tests.contains(&val) {
-                            all_tests.insert(val.clone());
+                        let key = normalize_features(&val);
+                        if !all_tests.contains(&key) {
+                            all_tests.insert(key);
                             envs.push(FeatureSet {
                                 env: env.clone(),
                                 values: vec![val],
@@ -326,6 +462,12 @@ impl FeatureSet {
         Ok(TestResult { success, output })
     }
 
+    /// A key identifying this feature set, independent of the order the features are listed in.
+    fn key(&self) -> String {
+        let values: Vec<_> = self.values.iter().map(|v| normalize_features(v)).collect();
+        values.join(",")
+    }
+
     /// Convert this feature set into a textual representation
     fn textual(&self) -> String {
         use std::fmt::Write;
@@ -353,6 +495,14 @@ impl FeatureSet {
     }
 }
 
+/// Sort and deduplicate a space separated list of features.
+fn normalize_features(text: &str) -> String {
+    let mut features: Vec<_> = text.split_whitespace().collect();
+    features.sort_unstable();
+    features.dedup();
+    features.join(" ")
+}
+
 fn lookup_matrix(y: &Yaml) -> Option<&Vec<Yaml>> {
     let jobs = Yaml::String("jobs".to_string());
     let environment = Yaml::String("environment".to_string());
@@ -71,6 +71,7 @@ IMAGE_F = {
         'COMPRESSED_LZMA1':      0x0000200,
         'COMPRESSED_LZMA2':      0x0000400,
         'COMPRESSED_ARM_THUMB':  0x0000800,
+        'DELTA':                 0x0001000,
 }
 
 TLV_VALUES = {
@@ -79,6 +80,7 @@ TLV_VALUES = {
         'SHA256': 0x10,
         'SHA384': 0x11,
         'SHA512': 0x12,
+        'HASH_TREE': 0x13,
         'RSA2048': 0x20,
         'ECDSASIG': 0x22,
         'RSA3072': 0x23,
@@ -96,6 +98,8 @@ TLV_VALUES = {
         'DECOMP_SHA': 0x71,
         'DECOMP_SIGNATURE': 0x72,
         'COMP_DEC_SIZE' : 0x73,
+        'DELTA_BASE': 0x74,
+        'DELTA_TARGET': 0x75,
 }
 
 TLV_SIZE = 4
@@ -233,6 +237,127 @@ def key_and_user_sha_to_alg_and_tlv(key, user_sha, is_pure = False):
                            .format(key.sig_type(), user_sha, allowed))
 
 
+# Sizes of the leaves of a tree hash the bootloader accepts, see
+# BOOTUTIL_HASH_TREE_MIN_LEAF_LOG2 and BOOTUTIL_HASH_TREE_MAX_LEAF_LOG2.
+HASH_TREE_MIN_LEAF = 1 << 10
+HASH_TREE_MAX_LEAF = 1 << 31
+
+# Hash of a tree hashed image, by the length of the leaf digests in its TLV.
+HASH_TREE_LEN_TO_SHA = {
+    32: '256',
+    48: '384',
+    64: '512',
+}
+
+
+def _hash_tree_digest(hash_algorithm, *parts):
+    sha = hash_algorithm()
+    for part in parts:
+        sha.update(part)
+    return sha.digest()
+
+
+def hash_tree_leaves(hash_algorithm, data, leaf_size):
+    """Return the digests of the leaves of the tree hash of data, H(0x00 ||
+    leaf), as they are stored in the HASH_TREE TLV."""
+    return [_hash_tree_digest(hash_algorithm, b'\x00', data[off:off + leaf_size])
+            for off in range(0, len(data), leaf_size)]
+
+
+def hash_tree_root_of(hash_algorithm, leaves, leaf_size):
+    """Return the root of a tree hash from the digests of its leaves, as
+    computed by bootutil/hash_tree.h: nodes are H(0x01 || left || right)
+    split as in RFC 6962, and the root is H(0x02 || leaf size || top node)."""
+    def digest(*parts):
+        return _hash_tree_digest(hash_algorithm, *parts)
+
+    def node(leaves):
+        if len(leaves) == 1:
+            return leaves[0]
+        split = 1
+        while split * 2 < len(leaves):
+            split *= 2
+        return digest(b'\x01', node(leaves[:split]), node(leaves[split:]))
+
+    return digest(b'\x02', struct.pack('<I', leaf_size), node(leaves))
+
+
+def hash_tree_root(hash_algorithm, data, leaf_size):
+    """Return the root of the tree hash of data with leaves of leaf_size
+    bytes."""
+    return hash_tree_root_of(hash_algorithm,
+                             hash_tree_leaves(hash_algorithm, data, leaf_size),
+                             leaf_size)
+
+
+# A block of the target that is found in the base is copied from it when the
+# match is at least this long, a shorter one costs more than its record.
+DELTA_BLOCK = 16
+DELTA_MIN_MATCH = 32
+
+
+def image_end(data, endian='little'):
+    """Return the size of the signed image at the start of data, from its
+    header to the end of its TLVs, without any padding."""
+    e = STRUCT_ENDIAN_DICT[endian]
+    magic, _, header_size, prot_size, img_size = struct.unpack(
+        e + 'IIHHI', data[:16])
+    if magic != IMAGE_MAGIC:
+        raise click.UsageError("Not a signed image")
+    off = header_size + img_size + prot_size
+    tlv_magic, tlv_tot = struct.unpack(e + 'HH', data[off:off + TLV_INFO_SIZE])
+    if tlv_magic != TLV_INFO_MAGIC:
+        raise click.UsageError("Signed image without TLVs")
+    return off + tlv_tot
+
+
+def make_delta(base, target, endian='little'):
+    """Return the patch of a delta image that builds target from base, as
+    bootutil/src/delta.c runs it: a list of records of the offset and length
+    of a block of the base to copy and the length of the bytes to insert after
+    it, each followed by these bytes."""
+    e = STRUCT_ENDIAN_DICT[endian]
+    index = {}
+    for off in range(len(base) - DELTA_BLOCK, -1, -4):
+        index[bytes(base[off:off + DELTA_BLOCK])] = off
+
+    patch = bytearray()
+    copy_off, copy_len = 0, 0
+    insert_off = 0
+    pos = 0
+    while pos + DELTA_BLOCK <= len(target):
+        src = index.get(bytes(target[pos:pos + DELTA_BLOCK]))
+        if src is None:
+            pos += 1
+            continue
+        start = pos
+        while start > insert_off and src > 0 and base[src - 1] == target[start - 1]:
+            src -= 1
+            start -= 1
+        end = pos + DELTA_BLOCK
+        while (end < len(target) and src + end - start < len(base) and
+               base[src + end - start] == target[end]):
+            end += 1
+        if end - start < DELTA_MIN_MATCH:
+            pos += 1
+            continue
+        patch += struct.pack(e + 'III', copy_off, copy_len, start - insert_off)
+        patch += target[insert_off:start]
+        copy_off, copy_len = src, end - start
+        insert_off = pos = end
+    patch += struct.pack(e + 'III', copy_off, copy_len, len(target) - insert_off)
+    patch += target[insert_off:]
+    return bytes(patch)
+
+
+def check_hash_tree_leaf(leaf_size):
+    if (leaf_size < HASH_TREE_MIN_LEAF or leaf_size > HASH_TREE_MAX_LEAF or
+            leaf_size & (leaf_size - 1) != 0):
+        raise click.UsageError(
+            "The hash tree leaf size must be a power of two between {} and {}"
+            .format(HASH_TREE_MIN_LEAF, HASH_TREE_MAX_LEAF))
+
+
 def get_digest(tlv_type, hash_region):
     sha = TLV_SHA_TO_SHA_AND_ALG[tlv_type].alg()
 
@@ -382,6 +507,10 @@ class Image:
                 self.payload = bytes([0] * self.header_size) + \
                     self.payload
 
+    def load_delta(self, patch):
+        """Load the patch of a delta image"""
+        self.load_compressed(patch, bytes())
+
     def save(self, path, hex_addr=None):
         """Save an image from a given file"""
         ext = os.path.splitext(path)[1][1:].lower()
@@ -469,9 +598,15 @@ class Image:
                compression_type=None, encrypt_keylen=128, clear=False,
                fixed_sig=None, pub_key=None, vector_to_sign=None,
                user_sha='auto', hmac_sha='auto', is_pure=False, keep_comp_size=False,
-               dont_encrypt=False):
+               dont_encrypt=False, hash_tree_leaf=None):
         self.enckey = enckey
 
+        if hash_tree_leaf is not None:
+            if is_pure:
+                raise click.UsageError("A tree hash can not be used with a "
+                                       "pure signature")
+            check_hash_tree_leaf(hash_tree_leaf)
+
         # key decides on sha, then pub_key; of both are none default is used
         check_key = key if key is not None else pub_key
         hash_algorithm, hash_tlv = key_and_user_sha_to_alg_and_tlv(check_key, user_sha, is_pure)
@@ -564,6 +699,8 @@ class Image:
                 compression_flags = IMAGE_F['COMPRESSED_LZMA2']
                 if compression_type == "lzma2armthumb":
                     compression_flags |= IMAGE_F['COMPRESSED_ARM_THUMB']
+            elif compression_type == "delta":
+                compression_flags = IMAGE_F['DELTA']
         # This adds the header to the payload as well
         if encrypt_keylen == 256:
             self.add_header(enckey, protected_tlv_size, compression_flags, 256)
@@ -616,10 +753,23 @@ class Image:
         # EC signatures so called Pure algorithm, designated to be run
         # over entire message is used with sha of image as message,
         # so, for example, in case of ED25519 we have here SHAxxx-ED25519-SHA512.
-        sha = hash_algorithm()
-        sha.update(self.payload)
-        digest = sha.digest()
-        tlv.add(hash_tlv, digest)
+        if hash_tree_leaf is not None:
+            # The leaf size and the digests of the leaves replace the hash
+            # TLV, and the signature is over the root they make up.
+            leaves = hash_tree_leaves(hash_algorithm, bytes(self.payload),
+                                      hash_tree_leaf)
+            if 4 + sum(len(leaf) for leaf in leaves) > 0xffff:
+                raise click.UsageError(
+                    "{} leaves of the hash tree do not fit in its TLV, use a "
+                    "larger --hash-tree-leaf".format(len(leaves)))
+            digest = hash_tree_root_of(hash_algorithm, leaves, hash_tree_leaf)
+            tlv.add('HASH_TREE',
+                    struct.pack('<I', hash_tree_leaf) + b''.join(leaves))
+        else:
+            sha = hash_algorithm()
+            sha.update(self.payload)
+            digest = sha.digest()
+            tlv.add(hash_tlv, digest)
         self.image_hash = digest
         # Unless pure, we are signing digest.
         message = digest
@@ -652,7 +802,7 @@ class Image:
                 # internally), while `sign_digest` expects only the digest
                 # of the payload
 
-                if hasattr(key, 'sign'):
+                if hasattr(key, 'sign') and hash_tree_leaf is None:
                     print(os.path.basename(__file__) + ": sign the payload")
                     sig = key.sign(bytes(self.payload))
                 else:
@@ -867,6 +1017,7 @@ class Image:
             tlv_off += TLV_SIZE + tlv_len
 
         digest = None
+        is_tree = False
         tlv_off = prot_tlv_size
         tlv_end = tlv_off + tlv_tot
         tlv_off += TLV_INFO_SIZE  # skip tlv info
@@ -883,12 +1034,40 @@ class Image:
                         return VerifyResult.OK, version, digest, None
                 else:
                     return VerifyResult.INVALID_HASH, None, None, None
+            elif tlv_type == TLV_VALUES['HASH_TREE']:
+                off = tlv_off + TLV_SIZE
+                if tlv_len < 4:
+                    return VerifyResult.INVALID_HASH, None, None, None
+                leaf_size, = struct.unpack('<I', b[off:off + 4])
+                if leaf_size == 0:
+                    return VerifyResult.INVALID_HASH, None, None, None
+                count = (len(hash_region) + leaf_size - 1) // leaf_size
+                sha = None
+                if (tlv_len - 4) % count == 0:
+                    sha = HASH_TREE_LEN_TO_SHA.get((tlv_len - 4) // count)
+                if sha is None:
+                    return VerifyResult.INVALID_HASH, None, None, None
+                if key is not None:
+                    try:
+                        key_and_user_sha_to_alg_and_tlv(key, sha)
+                    except click.UsageError:
+                        return VerifyResult.KEY_MISMATCH, None, None, None
+                hash_algorithm = USER_SHA_TO_ALG_AND_TLV[sha][0]
+                leaves = hash_tree_leaves(hash_algorithm, hash_region,
+                                          leaf_size)
+                digest = hash_tree_root_of(hash_algorithm, leaves, leaf_size)
+                is_tree = True
+                if b''.join(leaves) == b[off + 4:off + tlv_len]:
+                    if key is None:
+                        return VerifyResult.OK, version, digest, None
+                else:
+                    return VerifyResult.INVALID_HASH, None, None, None
             elif not is_pure and key is not None and tlv_type == TLV_VALUES[key.sig_tlv()]:
                 off = tlv_off + TLV_SIZE
                 tlv_sig = b[off:off + tlv_len]
                 payload = b[:prot_tlv_size]
                 try:
-                    if hasattr(key, 'verify'):
+                    if hasattr(key, 'verify') and not is_tree:
                         key.verify(tlv_sig, payload)
                     else:
                         key.verify_digest(tlv_sig, digest)
@@ -5,15 +5,85 @@ ECDSA key management
 # SPDX-License-Identifier: Apache-2.0
 import os.path
 import hashlib
+import sys
 
 from cryptography.hazmat.backends import default_backend
 from cryptography.hazmat.primitives import serialization
 from cryptography.hazmat.primitives.asymmetric import ec
+from cryptography.hazmat.primitives.asymmetric.utils import Prehashed
 from cryptography.hazmat.primitives.hashes import SHA256, SHA384
 
-from .general import KeyClass
+from .general import AUTOGEN_MESSAGE, FileHandler, KeyClass
 from .privatebytes import PrivateBytesMixin
 
+# Curve parameters of P-256, needed to precompute the comb tables that the
+# bootloader uses for fixed-key verification (MCUBOOT_ECDSA_P256_COMB).
+P256_P = 0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff
+P256_GX = 0x6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296
+P256_GY = 0x4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5
+
+# These must match BOOTUTIL_ECDSA_P256_COMB_TEETH and
+# BOOTUTIL_ECDSA_P256_COMB_SPACING in bootutil/crypto/ecdsa_p256_comb.h.
+P256_COMB_TEETH = 4
+P256_COMB_SPACING = 64
+
+
+def _p256_add(a, b):
+    """Add two affine P-256 points, None being the point at infinity."""
+    if a is None:
+        return b
+    if b is None:
+        return a
+    (x1, y1), (x2, y2) = a, b
+    if x1 == x2:
+        if (y1 + y2) % P256_P == 0:
+            return None
+        lam = (3 * x1 * x1 - 3) * pow(2 * y1, -1, P256_P)
+    else:
+        lam = (y2 - y1) * pow(x2 - x1, -1, P256_P)
+    lam %= P256_P
+    x3 = (lam * lam - x1 - x2) % P256_P
+    return (x3, (lam * (x1 - x3) - y1) % P256_P)
+
+
+def p256_comb_table(point):
+    """Return the comb table of an affine P-256 point.
+
+    Entry i - 1 holds the sum of 2^(P256_COMB_SPACING * j) * point over the
+    bits j set in i, for i = 1 .. 2^P256_COMB_TEETH - 1."""
+    teeth = [point]
+    for _ in range(1, P256_COMB_TEETH):
+        q = teeth[-1]
+        for _ in range(P256_COMB_SPACING):
+            q = _p256_add(q, q)
+        teeth.append(q)
+    table = []
+    for i in range(1, 1 << P256_COMB_TEETH):
+        q = None
+        for j in range(P256_COMB_TEETH):
+            if i & (1 << j):
+                q = _p256_add(q, teeth[j])
+        table.append(q)
+    return table
+
+
+def _p256_words(value):
+    """Split a field element into the 32-bit words of tinycrypt's native
+    (least significant word first) representation."""
+    return [(value >> (32 * i)) & 0xffffffff for i in range(8)]
+
+
+def emit_p256_comb_points(table, indent, file):
+    """Write the points of a comb table as a C initializer."""
+    for i, (x, y) in enumerate(table):
+        print("{}/* {:2} */ {{".format(indent, i + 1), file=file)
+        words = _p256_words(x) + _p256_words(y)
+        for line in range(0, len(words), 4):
+            print(indent + "    " +
+                  " ".join("0x{:08x},".format(w) for w in words[line:line + 4]),
+                  file=file)
+        print(indent + "},", file=file)
+
 
 class ECDSAUsageError(Exception):
     pass
@@ -181,6 +251,40 @@ class ECDSA256P1Public(ECDSAPublicKey):
         return k.verify(signature=signature, data=payload,
                         signature_algorithm=ec.ECDSA(SHA256()))
 
+    def verify_digest(self, signature, digest):
+        """Verify a signature made with sign_digest()."""
+        signature = signature[:signature[1] + 2]
+        k = self.key
+        if isinstance(self.key, ec.EllipticCurvePrivateKey):
+            k = self.key.public_key()
+        return k.verify(signature=signature, data=digest,
+                        signature_algorithm=ec.ECDSA(Prehashed(SHA256())))
+
+    def emit_c_public_comb(self, file=sys.stdout):
+        """Emit the precomputed comb table of the public key, for builds of
+        MCUboot with MCUBOOT_ECDSA_P256_COMB."""
+        numbers = self._get_public().public_numbers()
+        pubkey = (numbers.x.to_bytes(32, 'big') +
+                  numbers.y.to_bytes(32, 'big'))
+        with FileHandler(file, 'w') as file:
+            print(AUTOGEN_MESSAGE, file=file)
+            print("#include <bootutil/crypto/ecdsa_p256_comb.h>\n", file=file)
+            print("const struct bootutil_ecdsa_p256_comb "
+                  "{}_pub_key_comb = {{".format(self.shortname()), file=file)
+            print("    .pubkey = {", end='', file=file)
+            for count, b in enumerate(pubkey):
+                if count % 8 == 0:
+                    print("\n        ", end='', file=file)
+                else:
+                    print(" ", end='', file=file)
+                print("0x{:02x},".format(b), end='', file=file)
+            print("\n    },", file=file)
+            print("    .points = {", file=file)
+            emit_p256_comb_points(p256_comb_table((numbers.x, numbers.y)),
+                                  "        ", file)
+            print("    },", file=file)
+            print("};", file=file)
+
 
 class ECDSA256P1(ECDSAPrivateKey, ECDSA256P1Public):
     """
@@ -204,6 +308,17 @@ class ECDSA256P1(ECDSAPrivateKey, ECDSA256P1Public):
                 data=payload,
                 signature_algorithm=ec.ECDSA(SHA256()))
 
+    def sign_digest(self, digest):
+        """Sign a digest that is not the SHA256 of the payload, such as the
+        root of a tree hashed image."""
+        sig = self.key.sign(
+                data=digest,
+                signature_algorithm=ec.ECDSA(Prehashed(SHA256())))
+        if self.pad_sig:
+            # To make fixed length, pad with one or two zeros.
+            sig += b'\000' * (self.sig_len() - len(sig))
+        return sig
+
     def sign(self, payload):
         sig = self.raw_sign(payload)
         if self.pad_sig:
@@ -254,6 +369,15 @@ class ECDSA384P1Public(ECDSAPublicKey):
         return k.verify(signature=signature, data=payload,
                         signature_algorithm=ec.ECDSA(SHA384()))
 
+    def verify_digest(self, signature, digest):
+        """Verify a signature made with sign_digest()."""
+        signature = signature[:signature[1] + 2]
+        k = self.key
+        if isinstance(self.key, ec.EllipticCurvePrivateKey):
+            k = self.key.public_key()
+        return k.verify(signature=signature, data=digest,
+                        signature_algorithm=ec.ECDSA(Prehashed(SHA384())))
+
 
 class ECDSA384P1(ECDSAPrivateKey, ECDSA384P1Public):
     """
@@ -279,6 +403,17 @@ class ECDSA384P1(ECDSAPrivateKey, ECDSA384P1Public):
                 data=payload,
                 signature_algorithm=ec.ECDSA(SHA384()))
 
+    def sign_digest(self, digest):
+        """Sign a digest that is not the SHA384 of the payload, such as the
+        root of a tree hashed image."""
+        sig = self.key.sign(
+                data=digest,
+                signature_algorithm=ec.ECDSA(Prehashed(SHA384())))
+        if self.pad_sig:
+            # To make fixed length, pad with one or two zeros.
+            sig += b'\000' * (self.sig_len() - len(sig))
+        return sig
+
     def sign(self, payload):
         sig = self.raw_sign(payload)
         if self.pad_sig:
@@ -17,6 +17,8 @@ from cryptography.hazmat.primitives.hashes import SHA256
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '../..')))
 
 from imgtool.keys import load, ECDSA256P1, ECDSAUsageError
+from imgtool.keys.ecdsa import (P256_GX, P256_GY, P256_COMB_SPACING,
+                                P256_COMB_TEETH, p256_comb_table)
 
 class EcKeyGeneration(unittest.TestCase):
 
@@ -97,6 +99,26 @@ class EcKeyGeneration(unittest.TestCase):
         k2.emit_rust_public(rustcode)
         self.assertIn("ECDSA_PUB_KEY", rustcode.getvalue())
 
+    def test_emit_comb(self):
+        """Check the comb tables against multiples computed by the
+        cryptography library."""
+        table = p256_comb_table((P256_GX, P256_GY))
+        self.assertEqual(len(table), (1 << P256_COMB_TEETH) - 1)
+        for i, (x, y) in enumerate(table, 1):
+            scalar = sum(1 << (P256_COMB_SPACING * j)
+                         for j in range(P256_COMB_TEETH) if i & (1 << j))
+            expected = ec.derive_private_key(scalar, ec.SECP256R1()) \
+                .public_key().public_numbers()
+            self.assertEqual((x, y), (expected.x, expected.y))
+
+        k = ECDSA256P1.generate()
+        ccode = io.StringIO()
+        k.emit_c_public_comb(ccode)
+        self.assertIn("ecdsa_pub_key_comb", ccode.getvalue())
+        numbers = k.key.public_key().public_numbers()
+        self.assertIn("0x{:08x},".format(numbers.x & 0xffffffff),
+                      ccode.getvalue())
+
     def test_sig(self):
         k = ECDSA256P1.generate()
         buf = b'This is the message'
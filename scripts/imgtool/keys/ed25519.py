@@ -4,10 +4,106 @@ ED25519 key management
 
 # SPDX-License-Identifier: Apache-2.0
 
+import sys
+
 from cryptography.hazmat.primitives import serialization
 from cryptography.hazmat.primitives.asymmetric import ed25519
 
-from .general import KeyClass
+from .general import AUTOGEN_MESSAGE, FileHandler, KeyClass
+
+# Curve parameters of Ed25519, needed to precompute the comb tables that the
+# bootloader uses for fixed-key verification (MCUBOOT_ED25519_COMB).
+ED25519_P = 2**255 - 19
+ED25519_D = -121665 * pow(121666, -1, ED25519_P) % ED25519_P
+ED25519_BY = 4 * pow(5, -1, ED25519_P) % ED25519_P
+
+# These must match BOOTUTIL_ED25519_COMB_SPACING and
+# BOOTUTIL_ED25519_COMB_POINTS in bootutil/crypto/ed25519.h.
+ED25519_COMB_SPACING = 128
+ED25519_COMB_POINTS = 8
+
+
+def _ed25519_add(a, b):
+    """Add two affine Ed25519 points."""
+    (x1, y1), (x2, y2) = a, b
+    t = ED25519_D * x1 * x2 * y1 * y2 % ED25519_P
+    x3 = (x1 * y2 + x2 * y1) * pow(1 + t, -1, ED25519_P)
+    y3 = (y1 * y2 + x1 * x2) * pow(1 - t, -1, ED25519_P)
+    return (x3 % ED25519_P, y3 % ED25519_P)
+
+
+def ed25519_decode_point(data):
+    """Decode a compressed Ed25519 point (RFC 8032, 5.1.3)."""
+    y = int.from_bytes(data, 'little')
+    sign = y >> 255
+    y &= (1 << 255) - 1
+    if y >= ED25519_P:
+        raise ValueError("Invalid Ed25519 point")
+    u = (y * y - 1) % ED25519_P
+    v = (ED25519_D * y * y + 1) % ED25519_P
+    x = u * pow(v, 3, ED25519_P) * \
+        pow(u * pow(v, 7, ED25519_P), (ED25519_P - 5) // 8, ED25519_P)
+    x %= ED25519_P
+    if (v * x * x - u) % ED25519_P != 0:
+        x = x * pow(2, (ED25519_P - 1) // 4, ED25519_P) % ED25519_P
+    if (v * x * x - u) % ED25519_P != 0:
+        raise ValueError("Invalid Ed25519 point")
+    if x == 0 and sign:
+        raise ValueError("Invalid Ed25519 point")
+    if x & 1 != sign:
+        x = ED25519_P - x
+    return (x, y)
+
+
+def ed25519_base_point():
+    """Return the base point B of Ed25519, (x, 4/5) with x even."""
+    return ed25519_decode_point(ED25519_BY.to_bytes(32, 'little'))
+
+
+def ed25519_comb_table(point):
+    """Return the comb table of an affine Ed25519 point.
+
+    The first row holds the odd multiples 1, 3, ... of the point, the
+    second row those of 2^ED25519_COMB_SPACING times the point."""
+    rows = []
+    for tooth in range(2):
+        q = point
+        for _ in range(tooth * ED25519_COMB_SPACING):
+            q = _ed25519_add(q, q)
+        q2 = _ed25519_add(q, q)
+        row = [q]
+        for _ in range(1, ED25519_COMB_POINTS):
+            row.append(_ed25519_add(row[-1], q2))
+        rows.append(row)
+    return rows
+
+
+def _ed25519_limbs(value):
+    """Split a field element into the ten 26/25-bit limbs used by fiat."""
+    limbs = []
+    shift = 0
+    for i in range(10):
+        width = 26 if i % 2 == 0 else 25
+        limbs.append((value >> shift) & ((1 << width) - 1))
+        shift += width
+    return limbs
+
+
+def emit_ed25519_comb_points(row, indent, file):
+    """Write a row of a comb table as a C initializer of precomputed points
+    (y + x, y - x, 2dxy)."""
+    for i, (x, y) in enumerate(row):
+        print("{}/* {:2} */ {{".format(indent, 2 * i + 1), file=file)
+        for value in ((y + x) % ED25519_P, (y - x) % ED25519_P,
+                      2 * ED25519_D * x * y % ED25519_P):
+            limbs = _ed25519_limbs(value)
+            print(indent + "    {", file=file)
+            for line in range(0, len(limbs), 5):
+                print(indent + "        " +
+                      " ".join("{},".format(w) for w in limbs[line:line + 5]),
+                      file=file)
+            print(indent + "    },", file=file)
+        print(indent + "},", file=file)
 
 
 class Ed25519UsageError(Exception):
@@ -68,6 +164,37 @@ class Ed25519Public(KeyClass):
             k = self.key.public_key()
         return k.verify(signature=signature, data=digest)
 
+    def emit_c_public_comb(self, file=sys.stdout):
+        """Emit the precomputed comb table of the public key, for builds of
+        MCUboot with MCUBOOT_ED25519_COMB."""
+        pubkey = self._get_public().public_bytes(
+                encoding=serialization.Encoding.Raw,
+                format=serialization.PublicFormat.Raw)
+        # The bootloader computes [s]B - [h]A, so the table is of -A.
+        x, y = ed25519_decode_point(pubkey)
+        rows = ed25519_comb_table(((ED25519_P - x) % ED25519_P, y))
+        with FileHandler(file, 'w') as file:
+            print(AUTOGEN_MESSAGE, file=file)
+            print("#include <bootutil/crypto/ed25519.h>\n", file=file)
+            print("const struct ed25519_comb "
+                  "{}_pub_key_comb = {{".format(self.shortname()), file=file)
+            print("    .public_key = {", end='', file=file)
+            for count, b in enumerate(pubkey):
+                if count % 8 == 0:
+                    print("\n        ", end='', file=file)
+                else:
+                    print(" ", end='', file=file)
+                print("0x{:02x},".format(b), end='', file=file)
+            print("\n    },", file=file)
+            print("    .points = {", file=file)
+            for tooth, row in enumerate(rows):
+                print("        /* 2^{} * -A */ {{".format(
+                    tooth * ED25519_COMB_SPACING), file=file)
+                emit_ed25519_comb_points(row, "            ", file)
+                print("        },", file=file)
+            print("    },", file=file)
+            print("};", file=file)
+
 
 class Ed25519(Ed25519Public):
     """
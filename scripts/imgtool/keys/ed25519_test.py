@@ -17,6 +17,8 @@ from cryptography.hazmat.primitives.asymmetric import ed25519
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '../..')))
 
 from imgtool.keys import load, Ed25519, Ed25519UsageError
+from imgtool.keys.ed25519 import (ED25519_COMB_POINTS, ed25519_base_point,
+                                  ed25519_comb_table, emit_ed25519_comb_points)
 
 
 class Ed25519KeyGeneration(unittest.TestCase):
@@ -81,6 +83,26 @@ class Ed25519KeyGeneration(unittest.TestCase):
         k.emit_raw_public_hash(hashraw)
         self.assertTrue(len(hashraw.getvalue()) > 0)
 
+    def test_emit_comb(self):
+        """Check the comb tables against the table of the base point in
+        fiat's curve25519_tables.h."""
+        rows = ed25519_comb_table(ed25519_base_point())
+        self.assertEqual(len(rows), 2)
+        self.assertEqual(len(rows[0]), ED25519_COMB_POINTS)
+        self.assertEqual(len(rows[1]), ED25519_COMB_POINTS)
+        ccode = io.StringIO()
+        emit_ed25519_comb_points(rows[0], "", ccode)
+        # Bi[0] and Bi[7] of fiat, as y + x.
+        self.assertIn("25967493, 19198397, 29566455, 3660896, 54414519,",
+                      ccode.getvalue())
+        self.assertIn("63957664, 28508356, 9282713, 6866145, 35201802,",
+                      ccode.getvalue())
+
+        k = Ed25519.generate()
+        ccode = io.StringIO()
+        k.emit_c_public_comb(ccode)
+        self.assertIn("ed25519_pub_key_comb", ccode.getvalue())
+
     def test_emit_pub(self):
         """Basic sanity check on the code emitters, from public key."""
         pubname = self.tname("public.pem")
@@ -3,20 +3,48 @@ RSA Key management
 """
 
 # SPDX-License-Identifier: Apache-2.0
+import sys
 
 from cryptography.hazmat.backends import default_backend
 from cryptography.hazmat.primitives import serialization
 from cryptography.hazmat.primitives.asymmetric import rsa
 from cryptography.hazmat.primitives.asymmetric.padding import PSS, MGF1
+from cryptography.hazmat.primitives.asymmetric.utils import Prehashed
 from cryptography.hazmat.primitives.hashes import SHA256
 
-from .general import KeyClass
+from .general import AUTOGEN_MESSAGE, FileHandler, KeyClass
 from .privatebytes import PrivateBytesMixin
 
 
 # Sizes that bootutil will recognize
 RSA_KEY_SIZES = [2048, 3072]
 
+# This must match BOOTUTIL_RSA_MONT_LIMB_BITS in bootutil/crypto/rsa_mont.h.
+RSA_MONT_LIMB_BITS = 32
+
+
+def rsa_mont_constants(n, key_size):
+    """Return (-n^-1 mod 2^RSA_MONT_LIMB_BITS, R^2 mod n) for Montgomery
+    multiplication modulo n, with R = 2^key_size."""
+    limb = 1 << RSA_MONT_LIMB_BITS
+    n0inv = -pow(n, -1, limb) % limb
+    rr = pow(2, 2 * key_size, n)
+    return n0inv, rr
+
+
+def _emit_rsa_mont_limbs(name, value, key_size, file):
+    """Emit a number as an array of limbs, least significant first."""
+    mask = (1 << RSA_MONT_LIMB_BITS) - 1
+    print("    .{} = {{".format(name), end='', file=file)
+    for i in range(key_size // RSA_MONT_LIMB_BITS):
+        if i % 4 == 0:
+            print("\n        ", end='', file=file)
+        else:
+            print(" ", end='', file=file)
+        limb = (value >> (RSA_MONT_LIMB_BITS * i)) & mask
+        print("0x{:08x},".format(limb), end='', file=file)
+    print("\n    },", file=file)
+
 
 class RSAUsageError(Exception):
     pass
@@ -64,6 +92,24 @@ class RSAPublic(KeyClass):
         with open(path, 'wb') as f:
             f.write(pem)
 
+    def emit_c_public_mont(self, file=sys.stdout):
+        """Emit the precomputed Montgomery constants of the public key, for
+        builds of MCUboot with MCUBOOT_RSA_MONT."""
+        numbers = self._get_public().public_numbers()
+        if numbers.e != 65537:
+            raise RSAUsageError("The lang-c-mont encoding requires a public "
+                                "exponent of 65537")
+        n0inv, rr = rsa_mont_constants(numbers.n, self.key_size())
+        with FileHandler(file, 'w') as file:
+            print(AUTOGEN_MESSAGE, file=file)
+            print("#include <bootutil/crypto/rsa_mont.h>\n", file=file)
+            print("const struct bootutil_rsa_mont "
+                  "{}_pub_key_mont = {{".format(self.shortname()), file=file)
+            print("    .n0inv = 0x{:08x},".format(n0inv), file=file)
+            _emit_rsa_mont_limbs("n", numbers.n, self.key_size(), file)
+            _emit_rsa_mont_limbs("rr", rr, self.key_size(), file)
+            print("};", file=file)
+
     def sig_type(self):
         return "PKCS1_PSS_RSA{}_SHA256".format(self.key_size())
 
@@ -81,6 +127,15 @@ class RSAPublic(KeyClass):
                         padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
                         algorithm=SHA256())
 
+    def verify_digest(self, signature, digest):
+        """Verify a signature made with sign_digest()."""
+        k = self.key
+        if isinstance(self.key, rsa.RSAPrivateKey):
+            k = self.key.public_key()
+        return k.verify(signature=signature, data=digest,
+                        padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
+                        algorithm=Prehashed(SHA256()))
+
 
 class RSA(RSAPublic, PrivateBytesMixin):
     """
@@ -171,3 +226,11 @@ class RSA(RSAPublic, PrivateBytesMixin):
                 data=payload,
                 padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
                 algorithm=SHA256())
+
+    def sign_digest(self, digest):
+        """Sign a digest that is not the SHA256 of the payload, such as the
+        root of a tree hashed image."""
+        return self.key.sign(
+                data=digest,
+                padding=PSS(mgf=MGF1(SHA256()), salt_length=32),
+                algorithm=Prehashed(SHA256()))
@@ -19,7 +19,8 @@ sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__),
                                                 '../..')))
 
 from imgtool.keys import load, RSA, RSAUsageError
-from imgtool.keys.rsa import RSA_KEY_SIZES
+from imgtool.keys.rsa import (RSA_KEY_SIZES, RSA_MONT_LIMB_BITS,
+                               rsa_mont_constants)
 
 
 class KeyGeneration(unittest.TestCase):
@@ -91,6 +92,21 @@ class KeyGeneration(unittest.TestCase):
             k.emit_raw_public_hash(hashraw)
             self.assertTrue(len(hashraw.getvalue()) > 0)
 
+    def test_emit_mont(self):
+        """Check the Montgomery constants of the lang-c-mont encoding."""
+        for key_size in RSA_KEY_SIZES:
+            k = RSA.generate(key_size=key_size)
+            n = k.key.public_key().public_numbers().n
+            n0inv, rr = rsa_mont_constants(n, key_size)
+            self.assertEqual((n * n0inv + 1) % (1 << RSA_MONT_LIMB_BITS), 0)
+            self.assertEqual(rr, (1 << (2 * key_size)) % n)
+
+            ccode = io.StringIO()
+            k.emit_c_public_mont(ccode)
+            self.assertIn("rsa_pub_key_mont", ccode.getvalue())
+            self.assertIn("0x{:08x},".format(n & 0xffffffff),
+                          ccode.getvalue())
+
     def test_emit_pub(self):
         """Basic sanity check on the code emitters, from public key."""
         pubname = self.tname("public.pem")
@@ -82,7 +82,8 @@ def gen_x25519(keyfile, passwd):
 
 valid_langs = ['c', 'rust']
 valid_hash_encodings = ['lang-c', 'raw']
-valid_encodings = ['lang-c', 'lang-rust', 'pem', 'raw']
+valid_encodings = ['lang-c', 'lang-rust', 'pem', 'raw', 'lang-c-comb',
+                   'lang-c-mont']
 keygens = {
     'rsa-2048':   gen_rsa2048,
     'rsa-3072':   gen_rsa3072,
@@ -177,6 +178,17 @@ def getpub(key, encoding, lang, output):
         key.emit_public_pem(file=output)
     elif encoding == 'raw':
         key.emit_raw_public(file=output)
+    elif encoding == 'lang-c-comb':
+        if not hasattr(key, 'emit_c_public_comb'):
+            raise click.UsageError('The lang-c-comb encoding is only '
+                                   'supported for ECDSA P-256 and Ed25519 '
+                                   'keys')
+        key.emit_c_public_comb(file=output)
+    elif encoding == 'lang-c-mont':
+        if not hasattr(key, 'emit_c_public_mont'):
+            raise click.UsageError('The lang-c-mont encoding is only '
+                                   'supported for RSA keys')
+        key.emit_c_public_mont(file=output)
     else:
         raise click.UsageError()
 
@@ -466,6 +478,16 @@ class BasedIntParamType(click.ParamType):
               'no cryptographic signature is used, or default for signature type')
 @click.option('--hmac-sha', 'hmac_sha', type=click.Choice(valid_hmac_sha), default='auto',
               help='sha algorithm used in HKDF/HMAC in ECIES key exchange TLV')
+@click.option('--hash-tree-leaf', type=BasedIntParamType(), required=False,
+              help='Hash the image as a tree of leaves of this size, a power '
+              'of two from 1024, instead of with a single digest. Needs a '
+              'bootloader built with MCUBOOT_HASH_TREE.')
+@click.option('--delta-base', metavar='filename',
+              help='Output a delta image that builds the signed image from '
+              'the signed image in the given file, which must be the one in '
+              'the primary slot. Will fall back to the full image '
+              'automatically if the delta image is not smaller. Needs a '
+              'bootloader built with MCUBOOT_DELTA_IMAGES.')
 @click.option('--vector-to-sign', type=click.Choice(['payload', 'digest']),
               help='send to OUTFILE the payload or payload''s digest instead '
               'of complied image. These data can be used for external image '
@@ -479,7 +501,7 @@ def sign(key, public_key_format, align, version, pad_sig, header_size,
          dependencies, load_addr, hex_addr, erased_val, save_enctlv,
          security_counter, boot_record, custom_tlv, rom_fixed, max_align,
          clear, fix_sig, fix_sig_pubkey, sig_out, user_sha, hmac_sha, is_pure,
-         vector_to_sign, non_bootable):
+         hash_tree_leaf, delta_base, vector_to_sign, non_bootable):
 
     if confirm:
         # Confirmed but non-padded images don't make much sense, because
@@ -551,6 +573,16 @@ def sign(key, public_key_format, align, version, pad_sig, header_size,
             'Pure signatures, currently, enforces preferred hash algorithm, '
             'and forbids sha selection by user.')
 
+    if hash_tree_leaf is not None and compression in ["lzma2", "lzma2armthumb"]:
+        raise click.UsageError(
+            'A tree hash can not be used with compressed images.')
+
+    if delta_base is not None and (compression in ["lzma2", "lzma2armthumb"]
+                                   or enckey or vector_to_sign):
+        raise click.UsageError(
+            'A delta image can not be compressed, encrypted or signed '
+            'externally.')
+
     if compression in ["lzma2", "lzma2armthumb"]:
         img.create(key, public_key_format, enckey, dependencies, boot_record,
                custom_tlvs, compression_tlvs, None, int(encrypt_keylen), clear,
@@ -606,7 +638,42 @@ def sign(key, public_key_format, align, version, pad_sig, header_size,
         img.create(key, public_key_format, enckey, dependencies, boot_record,
                custom_tlvs, compression_tlvs, None, int(encrypt_keylen), clear,
                baked_signature, pub_key, vector_to_sign, user_sha=user_sha,
-               hmac_sha=hmac_sha, is_pure=is_pure)
+               hmac_sha=hmac_sha, is_pure=is_pure, hash_tree_leaf=hash_tree_leaf)
+    if delta_base is not None:
+        # The header of the base is part of its data.
+        base = image.Image(header_size=0)
+        base.load(delta_base)
+        base_data = bytes(base.payload[:image.image_end(base.payload, endian)])
+        target_data = bytes(img.payload)
+        hash_algorithm, _ = image.key_and_user_sha_to_alg_and_tlv(
+            key if key is not None else pub_key, user_sha, is_pure)
+        patch = image.make_delta(base_data, target_data, endian)
+        print(f"delta image patch size: {len(patch)} bytes")
+        print(f"original image size: {len(target_data)} bytes")
+        delta_tlvs = {}
+        for tag, data in (("DELTA_BASE", base_data),
+                          ("DELTA_TARGET", target_data)):
+            delta_tlvs[tag] = struct.pack(
+                img.get_struct_endian() + 'L', len(data)) + \
+                hash_algorithm(data).digest()
+        if len(patch) < len(target_data):
+            delta_img = image.Image(version=decode_version(version),
+                      header_size=header_size, pad_header=pad_header,
+                      pad=pad, confirm=confirm, align=int(align),
+                      slot_size=slot_size, max_sectors=max_sectors,
+                      overwrite_only=overwrite_only, endian=endian,
+                      load_addr=load_addr, rom_fixed=rom_fixed,
+                      erased_val=erased_val, save_enctlv=save_enctlv,
+                      security_counter=security_counter, max_align=max_align,
+                      non_bootable=non_bootable)
+            delta_img.load_delta(patch)
+            delta_img.base_addr = img.base_addr
+            delta_img.create(key, public_key_format, enckey, dependencies,
+               boot_record, custom_tlvs, delta_tlvs, "delta",
+               int(encrypt_keylen), clear, baked_signature, pub_key,
+               vector_to_sign, user_sha=user_sha, hmac_sha=hmac_sha,
+               is_pure=is_pure, hash_tree_leaf=hash_tree_leaf)
+            img = delta_img
     img.save(outfile, hex_addr)
     if sig_out is not None:
         new_signature = img.get_signature()
@@ -0,0 +1,149 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import hashlib
+import random
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool import keys
+from imgtool.image import (IMAGE_F, TLV_VALUES, Image, VerifyResult,
+                           image_end)
+from imgtool.main import imgtool
+
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+
+
+def sign(tmpdir: Path, key_file: Path, name: str, data: bytes, version: str,
+         delta_base: Path = None) -> Path:
+    in_file = tmpdir / f'{name}.bin'
+    with in_file.open("wb") as f:
+        f.write(data)
+    out_file: Path = tmpdir / f'{name}_signed.bin'
+
+    args = [
+        'sign',
+        str(in_file),
+        str(out_file),
+        f'--header-size={HEADER_SIZE}',
+        f'--slot-size={SLOT_SIZE}',
+        f'--version={version}',
+        '--pad-header',
+        f'--key={key_file}'
+    ]
+    if delta_base is not None:
+        args.append(f'--delta-base={delta_base}')
+
+    result = CliRunner().invoke(imgtool, args)
+    assert result.exit_code == 0
+    return out_file
+
+
+def protected_tlvs(data: bytes) -> dict:
+    _, _, header_size, prot_size, img_size = struct.unpack('<IIHHI', data[:16])
+    off = header_size + img_size
+    end = off + prot_size
+    tlvs = {}
+    off += 4
+    while off < end:
+        kind, size = struct.unpack('<HH', data[off:off + 4])
+        tlvs[kind] = data[off + 4:off + 4 + size]
+        off += 4 + size
+    return tlvs
+
+
+def apply_delta(base: bytes, data: bytes) -> bytes:
+    """Build the target of a delta image as the bootloader does."""
+    _, _, header_size, _, img_size = struct.unpack('<IIHHI', data[:16])
+    off = header_size
+    end = header_size + img_size
+    target = bytearray()
+    while off < end:
+        src_off, copy_len, insert_len = struct.unpack('<III', data[off:off + 12])
+        off += 12
+        target += base[src_off:src_off + copy_len]
+        target += data[off:off + insert_len]
+        off += insert_len
+    return bytes(target)
+
+
+@pytest.mark.parametrize('key_name', ['root-ed25519.pem', 'root-ec-p256.pem',
+                                      'root-rsa-2048.pem'])
+@pytest.mark.parametrize('size', [5000, 60000])
+def test_delta_sign(tmpdir: Path, key_name: str, size: int):
+    """
+    Sign an image with ``--delta-base`` and check that the delta image is
+    signed, smaller than the image, and that its patch builds the image its
+    TLVs describe from the base.
+    """
+    key_file = Path(__file__).parents[2] / key_name
+    key = keys.load(str(key_file))
+    rng = random.Random(size)
+    old = bytes(rng.getrandbits(8) for _ in range(size))
+    new = bytearray(old)
+    new[size // 3:size // 3 + 8] = b'\x55' * 8
+    new[size // 2:size // 2] = bytes(100)
+    new += b'\xaa' * 40
+
+    base_file = sign(tmpdir, key_file, 'old', old, '1.0.0')
+    out_file = sign(tmpdir, key_file, 'new', bytes(new), '1.1.0', base_file)
+
+    result, _, _, _ = Image.verify(str(out_file), key)
+    assert result == VerifyResult.OK
+
+    with base_file.open("rb") as f:
+        base = f.read()
+    base = base[:image_end(base)]
+    with out_file.open("rb") as f:
+        data = f.read()
+    flags, = struct.unpack('<I', data[16:20])
+    assert flags & IMAGE_F['DELTA']
+    assert image_end(data) < size // 2
+
+    tlvs = protected_tlvs(data)
+    base_tlv = tlvs[TLV_VALUES['DELTA_BASE']]
+    target_tlv = tlvs[TLV_VALUES['DELTA_TARGET']]
+    assert base_tlv == struct.pack('<I', len(base)) + hashlib.sha256(base).digest()
+
+    target = apply_delta(base, data)
+    assert target_tlv == struct.pack('<I', len(target)) + \
+        hashlib.sha256(target).digest()
+    assert target[HEADER_SIZE:HEADER_SIZE + len(new)] == new
+
+    target_file = tmpdir / 'target.bin'
+    with target_file.open("wb") as f:
+        f.write(target)
+    result, _, _, _ = Image.verify(str(target_file), key)
+    assert result == VerifyResult.OK
+
+
+def test_delta_fallback(tmpdir: Path):
+    """An image with nothing in common with the base is output whole."""
+    key_file = Path(__file__).parents[2] / 'root-ec-p256.pem'
+    rng = random.Random(0)
+    old = bytes(rng.getrandbits(8) for _ in range(4000))
+    new = bytes(rng.getrandbits(8) for _ in range(4000))
+
+    base_file = sign(tmpdir, key_file, 'old', old, '1.0.0')
+    out_file = sign(tmpdir, key_file, 'new', new, '1.1.0', base_file)
+
+    with out_file.open("rb") as f:
+        data = f.read()
+    flags, = struct.unpack('<I', data[16:20])
+    assert not flags & IMAGE_F['DELTA']
+    assert data[HEADER_SIZE:HEADER_SIZE + len(new)] == new
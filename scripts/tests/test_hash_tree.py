@@ -0,0 +1,130 @@
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import hashlib
+import struct
+from pathlib import Path
+
+import pytest
+from click.testing import CliRunner
+
+from imgtool import keys
+from imgtool.image import (Image, VerifyResult, hash_tree_leaves,
+                           hash_tree_root)
+from imgtool.main import imgtool
+
+VERSION = '2.0.0'
+HEADER_SIZE = 0x200
+SLOT_SIZE = 0x7a000
+
+
+def find_tlv(data: bytes, off: int, kind: int) -> bytes:
+    """Return the value of the first TLV of the given kind in the
+    unprotected TLV area at off."""
+    magic, total = struct.unpack('<HH', data[off:off + 4])
+    assert magic == 0x6907
+    end = off + total
+    off += 4
+    while off < end:
+        tlv_kind, tlv_len = struct.unpack('<HH', data[off:off + 4])
+        if tlv_kind == kind:
+            return data[off + 4:off + 4 + tlv_len]
+        off += 4 + tlv_len
+    raise KeyError(kind)
+
+
+def sign(tmpdir: Path, key_file: Path, leaf_size: int, size: int) -> Path:
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(bytes(i * 7 & 0xff for i in range(size)))
+    out_file: Path = tmpdir / 'zephyr_signed.bin'
+
+    runner = CliRunner()
+    result = runner.invoke(
+        imgtool,
+        [
+            'sign',
+            str(in_file),
+            str(out_file),
+            f'--header-size={HEADER_SIZE}',
+            f'--slot-size={SLOT_SIZE}',
+            f'--version={VERSION}',
+            '--pad-header',
+            f'--hash-tree-leaf={leaf_size}',
+            f'--key={key_file}'
+        ],
+    )
+    assert result.exit_code == 0
+    return out_file
+
+
+@pytest.mark.parametrize('key_name', ['root-ed25519.pem', 'root-ec-p256.pem',
+                                      'root-rsa-2048.pem'])
+@pytest.mark.parametrize('leaf_size, size', [(1024, 100), (1024, 5000),
+                                             (4096, 20000)])
+def test_hash_tree_sign(tmpdir: Path, key_name: str, leaf_size: int,
+                        size: int):
+    """
+    Sign with ``--hash-tree-leaf`` and check that the image verifies, that
+    its TLV holds the leaf size and the digests of the leaves, and that it no
+    longer verifies once a byte of it changed.
+    """
+    key_file = Path(__file__).parents[2] / key_name
+    key = keys.load(str(key_file))
+    out_file = sign(tmpdir, key_file, leaf_size, size)
+
+    result, _, digest, _ = Image.verify(str(out_file), key)
+    assert result == VerifyResult.OK
+
+    with out_file.open("rb") as f:
+        data = bytearray(f.read())
+    assert digest == hash_tree_root(hashlib.sha256,
+                                    bytes(data[:HEADER_SIZE + size]),
+                                    leaf_size)
+    leaves = hash_tree_leaves(hashlib.sha256, bytes(data[:HEADER_SIZE + size]),
+                              leaf_size)
+    assert find_tlv(data, HEADER_SIZE + size, 0x13) == \
+        struct.pack('<I', leaf_size) + b''.join(leaves)
+
+    data[HEADER_SIZE + size // 2] ^= 1
+    with out_file.open("wb") as f:
+        f.write(data)
+    result, _, _, _ = Image.verify(str(out_file), key)
+    assert result == VerifyResult.INVALID_HASH
+
+
+def test_hash_tree_bad_leaf(tmpdir: Path):
+    """A leaf size that is not a power of two from 1024 is refused."""
+    key_file = Path(__file__).parents[2] / 'root-ed25519.pem'
+    in_file = tmpdir / 'zephyr.bin'
+    with in_file.open("wb") as f:
+        f.write(b"\x00" * 64)
+
+    runner = CliRunner()
+    for leaf_size in (512, 3000):
+        result = runner.invoke(
+            imgtool,
+            [
+                'sign',
+                str(in_file),
+                str(tmpdir / 'zephyr_signed.bin'),
+                f'--header-size={HEADER_SIZE}',
+                f'--slot-size={SLOT_SIZE}',
+                f'--version={VERSION}',
+                '--pad-header',
+                f'--hash-tree-leaf={leaf_size}',
+                f'--key={key_file}'
+            ],
+        )
+        assert result.exit_code != 0
@@ -7,6 +7,7 @@ use std::env;
 use std::fs;
 use std::io;
 use std::path::{Path, PathBuf};
+use std::process::Command;
 
 fn main() {
     // Feature flags.
@@ -39,13 +40,34 @@ fn main() {
     let direct_xip = env::var("CARGO_FEATURE_DIRECT_XIP").is_ok();
     let max_align_32 = env::var("CARGO_FEATURE_MAX_ALIGN_32").is_ok();
     let hw_rollback_protection = env::var("CARGO_FEATURE_HW_ROLLBACK_PROTECTION").is_ok();
+    let large_geometry = env::var("CARGO_FEATURE_LARGE_GEOMETRY").is_ok();
+    let serial_recovery = env::var("CARGO_FEATURE_SERIAL_RECOVERY").is_ok();
+    let ecdsa_comb = env::var("CARGO_FEATURE_ECDSA_COMB").is_ok();
+    let ed25519_comb = env::var("CARGO_FEATURE_ED25519_COMB").is_ok();
+    let sig_pure = env::var("CARGO_FEATURE_SIG_PURE").is_ok();
+    let batch_verify = env::var("CARGO_FEATURE_BATCH_VERIFY").is_ok();
+    let rsa_mont = env::var("CARGO_FEATURE_RSA_MONT").is_ok();
+    let sha_kernel = env::var("CARGO_FEATURE_SHA_KERNEL").is_ok();
+    let sha_kernel_unroll = env::var("CARGO_FEATURE_SHA_KERNEL_UNROLL").is_ok();
+    let hash_tree = env::var("CARGO_FEATURE_HASH_TREE").is_ok();
+    let crypto_async = env::var("CARGO_FEATURE_CRYPTO_ASYNC").is_ok();
+    let enc_key_cache = env::var("CARGO_FEATURE_ENC_KEY_CACHE").is_ok();
+    let crypto_bench = env::var("CARGO_FEATURE_CRYPTO_BENCH").is_ok();
+    let erase_range = env::var("CARGO_FEATURE_ERASE_RANGE").is_ok();
+    let overwrite_resume = env::var("CARGO_FEATURE_OVERWRITE_RESUME").is_ok();
+    let flash_async = env::var("CARGO_FEATURE_FLASH_ASYNC").is_ok();
+    let scratch_wear_leveling = env::var("CARGO_FEATURE_SCRATCH_WEAR_LEVELING").is_ok();
+    let swap_move_batch = env::var("CARGO_FEATURE_SWAP_MOVE_BATCH").is_ok();
+    let delta = env::var("CARGO_FEATURE_DELTA").is_ok();
+    let slot_snapshot = env::var("CARGO_FEATURE_SLOT_SNAPSHOT").is_ok();
+    let image_extent = env::var("CARGO_FEATURE_IMAGE_EXTENT").is_ok();
 
     let mut conf = CachedBuild::new();
     conf.conf.define("__BOOTSIM__", None);
     conf.conf.define("MCUBOOT_HAVE_LOGGING", None);
     conf.conf.define("MCUBOOT_USE_FLASH_AREA_GET_SECTORS", None);
     conf.conf.define("MCUBOOT_HAVE_ASSERT_H", None);
-    conf.conf.define("MCUBOOT_MAX_IMG_SECTORS", Some("128"));
+    conf.conf.define("MCUBOOT_MAX_IMG_SECTORS", Some(if large_geometry { "4096" } else { "128" }));
 
     if max_align_32 {
         conf.conf.define("MCUBOOT_BOOT_MAX_ALIGN", Some("32"));
@@ -59,6 +81,68 @@ fn main() {
         panic!("Downgrade prevention requires overwrite only");
     }
 
+    if overwrite_resume && !overwrite_only {
+        panic!("overwrite-resume requires overwrite-only");
+    }
+
+    if scratch_wear_leveling && (overwrite_only || swap_move || swap_offset ||
+                                 ram_load || direct_xip) {
+        panic!("scratch-wear-leveling requires the swap using scratch upgrade");
+    }
+
+    if swap_move_batch && !swap_move {
+        panic!("swap-move-batch requires swap-move");
+    }
+
+    if delta && (!overwrite_only || enc_rsa || enc_aes256_rsa || enc_kw ||
+                 enc_aes256_kw || enc_ec256 || enc_ec256_mbedtls ||
+                 enc_aes256_ec256 || enc_x25519 || enc_aes256_x25519) {
+        panic!("delta requires overwrite-only, without encryption");
+    }
+
+    if slot_snapshot && (ram_load || direct_xip) {
+        panic!("slot-snapshot requires the swap or overwrite upgrades");
+    }
+
+    if ecdsa_comb && !sig_ecdsa {
+        panic!("ecdsa-comb requires sig-ecdsa");
+    }
+
+    if ed25519_comb && !sig_ed25519 {
+        panic!("ed25519-comb requires sig-ed25519");
+    }
+
+    if rsa_mont && (!(sig_rsa || sig_rsa3072) || psa_crypto_api) {
+        panic!("rsa-mont requires sig-rsa or sig-rsa3072, without psa-crypto-api");
+    }
+
+    if sig_pure && !sig_ed25519 {
+        panic!("sig-pure requires sig-ed25519");
+    }
+
+    if sig_pure && (enc_rsa || enc_aes256_rsa || enc_kw || enc_aes256_kw ||
+                    enc_ec256 || enc_ec256_mbedtls || enc_aes256_ec256 ||
+                    enc_x25519 || enc_aes256_x25519 || ram_load) {
+        panic!("sig-pure does not support encryption or ram-load");
+    }
+
+    if batch_verify && (!sig_ed25519 || sig_pure || !validate_primary_slot ||
+                        ram_load || direct_xip) {
+        panic!("batch-verify requires sig-ed25519 and validate-primary-slot, \
+                without sig-pure, ram-load or direct-xip");
+    }
+
+    if hash_tree && (sig_rsa || sig_rsa3072 || sig_ecdsa || sig_ecdsa_mbedtls ||
+                     sig_ecdsa_psa || sig_p384 || sig_pure) {
+        panic!("hash-tree requires sig-ed25519 or no signature, without sig-pure");
+    }
+
+    if enc_key_cache && !(enc_rsa || enc_aes256_rsa || enc_kw || enc_aes256_kw ||
+                          enc_ec256 || enc_ec256_mbedtls || enc_aes256_ec256 ||
+                          enc_x25519 || enc_aes256_x25519) {
+        panic!("enc-key-cache requires one of the enc-* features");
+    }
+
     if bootstrap {
         conf.conf.define("MCUBOOT_BOOTSTRAP", None);
         conf.conf.define("MCUBOOT_OVERWRITE_ONLY_FAST", None);
@@ -175,6 +259,11 @@ fn main() {
         conf.file("../../ext/mbedtls/library/asn1parse.c");
         conf.file("../../ext/mbedtls/library/md.c");
 
+        if rsa_mont {
+            conf.conf.define("MCUBOOT_RSA_MONT", None);
+            conf.file("../../boot/bootutil/src/rsa_mont.c");
+        }
+
     } else if sig_ecdsa {
         conf.conf.define("MCUBOOT_SIGN_EC256", None);
         conf.conf.define("MCUBOOT_USE_TINYCRYPT", None);
@@ -193,6 +282,11 @@ fn main() {
         conf.file("../../ext/tinycrypt/lib/source/ecc_platform_specific.c");
         conf.file("../../ext/mbedtls/library/platform_util.c");
         conf.file("../../ext/mbedtls/library/asn1parse.c");
+
+        if ecdsa_comb {
+            conf.conf.define("MCUBOOT_ECDSA_P256_COMB", None);
+            conf.file("../../boot/bootutil/src/ecdsa_p256_comb.c");
+        }
     } else if sig_ecdsa_mbedtls {
         conf.conf.define("MCUBOOT_SIGN_EC256", None);
         conf.conf.define("MCUBOOT_USE_MBED_TLS", None);
@@ -230,6 +324,16 @@ fn main() {
         conf.conf.define("MCUBOOT_SIGN_ED25519", None);
         conf.conf.define("MCUBOOT_USE_TINYCRYPT", None);
 
+        if sig_pure {
+            conf.conf.define("MCUBOOT_SIGN_PURE", None);
+        }
+        if ed25519_comb {
+            conf.conf.define("MCUBOOT_ED25519_COMB", None);
+        }
+        if batch_verify {
+            conf.conf.define("MCUBOOT_BATCH_VERIFY", None);
+        }
+
         conf.conf.include("../../ext/tinycrypt/lib/include");
         conf.conf.include("../../ext/tinycrypt-sha512/lib/include");
         conf.conf.include("../../ext/mbedtls/include");
@@ -448,6 +552,70 @@ fn main() {
         conf.conf.define("MBEDTLS_CONFIG_FILE", Some("<config-ec-psa.h>"));
     }
 
+    if sha_kernel || sha_kernel_unroll {
+        conf.conf.define("MCUBOOT_SHA_KERNEL", None);
+        if sha_kernel_unroll {
+            conf.conf.define("MCUBOOT_SHA_KERNEL_UNROLL", None);
+        }
+        conf.file("../../boot/bootutil/src/sha_kernel.c");
+    }
+
+    if hash_tree {
+        conf.conf.define("MCUBOOT_HASH_TREE", None);
+        conf.file("../../boot/bootutil/src/hash_tree.c");
+    }
+
+    if enc_key_cache {
+        conf.conf.define("MCUBOOT_ENC_KEY_CACHE", None);
+    }
+
+    if erase_range {
+        conf.conf.define("MCUBOOT_FLASH_ERASE_RANGE", None);
+    }
+
+    if overwrite_resume {
+        conf.conf.define("MCUBOOT_OVERWRITE_ONLY_RESUME", None);
+    }
+
+    if scratch_wear_leveling {
+        conf.conf.define("MCUBOOT_SCRATCH_WEAR_LEVELING", None);
+    }
+
+    if swap_move_batch {
+        conf.conf.define("MCUBOOT_SWAP_MOVE_BATCH_SECTORS", Some("4"));
+    }
+
+    if delta {
+        conf.conf.define("MCUBOOT_DELTA_IMAGES", None);
+        conf.file("../../boot/bootutil/src/delta.c");
+    }
+
+    if slot_snapshot {
+        conf.conf.define("MCUBOOT_SLOT_SNAPSHOT", None);
+    }
+
+    if image_extent {
+        conf.conf.define("MCUBOOT_IMAGE_EXTENT", None);
+    }
+
+    if flash_async {
+        conf.conf.define("MCUBOOT_FLASH_ASYNC", None);
+        conf.file("../../boot/bootutil/src/flash_async.c");
+        conf.file("csupport/flash_async.c");
+    }
+
+    if crypto_async {
+        conf.conf.define("MCUBOOT_CRYPTO_ASYNC", None);
+        conf.file("../../boot/bootutil/src/crypto_async.c");
+        conf.file("csupport/crypto_async.c");
+    }
+
+    // Timing of the crypto primitives, for the benchmarks in the tests.
+    if ed25519_comb || batch_verify || rsa_mont || sha_kernel || sha_kernel_unroll ||
+       hash_tree || crypto_bench {
+        conf.file("csupport/bench.c");
+    }
+
     conf.file("../../boot/bootutil/src/image_validate.c");
     if sig_rsa || sig_rsa3072 {
         conf.file("../../boot/bootutil/src/image_rsa.c");
@@ -471,6 +639,27 @@ fn main() {
     conf.file("../../boot/bootutil/src/tlv.c");
     conf.file("../../boot/bootutil/src/fault_injection_hardening.c");
     conf.file("csupport/run.c");
+    if serial_recovery {
+        // Allow larger packets than the default, so that the throughput with different chunk sizes
+        // can be compared.
+        println!("cargo:rerun-if-env-changed=MCUBOOT_SERIAL_MAX_RECEIVE_SIZE");
+        let max_receive = env::var("MCUBOOT_SERIAL_MAX_RECEIVE_SIZE")
+            .unwrap_or_else(|_| "2048".to_string());
+        conf.conf.define("MCUBOOT_SIM_SERIAL", None);
+        conf.conf.define("MCUBOOT_SERIAL_MAX_RECEIVE_SIZE", Some(max_receive.as_str()));
+        println!("cargo:rustc-env=BOOTSIM_SERIAL_MAX_RECEIVE_SIZE={}", max_receive);
+        conf.file("../../boot/boot_serial/src/boot_serial.c");
+        conf.file("../../boot/boot_serial/src/zcbor_bulk.c");
+        conf.file("../../boot/zcbor/src/zcbor_common.c");
+        conf.file("../../boot/zcbor/src/zcbor_decode.c");
+        conf.file("../../boot/zcbor/src/zcbor_encode.c");
+        conf.file("csupport/serial.c");
+        conf.conf.include("../../boot/boot_serial/include");
+        conf.conf.include("../../boot/zcbor/include");
+    }
+    if env::var("CARGO_CFG_TARGET_OS").unwrap() == "linux" {
+        conf.conf.define("MCUBOOT_SIM_STACK_MEASURE", None);
+    }
     conf.conf.include("../../boot/bootutil/include");
     conf.conf.include("csupport");
     conf.conf.debug(true);
@@ -484,6 +673,8 @@ fn main() {
 
     conf.conf.compile("libbootutil.a");
 
+    report_ram_usage();
+
     walk_dir("../../boot").unwrap();
     walk_dir("../../ext/tinycrypt/lib/source").unwrap();
     walk_dir("../../ext/mbedtls-asn1").unwrap();
@@ -492,6 +683,73 @@ fn main() {
     walk_dir("../../ext/mbedtls/library").unwrap();
 }
 
+/// Objects that only exist to support the simulator, and don't count towards the bootloader's RAM.
+const SIM_ONLY_OBJECTS: &[&str] = &[
+    "run.o",
+    "serial.o",
+    "security_cnt.o",
+    "psa_crypto_init_stub.o",
+    "fake_external_rng_for_test.o",
+    "random.o",
+];
+
+/// Measure the static RAM (data and bss) of the compiled bootloader with the `size` tool (or the
+/// one named by $SIZE).  The totals are passed to the crate as BOOTSIM_STATIC_DATA and
+/// BOOTSIM_STATIC_BSS, and the per-object breakdown is written to ram-usage.txt in OUT_DIR.  Set
+/// MCUBOOT_RAM_REPORT to also print the totals while building.
+fn report_ram_usage() {
+    println!("cargo:rerun-if-env-changed=SIZE");
+    println!("cargo:rerun-if-env-changed=MCUBOOT_RAM_REPORT");
+
+    let out_dir = PathBuf::from(env::var("OUT_DIR").unwrap());
+    let size = env::var("SIZE").unwrap_or_else(|_| "size".to_string());
+    let mut data = 0u64;
+    let mut bss = 0u64;
+    let mut report = String::new();
+
+    match Command::new(&size).arg(out_dir.join("libbootutil.a")).output() {
+        Ok(out) if out.status.success() => {
+            let text = String::from_utf8_lossy(&out.stdout);
+            let mut lines = text.lines();
+            // Berkeley format: "text data bss dec hex filename".
+            let header: Vec<&str> = lines.next().unwrap_or("").split_whitespace().collect();
+            let data_col = header.iter().position(|&h| h == "data");
+            let bss_col = header.iter().position(|&h| h == "bss");
+            let name_col = header.iter().position(|&h| h == "filename");
+            if let (Some(dc), Some(bc), Some(nc)) = (data_col, bss_col, name_col) {
+                for line in lines {
+                    let fields: Vec<&str> = line.split_whitespace().collect();
+                    if fields.len() <= nc {
+                        continue;
+                    }
+                    let (d, b) = match (fields[dc].parse::<u64>(), fields[bc].parse::<u64>()) {
+                        (Ok(d), Ok(b)) => (d, b),
+                        _ => continue,
+                    };
+                    if SIM_ONLY_OBJECTS.iter().any(|o| fields[nc].ends_with(o)) {
+                        continue;
+                    }
+                    report.push_str(&format!("{:8} {:8} {}\n", d, b, fields[nc]));
+                    data += d;
+                    bss += b;
+                }
+            } else {
+                println!("cargo:warning=Unrecognized output from '{}', RAM usage not measured",
+                         size);
+            }
+        }
+        _ => println!("cargo:warning=Unable to run '{}', RAM usage not measured", size),
+    }
+
+    report.push_str(&format!("{:8} {:8} total\n", data, bss));
+    fs::write(out_dir.join("ram-usage.txt"), report).unwrap();
+    println!("cargo:rustc-env=BOOTSIM_STATIC_DATA={}", data);
+    println!("cargo:rustc-env=BOOTSIM_STATIC_BSS={}", bss);
+    if env::var("MCUBOOT_RAM_REPORT").is_ok() {
+        println!("cargo:warning=Bootloader static RAM: data {} bytes, bss {} bytes", data, bss);
+    }
+}
+
 // Output the names of all files within a directory so that Cargo knows when to rebuild.
 fn walk_dir<P: AsRef<Path>>(path: P) -> io::Result<()> {
     for ent in fs::read_dir(path.as_ref())? {
@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Simulator stand-in for the Mynewt header of the same name, used when
+ * building boot_serial for the serial recovery tests.
+ */
+
+#ifndef H_BASE64_
+#define H_BASE64_
+
+#include <stdint.h>
+
+#define BASE64_ENCODE_SIZE(__size) ((((__size) * 4) / 3) + 4)
+
+int base64_encode(const void *data, int size, char *s, uint8_t should_pad);
+int base64_decode(const char *str, void *data);
+int base64_decode_len(const char *str);
+
+#endif
@@ -0,0 +1,597 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Timing of the crypto primitives, for the benchmarks in the simulator tests.
+ * Times are measured on the host, in nanoseconds.
+ */
+
+/* Needed for clock_gettime(). */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/sign_key.h"
+#include "bootutil/fault_injection_hardening.h"
+#include "bootutil/crypto/sha.h"
+
+#if defined(MCUBOOT_ENC_IMAGES)
+#include "bootutil/enc_key.h"
+#include "bootutil/crypto/aes_ctr.h"
+#endif
+
+#if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
+#include "bootutil/crypto/hmac_sha256.h"
+
+/* The hkdf() of encrypted.c, exported to the simulator. */
+extern int bootutil_sim_hkdf(uint8_t *ikm, uint16_t ikm_len, uint8_t *info,
+                             uint16_t info_len, uint8_t *okm, uint16_t *okm_len);
+#endif
+
+#if (defined(MCUBOOT_SIGN_RSA) || defined(MCUBOOT_SIGN_EC256) || \
+     defined(MCUBOOT_SIGN_EC384) || defined(MCUBOOT_SIGN_ED25519)) && \
+    !defined(MCUBOOT_SIGN_PURE)
+#define SIM_BENCH_VERIFY_SIG
+
+/* From bootutil_priv.h. */
+extern fih_ret bootutil_verify_sig(uint8_t *hash, uint32_t hlen, uint8_t *sig,
+                                   size_t slen, uint8_t key_id);
+#endif
+
+#if defined(MCUBOOT_ED25519_COMB) || defined(MCUBOOT_BATCH_VERIFY)
+#include "bootutil/crypto/ed25519.h"
+
+/* The raw key is at the end of the SubjectPublicKeyInfo. */
+static const uint8_t *sim_bench_ed25519_pubkey(void)
+{
+    return bootutil_keys[0].key + *bootutil_keys[0].len - 32;
+}
+#endif
+
+#if defined(MCUBOOT_SHA_KERNEL)
+#include "bootutil/crypto/sha_kernel.h"
+#endif
+
+#if defined(MCUBOOT_HASH_TREE)
+#include "bootutil/hash_tree.h"
+#endif
+
+#if defined(MCUBOOT_RSA_MONT)
+#define BOOTUTIL_CRYPTO_RSA_SIGN_ENABLED
+#include "bootutil/crypto/rsa.h"
+#include "bootutil/crypto/rsa_mont.h"
+#endif
+
+static uint64_t sim_bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#if defined(MCUBOOT_ED25519_COMB)
+/*
+ * Verify an ED25519 signature of msg with the built-in key, iterations
+ * times, with or without the comb table of the key.  Returns the average
+ * time of a verification, or 0 if the signature did not verify.
+ */
+uint64_t sim_bench_ed25519_verify(const uint8_t *msg, uint32_t len,
+                                  const uint8_t *sig, int use_comb,
+                                  uint32_t iterations)
+{
+    const uint8_t *pubkey;
+    struct ed25519_verify_ctx ctx;
+    uint64_t start;
+    uint32_t i;
+    int ok;
+
+    pubkey = sim_bench_ed25519_pubkey();
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        ok = ED25519_verify_init(&ctx, sig, pubkey);
+        if (ok) {
+            ED25519_verify_update(&ctx, msg, len);
+            if (use_comb) {
+                ok = ED25519_verify_finish_comb(&ctx, bootutil_ed25519_combs[0]);
+            } else {
+                ok = ED25519_verify_finish(&ctx);
+            }
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+
+    return (sim_bench_now_ns() - start) / iterations;
+}
+#endif
+
+#if defined(MCUBOOT_BATCH_VERIFY)
+#define SIM_BENCH_BATCH_MAX 8
+
+extern int ED25519_verify(const uint8_t *message, size_t message_len,
+                          const uint8_t signature[64],
+                          const uint8_t public_key[32]);
+
+/*
+ * Verify the num ED25519 signatures in sigs (64 bytes each) of the 32 byte
+ * messages in msgs with the built-in key, iterations times, one by one or as
+ * a batch.  Returns the average time to verify all of them, or 0 if they did
+ * not all verify.
+ */
+uint64_t sim_bench_ed25519_verify_batch(const uint8_t *msgs, const uint8_t *sigs,
+                                        uint32_t num, int batch,
+                                        uint32_t iterations)
+{
+    const uint8_t *messages[SIM_BENCH_BATCH_MAX];
+    size_t message_lens[SIM_BENCH_BATCH_MAX];
+    const uint8_t *signatures[SIM_BENCH_BATCH_MAX];
+    const uint8_t *public_keys[SIM_BENCH_BATCH_MAX];
+    uint64_t start;
+    uint32_t i;
+    uint32_t j;
+    int ok = 1;
+
+    if (num == 0 || num > SIM_BENCH_BATCH_MAX) {
+        return 0;
+    }
+
+    for (j = 0; j < num; j++) {
+        messages[j] = msgs + 32 * j;
+        message_lens[j] = 32;
+        signatures[j] = sigs + 64 * j;
+        public_keys[j] = sim_bench_ed25519_pubkey();
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations && ok; i++) {
+        if (batch) {
+            ok = ED25519_verify_batch(messages, message_lens, signatures,
+                                      public_keys, num);
+        } else {
+            for (j = 0; j < num && ok; j++) {
+                ok = ED25519_verify(messages[j], message_lens[j],
+                                    signatures[j], public_keys[j]);
+            }
+        }
+    }
+
+    if (!ok) {
+        return 0;
+    }
+
+    return (sim_bench_now_ns() - start) / iterations;
+}
+#endif
+
+#if defined(MCUBOOT_RSA_MONT)
+/*
+ * Compute em = sig^e mod n with the built-in key, iterations times, with
+ * Mbed TLS from the DER key or with the Montgomery constants of the key.
+ * Returns the average time of a computation, with em set to its result, or
+ * 0 if it failed.
+ */
+uint64_t sim_bench_rsa_public(const uint8_t *sig, uint32_t slen, int use_mont,
+                              uint32_t iterations, uint8_t *em)
+{
+    bootutil_rsa_context ctx;
+    const struct bootutil_rsa_mont *mont;
+    uint8_t *cp;
+    uint64_t start;
+    uint32_t i;
+    int rc = 0;
+
+    if (slen != MCUBOOT_SIGN_RSA_LEN / 8) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations && rc == 0; i++) {
+        if (use_mont) {
+            mont = bootutil_rsa_mont_find(0);
+            rc = mont == NULL ? -1 : bootutil_rsa_mont_public(mont, sig, em);
+        } else {
+            bootutil_rsa_init(&ctx);
+            cp = (uint8_t *)bootutil_keys[0].key;
+            rc = bootutil_rsa_parse_public_key(&ctx, &cp,
+                                               cp + *bootutil_keys[0].len);
+            if (rc == 0) {
+                rc = bootutil_rsa_public(&ctx, sig, em);
+            }
+            bootutil_rsa_drop(&ctx);
+        }
+    }
+
+    if (rc != 0) {
+        return 0;
+    }
+
+    return (sim_bench_now_ns() - start) / iterations;
+}
+#endif
+
+#if defined(MCUBOOT_SHA_KERNEL)
+/* Name of the SHA kernel index, or NULL if there is none. */
+const char *sim_sha_kernel_name(int kernel)
+{
+    if (kernel < 0 || kernel >= bootutil_sha_kernel_cnt) {
+        return NULL;
+    }
+
+    return bootutil_sha_kernels[kernel]->name;
+}
+
+/*
+ * Hash len bytes of data with SHA-256, SHA-384 or SHA-512 (bits) and the SHA
+ * kernel index, in updates of chunk bytes, iterations times.  Returns the
+ * average time of a hash, with digest set to its result, or 0 if the CPU
+ * cannot run the kernel.  The kernel picked by default is used again after.
+ */
+uint64_t sim_bench_sha(int kernel, uint32_t bits, const uint8_t *data,
+                       uint32_t len, uint32_t chunk, uint32_t iterations,
+                       uint8_t *digest)
+{
+    struct bootutil_sha256_ctx ctx256;
+    struct bootutil_sha512_ctx ctx512;
+    uint64_t start;
+    uint64_t ns;
+    uint32_t i;
+    uint32_t off;
+    uint32_t n;
+
+    if ((bits != 256 && bits != 384 && bits != 512) || chunk == 0 ||
+        iterations == 0 || kernel < 0 ||
+        bootutil_sha_kernel_select(kernel) != 0) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        if (bits == 256) {
+            bootutil_sha256_init(&ctx256);
+        } else if (bits == 384) {
+            bootutil_sha384_init(&ctx512);
+        } else {
+            bootutil_sha512_init(&ctx512);
+        }
+        for (off = 0; off < len; off += n) {
+            n = len - off < chunk ? len - off : chunk;
+            if (bits == 256) {
+                bootutil_sha256_update(&ctx256, data + off, n);
+            } else {
+                bootutil_sha512_update(&ctx512, data + off, n);
+            }
+        }
+        if (bits == 256) {
+            bootutil_sha256_finish(&ctx256, digest);
+        } else {
+            bootutil_sha512_finish(&ctx512, digest);
+        }
+    }
+    ns = (sim_bench_now_ns() - start) / iterations;
+
+    bootutil_sha_kernel_select(-1);
+
+    return ns == 0 ? 1 : ns;
+}
+#endif
+
+#if defined(MCUBOOT_HASH_TREE)
+/*
+ * Compute the tree hash of len bytes of data with leaves of leaf_size bytes,
+ * iterations times, as the bootloader does: the digest of each leaf, then
+ * the root from those digests.  Returns the average time of a hash in
+ * nanoseconds, with root set to its result, or 0 if it failed.
+ */
+uint64_t sim_bench_hash_tree(const uint8_t *data, uint32_t len,
+                             uint32_t leaf_size, uint32_t iterations,
+                             uint8_t *root)
+{
+    struct bootutil_hash_tree tree;
+    uint8_t digest[IMAGE_HASH_SIZE];
+    uint64_t start;
+    uint64_t ns;
+    uint32_t i;
+    uint32_t off;
+    uint32_t n;
+    int rc = 0;
+
+    if (iterations == 0) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations && rc == 0; i++) {
+        rc = bootutil_hash_tree_init(&tree, leaf_size);
+        for (off = 0; off < len && rc == 0; off += n) {
+            n = len - off < leaf_size ? len - off : leaf_size;
+            bootutil_hash_tree_leaf(data + off, n, digest);
+            rc = bootutil_hash_tree_add_leaf(&tree, digest);
+        }
+        if (rc == 0) {
+            rc = bootutil_hash_tree_finish(&tree, root);
+        }
+    }
+
+    if (rc != 0) {
+        return 0;
+    }
+
+    ns = (sim_bench_now_ns() - start) / iterations;
+
+    return ns == 0 ? 1 : ns;
+}
+#endif
+
+/*
+ * The benchmarks below are built for every configuration.  The ones of a
+ * primitive the configuration does not have return 0.
+ */
+
+/* Crypto library bootutil is built with. */
+const char *sim_bench_backend(void)
+{
+#if defined(MCUBOOT_USE_PSA_CRYPTO)
+    return "psa";
+#elif defined(MCUBOOT_USE_MBED_TLS)
+    return "mbedtls";
+#elif defined(MCUBOOT_USE_TINYCRYPT)
+    return "tinycrypt";
+#else
+    return "none";
+#endif
+}
+
+/*
+ * Hash len bytes of data with bootutil_sha_*, iterations times.  Returns the
+ * average time of a hash, with digest set to its result (IMAGE_HASH_SIZE
+ * bytes).
+ */
+uint64_t sim_bench_bootutil_sha(const uint8_t *data, uint32_t len,
+                                uint32_t iterations, uint8_t *digest)
+{
+    bootutil_sha_context ctx;
+    uint64_t start;
+    uint64_t ns;
+    uint32_t i;
+
+    if (iterations == 0) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        bootutil_sha_init(&ctx);
+        bootutil_sha_update(&ctx, data, len);
+        bootutil_sha_finish(&ctx, digest);
+        bootutil_sha_drop(&ctx);
+    }
+    ns = (sim_bench_now_ns() - start) / iterations;
+
+    return ns == 0 ? 1 : ns;
+}
+
+/*
+ * Encrypt len bytes of data with AES-CTR from a zero counter and the
+ * BOOT_ENC_KEY_SIZE byte key, iterations times, setting the key each time.
+ * Returns the average time of an encryption, with out set to its result, or
+ * 0 if it failed.
+ */
+uint64_t sim_bench_aes_ctr(const uint8_t *key, uint32_t klen,
+                           const uint8_t *data, uint32_t len,
+                           uint32_t iterations, uint8_t *out)
+{
+#if defined(MCUBOOT_ENC_IMAGES)
+    bootutil_aes_ctr_context ctx;
+    uint8_t counter[BOOT_ENC_BLOCK_SIZE];
+    uint64_t start;
+    uint64_t ns;
+    uint32_t i;
+    int rc = 0;
+
+    if (klen != BOOT_ENC_KEY_SIZE || iterations == 0) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations && rc == 0; i++) {
+        memset(counter, 0, sizeof(counter));
+        bootutil_aes_ctr_init(&ctx);
+        rc = bootutil_aes_ctr_set_key(&ctx, key);
+        if (rc == 0) {
+            rc = bootutil_aes_ctr_encrypt(&ctx, counter, data, len, 0, out);
+        }
+        bootutil_aes_ctr_drop(&ctx);
+    }
+
+    if (rc != 0) {
+        return 0;
+    }
+
+    ns = (sim_bench_now_ns() - start) / iterations;
+
+    return ns == 0 ? 1 : ns;
+#else
+    (void)key;
+    (void)klen;
+    (void)data;
+    (void)len;
+    (void)iterations;
+    (void)out;
+    return 0;
+#endif
+}
+
+/*
+ * Verify the signature of the image hash with bootutil_verify_sig() and the
+ * first built-in key, iterations times.  Returns the average time of a
+ * verification, or 0 if the signature did not verify.
+ */
+uint64_t sim_bench_verify_sig(const uint8_t *hash, uint32_t hlen,
+                              const uint8_t *sig, uint32_t slen,
+                              uint32_t iterations)
+{
+#if defined(SIM_BENCH_VERIFY_SIG)
+    FIH_DECLARE(fih_rc, FIH_FAILURE);
+    uint8_t hash_buf[64];
+    uint8_t sig_buf[512];
+    uint64_t start;
+    uint32_t i;
+
+    if (hlen > sizeof(hash_buf) || slen > sizeof(sig_buf) || iterations == 0) {
+        return 0;
+    }
+    memcpy(hash_buf, hash, hlen);
+    memcpy(sig_buf, sig, slen);
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        FIH_CALL(bootutil_verify_sig, fih_rc, hash_buf, hlen, sig_buf, slen, 0);
+        if (FIH_NOT_EQ(fih_rc, FIH_SUCCESS)) {
+            return 0;
+        }
+    }
+
+    return (sim_bench_now_ns() - start) / iterations;
+#else
+    (void)hash;
+    (void)hlen;
+    (void)sig;
+    (void)slen;
+    (void)iterations;
+    return 0;
+#endif
+}
+
+/*
+ * Unwrap the key of the encryption TLV with boot_decrypt_key() and the
+ * built-in private key, iterations times.  Returns the average time of an
+ * unwrap, with key set to its result (BOOT_ENC_KEY_SIZE bytes), or 0 if it
+ * failed.
+ */
+uint64_t sim_bench_enc_unwrap(const uint8_t *tlv, uint32_t len,
+                              uint32_t iterations, uint8_t *key)
+{
+#if defined(MCUBOOT_ENC_IMAGES)
+    uint64_t start;
+    uint32_t i;
+
+    if (len != BOOT_ENC_TLV_SIZE || iterations == 0) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        if (boot_decrypt_key(tlv, key) != 0) {
+            return 0;
+        }
+    }
+
+    return (sim_bench_now_ns() - start) / iterations;
+#else
+    (void)tlv;
+    (void)len;
+    (void)iterations;
+    (void)key;
+    return 0;
+#endif
+}
+
+/*
+ * Compute the HMAC-SHA256 of len bytes of data with the klen byte key,
+ * iterations times.  Returns the average time of a MAC, with mac set to its
+ * result (32 bytes), or 0 if it failed.
+ */
+uint64_t sim_bench_hmac_sha256(const uint8_t *key, uint32_t klen,
+                               const uint8_t *data, uint32_t len,
+                               uint32_t iterations, uint8_t *mac)
+{
+#if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
+    bootutil_hmac_sha256_context hmac;
+    uint64_t start;
+    uint64_t ns;
+    uint32_t i;
+    int rc = 0;
+
+    if (iterations == 0) {
+        return 0;
+    }
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations && rc == 0; i++) {
+        bootutil_hmac_sha256_init(&hmac);
+        rc = bootutil_hmac_sha256_set_key(&hmac, key, klen);
+        if (rc == 0) {
+            rc = bootutil_hmac_sha256_update(&hmac, data, len);
+        }
+        if (rc == 0) {
+            rc = bootutil_hmac_sha256_finish(&hmac, mac, 32);
+        }
+        bootutil_hmac_sha256_drop(&hmac);
+    }
+
+    if (rc != 0) {
+        return 0;
+    }
+
+    ns = (sim_bench_now_ns() - start) / iterations;
+
+    return ns == 0 ? 1 : ns;
+#else
+    (void)key;
+    (void)klen;
+    (void)data;
+    (void)len;
+    (void)iterations;
+    (void)mac;
+    return 0;
+#endif
+}
+
+/*
+ * Derive okm_len bytes from the ikm_len bytes of ikm with the HKDF of the
+ * ECIES key unwrap, iterations times.  Returns the average time of a
+ * derivation, with okm set to its result, or 0 if it failed.
+ */
+uint64_t sim_bench_hkdf(const uint8_t *ikm, uint32_t ikm_len, uint32_t okm_len,
+                        uint32_t iterations, uint8_t *okm)
+{
+#if defined(MCUBOOT_ENCRYPT_EC256) || defined(MCUBOOT_ENCRYPT_X25519)
+    uint8_t ikm_buf[64];
+    uint8_t info[] = "MCUBoot_ECIES_v1";
+    uint64_t start;
+    uint64_t ns;
+    uint32_t i;
+    uint16_t len;
+
+    if (ikm_len > sizeof(ikm_buf) || okm_len > UINT16_MAX || iterations == 0) {
+        return 0;
+    }
+    memcpy(ikm_buf, ikm, ikm_len);
+
+    start = sim_bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        len = (uint16_t)okm_len;
+        if (bootutil_sim_hkdf(ikm_buf, (uint16_t)ikm_len, info, sizeof(info) - 1,
+                              okm, &len) != 0) {
+            return 0;
+        }
+    }
+    ns = (sim_bench_now_ns() - start) / iterations;
+
+    return ns == 0 ? 1 : ns;
+#else
+    (void)ikm;
+    (void)ikm_len;
+    (void)okm_len;
+    (void)iterations;
+    (void)okm;
+    return 0;
+#endif
+}
@@ -0,0 +1,13 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Simulator stand-in for the Mynewt header of the same name, used when
+ * building boot_serial for the serial recovery tests.
+ */
+
+#ifndef H_BSP_
+#define H_BSP_
+
+#endif
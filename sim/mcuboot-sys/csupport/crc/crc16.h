@@ -0,0 +1,19 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Simulator stand-in for the Mynewt header of the same name, used when
+ * building boot_serial for the serial recovery tests.
+ */
+
+#ifndef H_CRC16_
+#define H_CRC16_
+
+#include <stdint.h>
+
+#define CRC16_INITIAL_CRC       0
+
+uint16_t crc16_ccitt(uint16_t initial_crc, const void *buf, int len);
+
+#endif
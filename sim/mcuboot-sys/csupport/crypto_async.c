@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Software driver of the asynchronous crypto jobs of
+ * bootutil/crypto/async.h: the jobs run on a worker thread of the host, in
+ * the order they were submitted.  It is shared by all the test threads.
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/crypto/async.h"
+
+static pthread_mutex_t sim_crypto_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Signalled when a job is submitted. */
+static pthread_cond_t sim_crypto_queued = PTHREAD_COND_INITIALIZER;
+/* Signalled when a job is complete. */
+static pthread_cond_t sim_crypto_complete = PTHREAD_COND_INITIALIZER;
+static pthread_once_t sim_crypto_once = PTHREAD_ONCE_INIT;
+static int sim_crypto_started;
+
+static struct bootutil_crypto_job *sim_crypto_head;
+static struct bootutil_crypto_job *sim_crypto_tail;
+
+/* Jobs submitted by the test of this thread. */
+static __thread uint64_t sim_crypto_jobs;
+
+static void *sim_crypto_worker(void *arg)
+{
+    struct bootutil_crypto_job *job;
+    int rc;
+
+    (void)arg;
+
+    pthread_mutex_lock(&sim_crypto_lock);
+    for (;;) {
+        while (sim_crypto_head == NULL) {
+            pthread_cond_wait(&sim_crypto_queued, &sim_crypto_lock);
+        }
+        job = sim_crypto_head;
+        sim_crypto_head = job->next;
+        if (sim_crypto_head == NULL) {
+            sim_crypto_tail = NULL;
+        }
+        pthread_mutex_unlock(&sim_crypto_lock);
+
+        rc = bootutil_crypto_job_run(job);
+
+        pthread_mutex_lock(&sim_crypto_lock);
+        job->rc = rc;
+        job->done = true;
+        pthread_cond_broadcast(&sim_crypto_complete);
+    }
+
+    return NULL;
+}
+
+static void sim_crypto_start(void)
+{
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, sim_crypto_worker, NULL) == 0) {
+        pthread_detach(thread);
+        sim_crypto_started = 1;
+    }
+}
+
+int bootutil_crypto_async_submit(struct bootutil_crypto_job *job)
+{
+    pthread_once(&sim_crypto_once, sim_crypto_start);
+    if (!sim_crypto_started) {
+        return -1;
+    }
+
+    job->next = NULL;
+    job->done = false;
+
+    pthread_mutex_lock(&sim_crypto_lock);
+    if (sim_crypto_tail == NULL) {
+        sim_crypto_head = job;
+    } else {
+        sim_crypto_tail->next = job;
+    }
+    sim_crypto_tail = job;
+    pthread_cond_signal(&sim_crypto_queued);
+    pthread_mutex_unlock(&sim_crypto_lock);
+
+    sim_crypto_jobs++;
+
+    return 0;
+}
+
+bool bootutil_crypto_async_poll(struct bootutil_crypto_job *job)
+{
+    bool done;
+
+    pthread_mutex_lock(&sim_crypto_lock);
+    done = job->done;
+    pthread_mutex_unlock(&sim_crypto_lock);
+
+    return done;
+}
+
+int bootutil_crypto_async_wait(struct bootutil_crypto_job *job)
+{
+    int rc;
+
+    pthread_mutex_lock(&sim_crypto_lock);
+    while (!job->done) {
+        pthread_cond_wait(&sim_crypto_complete, &sim_crypto_lock);
+    }
+    rc = job->rc;
+    pthread_mutex_unlock(&sim_crypto_lock);
+
+    return rc;
+}
+
+/* Number of jobs submitted so far on this thread, for the tests. */
+uint64_t sim_crypto_async_jobs(void)
+{
+    return sim_crypto_jobs;
+}
@@ -0,0 +1,163 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Driver of the asynchronous flash jobs of bootutil/flash_async.h.  The
+ * flash of a test is only reachable from its own thread, and an interrupted
+ * operation unwinds that thread, so the jobs run as soon as they are
+ * submitted, in the order bootutil issues them.  What would run at the same
+ * time is told by a time model instead: an operation keeps its device busy
+ * for a time that depends on its size, the CPU waits for the operations it
+ * runs itself, and for a job only once the job is waited for.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mcuboot_config/mcuboot_config.h"
+#include "bootutil/flash_async.h"
+
+/* Nanoseconds per byte: a SPI NOR flash read over a few MHz of bus, and
+ * written and erased at 10 ms per 4 KiB.
+ */
+#define SIM_FLASH_READ_NS   250
+#define SIM_FLASH_WRITE_NS  2500
+#define SIM_FLASH_ERASE_NS  2500
+
+#define SIM_FLASH_DEVICES   4
+#define SIM_FLASH_JOBS      4
+
+/* Time of the CPU, and sum of the times of all the operations. */
+static __thread uint64_t sim_flash_now;
+static __thread uint64_t sim_flash_serial;
+/* When each device is done with the operations issued so far. */
+static __thread uint64_t sim_flash_busy[SIM_FLASH_DEVICES];
+
+/* Set while a job runs, with the time it will be complete. */
+static __thread bool sim_flash_in_job;
+static __thread uint64_t sim_flash_job_end;
+
+/* The jobs that were not waited for yet. */
+static __thread struct {
+    struct bootutil_flash_job *job;
+    uint64_t end;
+} sim_flash_jobs[SIM_FLASH_JOBS];
+
+void sim_flash_async_op(uint8_t dev, char op, uint32_t len)
+{
+    uint64_t ns;
+    uint64_t start;
+
+    switch (op) {
+    case 'r':
+        ns = (uint64_t)len * SIM_FLASH_READ_NS;
+        break;
+    case 'w':
+        ns = (uint64_t)len * SIM_FLASH_WRITE_NS;
+        break;
+    default:
+        ns = (uint64_t)len * SIM_FLASH_ERASE_NS;
+        break;
+    }
+
+    if (dev >= SIM_FLASH_DEVICES) {
+        dev = SIM_FLASH_DEVICES - 1;
+    }
+
+    start = sim_flash_now;
+    if (start < sim_flash_busy[dev]) {
+        start = sim_flash_busy[dev];
+    }
+    sim_flash_busy[dev] = start + ns;
+    sim_flash_serial += ns;
+
+    if (sim_flash_in_job) {
+        sim_flash_job_end = sim_flash_busy[dev];
+    } else {
+        sim_flash_now = sim_flash_busy[dev];
+    }
+}
+
+/* Forget the jobs of a boot that was interrupted. */
+void sim_flash_async_reset(void)
+{
+    int i;
+
+    sim_flash_in_job = false;
+    for (i = 0; i < SIM_FLASH_JOBS; i++) {
+        sim_flash_jobs[i].job = NULL;
+    }
+}
+
+bool bootutil_flash_async_concurrent(const struct flash_area *fa_job,
+                                     const struct flash_area *fa_read)
+{
+    return flash_area_get_device_id(fa_job) != flash_area_get_device_id(fa_read);
+}
+
+int bootutil_flash_async_submit(struct bootutil_flash_job *job)
+{
+    int i;
+
+    for (i = 0; i < SIM_FLASH_JOBS && sim_flash_jobs[i].job != NULL; i++) {
+    }
+    if (i == SIM_FLASH_JOBS) {
+        return -1;
+    }
+
+    job->next = NULL;
+    job->done = false;
+
+    sim_flash_in_job = true;
+    sim_flash_job_end = sim_flash_now;
+    job->rc = bootutil_flash_job_run(job);
+    sim_flash_in_job = false;
+
+    job->done = true;
+    sim_flash_jobs[i].job = job;
+    sim_flash_jobs[i].end = sim_flash_job_end;
+
+    return 0;
+}
+
+bool bootutil_flash_async_poll(struct bootutil_flash_job *job)
+{
+    return job->done;
+}
+
+int bootutil_flash_async_wait(struct bootutil_flash_job *job)
+{
+    int i;
+
+    for (i = 0; i < SIM_FLASH_JOBS; i++) {
+        if (sim_flash_jobs[i].job == job) {
+            if (sim_flash_now < sim_flash_jobs[i].end) {
+                sim_flash_now = sim_flash_jobs[i].end;
+            }
+            sim_flash_jobs[i].job = NULL;
+        }
+    }
+
+    return job->rc;
+}
+
+/*
+ * Time of the flash operations on this thread so far, for the tests: one
+ * after the other, and with the jobs overlapping.
+ */
+void sim_flash_async_time(uint64_t *serial, uint64_t *elapsed)
+{
+    uint64_t end = sim_flash_now;
+    int i;
+
+    for (i = 0; i < SIM_FLASH_DEVICES; i++) {
+        if (end < sim_flash_busy[i]) {
+            end = sim_flash_busy[i];
+        }
+    }
+
+    *serial = sim_flash_serial;
+    *elapsed = end;
+}
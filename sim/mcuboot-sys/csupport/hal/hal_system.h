@@ -0,0 +1,16 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Simulator stand-in for the Mynewt header of the same name, used when
+ * building boot_serial for the serial recovery tests.
+ */
+
+#ifndef H_HAL_SYSTEM_
+#define H_HAL_SYSTEM_
+
+/* Ends the serial recovery session in the simulator. */
+void hal_system_reset(void) __attribute__((noreturn));
+
+#endif
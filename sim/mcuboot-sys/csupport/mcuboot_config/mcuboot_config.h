@@ -25,4 +25,7 @@
     do {                                \
     } while (0)
 
+/* Serial recovery only handles the standard mcumgr groups. */
+#define MCUBOOT_PERUSER_MGMT_GROUP_ENABLED 0
+
 #endif /* __MCUBOOT_CONFIG_H__ */
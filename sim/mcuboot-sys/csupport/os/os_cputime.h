@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Simulator stand-in for the Mynewt header of the same name, used when
+ * building boot_serial for the serial recovery tests.
+ */
+
+#ifndef H_OS_CPUTIME_
+#define H_OS_CPUTIME_
+
+#include <stdint.h>
+
+/* There is nothing to wait for in the simulator. */
+static inline void os_cputime_delay_usecs(uint32_t usecs)
+{
+    (void)usecs;
+}
+
+#endif
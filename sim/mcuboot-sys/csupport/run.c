@@ -1,5 +1,10 @@
 /* Run the boot image. */
 
+#if defined(MCUBOOT_SIM_STACK_MEASURE)
+/* Needed for the ucontext functions. */
+#define _XOPEN_SOURCE 700
+#endif
+
 #include <assert.h>
 #include <setjmp.h>
 #include <stdio.h>
@@ -8,6 +13,9 @@
 #include <bootutil/bootutil.h>
 #include <bootutil/image.h>
 #include <errno.h>
+#if defined(MCUBOOT_SIM_STACK_MEASURE)
+#include <ucontext.h>
+#endif
 
 #include <flash_map_backend/flash_map_backend.h>
 
@@ -39,19 +47,160 @@ extern struct sim_context *sim_get_context(void);
 extern void sim_set_context(struct sim_context *ctx);
 extern void sim_reset_context(void);
 
-extern int sim_flash_erase(uint8_t flash_id, uint32_t offset, uint32_t size);
-extern int sim_flash_read(uint8_t flash_id, uint32_t offset, uint8_t *dest,
-        uint32_t size);
-extern int sim_flash_write(uint8_t flash_id, uint32_t offset, const uint8_t *src,
+extern int sim_flash_erase(uint8_t flash_id, uint8_t area_id, uint32_t offset,
         uint32_t size);
+extern int sim_flash_read(uint8_t flash_id, uint8_t area_id, uint32_t offset,
+        uint8_t *dest, uint32_t size);
+extern int sim_flash_write(uint8_t flash_id, uint8_t area_id, uint32_t offset,
+        const uint8_t *src, uint32_t size);
 extern uint32_t sim_flash_align(uint8_t flash_id);
 extern uint8_t sim_flash_erased_val(uint8_t flash_id);
 
+#if defined(MCUBOOT_FLASH_ASYNC)
+/* Time model of the flash operations, see flash_async.c. */
+extern void sim_flash_async_op(uint8_t dev, char op, uint32_t len);
+extern void sim_flash_async_reset(void);
+#define SIM_FLASH_ASYNC_OP(area, op, len) \
+        sim_flash_async_op((area)->fa_device_id, (op), (len))
+#else
+#define SIM_FLASH_ASYNC_OP(area, op, len)
+#endif
+
+#if defined(MCUBOOT_SWAP_USING_MOVE) && MCUBOOT_SWAP_MOVE_BATCH_SECTORS > 1
+/* Sectors of image data and swap status entries written to the primary slots
+ * on this thread, for the tests.
+ */
+static __thread uint64_t sim_swap_sectors;
+static __thread uint64_t sim_swap_status_writes;
+
+static void sim_swap_write(const struct flash_area *area, uint32_t off)
+{
+    struct flash_sector sector;
+    uint32_t status_off;
+    int i;
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        if (area->fa_id == FLASH_AREA_IMAGE_PRIMARY(i)) {
+            break;
+        }
+    }
+    if (i == BOOT_IMAGE_NUMBER) {
+        return;
+    }
+
+    status_off = boot_status_off(area);
+    if (off < status_off) {
+        /* The copies write whole sectors, in chunks that start on them. */
+        if (flash_area_get_sector(area, off, &sector) == 0 && sector.fs_off == off) {
+            sim_swap_sectors++;
+        }
+    } else if (off < status_off + boot_status_sz(flash_area_align(area))) {
+        sim_swap_status_writes++;
+    }
+}
+#endif
+
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+/* Reads of the trailers of the image slots, from swap_info up to the magic, on
+ * this thread, for the tests.
+ */
+static __thread uint64_t sim_trailer_read_count;
+
+static void sim_trailer_read(const struct flash_area *area, uint32_t off,
+                             uint32_t len)
+{
+    int i;
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        if (area->fa_id == FLASH_AREA_IMAGE_PRIMARY(i) ||
+            area->fa_id == FLASH_AREA_IMAGE_SECONDARY(i)) {
+            break;
+        }
+    }
+    if (i < BOOT_IMAGE_NUMBER && off + len > boot_swap_info_off(area)) {
+        sim_trailer_read_count++;
+    }
+}
+#endif
+
+/* Writes of the trailer fields from the encryption keys up to swap_info, and
+ * writes of the magic, to the image slots and the scratch area on this thread,
+ * for the tests.
+ */
+static __thread uint64_t sim_trailer_info_writes;
+static __thread uint64_t sim_trailer_magic_writes;
+
+static void sim_trailer_write(const struct flash_area *area, uint32_t off,
+                              uint32_t len)
+{
+    uint32_t info_off;
+    int i;
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        if (area->fa_id == FLASH_AREA_IMAGE_PRIMARY(i) ||
+            area->fa_id == FLASH_AREA_IMAGE_SECONDARY(i)) {
+            break;
+        }
+    }
+#if MCUBOOT_SWAP_USING_SCRATCH
+    if (area->fa_id == FLASH_AREA_IMAGE_SCRATCH) {
+        i = 0;
+    }
+#endif
+    if (i == BOOT_IMAGE_NUMBER) {
+        return;
+    }
+
+    /* swap_size is right before swap_info, copy_done right after it. */
+    info_off = boot_swap_info_off(area);
+    if (off >= boot_status_off(area) && off + len > info_off - BOOT_MAX_ALIGN &&
+        off + len <= info_off + BOOT_MAX_ALIGN) {
+        sim_trailer_info_writes++;
+    } else if (off == area->fa_size - BOOT_MAGIC_ALIGN_SIZE) {
+        sim_trailer_magic_writes++;
+    }
+}
+
+#if defined(MCUBOOT_IMAGE_EXTENT)
+/* Bytes erased or written in the secondary slots on this thread, for the tests. */
+static __thread uint64_t sim_secondary_bytes;
+
+static void sim_secondary_op(const struct flash_area *area, uint32_t len)
+{
+    int i;
+
+    for (i = 0; i < BOOT_IMAGE_NUMBER; i++) {
+        if (area->fa_id == FLASH_AREA_IMAGE_SECONDARY(i)) {
+            sim_secondary_bytes += len;
+            break;
+        }
+    }
+}
+#endif
+
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+/* Bytes erased and written in the scratch area on this thread, for the tests. */
+static __thread uint64_t sim_scratch_erased;
+static __thread uint64_t sim_scratch_written;
+static __thread uint32_t sim_scratch_size;
+
+#define SIM_SCRATCH_OP(area, counter, len)                      \
+    do {                                                        \
+        if ((area)->fa_id == FLASH_AREA_IMAGE_SCRATCH) {        \
+            sim_scratch_size = (area)->fa_size;                 \
+            (counter) += (len);                                 \
+        }                                                       \
+    } while (0)
+#else
+#define SIM_SCRATCH_OP(area, counter, len)
+#endif
+
 struct sim_context {
     int flash_counter;
     int jumped;
     uint8_t c_asserts;
     uint8_t c_catch_asserts;
+    uint32_t stack_used;
     jmp_buf boot_jmpbuf;
 };
 
@@ -245,26 +394,20 @@ struct area_desc {
     uint32_t num_slots;
 };
 
-int invoke_boot_go(struct sim_context *ctx, struct area_desc *adesc,
-                   struct boot_rsp *rsp, int image_id)
+static int sim_boot_go(struct sim_context *ctx, struct area_desc *adesc,
+                       struct boot_loader_state *state, struct boot_rsp *rsp,
+                       int image_id)
 {
     int res;
-    struct boot_loader_state *state;
-
-#if defined(MCUBOOT_SIGN_RSA) || \
-    (defined(MCUBOOT_SIGN_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
-    (defined(MCUBOOT_ENCRYPT_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
-    (defined(MCUBOOT_ENCRYPT_X25519) && defined(MCUBOOT_USE_MBED_TLS))
-    mbedtls_platform_set_calloc_free(calloc, free);
-#endif
-
-    state = malloc(sizeof(struct boot_loader_state));
 
     sim_set_flash_areas(adesc);
     sim_set_context(ctx);
 
     if (setjmp(ctx->boot_jmpbuf) == 0) {
         boot_state_clear(state);
+#if defined(MCUBOOT_FLASH_ASYNC)
+        sim_flash_async_reset();
+#endif
 
 #if BOOT_IMAGE_NUMBER > 1
         if (image_id >= 0) {
@@ -278,17 +421,154 @@ int invoke_boot_go(struct sim_context *ctx, struct area_desc *adesc,
         res = context_boot_go(state, rsp);
         sim_reset_flash_areas();
         sim_reset_context();
-        free(state);
         /* printf("boot_go off: %d (0x%08x)\n", res, rsp->br_image_off); */
         return res;
     } else {
         sim_reset_flash_areas();
         sim_reset_context();
-        free(state);
         return -0x13579;
     }
 }
 
+#if defined(MCUBOOT_SIM_STACK_MEASURE)
+/*
+ * To measure the stack depth of the bootloader, it is run on a stack of its
+ * own that is filled with a known pattern beforehand. Afterwards, the lowest
+ * byte that no longer holds the pattern marks the deepest point reached. This
+ * includes the simulator's flash callbacks, which are shallow.
+ */
+#define SIM_STACK_SIZE      (1024 * 1024)
+#define SIM_STACK_PATTERN   0xa5
+
+struct sim_boot_args {
+    struct sim_context *ctx;
+    struct area_desc *adesc;
+    struct boot_loader_state *state;
+    struct boot_rsp *rsp;
+    int image_id;
+    int res;
+};
+
+/* makecontext() only passes int arguments portably, so hand the arguments
+ * over through a per-thread pointer instead.
+ */
+static __thread struct sim_boot_args *sim_boot_args;
+
+static void sim_boot_go_entry(void)
+{
+    struct sim_boot_args *args = sim_boot_args;
+
+    args->res = sim_boot_go(args->ctx, args->adesc, args->state, args->rsp,
+                            args->image_id);
+}
+
+static int sim_boot_go_measured(struct sim_context *ctx, struct area_desc *adesc,
+                                struct boot_loader_state *state,
+                                struct boot_rsp *rsp, int image_id)
+{
+    struct sim_boot_args args = {
+        .ctx = ctx,
+        .adesc = adesc,
+        .state = state,
+        .rsp = rsp,
+        .image_id = image_id,
+    };
+    ucontext_t caller;
+    ucontext_t boot;
+    uint8_t *stack;
+    size_t i;
+
+    stack = malloc(SIM_STACK_SIZE);
+    memset(stack, SIM_STACK_PATTERN, SIM_STACK_SIZE);
+
+    getcontext(&boot);
+    boot.uc_stack.ss_sp = stack;
+    boot.uc_stack.ss_size = SIM_STACK_SIZE;
+    boot.uc_link = &caller;
+    makecontext(&boot, sim_boot_go_entry, 0);
+
+    sim_boot_args = &args;
+    swapcontext(&caller, &boot);
+    sim_boot_args = NULL;
+
+    for (i = 0; i < SIM_STACK_SIZE && stack[i] == SIM_STACK_PATTERN; i++) {
+    }
+    if (i == 0) {
+        printf("Boot stack of %d bytes overflowed\n", SIM_STACK_SIZE);
+        abort();
+    }
+    ctx->stack_used = SIM_STACK_SIZE - i;
+
+    free(stack);
+    return args.res;
+}
+#endif /* MCUBOOT_SIM_STACK_MEASURE */
+
+int invoke_boot_go(struct sim_context *ctx, struct area_desc *adesc,
+                   struct boot_rsp *rsp, int image_id)
+{
+    int res;
+    struct boot_loader_state *state;
+
+#if defined(MCUBOOT_SIGN_RSA) || \
+    (defined(MCUBOOT_SIGN_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
+    (defined(MCUBOOT_ENCRYPT_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
+    (defined(MCUBOOT_ENCRYPT_X25519) && defined(MCUBOOT_USE_MBED_TLS))
+    mbedtls_platform_set_calloc_free(calloc, free);
+#endif
+
+    state = malloc(sizeof(struct boot_loader_state));
+
+#if defined(MCUBOOT_SIM_STACK_MEASURE)
+    res = sim_boot_go_measured(ctx, adesc, state, rsp, image_id);
+#else
+    res = sim_boot_go(ctx, adesc, state, rsp, image_id);
+#endif
+
+    free(state);
+    return res;
+}
+
+#if defined(MCUBOOT_SIM_SERIAL)
+#include "boot_serial/boot_serial.h"
+
+extern const struct boot_uart_funcs *sim_serial_uart(int fd);
+
+/* A reset request ends the serial recovery session. */
+void hal_system_reset(void)
+{
+    longjmp(sim_get_context()->boot_jmpbuf, 1);
+}
+
+/*
+ * Run serial recovery with its console on the given file descriptor, until
+ * the uploader requests a reset or goes away. Returns -0x13579 if the session
+ * was stopped by the flash simulation instead.
+ */
+int invoke_boot_serial(struct sim_context *ctx, struct area_desc *adesc, int fd)
+{
+    int jumped = ctx->jumped;
+
+#if defined(MCUBOOT_SIGN_RSA) || \
+    (defined(MCUBOOT_SIGN_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
+    (defined(MCUBOOT_ENCRYPT_EC256) && defined(MCUBOOT_USE_MBED_TLS)) ||\
+    (defined(MCUBOOT_ENCRYPT_X25519) && defined(MCUBOOT_USE_MBED_TLS))
+    mbedtls_platform_set_calloc_free(calloc, free);
+#endif
+
+    sim_set_flash_areas(adesc);
+    sim_set_context(ctx);
+
+    if (setjmp(ctx->boot_jmpbuf) == 0) {
+        boot_serial_start(sim_serial_uart(fd));
+    }
+
+    sim_reset_flash_areas();
+    sim_reset_context();
+    return ctx->jumped != jumped ? -0x13579 : 0;
+}
+#endif /* MCUBOOT_SIM_SERIAL */
+
 void *os_malloc(size_t size)
 {
     // printf("os_malloc 0x%x bytes\n", size);
@@ -340,7 +620,12 @@ int flash_area_read(const struct flash_area *area, uint32_t off, void *dst,
 {
     BOOT_LOG_SIM("%s: area=%d, off=%x, len=%x",
                  __func__, area->fa_id, off, len);
-    return sim_flash_read(area->fa_device_id, area->fa_off + off, dst, len);
+    SIM_FLASH_ASYNC_OP(area, 'r', len);
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+    sim_trailer_read(area, off, len);
+#endif
+    return sim_flash_read(area->fa_device_id, area->fa_id, area->fa_off + off,
+                          dst, len);
 }
 
 int flash_area_write(const struct flash_area *area, uint32_t off, const void *src,
@@ -353,7 +638,17 @@ int flash_area_write(const struct flash_area *area, uint32_t off, const void *sr
         ctx->jumped++;
         longjmp(ctx->boot_jmpbuf, 1);
     }
-    return sim_flash_write(area->fa_device_id, area->fa_off + off, src, len);
+    SIM_FLASH_ASYNC_OP(area, 'w', len);
+    SIM_SCRATCH_OP(area, sim_scratch_written, len);
+#if defined(MCUBOOT_SWAP_USING_MOVE) && MCUBOOT_SWAP_MOVE_BATCH_SECTORS > 1
+    sim_swap_write(area, off);
+#endif
+    sim_trailer_write(area, off, len);
+#if defined(MCUBOOT_IMAGE_EXTENT)
+    sim_secondary_op(area, len);
+#endif
+    return sim_flash_write(area->fa_device_id, area->fa_id, area->fa_off + off,
+                           src, len);
 }
 
 int flash_area_erase(const struct flash_area *area, uint32_t off, uint32_t len)
@@ -365,8 +660,76 @@ int flash_area_erase(const struct flash_area *area, uint32_t off, uint32_t len)
         ctx->jumped++;
         longjmp(ctx->boot_jmpbuf, 1);
     }
-    return sim_flash_erase(area->fa_device_id, area->fa_off + off, len);
+    SIM_FLASH_ASYNC_OP(area, 'e', len);
+    SIM_SCRATCH_OP(area, sim_scratch_erased, len);
+#if defined(MCUBOOT_IMAGE_EXTENT)
+    sim_secondary_op(area, len);
+#endif
+    return sim_flash_erase(area->fa_device_id, area->fa_id, area->fa_off + off,
+                           len);
+}
+
+#if defined(MCUBOOT_FLASH_ERASE_RANGE)
+/* The 32 KiB and 64 KiB block erases of NOR flash. */
+#define SIM_FLASH_ERASE_BLOCKS ((1u << 15) | (1u << 16))
+
+/* Erases of whole blocks on this thread, for the tests. */
+static __thread uint64_t sim_flash_erase_range_count;
+
+uint32_t flash_area_erase_blocks(const struct flash_area *area)
+{
+    (void)area;
+    return SIM_FLASH_ERASE_BLOCKS;
+}
+
+int flash_area_erase_range(const struct flash_area *area, uint32_t off, uint32_t len)
+{
+    sim_flash_erase_range_count++;
+    return flash_area_erase(area, off, len);
+}
+
+uint64_t sim_flash_erase_ranges(void)
+{
+    return sim_flash_erase_range_count;
+}
+#endif
+
+#if defined(MCUBOOT_SLOT_SNAPSHOT)
+uint64_t sim_trailer_reads(void)
+{
+    return sim_trailer_read_count;
+}
+#endif
+
+#if defined(MCUBOOT_SWAP_USING_MOVE) && MCUBOOT_SWAP_MOVE_BATCH_SECTORS > 1
+void sim_swap_writes(uint64_t *sectors, uint64_t *status_writes)
+{
+    *sectors = sim_swap_sectors;
+    *status_writes = sim_swap_status_writes;
+}
+#endif
+
+void sim_trailer_writes(uint64_t *info_writes, uint64_t *magic_writes)
+{
+    *info_writes = sim_trailer_info_writes;
+    *magic_writes = sim_trailer_magic_writes;
+}
+
+#if defined(MCUBOOT_IMAGE_EXTENT)
+uint64_t sim_secondary_scrambled(void)
+{
+    return sim_secondary_bytes;
 }
+#endif
+
+#if defined(MCUBOOT_SCRATCH_WEAR_LEVELING)
+void sim_scratch_wear(uint64_t *erased, uint64_t *written, uint32_t *size)
+{
+    *erased = sim_scratch_erased;
+    *written = sim_scratch_written;
+    *size = sim_scratch_size;
+}
+#endif
 
 int flash_area_to_sectors(int idx, int *cnt, struct flash_area *ret)
 {
@@ -0,0 +1,249 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Support for running boot_serial in the simulator.  The console is one end
+ * of a pseudo-terminal, driven by the uploader in the Rust test code, and the
+ * CRC and base64 helpers that Mynewt would provide are implemented here.
+ */
+
+/* Needed for poll(). */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <base64/base64.h>
+#include <crc/crc16.h>
+#include <hal/hal_system.h>
+#include <zcbor_common.h>
+
+#include "boot_serial/boot_serial.h"
+#include "../../../boot/boot_serial/src/boot_serial_priv.h"
+
+/* How long to wait for the uploader before giving up on the session. */
+#define SIM_SERIAL_TIMEOUT_MS   30000
+
+static int sim_serial_fd = -1;
+
+/* Bytes received after the end of the line last returned by sim_uart_read. */
+static char sim_serial_pending[256];
+static int sim_serial_pending_len;
+
+/*
+ * Return the next line of input, without its newline and terminated with a
+ * NUL, as expected by boot_serial_in_dec().  The session ends (as if the
+ * target was reset) when the uploader goes away.
+ */
+static int sim_uart_read(char *str, int cnt, int *newline)
+{
+    struct pollfd pfd;
+    int len = 0;
+    int rc;
+    int i;
+
+    *newline = 0;
+    while (len < cnt - 1) {
+        if (sim_serial_pending_len == 0) {
+            pfd.fd = sim_serial_fd;
+            pfd.events = POLLIN;
+            rc = poll(&pfd, 1, SIM_SERIAL_TIMEOUT_MS);
+            if (rc <= 0) {
+                hal_system_reset();
+            }
+            rc = read(sim_serial_fd, sim_serial_pending,
+                      sizeof(sim_serial_pending));
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            if (rc <= 0) {
+                hal_system_reset();
+            }
+            sim_serial_pending_len = rc;
+        }
+
+        for (i = 0; i < sim_serial_pending_len && len < cnt - 1; i++) {
+            if (sim_serial_pending[i] == '\n') {
+                *newline = 1;
+                i++;
+                break;
+            }
+            str[len++] = sim_serial_pending[i];
+        }
+        memmove(sim_serial_pending, &sim_serial_pending[i],
+                sim_serial_pending_len - i);
+        sim_serial_pending_len -= i;
+
+        if (*newline) {
+            break;
+        }
+    }
+
+    str[len] = '\0';
+    return len;
+}
+
+static void sim_uart_write(const char *ptr, int cnt)
+{
+    int rc;
+
+    while (cnt > 0) {
+        rc = write(sim_serial_fd, ptr, cnt);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return;
+        }
+        ptr += rc;
+        cnt -= rc;
+    }
+}
+
+static const struct boot_uart_funcs sim_uart_funcs = {
+    .read = sim_uart_read,
+    .write = sim_uart_write,
+};
+
+const struct boot_uart_funcs *sim_serial_uart(int fd)
+{
+    sim_serial_fd = fd;
+    sim_serial_pending_len = 0;
+    return &sim_uart_funcs;
+}
+
+int bs_peruser_system_specific(const struct nmgr_hdr *hdr, const char *buffer,
+                               int len, zcbor_state_t *cs)
+{
+    (void)hdr;
+    (void)buffer;
+    (void)len;
+    (void)cs;
+    return MGMT_ERR_ENOTSUP;
+}
+
+uint16_t crc16_ccitt(uint16_t initial_crc, const void *buf, int len)
+{
+    const uint8_t *ptr = buf;
+    uint16_t crc = initial_crc;
+    int i;
+
+    while (len-- > 0) {
+        crc ^= (uint16_t)*ptr++ << 8;
+        for (i = 0; i < 8; i++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ 0x1021;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+static const char base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int base64_encode(const void *data, int size, char *s, uint8_t should_pad)
+{
+    const uint8_t *p = data;
+    char *out = s;
+    uint32_t val;
+    int i;
+
+    for (i = 0; i < size; i += 3) {
+        val = (uint32_t)p[i] << 16;
+        if (i + 1 < size) {
+            val |= (uint32_t)p[i + 1] << 8;
+        }
+        if (i + 2 < size) {
+            val |= p[i + 2];
+        }
+        *out++ = base64_chars[(val >> 18) & 0x3f];
+        *out++ = base64_chars[(val >> 12) & 0x3f];
+        if (i + 1 < size) {
+            *out++ = base64_chars[(val >> 6) & 0x3f];
+        } else if (should_pad) {
+            *out++ = '=';
+        }
+        if (i + 2 < size) {
+            *out++ = base64_chars[val & 0x3f];
+        } else if (should_pad) {
+            *out++ = '=';
+        }
+    }
+    *out = '\0';
+
+    return out - s;
+}
+
+static int base64_value(char c)
+{
+    const char *pos;
+
+    if (c == '\0') {
+        return -1;
+    }
+    pos = strchr(base64_chars, c);
+    return pos ? (int)(pos - base64_chars) : -1;
+}
+
+int base64_decode(const char *str, void *data)
+{
+    uint8_t *out = data;
+    uint32_t val;
+    int nchars;
+    int v;
+
+    while (*str != '\0') {
+        val = 0;
+        for (nchars = 0; nchars < 4; nchars++) {
+            v = base64_value(str[nchars]);
+            if (v < 0) {
+                break;
+            }
+            val = (val << 6) | v;
+        }
+        if (nchars < 2) {
+            return -1;
+        }
+        val <<= 6 * (4 - nchars);
+        *out++ = val >> 16;
+        if (nchars > 2) {
+            *out++ = val >> 8;
+        }
+        if (nchars > 3) {
+            *out++ = val;
+        }
+        if (nchars < 4) {
+            /* Only padding may follow a short group. */
+            str += nchars;
+            while (*str == '=') {
+                str++;
+            }
+            if (*str != '\0') {
+                return -1;
+            }
+            break;
+        }
+        str += 4;
+    }
+
+    return out - (uint8_t *)data;
+}
+
+int base64_decode_len(const char *str)
+{
+    int len = strlen(str);
+
+    while (len > 0 && str[len - 1] == '=') {
+        len--;
+    }
+    return (len * 3) / 4;
+}
@@ -153,6 +153,18 @@ int flash_area_sector_from_off(uint32_t off, struct flash_sector *sector);
 int flash_area_get_sector(const struct flash_area *fa, uint32_t off,
   struct flash_sector *sector);
 
+/*
+ * Erase block sizes of the device, besides its sectors, as a mask of powers
+ * of two (MCUBOOT_FLASH_ERASE_RANGE).
+ */
+uint32_t flash_area_erase_blocks(const struct flash_area *fa);
+
+/*
+ * Erase len bytes at off with one of the erase blocks of the device.
+ */
+int flash_area_erase_range(const struct flash_area *fa, uint32_t off,
+  uint32_t len);
+
 /*
  * Similar to flash_area_get_sectors(), but return the values in an
  * array of struct flash_area instead.
@@ -8,7 +8,10 @@
 
 use crate::area::CAreaDesc;
 use log::{Level, log_enabled, warn};
-use simflash::{Result, Flash, FlashPtr};
+use simflash::{
+    Result, Flash, FlashPtr, SimMultiFlash,
+    trace::{self, Trace, TraceOp, TraceRecord},
+};
 use std::{
     cell::RefCell,
     collections::HashMap,
@@ -96,6 +99,8 @@ pub struct CSimContext {
     pub jumped: libc::c_int,
     pub c_asserts: u8,
     pub c_catch_asserts: u8,
+    /// Deepest stack use of the last invocation, in bytes, when measured.
+    pub stack_used: u32,
     // NOTE: Always leave boot_jmpbuf declaration at the end; this should
     // store a "jmp_buf" which is arch specific and not defined by libc crate.
     // The size below is enough to store data on a x86_64 machine.
@@ -109,6 +114,7 @@ impl Default for CSimContext {
             jumped: 0,
             c_asserts: 0,
             c_catch_asserts: 0,
+            stack_used: 0,
             boot_jmpbuf: [0; 48],
         }
     }
@@ -165,11 +171,23 @@ impl NvCounterStorage {
     }
 }
 
+/// Per thread state for recording traces of the flash operations performed by the C code.  When
+/// enabled, each call to boot_go produces one trace.
+#[derive(Default)]
+pub struct TraceContext {
+    enabled: bool,
+    current: Option<Trace>,
+    done: Vec<Trace>,
+    image: u8,
+    phase: u8,
+}
+
 thread_local! {
     pub static THREAD_CTX: RefCell<FlashContext> = RefCell::new(FlashContext::new());
     pub static SIM_CTX: RefCell<CSimContextPtr> = RefCell::new(CSimContextPtr::new());
     pub static RAM_CTX: RefCell<BootsimRamInfo> = RefCell::new(BootsimRamInfo::default());
     pub static NV_COUNTER_CTX: RefCell<NvCounterStorage> = RefCell::new(NvCounterStorage::new());
+    pub static TRACE_CTX: RefCell<TraceContext> = RefCell::new(TraceContext::default());
 }
 
 /// Set the flash device to be used by the simulation.  The pointer is unsafely stashed away.
@@ -268,8 +286,82 @@ pub fn clear_ram_info() {
     });
 }
 
+/// Enable or disable recording of flash operation traces on this thread.  Disabling discards any
+/// traces that have not been collected.
+pub fn trace_enable(enable: bool) {
+    TRACE_CTX.with(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        ctx.enabled = enable;
+        if !enable {
+            ctx.current = None;
+            ctx.done.clear();
+        }
+    });
+}
+
+/// Start a new trace, if tracing is enabled, snapshotting the flash as the bootloader will see it.
+pub fn trace_begin(flash: &SimMultiFlash) {
+    TRACE_CTX.with(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        if ctx.enabled {
+            ctx.current = Some(Trace::new(flash));
+            ctx.image = 0;
+            ctx.phase = 0;
+        }
+    });
+}
+
+/// Finish the current trace, if any.
+pub fn trace_end() {
+    TRACE_CTX.with(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        if let Some(trace) = ctx.current.take() {
+            ctx.done.push(trace);
+        }
+    });
+}
+
+/// Return the traces finished since the last call.
+pub fn take_traces() -> Vec<Trace> {
+    TRACE_CTX.with(|ctx| {
+        ctx.borrow_mut().done.drain(..).collect()
+    })
+}
+
+fn trace_record(op: TraceOp, dev_id: u8, area_id: u8, offset: u32, len: u32, data: &[u8],
+                rc: libc::c_int) {
+    TRACE_CTX.with(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        let (image, phase) = (ctx.image, ctx.phase);
+        if let Some(cur) = ctx.current.as_mut() {
+            cur.push(TraceRecord {
+                op,
+                failed: rc != 0,
+                dev_id,
+                area_id,
+                image,
+                phase,
+                offset,
+                len,
+                digest: if op == TraceOp::Erase { 0 } else { trace::digest(data) },
+                data: if op == TraceOp::Write { data.to_vec() } else { Vec::new() },
+            });
+        }
+    });
+}
+
+/// Called by the loader (through BOOT_SET_PHASE) to tag subsequent flash operations.
+#[no_mangle]
+pub extern "C" fn sim_set_boot_phase(image: u8, phase: u8) {
+    TRACE_CTX.with(|ctx| {
+        let mut ctx = ctx.borrow_mut();
+        ctx.image = image;
+        ctx.phase = phase;
+    });
+}
+
 #[no_mangle]
-pub extern "C" fn sim_flash_erase(dev_id: u8, offset: u32, size: u32) -> libc::c_int {
+pub extern "C" fn sim_flash_erase(dev_id: u8, area_id: u8, offset: u32, size: u32) -> libc::c_int {
     let mut rc: libc::c_int = -19;
     THREAD_CTX.with(|ctx| {
         if let Some(flash) = ctx.borrow().flash_map.get(&dev_id) {
@@ -277,32 +369,37 @@ pub extern "C" fn sim_flash_erase(dev_id: u8, offset: u32, size: u32) -> libc::c
             rc = map_err(dev.erase(offset as usize, size as usize));
         }
     });
+    trace_record(TraceOp::Erase, dev_id, area_id, offset, size, &[], rc);
     rc
 }
 
 #[no_mangle]
-pub extern "C" fn sim_flash_read(dev_id: u8, offset: u32, dest: *mut u8, size: u32) -> libc::c_int {
+pub extern "C" fn sim_flash_read(dev_id: u8, area_id: u8, offset: u32, dest: *mut u8,
+                                 size: u32) -> libc::c_int {
     let mut rc: libc::c_int = -19;
+    let mut buf: &mut[u8] = unsafe { slice::from_raw_parts_mut(dest, size as usize) };
     THREAD_CTX.with(|ctx| {
         if let Some(flash) = ctx.borrow().flash_map.get(&dev_id) {
-            let mut buf: &mut[u8] = unsafe { slice::from_raw_parts_mut(dest, size as usize) };
             let dev = unsafe { &mut *(flash.ptr) };
             rc = map_err(dev.read(offset as usize, &mut buf));
         }
     });
+    trace_record(TraceOp::Read, dev_id, area_id, offset, size, buf, rc);
     rc
 }
 
 #[no_mangle]
-pub extern "C" fn sim_flash_write(dev_id: u8, offset: u32, src: *const u8, size: u32) -> libc::c_int {
+pub extern "C" fn sim_flash_write(dev_id: u8, area_id: u8, offset: u32, src: *const u8,
+                                  size: u32) -> libc::c_int {
     let mut rc: libc::c_int = -19;
+    let buf: &[u8] = unsafe { slice::from_raw_parts(src, size as usize) };
     THREAD_CTX.with(|ctx| {
         if let Some(flash) = ctx.borrow().flash_map.get(&dev_id) {
-            let buf: &[u8] = unsafe { slice::from_raw_parts(src, size as usize) };
             let dev = unsafe { &mut *(flash.ptr) };
             rc = map_err(dev.write(offset as usize, &buf));
         }
     });
+    trace_record(TraceOp::Write, dev_id, area_id, offset, size, buf, rc);
     rc
 }
 
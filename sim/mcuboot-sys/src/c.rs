@@ -7,13 +7,19 @@
 //! Interface wrappers to C API entering to the bootloader
 
 use crate::area::AreaDesc;
-use simflash::SimMultiFlash;
+use simflash::{SimMultiFlash, trace::Trace};
 use crate::api;
 
 #[allow(unused)]
 use std::sync::Once;
 
 use std::borrow::Borrow;
+use std::cell::Cell;
+
+thread_local! {
+    /// Deepest stack use of any `boot_go` call on this thread, see `take_stack_peak`.
+    static STACK_PEAK: Cell<usize> = Cell::new(0);
+}
 
 /// The result of an invocation of `boot_go`.  This is intentionally opaque so that we can provide
 /// accessors for everything we need from this.
@@ -84,6 +90,7 @@ pub fn boot_go(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
         c_catch_asserts: if catch_asserts { 1 } else { 0 },
         .. Default::default()
     };
+    api::trace_begin(multiflash);
     let mut rsp = api::BootRsp {
         br_hdr: std::ptr::null(),
         flash_dev_id: 0,
@@ -101,6 +108,8 @@ pub fn boot_go(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
                                            i as i32) as i32
         }
     };
+    api::trace_end();
+    STACK_PEAK.with(|peak| peak.set(peak.get().max(sim_ctx.stack_used as usize)));
     let asserts = sim_ctx.c_asserts;
     if let Some(c) = counter {
         *c = sim_ctx.flash_counter;
@@ -115,6 +124,87 @@ pub fn boot_go(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
     }
 }
 
+/// The result of a serial recovery session.
+#[derive(Debug)]
+pub struct SerialResult {
+    /// The session was stopped by the flash simulation mechanism, rather than ending with a reset
+    /// request (or the uploader going away).
+    pub interrupted: bool,
+    /// The number of flash writes and erases performed.
+    pub flash_ops: i32,
+}
+
+/// Run serial recovery on this flash device, with its console on the given file descriptor (one
+/// end of a pseudo-terminal).  Returns once the uploader requests a reset, closes its end, or the
+/// flash counter runs out.
+#[cfg(feature = "serial-recovery")]
+pub fn boot_serial(multiflash: &mut SimMultiFlash, areadesc: &AreaDesc,
+                   counter: Option<&mut i32>, fd: std::os::unix::io::RawFd) -> SerialResult {
+    // boot_serial keeps its buffers in globals, so only one session can run at a time.
+    static SERIAL_LOCK: std::sync::Mutex<()> = std::sync::Mutex::new(());
+    let _lock = SERIAL_LOCK.lock().unwrap_or_else(|e| e.into_inner());
+
+    init_crypto();
+
+    for (&dev_id, flash) in multiflash.iter_mut() {
+        api::set_flash(dev_id, flash);
+    }
+    let start = match counter {
+        None => 0,
+        Some(ref c) => **c as libc::c_int
+    };
+    let mut sim_ctx = api::CSimContext {
+        flash_counter: start,
+        .. Default::default()
+    };
+    api::trace_begin(multiflash);
+    let result = unsafe {
+        let adesc = areadesc.get_c();
+        raw::invoke_boot_serial(&mut sim_ctx as *mut _, adesc.borrow() as *const _,
+                                fd as libc::c_int) as i32
+    };
+    api::trace_end();
+    if let Some(c) = counter {
+        *c = sim_ctx.flash_counter;
+    }
+    for &dev_id in multiflash.keys() {
+        api::clear_flash(dev_id);
+    }
+    SerialResult {
+        interrupted: result == -0x13579,
+        flash_ops: start - sim_ctx.flash_counter,
+    }
+}
+
+/// The largest packet serial recovery accepts, which limits the size of an upload chunk.
+#[cfg(feature = "serial-recovery")]
+pub fn serial_max_receive_size() -> usize {
+    env!("BOOTSIM_SERIAL_MAX_RECEIVE_SIZE").parse().unwrap()
+}
+
+/// Return, and reset, the deepest stack use in bytes of the bootloader over the calls to `boot_go`
+/// on this thread.  This is zero on hosts where the stack use is not measured.
+pub fn take_stack_peak() -> usize {
+    STACK_PEAK.with(|peak| peak.replace(0))
+}
+
+/// The static RAM used by the bootloader in this configuration, as the sizes of its data and bss
+/// sections.  These are measured when building, and are zero if that wasn't possible.
+pub fn static_ram_usage() -> (usize, usize) {
+    (env!("BOOTSIM_STATIC_DATA").parse().unwrap(),
+     env!("BOOTSIM_STATIC_BSS").parse().unwrap())
+}
+
+/// Enable or disable tracing of the flash operations performed by `boot_go` on this thread.
+pub fn trace_enable(enable: bool) {
+    api::trace_enable(enable);
+}
+
+/// Collect the traces recorded so far, one per call to `boot_go`.
+pub fn take_traces() -> Vec<Trace> {
+    api::take_traces()
+}
+
 pub fn boot_trailer_sz(align: u32) -> u32 {
     unsafe { raw::boot_trailer_sz(align) }
 }
@@ -170,6 +260,241 @@ pub fn reset_security_counters() {
     api::sim_reset_nv_counters();
 }
 
+/// Average time in nanoseconds of verifying an ED25519 signature of `msg`
+/// with the built-in key, with or without its comb table, or None if the
+/// signature does not verify.
+#[cfg(feature = "ed25519-comb")]
+pub fn ed25519_verify_time(msg: &[u8], sig: &[u8; 64], use_comb: bool,
+                           iterations: u32) -> Option<u64> {
+    let ns = unsafe {
+        raw::sim_bench_ed25519_verify(msg.as_ptr(), msg.len() as u32, sig.as_ptr(),
+                                      use_comb as libc::c_int, iterations)
+    };
+    if ns == 0 { None } else { Some(ns) }
+}
+
+/// Average time in nanoseconds of verifying the ED25519 signatures of all the
+/// `msgs` with the built-in key, one by one or as a batch, or None if they do
+/// not all verify.
+#[cfg(feature = "batch-verify")]
+pub fn ed25519_verify_batch_time(msgs: &[[u8; 32]], sigs: &[[u8; 64]], batch: bool,
+                                 iterations: u32) -> Option<u64> {
+    assert_eq!(msgs.len(), sigs.len());
+    let ns = unsafe {
+        raw::sim_bench_ed25519_verify_batch(msgs.as_ptr() as *const u8,
+                                            sigs.as_ptr() as *const u8,
+                                            msgs.len() as u32, batch as libc::c_int,
+                                            iterations)
+    };
+    if ns == 0 { None } else { Some(ns) }
+}
+
+/// Average time in nanoseconds of computing `sig`^e mod n with the built-in
+/// RSA key, with Mbed TLS or with the Montgomery constants of the key, along
+/// with the result, or None if it failed.
+#[cfg(feature = "rsa-mont")]
+pub fn rsa_public_time(sig: &[u8], use_mont: bool, iterations: u32) -> Option<(u64, Vec<u8>)> {
+    let mut em = vec![0u8; sig.len()];
+    let ns = unsafe {
+        raw::sim_bench_rsa_public(sig.as_ptr(), sig.len() as u32, use_mont as libc::c_int,
+                                  iterations, em.as_mut_ptr())
+    };
+    if ns == 0 { None } else { Some((ns, em)) }
+}
+
+/// Name of the SHA kernel `kernel`, or None past the last one.
+#[cfg(any(feature = "sha-kernel", feature = "sha-kernel-unroll"))]
+pub fn sha_kernel_name(kernel: i32) -> Option<String> {
+    let name = unsafe { raw::sim_sha_kernel_name(kernel as libc::c_int) };
+    if name.is_null() {
+        None
+    } else {
+        Some(unsafe { std::ffi::CStr::from_ptr(name) }.to_string_lossy().into_owned())
+    }
+}
+
+/// Average time in nanoseconds of hashing `data` with SHA-256, SHA-384 or
+/// SHA-512 (`bits`) and the SHA kernel `kernel`, in updates of `chunk` bytes,
+/// along with the digest, or None if the CPU cannot run the kernel.
+#[cfg(any(feature = "sha-kernel", feature = "sha-kernel-unroll"))]
+pub fn sha_time(kernel: i32, bits: u32, data: &[u8], chunk: u32,
+                iterations: u32) -> Option<(u64, Vec<u8>)> {
+    let mut digest = vec![0u8; 64];
+    let ns = unsafe {
+        raw::sim_bench_sha(kernel as libc::c_int, bits, data.as_ptr(), data.len() as u32,
+                           chunk, iterations, digest.as_mut_ptr())
+    };
+    digest.truncate(bits as usize / 8);
+    if ns == 0 { None } else { Some((ns, digest)) }
+}
+
+/// Average time in nanoseconds of computing the tree hash of `data` with
+/// leaves of `leaf_size` bytes, along with the root, or None if it failed.
+#[cfg(feature = "hash-tree")]
+pub fn hash_tree_time(data: &[u8], leaf_size: u32,
+                      iterations: u32) -> Option<(u64, Vec<u8>)> {
+    let mut root = vec![0u8; 32];
+    let ns = unsafe {
+        raw::sim_bench_hash_tree(data.as_ptr(), data.len() as u32, leaf_size,
+                                 iterations, root.as_mut_ptr())
+    };
+    if ns == 0 { None } else { Some((ns, root)) }
+}
+
+/// Number of erases of whole erase blocks so far on this thread.
+#[cfg(feature = "erase-range")]
+pub fn flash_erase_ranges() -> u64 {
+    unsafe { raw::sim_flash_erase_ranges() }
+}
+
+/// Name of the crypto library bootutil is built with.
+#[cfg(feature = "crypto-bench")]
+pub fn crypto_backend() -> String {
+    let name = unsafe { raw::sim_bench_backend() };
+    unsafe { std::ffi::CStr::from_ptr(name) }.to_string_lossy().into_owned()
+}
+
+/// Average time in nanoseconds of hashing `data` with `bootutil_sha_*`, along
+/// with the digest of `digest_len` bytes.
+#[cfg(feature = "crypto-bench")]
+pub fn bootutil_sha_time(data: &[u8], digest_len: usize, iterations: u32) -> (u64, Vec<u8>) {
+    init_crypto();
+    let mut digest = vec![0u8; 64];
+    let ns = unsafe {
+        raw::sim_bench_bootutil_sha(data.as_ptr(), data.len() as u32, iterations,
+                                    digest.as_mut_ptr())
+    };
+    digest.truncate(digest_len);
+    (ns, digest)
+}
+
+/// Average time in nanoseconds of encrypting `data` with AES-CTR from a zero
+/// counter, along with the result, or None if the configuration has no
+/// encryption or it failed.
+#[cfg(feature = "crypto-bench")]
+pub fn aes_ctr_time(key: &[u8], data: &[u8], iterations: u32) -> Option<(u64, Vec<u8>)> {
+    init_crypto();
+    let mut out = vec![0u8; data.len()];
+    let ns = unsafe {
+        raw::sim_bench_aes_ctr(key.as_ptr(), key.len() as u32, data.as_ptr(),
+                               data.len() as u32, iterations, out.as_mut_ptr())
+    };
+    if ns == 0 { None } else { Some((ns, out)) }
+}
+
+/// Average time in nanoseconds of verifying the signature `sig` of the image
+/// hash `hash` with the built-in key, or None if the configuration has no
+/// signature of the hash or it does not verify.
+#[cfg(feature = "crypto-bench")]
+pub fn verify_sig_time(hash: &[u8], sig: &[u8], iterations: u32) -> Option<u64> {
+    init_crypto();
+    let ns = unsafe {
+        raw::sim_bench_verify_sig(hash.as_ptr(), hash.len() as u32, sig.as_ptr(),
+                                  sig.len() as u32, iterations)
+    };
+    if ns == 0 { None } else { Some(ns) }
+}
+
+/// Average time in nanoseconds of unwrapping the key of the encryption TLV
+/// `tlv` with the built-in private key, along with the key, or None if the
+/// configuration has no encryption or it failed.
+#[cfg(feature = "crypto-bench")]
+pub fn enc_unwrap_time(tlv: &[u8], key_len: usize, iterations: u32) -> Option<(u64, Vec<u8>)> {
+    init_crypto();
+    let mut key = vec![0u8; key_len];
+    let ns = unsafe {
+        raw::sim_bench_enc_unwrap(tlv.as_ptr(), tlv.len() as u32, iterations, key.as_mut_ptr())
+    };
+    if ns == 0 { None } else { Some((ns, key)) }
+}
+
+/// Average time in nanoseconds of the HMAC-SHA256 of `data` with `key`, along
+/// with the MAC, or None if the configuration has no ECIES key unwrap.
+#[cfg(feature = "crypto-bench")]
+pub fn hmac_sha256_time(key: &[u8], data: &[u8], iterations: u32) -> Option<(u64, Vec<u8>)> {
+    init_crypto();
+    let mut mac = vec![0u8; 32];
+    let ns = unsafe {
+        raw::sim_bench_hmac_sha256(key.as_ptr(), key.len() as u32, data.as_ptr(),
+                                   data.len() as u32, iterations, mac.as_mut_ptr())
+    };
+    if ns == 0 { None } else { Some((ns, mac)) }
+}
+
+/// Average time in nanoseconds of deriving `okm_len` bytes from `ikm` with the
+/// HKDF of the ECIES key unwrap, along with them, or None if the
+/// configuration has no ECIES key unwrap.
+#[cfg(feature = "crypto-bench")]
+pub fn hkdf_time(ikm: &[u8], okm_len: usize, iterations: u32) -> Option<(u64, Vec<u8>)> {
+    init_crypto();
+    let mut okm = vec![0u8; okm_len];
+    let ns = unsafe {
+        raw::sim_bench_hkdf(ikm.as_ptr(), ikm.len() as u32, okm_len as u32, iterations,
+                            okm.as_mut_ptr())
+    };
+    if ns == 0 { None } else { Some((ns, okm)) }
+}
+
+/// Number of crypto jobs the bootloader submitted to the worker thread so far
+/// on this thread.
+#[cfg(feature = "crypto-async")]
+pub fn crypto_async_jobs() -> u64 {
+    unsafe { raw::sim_crypto_async_jobs() }
+}
+
+/// Time in nanoseconds the flash operations took so far on this thread, after
+/// the time model of the simulator: one after the other, and with the flash
+/// jobs overlapping with the reads of the other device.
+#[cfg(feature = "flash-async")]
+pub fn flash_async_time() -> (u64, u64) {
+    let mut serial = 0;
+    let mut elapsed = 0;
+    unsafe { raw::sim_flash_async_time(&mut serial, &mut elapsed) };
+    (serial, elapsed)
+}
+
+/// Sectors of image data and swap status entries written to the primary slots
+/// so far on this thread.
+#[cfg(feature = "swap-move-batch")]
+pub fn swap_writes() -> (u64, u64) {
+    let mut sectors = 0;
+    let mut status_writes = 0;
+    unsafe { raw::sim_swap_writes(&mut sectors, &mut status_writes) };
+    (sectors, status_writes)
+}
+
+/// Reads of the trailers of the image slots so far on this thread.
+#[cfg(feature = "slot-snapshot")]
+pub fn trailer_reads() -> u64 {
+    unsafe { raw::sim_trailer_reads() }
+}
+
+/// Writes of the trailer fields from the encryption keys up to swap_info, and
+/// writes of the magic, so far on this thread.
+pub fn trailer_writes() -> (u64, u64) {
+    let mut info_writes = 0;
+    let mut magic_writes = 0;
+    unsafe { raw::sim_trailer_writes(&mut info_writes, &mut magic_writes) };
+    (info_writes, magic_writes)
+}
+
+/// Bytes erased or written in the secondary slots so far on this thread.
+#[cfg(feature = "image-extent")]
+pub fn secondary_scrambled() -> u64 {
+    unsafe { raw::sim_secondary_scrambled() }
+}
+
+/// Bytes erased and written in the scratch area so far on this thread, and the
+/// size of the scratch area.
+#[cfg(feature = "scratch-wear-leveling")]
+pub fn scratch_wear() -> (u64, u64, u64) {
+    let mut erased = 0;
+    let mut written = 0;
+    let mut size = 0u32;
+    unsafe { raw::sim_scratch_wear(&mut erased, &mut written, &mut size) };
+    (erased, written, size as u64)
+}
+
 mod raw {
     use crate::area::CAreaDesc;
     use crate::api::{BootRsp, CSimContext};
@@ -181,6 +506,10 @@ mod raw {
         pub fn invoke_boot_go(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc,
             rsp: *mut BootRsp, image_index: libc::c_int) -> libc::c_int;
 
+        #[cfg(feature = "serial-recovery")]
+        pub fn invoke_boot_serial(sim_ctx: *mut CSimContext, areadesc: *const CAreaDesc,
+            fd: libc::c_int) -> libc::c_int;
+
         pub fn boot_trailer_sz(min_write_sz: u32) -> u32;
         pub fn boot_status_sz(min_write_sz: u32) -> u32;
 
@@ -194,6 +523,60 @@ mod raw {
         pub fn kw_encrypt_(kek: *const u8, seckey: *const u8,
                            encbuf: *mut u8) -> libc::c_int;
 
+        #[cfg(feature = "ed25519-comb")]
+        pub fn sim_bench_ed25519_verify(msg: *const u8, len: u32, sig: *const u8,
+                                        use_comb: libc::c_int, iterations: u32) -> u64;
+
+        #[cfg(feature = "batch-verify")]
+        pub fn sim_bench_ed25519_verify_batch(msgs: *const u8, sigs: *const u8, num: u32,
+                                              batch: libc::c_int, iterations: u32) -> u64;
+        #[cfg(any(feature = "sha-kernel", feature = "sha-kernel-unroll"))]
+        pub fn sim_sha_kernel_name(kernel: libc::c_int) -> *const libc::c_char;
+        #[cfg(any(feature = "sha-kernel", feature = "sha-kernel-unroll"))]
+        pub fn sim_bench_sha(kernel: libc::c_int, bits: u32, data: *const u8, len: u32,
+                             chunk: u32, iterations: u32, digest: *mut u8) -> u64;
+        #[cfg(feature = "rsa-mont")]
+        pub fn sim_bench_rsa_public(sig: *const u8, slen: u32, use_mont: libc::c_int,
+                                    iterations: u32, em: *mut u8) -> u64;
+        #[cfg(feature = "hash-tree")]
+        pub fn sim_bench_hash_tree(data: *const u8, len: u32, leaf_size: u32,
+                                   iterations: u32, root: *mut u8) -> u64;
+        #[cfg(feature = "crypto-async")]
+        pub fn sim_crypto_async_jobs() -> u64;
+        #[cfg(feature = "erase-range")]
+        pub fn sim_flash_erase_ranges() -> u64;
+        #[cfg(feature = "flash-async")]
+        pub fn sim_flash_async_time(serial: *mut u64, elapsed: *mut u64);
+        #[cfg(feature = "swap-move-batch")]
+        pub fn sim_swap_writes(sectors: *mut u64, status_writes: *mut u64);
+        #[cfg(feature = "slot-snapshot")]
+        pub fn sim_trailer_reads() -> u64;
+        pub fn sim_trailer_writes(info_writes: *mut u64, magic_writes: *mut u64);
+        #[cfg(feature = "image-extent")]
+        pub fn sim_secondary_scrambled() -> u64;
+        #[cfg(feature = "scratch-wear-leveling")]
+        pub fn sim_scratch_wear(erased: *mut u64, written: *mut u64, size: *mut u32);
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_backend() -> *const libc::c_char;
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_bootutil_sha(data: *const u8, len: u32, iterations: u32,
+                                      digest: *mut u8) -> u64;
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_aes_ctr(key: *const u8, klen: u32, data: *const u8, len: u32,
+                                 iterations: u32, out: *mut u8) -> u64;
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_verify_sig(hash: *const u8, hlen: u32, sig: *const u8, slen: u32,
+                                    iterations: u32) -> u64;
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_enc_unwrap(tlv: *const u8, len: u32, iterations: u32,
+                                    key: *mut u8) -> u64;
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_hmac_sha256(key: *const u8, klen: u32, data: *const u8, len: u32,
+                                     iterations: u32, mac: *mut u8) -> u64;
+        #[cfg(feature = "crypto-bench")]
+        pub fn sim_bench_hkdf(ikm: *const u8, ikm_len: u32, okm_len: u32, iterations: u32,
+                              okm: *mut u8) -> u64;
+
         #[allow(unused)]
         pub fn psa_crypto_init() -> u32;
 
@@ -9,6 +9,7 @@
 //! These generally can be written as individual bytes, but must be erased in larger units.
 
 mod pdump;
+pub mod trace;
 
 use crate::pdump::HexDump;
 use log::info;
@@ -37,6 +38,8 @@ pub enum FlashError {
     Write(String),
     #[error("Write failed by chance: {0}")]
     SimulatedFail(String),
+    #[error("Invalid trace: {0}")]
+    Trace(String),
     #[error("{0}")]
     Io(#[from] io::Error),
 }
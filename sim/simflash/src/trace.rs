@@ -0,0 +1,519 @@
+// SPDX-License-Identifier: Apache-2.0
+
+//! Flash operation traces.
+//!
+//! A trace records every erase, write and read that a single invocation of the bootloader performs
+//! against the simulated flash devices, along with a snapshot of the devices as they were when the
+//! bootloader started.  Each record carries the flash area, offset, length, a digest of the data
+//! and the boot phase the loader reported at the time.  Writes also keep their payload, so that
+//! the flash contents can be reconstructed at any point in the trace.
+//!
+//! Traces are stored in a compact little-endian binary format, and a file can hold any number of
+//! them (typically one per call to `boot_go` within a test).
+
+use crate::{Flash, FlashError, Result, SimFlash, SimMultiFlash};
+use std::{
+    collections::BTreeMap,
+    fmt,
+    fs::File,
+    io::{BufReader, BufWriter, Read, Write},
+    path::Path,
+};
+
+const TRACE_MAGIC: &[u8; 8] = b"MCUTRACE";
+const TRACE_VERSION: u32 = 1;
+
+/// Record flag: the underlying flash operation returned an error.
+const FLAG_FAILED: u8 = 0x01;
+
+/// The kind of flash operation.
+#[derive(Copy, Clone, Debug, PartialEq, Eq, PartialOrd, Ord)]
+pub enum TraceOp {
+    Erase,
+    Write,
+    Read,
+}
+
+impl TraceOp {
+    fn from_u8(value: u8) -> Result<TraceOp> {
+        match value {
+            0 => Ok(TraceOp::Erase),
+            1 => Ok(TraceOp::Write),
+            2 => Ok(TraceOp::Read),
+            _ => Err(etrace(format!("unknown operation {}", value))),
+        }
+    }
+
+    fn to_u8(self) -> u8 {
+        match self {
+            TraceOp::Erase => 0,
+            TraceOp::Write => 1,
+            TraceOp::Read => 2,
+        }
+    }
+
+    /// Erase and write are the operations counted by the power-fail `stop` counter.
+    pub fn is_counted(self) -> bool {
+        self != TraceOp::Read
+    }
+}
+
+/// Boot phases, as reported by the loader through `BOOT_SET_PHASE()`.  These must match the
+/// `BOOT_PHASE_*` definitions in `bootutil_priv.h`.
+pub fn phase_name(phase: u8) -> &'static str {
+    match phase {
+        0 => "none",
+        1 => "prepare",
+        2 => "resume",
+        3 => "validate",
+        4 => "update",
+        5 => "select",
+        _ => "unknown",
+    }
+}
+
+/// A single flash operation.
+#[derive(Clone, Debug, PartialEq, Eq)]
+pub struct TraceRecord {
+    pub op: TraceOp,
+    pub failed: bool,
+    pub dev_id: u8,
+    pub area_id: u8,
+    pub image: u8,
+    pub phase: u8,
+    /// Offset of the operation within the device.
+    pub offset: u32,
+    pub len: u32,
+    /// FNV-1a digest of the data written or read.  Zero for erases.
+    pub digest: u32,
+    /// The payload of a write, empty for other operations.
+    pub data: Vec<u8>,
+}
+
+impl TraceRecord {
+    /// Two records describe the same operation if everything but the payload matches.
+    fn same_as(&self, other: &TraceRecord) -> bool {
+        self.op == other.op &&
+            self.failed == other.failed &&
+            self.dev_id == other.dev_id &&
+            self.area_id == other.area_id &&
+            self.image == other.image &&
+            self.phase == other.phase &&
+            self.offset == other.offset &&
+            self.len == other.len &&
+            self.digest == other.digest
+    }
+}
+
+impl fmt::Display for TraceRecord {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let op = match self.op {
+            TraceOp::Erase => "erase",
+            TraceOp::Write => "write",
+            TraceOp::Read => "read ",
+        };
+        write!(f, "{} dev={} area={} off={:#08x} len={:#06x} digest={:08x} img={} phase={}{}",
+               op, self.dev_id, self.area_id, self.offset, self.len, self.digest, self.image,
+               phase_name(self.phase), if self.failed { " FAILED" } else { "" })
+    }
+}
+
+/// The layout and initial contents of one flash device.  Only sectors that are not fully erased
+/// are kept.
+#[derive(Clone, Debug)]
+pub struct TraceDevice {
+    pub dev_id: u8,
+    pub sectors: Vec<usize>,
+    pub align: usize,
+    pub erased_val: u8,
+    contents: Vec<(u32, Vec<u8>)>,
+}
+
+impl TraceDevice {
+    pub fn capture(dev_id: u8, flash: &SimFlash) -> TraceDevice {
+        let contents = flash.sector_iter()
+            .filter(|s| flash.data[s.base .. s.base + s.size].iter().any(|&b| b != flash.erased_val))
+            .map(|s| (s.base as u32, flash.data[s.base .. s.base + s.size].to_vec()))
+            .collect();
+        TraceDevice {
+            dev_id,
+            sectors: flash.sectors.clone(),
+            align: flash.align,
+            erased_val: flash.erased_val,
+            contents,
+        }
+    }
+
+    fn restore(&self) -> Result<SimFlash> {
+        let mut flash = SimFlash::new(self.sectors.clone(), self.align, self.erased_val);
+        for (off, data) in &self.contents {
+            flash.write(*off as usize, data)?;
+        }
+        // The recorded operations already passed any checks when they were first performed.
+        flash.set_verify_writes(false);
+        Ok(flash)
+    }
+}
+
+/// The trace of one bootloader invocation.
+#[derive(Clone, Debug, Default)]
+pub struct Trace {
+    pub devices: Vec<TraceDevice>,
+    pub records: Vec<TraceRecord>,
+}
+
+impl Trace {
+    /// Start a new trace, capturing the current state of the given devices.
+    pub fn new(flash: &SimMultiFlash) -> Trace {
+        let mut devices: Vec<_> = flash.iter()
+            .map(|(&id, dev)| TraceDevice::capture(id, dev))
+            .collect();
+        devices.sort_by_key(|d| d.dev_id);
+        Trace {
+            devices,
+            records: Vec::new(),
+        }
+    }
+
+    pub fn push(&mut self, record: TraceRecord) {
+        self.records.push(record);
+    }
+
+    /// Reconstruct the flash devices as they were after the first `upto` operations.
+    pub fn replay(&self, upto: usize) -> Result<SimMultiFlash> {
+        let mut flash = SimMultiFlash::new();
+        for dev in &self.devices {
+            flash.insert(dev.dev_id, dev.restore()?);
+        }
+        for rec in self.records.iter().take(upto) {
+            if rec.failed {
+                continue;
+            }
+            let dev = flash.get_mut(&rec.dev_id)
+                .ok_or_else(|| etrace(format!("no device {}", rec.dev_id)))?;
+            match rec.op {
+                TraceOp::Erase => dev.erase(rec.offset as usize, rec.len as usize)?,
+                TraceOp::Write => dev.write(rec.offset as usize, &rec.data)?,
+                TraceOp::Read => (),
+            }
+        }
+        Ok(flash)
+    }
+
+    /// Return the index of the record that a power-fail counter of `stop` interrupts, which is the
+    /// `stop`th erase or write.  Operations before that index are the ones that completed.
+    pub fn stop_index(&self, stop: usize) -> Option<usize> {
+        if stop == 0 {
+            return None;
+        }
+        self.records.iter()
+            .enumerate()
+            .filter(|(_, r)| r.op.is_counted())
+            .nth(stop - 1)
+            .map(|(i, _)| i)
+    }
+
+    /// Count operations and bytes by (phase, op).
+    pub fn summary(&self) -> BTreeMap<(u8, TraceOp), (usize, u64)> {
+        let mut sum = BTreeMap::new();
+        for rec in &self.records {
+            let ent = sum.entry((rec.phase, rec.op)).or_insert((0, 0));
+            ent.0 += 1;
+            ent.1 += rec.len as u64;
+        }
+        sum
+    }
+
+    fn encode<W: Write>(&self, w: &mut W) -> Result<()> {
+        put_u32(w, self.devices.len() as u32)?;
+        for dev in &self.devices {
+            w.write_all(&[dev.dev_id, dev.erased_val])?;
+            put_u32(w, dev.align as u32)?;
+            put_u32(w, dev.sectors.len() as u32)?;
+            for &s in &dev.sectors {
+                put_u32(w, s as u32)?;
+            }
+            put_u32(w, dev.contents.len() as u32)?;
+            for (off, data) in &dev.contents {
+                put_u32(w, *off)?;
+                put_u32(w, data.len() as u32)?;
+                w.write_all(data)?;
+            }
+        }
+        put_u32(w, self.records.len() as u32)?;
+        for rec in &self.records {
+            let flags = if rec.failed { FLAG_FAILED } else { 0 };
+            w.write_all(&[rec.op.to_u8(), flags, rec.dev_id, rec.area_id, rec.image, rec.phase])?;
+            put_u32(w, rec.offset)?;
+            put_u32(w, rec.len)?;
+            put_u32(w, rec.digest)?;
+            if rec.op == TraceOp::Write {
+                w.write_all(&rec.data)?;
+            }
+        }
+        Ok(())
+    }
+
+    fn decode<R: Read>(r: &mut R) -> Result<Trace> {
+        let ndev = get_u32(r)?;
+        let mut devices = Vec::new();
+        for _ in 0 .. ndev {
+            let mut hdr = [0u8; 2];
+            r.read_exact(&mut hdr)?;
+            let align = get_u32(r)? as usize;
+            let nsect = get_u32(r)?;
+            let mut sectors = Vec::new();
+            for _ in 0 .. nsect {
+                sectors.push(get_u32(r)? as usize);
+            }
+            let nchunk = get_u32(r)?;
+            let mut contents = Vec::new();
+            for _ in 0 .. nchunk {
+                let off = get_u32(r)?;
+                let len = get_u32(r)? as usize;
+                let data = get_bytes(r, len)?;
+                contents.push((off, data));
+            }
+            devices.push(TraceDevice {
+                dev_id: hdr[0],
+                sectors,
+                align,
+                erased_val: hdr[1],
+                contents,
+            });
+        }
+
+        let nrec = get_u32(r)?;
+        let mut records = Vec::new();
+        for _ in 0 .. nrec {
+            let mut hdr = [0u8; 6];
+            r.read_exact(&mut hdr)?;
+            let op = TraceOp::from_u8(hdr[0])?;
+            let offset = get_u32(r)?;
+            let len = get_u32(r)?;
+            let digest = get_u32(r)?;
+            let data = if op == TraceOp::Write {
+                get_bytes(r, len as usize)?
+            } else {
+                Vec::new()
+            };
+            records.push(TraceRecord {
+                op,
+                failed: hdr[1] & FLAG_FAILED != 0,
+                dev_id: hdr[2],
+                area_id: hdr[3],
+                image: hdr[4],
+                phase: hdr[5],
+                offset,
+                len,
+                digest,
+                data,
+            });
+        }
+        Ok(Trace { devices, records })
+    }
+}
+
+/// Write a sequence of traces to a file.
+pub fn write_traces<P: AsRef<Path>>(path: P, traces: &[Trace]) -> Result<()> {
+    let mut w = BufWriter::new(File::create(path)?);
+    w.write_all(TRACE_MAGIC)?;
+    put_u32(&mut w, TRACE_VERSION)?;
+    put_u32(&mut w, traces.len() as u32)?;
+    for t in traces {
+        t.encode(&mut w)?;
+    }
+    w.flush()?;
+    Ok(())
+}
+
+/// Read back a file written by `write_traces`.
+pub fn read_traces<P: AsRef<Path>>(path: P) -> Result<Vec<Trace>> {
+    let mut r = BufReader::new(File::open(path)?);
+    let mut magic = [0u8; 8];
+    r.read_exact(&mut magic)?;
+    if &magic != TRACE_MAGIC {
+        return Err(etrace("not a trace file"));
+    }
+    let version = get_u32(&mut r)?;
+    if version != TRACE_VERSION {
+        return Err(etrace(format!("unsupported trace version {}", version)));
+    }
+    let count = get_u32(&mut r)?;
+    (0 .. count).map(|_| Trace::decode(&mut r)).collect()
+}
+
+/// The difference between two traces.  Operations common to the start and to the end of both
+/// traces are skipped; what is left over is the region where they diverge.
+pub struct TraceDiff<'a> {
+    pub a: &'a Trace,
+    pub b: &'a Trace,
+    /// Number of identical leading records.
+    pub prefix: usize,
+    /// Number of identical trailing records, not overlapping the prefix.
+    pub suffix: usize,
+}
+
+impl<'a> TraceDiff<'a> {
+    pub fn new(a: &'a Trace, b: &'a Trace) -> TraceDiff<'a> {
+        let prefix = a.records.iter()
+            .zip(b.records.iter())
+            .take_while(|(x, y)| x.same_as(y))
+            .count();
+        let max_suffix = a.records.len().min(b.records.len()) - prefix;
+        let suffix = a.records.iter().rev()
+            .zip(b.records.iter().rev())
+            .take(max_suffix)
+            .take_while(|(x, y)| x.same_as(y))
+            .count();
+        TraceDiff { a, b, prefix, suffix }
+    }
+
+    /// Do the traces perform exactly the same operations?
+    pub fn is_same(&self) -> bool {
+        self.prefix == self.a.records.len() && self.prefix == self.b.records.len()
+    }
+
+    pub fn only_a(&self) -> &'a [TraceRecord] {
+        &self.a.records[self.prefix .. self.a.records.len() - self.suffix]
+    }
+
+    pub fn only_b(&self) -> &'a [TraceRecord] {
+        &self.b.records[self.prefix .. self.b.records.len() - self.suffix]
+    }
+}
+
+impl<'a> fmt::Display for TraceDiff<'a> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        if self.is_same() {
+            return writeln!(f, "traces are identical ({} operations)", self.a.records.len());
+        }
+        writeln!(f, "diverge at operation {} ({} common trailing operations)",
+                 self.prefix, self.suffix)?;
+        for rec in self.only_a() {
+            writeln!(f, "- {}", rec)?;
+        }
+        for rec in self.only_b() {
+            writeln!(f, "+ {}", rec)?;
+        }
+
+        let sa = self.a.summary();
+        let sb = self.b.summary();
+        let mut keys: Vec<_> = sa.keys().chain(sb.keys()).cloned().collect();
+        keys.sort();
+        keys.dedup();
+        writeln!(f, "per phase counts (a -> b):")?;
+        for key in keys {
+            let (ca, ba) = sa.get(&key).cloned().unwrap_or((0, 0));
+            let (cb, bb) = sb.get(&key).cloned().unwrap_or((0, 0));
+            if ca != cb || ba != bb {
+                writeln!(f, "  {:>8} {:?}: {} -> {} ops, {} -> {} bytes",
+                         phase_name(key.0), key.1, ca, cb, ba, bb)?;
+            }
+        }
+        Ok(())
+    }
+}
+
+/// The FNV-1a hash, used as a cheap content digest.
+pub fn digest(data: &[u8]) -> u32 {
+    data.iter().fold(0x811c9dc5u32, |h, &b| (h ^ b as u32).wrapping_mul(0x01000193))
+}
+
+fn etrace<T: AsRef<str>>(message: T) -> FlashError {
+    FlashError::Trace(message.as_ref().to_owned())
+}
+
+fn put_u32<W: Write>(w: &mut W, value: u32) -> Result<()> {
+    w.write_all(&value.to_le_bytes())?;
+    Ok(())
+}
+
+fn get_u32<R: Read>(r: &mut R) -> Result<u32> {
+    let mut buf = [0u8; 4];
+    r.read_exact(&mut buf)?;
+    Ok(u32::from_le_bytes(buf))
+}
+
+fn get_bytes<R: Read>(r: &mut R, len: usize) -> Result<Vec<u8>> {
+    let mut buf = vec![0u8; len];
+    r.read_exact(&mut buf)?;
+    Ok(buf)
+}
+
+#[cfg(test)]
+mod test {
+    use super::{digest, Trace, TraceDiff, TraceOp, TraceRecord};
+    use crate::{Flash, SimFlash, SimMultiFlash};
+
+    fn record(op: TraceOp, offset: u32, data: &[u8], phase: u8) -> TraceRecord {
+        TraceRecord {
+            op,
+            failed: false,
+            dev_id: 0,
+            area_id: 1,
+            image: 0,
+            phase,
+            offset,
+            len: data.len() as u32,
+            digest: if op == TraceOp::Erase { 0 } else { digest(data) },
+            data: if op == TraceOp::Write { data.to_vec() } else { Vec::new() },
+        }
+    }
+
+    fn sample() -> Trace {
+        let mut dev = SimFlash::new(vec![4096; 4], 1, 0xff);
+        dev.write(4096, &[1, 2, 3, 4]).unwrap();
+        let mut flash = SimMultiFlash::new();
+        flash.insert(0, dev);
+
+        let mut trace = Trace::new(&flash);
+        trace.push(record(TraceOp::Read, 4096, &[1, 2, 3, 4], 1));
+        trace.push(record(TraceOp::Erase, 4096, &[0; 4096], 4));
+        trace.push(record(TraceOp::Write, 0, &[5, 6], 4));
+        trace
+    }
+
+    #[test]
+    fn test_replay() {
+        let trace = sample();
+        let mut buf = [0u8; 4];
+
+        let flash = trace.replay(0).unwrap();
+        flash[&0].read(4096, &mut buf).unwrap();
+        assert_eq!(buf, [1, 2, 3, 4]);
+
+        let flash = trace.replay(3).unwrap();
+        flash[&0].read(4096, &mut buf).unwrap();
+        assert_eq!(buf, [0xff; 4]);
+        flash[&0].read(0, &mut buf).unwrap();
+        assert_eq!(buf, [5, 6, 0xff, 0xff]);
+
+        assert_eq!(trace.stop_index(1), Some(1));
+        assert_eq!(trace.stop_index(2), Some(2));
+        assert_eq!(trace.stop_index(3), None);
+    }
+
+    #[test]
+    fn test_encode() {
+        let trace = sample();
+        let mut buf = Vec::new();
+        trace.encode(&mut buf).unwrap();
+        let back = Trace::decode(&mut &buf[..]).unwrap();
+        assert_eq!(back.records, trace.records);
+        assert!(TraceDiff::new(&trace, &back).is_same());
+    }
+
+    #[test]
+    fn test_diff() {
+        let a = sample();
+        let mut b = sample();
+        b.records.insert(2, record(TraceOp::Write, 8192, &[7, 7], 4));
+        let diff = TraceDiff::new(&a, &b);
+        assert!(!diff.is_same());
+        assert_eq!(diff.prefix, 2);
+        assert_eq!(diff.suffix, 1);
+        assert!(diff.only_a().is_empty());
+        assert_eq!(diff.only_b().len(), 1);
+    }
+}
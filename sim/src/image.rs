@@ -19,7 +19,8 @@ use rand::{
     rngs::SmallRng,
 };
 use std::{
-    collections::{BTreeMap, HashSet}, io::{Cursor, Write}, mem, rc::Rc, slice
+    collections::{BTreeMap, HashSet}, io::{Cursor, Write}, mem, rc::Rc, slice,
+    time::Instant,
 };
 use aes::{
     Aes128,
@@ -38,6 +39,7 @@ use simflash::{Flash, SimFlash, SimMultiFlash};
 use mcuboot_sys::{c, AreaDesc, FlashId, RamBlock};
 use crate::{
     ALL_DEVICES,
+    LARGE_DEVICES,
     DeviceName,
 };
 use crate::caps::Caps;
@@ -51,6 +53,10 @@ use crate::depends::{
     UpgradeInfo,
 };
 use crate::tlv::{ManifestGen, TlvGen, TlvFlags};
+#[cfg(feature = "hash-tree")]
+use crate::tlv::{HASH_TREE_LEAF, hash_tree_leaf_size};
+#[cfg(feature = "serial-recovery")]
+use crate::serial::{self, Pty, SerialConfig, UploadStats};
 use crate::utils::align_up;
 use typenum::{U32, U16};
 
@@ -207,6 +213,19 @@ impl ImagesBuilder {
     pub fn each_device<F>(f: F)
         where F: Fn(Self)
     {
+        // The large devices take long enough to simulate that they are only
+        // run with a single alignment and erased value.
+        if cfg!(feature = "large-geometry") {
+            let align = *test_alignments().last().unwrap();
+            for &dev in LARGE_DEVICES {
+                match Self::new(dev, align, 0xff) {
+                    Ok(run) => f(run),
+                    Err(msg) => warn!("Skipping {}: {}", dev, msg),
+                }
+            }
+            return;
+        }
+
         for &dev in ALL_DEVICES {
             for &align in test_alignments() {
                 for &erased_val in &[0, 0xff] {
@@ -298,6 +317,16 @@ impl ImagesBuilder {
     }
 
     pub fn make_bad_secondary_slot_image(self) -> Images {
+        self.make_sized_bad_secondary_slot_image(maximal(41928))
+    }
+
+    /// Construct an `Images` where the secondary slot of each image holds an image with a bad
+    /// signature that fills a quarter of the slot.
+    pub fn make_small_bad_secondary_slot_image(self) -> Images {
+        self.make_sized_bad_secondary_slot_image(ImageSize::Partial(4))
+    }
+
+    fn make_sized_bad_secondary_slot_image(self, size: ImageSize) -> Images {
         let mut bad_flash = self.flash;
         let ram = self.ram.clone(); // TODO: Avoid this clone.
         let images = self.slots.into_iter().enumerate().map(|(image_num, slots)| {
@@ -305,7 +334,7 @@ impl ImagesBuilder {
             let primaries = install_image(&mut bad_flash, &self.areadesc, &slots, 0,
                 maximal(32784), &ram, &dep, ImageManipulation::None, Some(0));
             let upgrades = install_image(&mut bad_flash, &self.areadesc, &slots, 1,
-                maximal(41928), &ram, &dep, ImageManipulation::BadSignature, Some(0));
+                size, &ram, &dep, ImageManipulation::BadSignature, Some(0));
             OneImage {
                 slots,
                 primaries,
@@ -589,7 +618,167 @@ impl ImagesBuilder {
                 flash.insert(dev_id, dev);
                 (flash, Rc::new(areadesc), &[])
             }
+            DeviceName::LargeUniform4k => {
+                // External flash style, uniform 4 KB sectors, with 8 MB slots of 2048 sectors
+                // each.
+                let dev = SimFlash::new(vec![4096; 4144], align as usize, erased_val);
+
+                let dev_id = 0;
+                let mut areadesc = AreaDesc::new();
+                areadesc.add_flash_sectors(dev_id, &dev);
+                areadesc.add_image(0x0020000, 0x800000, FlashId::Image0, dev_id);
+                areadesc.add_image(0x0820000, 0x800000, FlashId::Image1, dev_id);
+                areadesc.add_image(0x1020000, 0x010000, FlashId::ImageScratch, dev_id);
+
+                let mut flash = SimMultiFlash::new();
+                flash.insert(dev_id, dev);
+                (flash, Rc::new(areadesc), &[])
+            }
+            DeviceName::LargeMixed => {
+                // 8 MB slots, each starting with a few 4 KB sectors followed by 64 KB ones.
+                let mut sectors = vec![4096; 16];
+                for _ in 0 .. 2 {
+                    sectors.extend(vec![4096; 16]);
+                    sectors.extend(vec![64 * 1024; 127]);
+                }
+                sectors.extend(vec![64 * 1024; 2]);
+                let dev = SimFlash::new(sectors, align as usize, erased_val);
+
+                let dev_id = 0;
+                let mut areadesc = AreaDesc::new();
+                areadesc.add_flash_sectors(dev_id, &dev);
+                areadesc.add_image(0x0010000, 0x800000, FlashId::Image0, dev_id);
+                areadesc.add_image(0x0810000, 0x800000, FlashId::Image1, dev_id);
+                areadesc.add_image(0x1010000, 0x020000, FlashId::ImageScratch, dev_id);
+
+                let mut flash = SimMultiFlash::new();
+                flash.insert(dev_id, dev);
+                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove, Caps::SwapUsingOffset])
+            }
+            DeviceName::LargeSplit => {
+                // An 8 MB primary slot in 4 KB sectors, with the secondary slot and scratch on a
+                // 16 MB external flash with 64 KB sectors.
+                let dev0 = SimFlash::new(vec![4096; 2064], align as usize, erased_val);
+                let dev1 = SimFlash::new(vec![64 * 1024; 256], align as usize, erased_val);
+
+                let mut areadesc = AreaDesc::new();
+                areadesc.add_flash_sectors(0, &dev0);
+                areadesc.add_flash_sectors(1, &dev1);
+                areadesc.add_image(0x010000, 0x800000, FlashId::Image0, 0);
+                areadesc.add_image(0x000000, 0x800000, FlashId::Image1, 1);
+                areadesc.add_image(0x800000, 0x020000, FlashId::ImageScratch, 1);
+
+                let mut flash = SimMultiFlash::new();
+                flash.insert(0, dev0);
+                flash.insert(1, dev1);
+                (flash, Rc::new(areadesc), &[Caps::SwapUsingMove, Caps::SwapUsingOffset])
+            }
+        }
+    }
+
+    /// Check that the cost of an upgrade grows linearly with the size of the image.  Upgrades an
+    /// image filling half of the slot and one filling all of it, and compares the number of flash
+    /// operations and the time taken.  Returns true on failure.
+    pub fn run_upgrade_scaling(self) -> bool {
+        if !Caps::modifies_flash() {
+            return false;
+        }
+
+        let half = self.clone().make_sized_image(ImageSize::Partial(2));
+        let full = self.make_sized_image(ImageSize::Largest);
+
+        let (half_ops, half_time) = half.timed_upgrade();
+        let (full_ops, full_time) = full.timed_upgrade();
+        info!("Upgrade scaling: half {} ops in {:.2}s, full {} ops in {:.2}s",
+              half_ops, half_time, full_ops, full_time);
+
+        let mut fails = 0;
+        if half_ops <= 0 || full_ops <= 0 {
+            error!("Upgrade did not complete");
+            return true;
+        }
+
+        // Doubling the image should at most double the work, give or take the fixed cost of
+        // handling the trailers.
+        if full_ops as f64 > 2.25 * half_ops as f64 + 64.0 {
+            error!("Flash operations grow super-linearly: {} -> {}", half_ops, full_ops);
+            fails += 1;
         }
+
+        // Timing is noisy, so only catch gross (e.g. quadratic) growth.
+        if full_time > 3.0 * half_time + 1.0 {
+            error!("Upgrade time grows super-linearly: {:.2}s -> {:.2}s", half_time, full_time);
+            fails += 1;
+        }
+
+        fails > 0
+    }
+
+    /// Construct an `Images` where both slots of each image hold an image of the given size, with
+    /// the upgrade marked as pending.
+    fn make_sized_image(self, size: ImageSize) -> Images {
+        let mut flash = self.flash;
+        let ram = self.ram.clone(); // TODO: Avoid this clone.
+        let images = self.slots.into_iter().enumerate().map(|(image_num, slots)| {
+            let dep = BoringDep::new(image_num, &NO_DEPS);
+            let primaries = install_image(&mut flash, &self.areadesc, &slots, 0,
+                size, &ram, &dep, ImageManipulation::None, Some(0));
+            let upgrades = install_image(&mut flash, &self.areadesc, &slots, 1,
+                size, &ram, &dep, ImageManipulation::None, Some(1));
+            mark_upgrade(&mut flash, &slots[1]);
+            OneImage {
+                slots,
+                primaries,
+                upgrades,
+            }}).collect();
+        install_ptable(&mut flash, &self.areadesc);
+        Images {
+            flash,
+            areadesc: self.areadesc,
+            images,
+            total_count: None,
+            ram: self.ram,
+        }
+    }
+
+    /// Construct an `Images` where the secondary slot of each image holds a delta image, a patch
+    /// from the image in the primary slot to a new one, with the upgrade marked as pending.  The
+    /// primary slot is filled to a third, to leave room in the secondary slot for the delta image
+    /// and the image it is built into.  Returns None if there is not enough room.
+    #[cfg(feature = "delta")]
+    pub fn make_delta_image(self) -> Option<Images> {
+        let mut flash = self.flash;
+        let ram = self.ram.clone(); // TODO: Avoid this clone.
+        let mut images = vec![];
+        for (image_num, slots) in self.slots.into_iter().enumerate() {
+            let dep = BoringDep::new(image_num, &NO_DEPS);
+            let primaries = install_image(&mut flash, &self.areadesc, &slots, 0,
+                ImageSize::Partial(3), &ram, &dep, ImageManipulation::None, Some(0));
+            let upgrades = install_delta_image(&mut flash, &slots, &primaries, &dep)?;
+            mark_upgrade(&mut flash, &slots[1]);
+            images.push(OneImage {
+                slots,
+                primaries,
+                upgrades,
+            });
+        }
+        install_ptable(&mut flash, &self.areadesc);
+        let mut images = Images {
+            flash,
+            areadesc: self.areadesc,
+            images,
+            total_count: None,
+            ram: self.ram,
+        };
+
+        if Caps::modifies_flash() {
+            let total_count = images.run_basic_upgrade(true)
+                .expect("Unable to perform basic upgrade");
+            c::reset_security_counters();
+            images.total_count = Some(total_count);
+        }
+
+        Some(images)
     }
 
     pub fn num_images(&self) -> usize {
@@ -598,6 +787,11 @@ impl ImagesBuilder {
 }
 
 impl Images {
+    /// The number of images in the simulation.
+    pub fn num_images(&self) -> usize {
+        self.images.len()
+    }
+
     /// A simple upgrade without forced failures.
     ///
     /// Returns the number of flash operations which can later be used to
@@ -615,6 +809,408 @@ impl Images {
         }
     }
 
+    /// Upgrade once, and check that the trailers the swap sets up have their
+    /// encryption keys, swap_size and swap_info written together, with no
+    /// more writes than of their magic.  Returns true on failure.
+    pub fn run_trailer_writes(&self) -> bool {
+        if !self.is_swap_upgrade() {
+            return false;
+        }
+
+        let mut fails = 0;
+
+        let (info0, magic0) = c::trailer_writes();
+        let (flash, _) = self.try_upgrade(None, false);
+        let (info1, magic1) = c::trailer_writes();
+        let (info_writes, magic_writes) = (info1 - info0, magic1 - magic0);
+        info!("{} writes of the trailer fields for {} of the magic", info_writes, magic_writes);
+
+        if !self.verify_images(&flash, 0, 1) {
+            warn!("Image mismatch after the upgrade");
+            fails += 1;
+        }
+
+        if magic_writes == 0 || info_writes > magic_writes {
+            warn!("Trailer fields written one by one");
+            fails += 1;
+        }
+
+        fails > 0
+    }
+
+    /// Boot once with an upgrade to an image with a bad signature pending, and check that
+    /// removing it erases or writes no more than the sectors of the slot that hold the image or
+    /// the trailer.  Returns true on failure.
+    #[cfg(feature = "image-extent")]
+    pub fn run_scramble_extent(&self) -> bool {
+        if !Caps::modifies_flash() {
+            return false;
+        }
+
+        let mut fails = 0;
+        let mut flash = self.flash.clone();
+        self.mark_upgrades(&mut flash, 1);
+
+        let start = c::secondary_scrambled();
+        if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+            warn!("Failed boot");
+            return true;
+        }
+        let scrambled = c::secondary_scrambled() - start;
+
+        let extent: u64 = self.images.iter().map(|image| {
+            let slot = &image.slots[1];
+            let dev = self.flash.get(&slot.dev_id).unwrap();
+            let slot_end = slot.base_off + slot.len;
+            let mut image_end = slot.base_off + image.upgrades.size;
+            if Caps::SwapUsingOffset.present() {
+                image_end += dev.sector_iter().next().unwrap().size;
+            }
+            let trailer_off = slot_end - c::boot_trailer_sz(dev.align() as u32) as usize;
+            dev.sector_iter()
+                .filter(|s| s.base >= slot.base_off && s.base < slot_end)
+                .filter(|s| s.base < image_end || s.base + s.size > trailer_off)
+                .map(|s| s.size as u64)
+                .sum::<u64>()
+        }).sum();
+        info!("Removing the images scrambled {} bytes, their sectors take {}", scrambled, extent);
+
+        if !self.verify_images(&flash, 0, 0) {
+            warn!("Image mismatch after the boot");
+            fails += 1;
+        }
+
+        if scrambled == 0 || scrambled > extent {
+            warn!("Scrambled past the sectors of the images");
+            fails += 1;
+        }
+
+        fails > 0
+    }
+
+    /// Boot once with an upgrade to an image with a bad signature pending, and check that
+    /// removing it erased some blocks of the flash at once, on the devices where the secondary
+    /// slot holds an erase block made of smaller sectors.  Returns true on failure.
+    #[cfg(feature = "erase-range")]
+    pub fn run_erase_range(&self) -> bool {
+        // The smallest erase block of the simulated flash, see run.c.
+        const BLOCK: usize = 0x8000;
+
+        let start = c::flash_erase_ranges();
+        if self.run_signfail_upgrade() {
+            return true;
+        }
+        let ranges = c::flash_erase_ranges() - start;
+        info!("{} erase blocks used", ranges);
+
+        let has_block = self.images.iter().any(|image| {
+            let slot = &image.slots[1];
+            let dev = self.flash.get(&slot.dev_id).unwrap();
+            let block = align_up(slot.base_off as u32, BLOCK as u32) as usize;
+            block + BLOCK <= slot.base_off + image.upgrades.size &&
+                dev.sector_iter().any(|s| s.base == block) &&
+                dev.sector_iter()
+                    .filter(|s| s.base >= block && s.base < block + BLOCK)
+                    .all(|s| s.base + s.size <= block + BLOCK)
+        });
+        if has_block && ranges == 0 {
+            warn!("No erase block was used");
+            return true;
+        }
+
+        false
+    }
+
+    /// Upgrade with the erases and writes of the copies run as flash jobs.  When the two slots
+    /// of an image are on different flash devices, the time model of the simulator must see the
+    /// jobs overlap with the reads of the other device.  Returns true on failure.
+    #[cfg(feature = "flash-async")]
+    pub fn run_flash_async(&self) -> bool {
+        let (serial0, elapsed0) = c::flash_async_time();
+        if self.run_basic_upgrade(true).is_none() {
+            return true;
+        }
+        let (serial1, elapsed1) = c::flash_async_time();
+        let (serial, elapsed) = (serial1 - serial0, elapsed1 - elapsed0);
+        info!("Flash operations: {} ns one after the other, {} ns with jobs", serial, elapsed);
+
+        let two_devices = self.images.iter().any(|image| {
+            image.slots[0].dev_id != image.slots[1].dev_id
+        });
+        if two_devices && elapsed >= serial {
+            warn!("No flash job overlapped with a read");
+            return true;
+        }
+
+        false
+    }
+
+    /// Upgrade with up to four sectors per step of the swap.  An unbatched swap writes one
+    /// status entry for each of the sectors it moves up, and two for each of the sectors it
+    /// swaps, that is three for every two sectors of image data written to the primary slot:
+    /// the batched one must write fewer.  Returns true on failure.
+    #[cfg(feature = "swap-move-batch")]
+    pub fn run_swap_move_batch(&self) -> bool {
+        let (sectors0, status0) = c::swap_writes();
+        if self.run_basic_upgrade(true).is_none() {
+            return true;
+        }
+        let (sectors1, status1) = c::swap_writes();
+        let (sectors, status_writes) = (sectors1 - sectors0, status1 - status0);
+        info!("{} sectors written with {} status entries", sectors, status_writes);
+
+        if status_writes * 2 >= sectors * 3 {
+            warn!("No step was batched");
+            return true;
+        }
+
+        false
+    }
+
+    /// Upgrade with the scratch area used in turns.  Only the first step of a swap, which may
+    /// keep the swap status at the end of the scratch area, erases all of it, before and after
+    /// its copy.  The other steps only erase the sectors they write to, which are whole ones but
+    /// for the last step, so the bytes erased in the scratch area stay within three times its
+    /// size per image of the bytes written there.  Returns true on failure.
+    #[cfg(feature = "scratch-wear-leveling")]
+    pub fn run_scratch_wear_leveling(&self) -> bool {
+        let (erased0, written0, _) = c::scratch_wear();
+        if self.run_basic_upgrade(true).is_none() {
+            return true;
+        }
+        let (erased1, written1, size) = c::scratch_wear();
+        let (erased, written) = (erased1 - erased0, written1 - written0);
+        info!("Scratch area: {} bytes erased, {} bytes written", erased, written);
+
+        if erased > written + 3 * size * self.num_images() as u64 {
+            warn!("The scratch area was erased more than the steps need");
+            return true;
+        }
+
+        false
+    }
+
+    /// Boot once with nothing to upgrade, and check that the images in the
+    /// primary slots are left as they are.  Returns true on failure.
+    pub fn run_no_upgrade_boot(&self) -> bool {
+        let mut flash = self.flash.clone();
+
+        if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+            warn!("Failed boot");
+            return true;
+        }
+
+        if !self.verify_images(&flash, 0, 0) {
+            warn!("Image mismatch after the boot");
+            return true;
+        }
+
+        false
+    }
+
+    /// Boot once with nothing to upgrade.  With the snapshot of the slots, the trailer of each
+    /// slot is read once per boot, however many times the boot asks for the swap state of the
+    /// slot or the swap type of the image.  Returns true on failure.
+    #[cfg(feature = "slot-snapshot")]
+    pub fn run_slot_snapshot(&self) -> bool {
+        let reads0 = c::trailer_reads();
+        if self.run_no_upgrade_boot() {
+            return true;
+        }
+        let reads = c::trailer_reads() - reads0;
+        info!("{} trailer reads for {} images", reads, self.num_images());
+
+        if reads > 2 * self.num_images() as u64 {
+            warn!("The trailers were read more than once per slot");
+            return true;
+        }
+
+        false
+    }
+
+    /// Boot once with an upgrade of image 0 pending, whose second leaf of the tree hash was
+    /// corrupted after the image was signed, and check that the upgrade is not installed.
+    /// Returns true on failure.
+    #[cfg(feature = "hash-tree")]
+    pub fn run_hash_tree_bad_leaf(&self) -> bool {
+        if !Caps::modifies_flash() {
+            return false;
+        }
+
+        let mut flash = self.flash.clone();
+        let slot = &self.images[0].slots[1];
+        let dev = flash.get_mut(&slot.dev_id).unwrap();
+        let mut off = slot.base_off + HASH_TREE_LEAF + 1;
+        if Caps::SwapUsingOffset.present() {
+            off += dev.sector_iter().next().unwrap().size;
+        }
+        let sector = dev.sector_iter().find(|s| s.base <= off && off < s.base + s.size).unwrap();
+        let mut buf = vec![0; sector.size];
+        dev.read(sector.base, &mut buf).unwrap();
+        buf[off - sector.base] ^= 1;
+        // Only write back up to the last byte written, the sector may also hold the trailer.
+        let erased_val = dev.erased_val();
+        let len = buf.iter().rposition(|&b| b != erased_val).map_or(0, |i| i + 1);
+        dev.erase(sector.base, sector.size).unwrap();
+        dev.write(sector.base, &buf[..align_up(len as u32, dev.align() as u32) as usize]).unwrap();
+
+        mark_upgrade(&mut flash, slot);
+
+        if !c::boot_go(&mut flash, &self.areadesc, None, None, false).success() {
+            warn!("Failed boot");
+            return true;
+        }
+
+        if !self.verify_images(&flash, 0, 0) {
+            warn!("Image with a bad leaf was installed");
+            return true;
+        }
+
+        false
+    }
+
+    /// Upload the upgrade image of image 0 into its primary slot using serial recovery, and check
+    /// that it is then booted.  The upload is also interrupted at a few points, and must succeed
+    /// when restarted from the beginning.  Returns true on failure.
+    #[cfg(feature = "serial-recovery")]
+    pub fn run_serial_recovery(&self) -> bool {
+        if !self.serial_supported() {
+            return false;
+        }
+
+        let config = SerialConfig { mtu: 127, chunk: 512 };
+        let mut flash = self.flash.clone();
+        let (result, stats) = self.serial_upload(&mut flash, config, None);
+        if result.interrupted || !stats.complete {
+            error!("Serial upload failed");
+            return true;
+        }
+        if !self.verify_serial_upload(&flash) {
+            return true;
+        }
+
+        let mut fails = 0;
+        let total = result.flash_ops;
+        for stop in [total / 4, total / 2, total * 3 / 4] {
+            if stop <= 0 {
+                continue;
+            }
+            let mut flash = self.flash.clone();
+            let mut counter = stop;
+            let (result, _) = self.serial_upload(&mut flash, config, Some(&mut counter));
+            if !result.interrupted {
+                error!("Serial upload not interrupted at {}", stop);
+                fails += 1;
+                continue;
+            }
+
+            let (result, stats) = self.serial_upload(&mut flash, config, None);
+            if result.interrupted || !stats.complete || !self.verify_serial_upload(&flash) {
+                error!("Serial upload not recovered after interruption at {}", stop);
+                fails += 1;
+            }
+        }
+
+        fails > 0
+    }
+
+    /// Measure serial recovery uploads with a range of line and chunk sizes, reporting the
+    /// throughput, round trips and flash operations of each.  Returns true on failure.
+    #[cfg(feature = "serial-recovery")]
+    pub fn run_serial_throughput(&self) -> bool {
+        if !self.serial_supported() {
+            return false;
+        }
+
+        let max_chunk = c::serial_max_receive_size();
+        let mut fails = 0;
+        println!("{:>5} {:>6} {:>10} {:>8} {:>9} {:>10}",
+                 "mtu", "chunk", "bytes/s", "trips", "flash ops", "line bytes");
+        let mut chunks: Vec<usize> = vec![128, 256, 512, 1024, max_chunk];
+        chunks.retain(|&chunk| chunk <= max_chunk);
+        chunks.dedup();
+        for &mtu in &[127, 256, 512] {
+            for &chunk in &chunks {
+                let config = SerialConfig { mtu, chunk };
+                let mut flash = self.flash.clone();
+                let (result, stats) = self.serial_upload(&mut flash, config, None);
+                if result.interrupted || !stats.complete || !self.verify_serial_upload(&flash) {
+                    error!("Serial upload failed with {:?}", config);
+                    fails += 1;
+                    continue;
+                }
+                println!("{:>5} {:>6} {:>10.0} {:>8} {:>9} {:>10}",
+                         mtu, chunk, stats.bytes_per_sec(), stats.round_trips,
+                         result.flash_ops, stats.line_bytes);
+            }
+        }
+
+        fails > 0
+    }
+
+    /// Serial recovery uploads the image built for the secondary slot into the primary slot, so
+    /// only test it when that image is valid there as is: not encrypted, not loaded into RAM, and
+    /// not built for swap-using-offset's shifted secondary slot.
+    #[cfg(feature = "serial-recovery")]
+    fn serial_supported(&self) -> bool {
+        !(Caps::EncRsa.present() || Caps::EncKw.present() ||
+          Caps::EncEc256.present() || Caps::EncX25519.present() ||
+          Caps::RamLoad.present() || Caps::SwapUsingOffset.present())
+    }
+
+    /// Run serial recovery on the given flash, with an uploader for the upgrade image of image 0
+    /// on the other end of the serial port.
+    #[cfg(feature = "serial-recovery")]
+    fn serial_upload(&self, flash: &mut SimMultiFlash, config: SerialConfig,
+                     counter: Option<&mut i32>) -> (c::SerialResult, UploadStats) {
+        let Pty { master, slave } = Pty::open().expect("Unable to open a pseudo-terminal");
+        let image = self.images[0].upgrades.plain.clone();
+        let max_receive = c::serial_max_receive_size();
+        let uploader = std::thread::spawn(move || {
+            serial::upload(master, &image, config, max_receive)
+        });
+
+        let result = c::boot_serial(flash, &self.areadesc, counter,
+                                    std::os::unix::io::AsRawFd::as_raw_fd(&slave));
+        // Closing the port wakes the uploader if the bootloader stopped early.
+        drop(slave);
+        let stats = uploader.join().unwrap();
+        (result, stats)
+    }
+
+    /// Check that the primary slot of image 0 holds the uploaded image, and that it boots.
+    #[cfg(feature = "serial-recovery")]
+    fn verify_serial_upload(&self, flash: &SimMultiFlash) -> bool {
+        let image = &self.images[0];
+        if !verify_image(flash, &image.slots[0], &image.upgrades) {
+            error!("Primary slot doesn't hold the uploaded image");
+            return false;
+        }
+
+        let mut flash = flash.clone();
+        let result = c::boot_go(&mut flash, &self.areadesc, None, None, false);
+        if !result.success() {
+            error!("Uploaded image failed to boot");
+            return false;
+        }
+        true
+    }
+
+    /// Perform a permanent upgrade, returning the number of flash operations and the time it took
+    /// in seconds.  The operation count is negative if the upgrade did not succeed.
+    fn timed_upgrade(&self) -> (i32, f64) {
+        let start = Instant::now();
+        let (flash, count) = self.try_upgrade(None, true);
+        let elapsed = start.elapsed().as_secs_f64();
+        c::reset_security_counters();
+
+        if !self.verify_images(&flash, 0, 1) {
+            warn!("Image mismatch after timed upgrade");
+            return (-1, elapsed);
+        }
+        (count, elapsed)
+    }
+
     pub fn run_bootstrap(&self) -> bool {
         let mut flash = self.flash.clone();
         let mut fails = 0;
@@ -731,7 +1327,7 @@ impl Images {
         }
 
         // Let's try an image halfway through.
-        for i in 1 .. total_flash_ops {
+        for i in fail_points(total_flash_ops) {
             info!("Try interruption at {}", i);
             let (flash, count) = self.try_upgrade(Some(i), true);
             info!("Second boot, count={}", count);
@@ -767,6 +1363,31 @@ impl Images {
         fails > 0
     }
 
+    /// Interrupt a permanent upgrade three quarters of the way through, and
+    /// check that the boot that completes it resumes the copy rather than
+    /// starts it over.  Returns true on failure.
+    #[cfg(feature = "overwrite-resume")]
+    pub fn run_overwrite_resume(&self) -> bool {
+        let total_flash_ops = self.total_count.unwrap();
+        let stop = total_flash_ops * 3 / 4;
+
+        info!("Try interruption at {}", stop);
+        let (flash, count) = self.try_upgrade(Some(stop), true);
+        if !self.verify_images(&flash, 0, 1) {
+            warn!("FAIL at step {} of {}", stop, total_flash_ops);
+            return true;
+        }
+
+        let resumed = count - stop;
+        info!("Resumed upgrade took {} flash operations out of {}", resumed, total_flash_ops);
+        if resumed >= total_flash_ops {
+            warn!("The interrupted upgrade started over");
+            return true;
+        }
+
+        false
+    }
+
     pub fn run_perm_with_random_fails(&self, total_fails: usize) -> bool {
         if !Caps::modifies_flash() {
             return false;
@@ -821,7 +1442,7 @@ impl Images {
         }
 
         if self.is_swap_upgrade() {
-            for i in 1 .. self.total_count.unwrap() {
+            for i in fail_points(self.total_count.unwrap()) {
                 info!("Try interruption at {}", i);
                 if self.try_revert_with_fail_at(i) {
                     error!("Revert failed at interruption {}", i);
@@ -1748,7 +2369,7 @@ fn show_flash(flash: &dyn Flash) {
     println!();
 }
 
-#[derive(Debug)]
+#[derive(Clone, Copy, Debug)]
 enum ImageSize {
     /// Make the image the specified given size.
     #[allow(dead_code)]
@@ -1757,6 +2378,8 @@ enum ImageSize {
     Largest,
     /// Make the image quite larger than it can be for the partition/device/
     Oversized,
+    /// Make the image the given fraction (1/n) of the largest it can be.
+    Partial(usize),
 }
 
 /// Estimate the number of bytes in each slot that must be reserved for the trailer when
@@ -1810,8 +2433,13 @@ fn image_largest_trailer(dev: &dyn Flash, areadesc: &AreaDesc, slot: &SlotInfo)
             // Using the header size we know, the trailer size, and the slot size, we can compute
             // the largest image possible.
             let trailer = if Caps::OverwriteUpgrade.present() {
-                // magic + image-ok + copy-done + swap-info
-                c::boot_magic_sz() + 3 * c::boot_max_align()
+                if cfg!(feature = "overwrite-resume") {
+                    // The status area holds the progress of the copy.
+                    c::boot_trailer_sz(dev.align() as u32) as usize
+                } else {
+                    // magic + image-ok + copy-done + swap-info
+                    c::boot_magic_sz() + 3 * c::boot_max_align()
+                }
             } else if Caps::SwapUsingOffset.present() || Caps::SwapUsingMove.present() {
                 let sector_size = dev.sector_iter().next().unwrap().size as u32;
                 align_up(c::boot_trailer_sz(dev.align() as u32), sector_size) as usize
@@ -1854,7 +2482,26 @@ fn compute_largest_image_size(dev: &dyn Flash, areadesc: &AreaDesc, slots: &[Slo
     info!("slot: 0x{:x}, HDR: 0x{:x}, trailer: 0x{:x}, tlv_len: 0x{:x}, padding: 0x{:x}",
         slot_len, hdr_size, trailer, tlv_len, padding);
 
-    slot_len - hdr_size - trailer - tlv_len - padding
+    #[allow(unused_mut)]
+    let mut size = slot_len - hdr_size - trailer - tlv_len - padding;
+
+    // The TLV of a tree hash also holds the digests of the leaves but the
+    // first, which the estimate without a payload leaves out.
+    #[cfg(feature = "hash-tree")]
+    {
+        let digests = |size: usize| {
+            let len = hdr_size + size + tlv.protect_size() as usize;
+            let leaf_size = hash_tree_leaf_size(len);
+            32 * ((len + leaf_size - 1) / leaf_size - 1)
+        };
+        let avail = size;
+        size -= digests(size);
+        while size + 1 + digests(size + 1) <= avail {
+            size += 1;
+        }
+    }
+
+    size
 }
 
 /// Install a "program" into the given image.  This fakes the image header, or at least all of the
@@ -1908,6 +2555,8 @@ fn install_image(flash: &mut SimMultiFlash, areadesc: &AreaDesc, slots: &[SlotIn
                                                             HDR_SIZE, tlv.as_ref());
             largest_img_sz + dev.align()
         }
+        ImageSize::Partial(n) => compute_largest_image_size(dev, areadesc, slots, slot_ind,
+                                                            HDR_SIZE, tlv.as_ref()) / n,
     };
 
     // Generate a boot header.  Note that the size doesn't include the header.
@@ -2061,6 +2710,154 @@ fn install_image(flash: &mut SimMultiFlash, areadesc: &AreaDesc, slots: &[SlotIn
     }
 }
 
+/// Install in the secondary slot a delta image whose base is the image installed in the primary
+/// slot, and whose target is the same image with another version and a few changes to its
+/// payload.  Returns the target, which is what the primary slot holds after the upgrade, or None
+/// if the secondary slot can not hold both the delta image and the target.
+#[cfg(feature = "delta")]
+fn install_delta_image(flash: &mut SimMultiFlash, slots: &[SlotInfo], base: &ImageData,
+                       deps: &dyn Depender) -> Option<ImageData> {
+    const HDR_SIZE: usize = 32;
+    let slot = &slots[1];
+    let offset = slot.base_off;
+    let dev = flash.get_mut(&slot.dev_id).unwrap();
+    let align = dev.align();
+    let erased_val = dev.erased_val();
+
+    let base = &base.plain[..base.size];
+    let base_len = u32::from_le_bytes(base[12..16].try_into().unwrap()) as usize;
+    let mut payload = base[HDR_SIZE..HDR_SIZE + base_len].to_vec();
+    for (i, b) in payload[base_len / 2..base_len / 2 + 64].iter_mut().enumerate() {
+        *b = i as u8;
+    }
+    payload.extend_from_slice(&[0x5a; 300]);
+
+    // The target and the delta image have the same header but for the size and the flags, and
+    // the same TLVs but for the delta ones.
+    let make_image = |payload: &[u8], delta: Option<&[u8]>| {
+        let mut tlv: Box<dyn ManifestGen> = Box::new(make_tlv());
+        tlv.set_security_counter(Some(1));
+        for dep in deps.my_deps(offset, slot.index) {
+            tlv.add_dependency(deps.other_id(), &dep);
+        }
+        if let Some(target) = delta {
+            tlv.set_delta(base, target);
+        }
+
+        let header = ImageHeader {
+            magic: tlv.get_magic(),
+            load_addr: 0,
+            hdr_size: HDR_SIZE as u16,
+            protect_tlv_size: tlv.protect_size(),
+            img_size: payload.len() as u32,
+            flags: tlv.get_flags(),
+            ver: deps.my_version(offset, slot.index),
+            _pad2: 0,
+        };
+
+        let mut buf = header.as_raw().to_vec();
+        tlv.add_bytes(&buf);
+        tlv.add_bytes(payload);
+        buf.extend_from_slice(payload);
+        buf.append(&mut tlv.make_tlv());
+        buf
+    };
+
+    let target = make_image(&payload, None);
+    let delta = make_image(&make_delta_patch(base, &target), Some(&target[..]));
+    info!("Delta image: 0x{:x} bytes for a target of 0x{:x} bytes", delta.len(), target.len());
+
+    // The target is built from the first sector past the delta image, and must end before the
+    // sector holding the trailer.
+    let status_off = offset + slot.len - c::boot_trailer_sz(align as u32) as usize;
+    let start = dev.sector_iter()
+        .map(|sector| sector.base)
+        .find(|&off| off >= offset + delta.len())?;
+    let end = dev.sector_iter()
+        .map(|sector| sector.base + sector.size)
+        .filter(|&end| end > start && end <= status_off)
+        .last()?;
+    if end - start < target.len() {
+        warn!("No room for the target of the delta image");
+        return None;
+    }
+
+    let mut buf = delta;
+    while buf.len() % align != 0 {
+        buf.push(erased_val);
+    }
+    dev.write(offset, &buf).unwrap();
+
+    let size = target.len();
+    let mut plain = target;
+    while plain.len() % align != 0 {
+        plain.push(erased_val);
+    }
+
+    Some(ImageData {
+        size,
+        plain,
+        cipher: None,
+    })
+}
+
+/// Build the patch of a delta image from `base` to `target`, the same way as imgtool does: a list
+/// of records of the offset and length of a block of the base to copy and of the length of the
+/// bytes to insert after it, each followed by these bytes.
+#[cfg(feature = "delta")]
+fn make_delta_patch(base: &[u8], target: &[u8]) -> Vec<u8> {
+    const BLOCK: usize = 16;
+    const MIN_MATCH: usize = 32;
+
+    let mut index = std::collections::HashMap::new();
+    if base.len() >= BLOCK {
+        for off in (0..=base.len() - BLOCK).rev().step_by(4) {
+            index.insert(&base[off..off + BLOCK], off);
+        }
+    }
+
+    let mut patch = vec![];
+    let record = |patch: &mut Vec<u8>, src: usize, len: usize, insert: &[u8]| {
+        patch.write_u32::<LittleEndian>(src as u32).unwrap();
+        patch.write_u32::<LittleEndian>(len as u32).unwrap();
+        patch.write_u32::<LittleEndian>(insert.len() as u32).unwrap();
+        patch.extend_from_slice(insert);
+    };
+    let (mut copy_off, mut copy_len) = (0, 0);
+    let mut insert_off = 0;
+    let mut pos = 0;
+    while pos + BLOCK <= target.len() {
+        let mut src = match index.get(&target[pos..pos + BLOCK]) {
+            Some(&src) => src,
+            None => {
+                pos += 1;
+                continue;
+            }
+        };
+        let mut start = pos;
+        while start > insert_off && src > 0 && base[src - 1] == target[start - 1] {
+            src -= 1;
+            start -= 1;
+        }
+        let mut end = pos + BLOCK;
+        while end < target.len() && src + end - start < base.len() &&
+            base[src + end - start] == target[end] {
+            end += 1;
+        }
+        if end - start < MIN_MATCH {
+            pos += 1;
+            continue;
+        }
+        record(&mut patch, copy_off, copy_len, &target[insert_off..start]);
+        copy_off = src;
+        copy_len = end - start;
+        insert_off = end;
+        pos = end;
+    }
+    record(&mut patch, copy_off, copy_len, &target[insert_off..]);
+    patch
+}
+
 /// Install no image.  This is used when no upgrade happens.
 fn install_no_image() -> ImageData {
     ImageData {
@@ -2119,6 +2916,22 @@ fn make_tlv() -> TlvGen {
     }
 }
 
+/// Build the TLV area that protects `payload` as MCUboot is currently configured, along with the
+/// encryption key it carries, which is empty for the non-encrypted configurations.  This is for
+/// the crypto benchmarks, which verify and unwrap the TLVs outside of an image.
+pub fn make_manifest(payload: &[u8]) -> (Vec<u8>, Vec<u8>) {
+    let mut tlv = Box::new(make_tlv());
+    let flag = TlvFlags::ENCRYPTED_AES128 as u32 | TlvFlags::ENCRYPTED_AES256 as u32;
+    let enc_key = if (tlv.get_flags() & flag) != 0 {
+        tlv.generate_enc_key();
+        tlv.get_enc_key()
+    } else {
+        vec![]
+    };
+    tlv.add_bytes(payload);
+    (tlv.make_tlv(), enc_key)
+}
+
 impl ImageData {
     /// Find the image contents for the given slot.  This assumes that slot 0
     /// is unencrypted, and slot 1 is encrypted.
@@ -2425,6 +3238,9 @@ pub fn show_sizes() {
         let msize = c::boot_trailer_sz(*min);
         println!("{:2}: {} (0x{:x})", min, msize, msize);
     }
+
+    let (data, bss) = c::static_ram_usage();
+    println!("static RAM: data {} bss {}", data, bss);
 }
 
 #[cfg(not(feature = "max-align-32"))]
@@ -2437,6 +3253,18 @@ fn test_alignments() -> &'static [usize] {
     &[32]
 }
 
+/// The power-fail tests interrupt an upgrade at each of its flash operations in turn.  With the
+/// large geometries there are far too many of those, so only a spread of them are tried.
+fn fail_points(total: i32) -> Vec<i32> {
+    const LARGE_FAIL_POINTS: i32 = 8;
+
+    if cfg!(feature = "large-geometry") && total > LARGE_FAIL_POINTS {
+        (1 ..= LARGE_FAIL_POINTS).map(|i| i * (total - 1) / LARGE_FAIL_POINTS).collect()
+    } else {
+        (1 .. total).collect()
+    }
+}
+
 /// For testing, some of the tests are quite slow. This will query for an
 /// environment variable `MCUBOOT_SKIP_SLOW_TESTS`, which can be set to avoid
 /// running these tests.
@@ -15,7 +15,10 @@ use serde_derive::Deserialize;
 mod caps;
 mod depends;
 mod image;
+#[cfg(feature = "serial-recovery")]
+mod serial;
 mod tlv;
+mod trace;
 mod utils;
 pub mod testlog;
 
@@ -31,8 +34,14 @@ pub use crate::{
         ImagesBuilder,
         Images,
         ImageManipulation,
+        make_manifest,
         show_sizes,
     },
+    tlv::ed25519_sign,
+    tlv::rsa_sign,
+    tlv::hash_tree_root,
+    tlv::hash_tree_root_of,
+    tlv::HASH_TREE_LEAF,
 };
 
 const USAGE: &str = "
@@ -42,6 +51,9 @@ Usage:
   bootsim sizes
   bootsim run --device TYPE [--align SIZE]
   bootsim runall
+  bootsim trace show <file> [--boot N]
+  bootsim trace replay <file> --boot N --index N --out PREFIX
+  bootsim trace diff <file> <file> [--boot N]
   bootsim (--help | --version)
 
 Options:
@@ -50,21 +62,33 @@ Options:
   --device TYPE      MCU to simulate
                      Valid values: stm32f4, k64f
   --align SIZE       Flash write alignment
+  --boot N           Which bootloader invocation within a trace file
+  --index N          Number of operations to replay
+  --out PREFIX       Prefix of the replayed flash image file(s)
 ";
 
 #[derive(Debug, Deserialize)]
 struct Args {
     flag_device: Option<DeviceName>,
     flag_align: Option<AlignArg>,
+    flag_boot: Option<usize>,
+    flag_index: Option<usize>,
+    flag_out: Option<String>,
+    arg_file: Vec<String>,
     cmd_sizes: bool,
     cmd_run: bool,
     cmd_runall: bool,
+    cmd_trace: bool,
+    cmd_show: bool,
+    cmd_replay: bool,
+    cmd_diff: bool,
 }
 
 #[derive(Copy, Clone, Debug, Deserialize)]
 pub enum DeviceName {
     Stm32f4, Stm32f4SpiFlash, K64f, K64fBig, K64fMulti, Nrf52840, Nrf52840SpiFlash,
     Nrf52840UnequalSlots, Nrf52840UnequalSlotsLargerSlot1,
+    LargeUniform4k, LargeMixed, LargeSplit,
 }
 
 pub static ALL_DEVICES: &[DeviceName] = &[
@@ -79,6 +103,14 @@ pub static ALL_DEVICES: &[DeviceName] = &[
     DeviceName::Nrf52840UnequalSlotsLargerSlot1,
 ];
 
+/// Devices with multi-megabyte slots and thousands of sectors.  These need the
+/// "large-geometry" feature, and replace ALL_DEVICES in the tests when it is enabled.
+pub static LARGE_DEVICES: &[DeviceName] = &[
+    DeviceName::LargeUniform4k,
+    DeviceName::LargeMixed,
+    DeviceName::LargeSplit,
+];
+
 impl fmt::Display for DeviceName {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         let name = match *self {
@@ -91,6 +123,9 @@ impl fmt::Display for DeviceName {
             DeviceName::Nrf52840SpiFlash => "Nrf52840SpiFlash",
             DeviceName::Nrf52840UnequalSlots => "Nrf52840UnequalSlots",
             DeviceName::Nrf52840UnequalSlotsLargerSlot1 => "Nrf52840UnequalSlotsLargerSlot1",
+            DeviceName::LargeUniform4k => "LargeUniform4k",
+            DeviceName::LargeMixed => "LargeMixed",
+            DeviceName::LargeSplit => "LargeSplit",
         };
         f.write_str(name)
     }
@@ -140,6 +175,24 @@ pub fn main() {
         return;
     }
 
+    if args.cmd_trace {
+        let res = if args.cmd_show {
+            trace::show(&args.arg_file[0], args.flag_boot)
+        } else if args.cmd_replay {
+            trace::replay(&args.arg_file[0], args.flag_boot.unwrap(), args.flag_index.unwrap(),
+                          args.flag_out.as_ref().unwrap())
+        } else if args.cmd_diff {
+            trace::diff(&args.arg_file[0], &args.arg_file[1], args.flag_boot)
+        } else {
+            unreachable!()
+        };
+        if let Err(e) = res {
+            error!("{}", e);
+            process::exit(1);
+        }
+        return;
+    }
+
     let mut status = RunStatus::new();
     if args.cmd_run {
 
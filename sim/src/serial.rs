@@ -0,0 +1,425 @@
+// SPDX-License-Identifier: Apache-2.0
+
+//! Host side of the serial recovery tests.
+//!
+//! The bootloader's console is one end of a pseudo-terminal.  The uploader on the other end speaks
+//! the mcumgr SMP protocol over the serial transport: each packet is prefixed with its length,
+//! followed by a CRC16, base64 encoded and split into lines of at most the given MTU.
+
+use log::{debug, info};
+use std::{
+    fs::File,
+    io::{self, Read, Write},
+    os::unix::io::{AsRawFd, FromRawFd, RawFd},
+    time::{Duration, Instant},
+};
+
+/// How long to wait for a response before giving up.
+const RESPONSE_TIMEOUT_MS: libc::c_int = 10000;
+
+const SHELL_NLIP_PKT_START: [u8; 2] = [6, 9];
+const SHELL_NLIP_DATA_START: [u8; 2] = [4, 20];
+
+const NMGR_OP_WRITE: u8 = 2;
+const MGMT_GROUP_ID_DEFAULT: u16 = 0;
+const MGMT_GROUP_ID_IMAGE: u16 = 1;
+const NMGR_ID_RESET: u8 = 5;
+const IMGMGR_NMGR_ID_UPLOAD: u8 = 1;
+
+/// The size of the SMP header.
+const HDR_SIZE: usize = 8;
+
+/// A pseudo-terminal, with the uploader on the master side and the bootloader on the slave side.
+pub struct Pty {
+    pub master: File,
+    pub slave: File,
+}
+
+impl Pty {
+    pub fn open() -> io::Result<Pty> {
+        unsafe {
+            let master = libc::posix_openpt(libc::O_RDWR | libc::O_NOCTTY);
+            if master < 0 {
+                return Err(io::Error::last_os_error());
+            }
+            let master = File::from_raw_fd(master);
+            if libc::grantpt(master.as_raw_fd()) != 0 || libc::unlockpt(master.as_raw_fd()) != 0 {
+                return Err(io::Error::last_os_error());
+            }
+            let name = libc::ptsname(master.as_raw_fd());
+            if name.is_null() {
+                return Err(io::Error::last_os_error());
+            }
+            let slave = libc::open(name, libc::O_RDWR | libc::O_NOCTTY);
+            if slave < 0 {
+                return Err(io::Error::last_os_error());
+            }
+            let slave = File::from_raw_fd(slave);
+
+            // Pass the bytes through untouched, without echo or line editing.
+            let mut tio: libc::termios = std::mem::zeroed();
+            if libc::tcgetattr(slave.as_raw_fd(), &mut tio) != 0 {
+                return Err(io::Error::last_os_error());
+            }
+            libc::cfmakeraw(&mut tio);
+            if libc::tcsetattr(slave.as_raw_fd(), libc::TCSANOW, &tio) != 0 {
+                return Err(io::Error::last_os_error());
+            }
+
+            Ok(Pty { master, slave })
+        }
+    }
+}
+
+/// Parameters of an upload.
+#[derive(Clone, Copy, Debug)]
+pub struct SerialConfig {
+    /// The longest line sent, including the two byte frame marker and the newline.
+    pub mtu: usize,
+    /// The number of bytes of the image sent in each upload request.  This is reduced as needed
+    /// so that a request fits in the bootloader's receive buffer.
+    pub chunk: usize,
+}
+
+/// Statistics of an upload.
+#[derive(Clone, Debug, Default)]
+pub struct UploadStats {
+    /// The size of the image.
+    pub image_bytes: usize,
+    /// The bytes sent over the serial line, after encoding.
+    pub line_bytes: usize,
+    /// The number of requests sent (each waits for its response).
+    pub round_trips: usize,
+    /// The time taken to upload the image, not counting the reset request.
+    pub elapsed: Duration,
+    /// Whether the whole image was accepted, and the bootloader asked to reset.
+    pub complete: bool,
+}
+
+impl UploadStats {
+    pub fn bytes_per_sec(&self) -> f64 {
+        self.image_bytes as f64 / self.elapsed.as_secs_f64().max(1e-9)
+    }
+}
+
+/// Upload an image into the primary slot of image 0, then request a reset.  Intended to be run on
+/// a thread of its own, while the bootloader runs serial recovery on the other end of the port.
+/// Errors (such as the bootloader going away when the flash simulation stops it) end the upload,
+/// and are reflected in `complete`.
+pub fn upload(port: File, image: &[u8], config: SerialConfig, max_receive: usize) -> UploadStats {
+    let mut up = Uploader {
+        port,
+        seq: 0,
+        mtu: config.mtu,
+        stats: UploadStats {
+            image_bytes: image.len(),
+            .. Default::default()
+        },
+    };
+    match up.upload(image, config.chunk, max_receive) {
+        Ok(()) => up.stats.complete = true,
+        Err(err) => info!("Serial upload ended: {}", err),
+    }
+    up.stats
+}
+
+struct Uploader {
+    port: File,
+    seq: u8,
+    mtu: usize,
+    stats: UploadStats,
+}
+
+impl Uploader {
+    fn upload(&mut self, image: &[u8], chunk: usize, max_receive: usize) -> io::Result<()> {
+        let start = Instant::now();
+        let mut off = 0;
+        while off < image.len() {
+            let mut len = chunk.min(image.len() - off);
+            let payload = loop {
+                let payload = upload_request(image, off, len);
+                // The length, header, payload and CRC must fit in the receive buffer, and the
+                // decoder wants one spare byte.
+                let total = 2 + HDR_SIZE + payload.len() + 2;
+                if total < max_receive {
+                    break payload;
+                }
+                let excess = total - max_receive + 1;
+                if excess >= len {
+                    return Err(io::Error::new(io::ErrorKind::InvalidInput,
+                                              "chunk does not fit in a packet"));
+                }
+                len -= excess;
+            };
+
+            let rsp = self.request(MGMT_GROUP_ID_IMAGE, IMGMGR_NMGR_ID_UPLOAD, &payload)?;
+            let rc = cbor_map_int(&rsp, "rc").unwrap_or(0);
+            if rc != 0 {
+                return Err(io::Error::new(io::ErrorKind::Other,
+                                          format!("upload at {:#x} failed: rc={}", off, rc)));
+            }
+            let next = cbor_map_int(&rsp, "off").ok_or_else(|| {
+                io::Error::new(io::ErrorKind::InvalidData, "upload response without offset")
+            })? as usize;
+            if next <= off && len > 0 {
+                return Err(io::Error::new(io::ErrorKind::Other,
+                                          format!("upload stuck at {:#x}", off)));
+            }
+            off = next;
+        }
+        self.stats.elapsed = start.elapsed();
+
+        // The bootloader resets after responding, which ends the session.
+        let rsp = self.request(MGMT_GROUP_ID_DEFAULT, NMGR_ID_RESET, &[0xa0])?;
+        debug!("Reset response: rc={:?}", cbor_map_int(&rsp, "rc"));
+        Ok(())
+    }
+
+    /// Send a write request, and return the payload of its response.
+    fn request(&mut self, group: u16, id: u8, payload: &[u8]) -> io::Result<Vec<u8>> {
+        let mut pkt = Vec::with_capacity(HDR_SIZE + payload.len() + 2);
+        pkt.push(NMGR_OP_WRITE);
+        pkt.push(0);
+        pkt.extend_from_slice(&(payload.len() as u16).to_be_bytes());
+        pkt.extend_from_slice(&group.to_be_bytes());
+        pkt.push(self.seq);
+        pkt.push(id);
+        pkt.extend_from_slice(payload);
+        let crc = crc16(&pkt);
+        pkt.extend_from_slice(&crc.to_be_bytes());
+
+        let mut framed = (pkt.len() as u16).to_be_bytes().to_vec();
+        framed.extend_from_slice(&pkt);
+        let encoded = base64::encode(&framed);
+
+        // Each line is decoded on its own, so split on a multiple of 4 characters.
+        let per_line = ((self.mtu - 3) / 4 * 4).max(4);
+        let mut out = vec![];
+        for (i, part) in encoded.as_bytes().chunks(per_line).enumerate() {
+            out.extend_from_slice(if i == 0 { &SHELL_NLIP_PKT_START } else { &SHELL_NLIP_DATA_START });
+            out.extend_from_slice(part);
+            out.push(b'\n');
+        }
+        self.port.write_all(&out)?;
+        self.stats.line_bytes += out.len();
+        self.stats.round_trips += 1;
+
+        let rsp = self.response()?;
+        if rsp.len() < HDR_SIZE || rsp[6] != self.seq {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, "unexpected response"));
+        }
+        self.seq = self.seq.wrapping_add(1);
+        Ok(rsp[HDR_SIZE..].to_vec())
+    }
+
+    /// Read one response packet, returning it without the length and CRC.
+    fn response(&mut self) -> io::Result<Vec<u8>> {
+        let mut data: Vec<u8> = vec![];
+        loop {
+            let line = self.read_line()?;
+            if line.starts_with(&SHELL_NLIP_PKT_START) {
+                data.clear();
+            } else if !line.starts_with(&SHELL_NLIP_DATA_START) {
+                // Not part of a packet (e.g. console output).
+                continue;
+            }
+            let part = base64::decode(&line[2..]).map_err(|e| {
+                io::Error::new(io::ErrorKind::InvalidData, e.to_string())
+            })?;
+            data.extend_from_slice(&part);
+
+            if data.len() < 2 {
+                continue;
+            }
+            let len = u16::from_be_bytes([data[0], data[1]]) as usize;
+            if data.len() - 2 < len {
+                continue;
+            }
+            let pkt = &data[2..2 + len];
+            if pkt.len() < 2 || crc16(pkt) != 0 {
+                return Err(io::Error::new(io::ErrorKind::InvalidData, "bad response CRC"));
+            }
+            return Ok(pkt[..pkt.len() - 2].to_vec());
+        }
+    }
+
+    /// Read a line, without its newline.
+    fn read_line(&mut self) -> io::Result<Vec<u8>> {
+        let mut line = vec![];
+        let mut byte = [0u8; 1];
+        loop {
+            wait_readable(self.port.as_raw_fd())?;
+            if self.port.read(&mut byte)? == 0 {
+                return Err(io::ErrorKind::UnexpectedEof.into());
+            }
+            if byte[0] == b'\n' {
+                return Ok(line);
+            }
+            line.push(byte[0]);
+        }
+    }
+}
+
+fn wait_readable(fd: RawFd) -> io::Result<()> {
+    let mut pfd = libc::pollfd {
+        fd,
+        events: libc::POLLIN,
+        revents: 0,
+    };
+    match unsafe { libc::poll(&mut pfd, 1, RESPONSE_TIMEOUT_MS) } {
+        n if n < 0 => Err(io::Error::last_os_error()),
+        0 => Err(io::ErrorKind::TimedOut.into()),
+        _ => Ok(()),
+    }
+}
+
+/// The CRC16 (CCITT polynomial, zero initial value) used by the serial transport.
+fn crc16(data: &[u8]) -> u16 {
+    let mut crc = 0u16;
+    for &b in data {
+        crc ^= (b as u16) << 8;
+        for _ in 0..8 {
+            crc = if crc & 0x8000 != 0 { (crc << 1) ^ 0x1021 } else { crc << 1 };
+        }
+    }
+    crc
+}
+
+/// Encode an upload request for `len` bytes of the image at `off`.  The first request also gives
+/// the image number and its total length.
+fn upload_request(image: &[u8], off: usize, len: usize) -> Vec<u8> {
+    let mut buf = vec![];
+    let first = off == 0;
+    cbor_head(&mut buf, 5, if first { 4 } else { 2 });
+    if first {
+        cbor_text(&mut buf, "image");
+        cbor_head(&mut buf, 0, 0);
+        cbor_text(&mut buf, "len");
+        cbor_head(&mut buf, 0, image.len() as u64);
+    }
+    cbor_text(&mut buf, "off");
+    cbor_head(&mut buf, 0, off as u64);
+    cbor_text(&mut buf, "data");
+    cbor_head(&mut buf, 2, len as u64);
+    buf.extend_from_slice(&image[off..off + len]);
+    buf
+}
+
+fn cbor_head(buf: &mut Vec<u8>, major: u8, value: u64) {
+    let major = major << 5;
+    if value < 24 {
+        buf.push(major | value as u8);
+    } else if value <= 0xff {
+        buf.push(major | 24);
+        buf.push(value as u8);
+    } else if value <= 0xffff {
+        buf.push(major | 25);
+        buf.extend_from_slice(&(value as u16).to_be_bytes());
+    } else if value <= 0xffff_ffff {
+        buf.push(major | 26);
+        buf.extend_from_slice(&(value as u32).to_be_bytes());
+    } else {
+        buf.push(major | 27);
+        buf.extend_from_slice(&value.to_be_bytes());
+    }
+}
+
+fn cbor_text(buf: &mut Vec<u8>, text: &str) {
+    cbor_head(buf, 3, text.len() as u64);
+    buf.extend_from_slice(text.as_bytes());
+}
+
+/// Decode the head of a CBOR item, returning its major type and argument.
+fn cbor_read_head(data: &[u8], pos: &mut usize) -> Option<(u8, u64)> {
+    let first = *data.get(*pos)?;
+    *pos += 1;
+    let extra = match first & 0x1f {
+        n if n < 24 => return Some((first >> 5, n as u64)),
+        24 => 1,
+        25 => 2,
+        26 => 4,
+        27 => 8,
+        _ => return None,
+    };
+    let bytes = data.get(*pos .. *pos + extra)?;
+    *pos += extra;
+    Some((first >> 5, bytes.iter().fold(0u64, |acc, &b| (acc << 8) | b as u64)))
+}
+
+/// Look up an integer value in a CBOR map with text keys.  Only the simple items found in the
+/// bootloader's responses are understood.
+fn cbor_map_int(data: &[u8], key: &str) -> Option<i64> {
+    let mut pos = 0;
+    // zcbor encodes maps with an indefinite length, ended by a break.
+    let count = if data.first() == Some(&0xbf) {
+        pos += 1;
+        u64::MAX
+    } else {
+        match cbor_read_head(data, &mut pos)? {
+            (5, count) => count,
+            _ => return None,
+        }
+    };
+    for _ in 0..count {
+        if data.get(pos) == Some(&0xff) {
+            break;
+        }
+        let (kmajor, klen) = cbor_read_head(data, &mut pos)?;
+        if kmajor != 3 {
+            return None;
+        }
+        let k = data.get(pos .. pos + klen as usize)?;
+        pos += klen as usize;
+        let (vmajor, value) = cbor_read_head(data, &mut pos)?;
+        let result = match vmajor {
+            0 => Some(value as i64),
+            1 => Some(-1 - value as i64),
+            2 | 3 => {
+                pos += value as usize;
+                None
+            }
+            // true/false/null.
+            7 => None,
+            _ => return None,
+        };
+        if k == key.as_bytes() {
+            return result;
+        }
+    }
+    None
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn test_crc16() {
+        // The CRC-16/XMODEM check value.
+        assert_eq!(crc16(b"123456789"), 0x31c3);
+        let mut data = b"123456789".to_vec();
+        data.extend_from_slice(&0x31c3u16.to_be_bytes());
+        assert_eq!(crc16(&data), 0);
+    }
+
+    #[test]
+    fn test_cbor() {
+        let image = vec![0x55u8; 0x10000];
+        let req = upload_request(&image, 0, 300);
+        assert_eq!(cbor_map_int(&req, "len"), Some(0x10000));
+        assert_eq!(cbor_map_int(&req, "off"), Some(0));
+        assert_eq!(cbor_map_int(&req, "image"), Some(0));
+        assert_eq!(cbor_map_int(&req, "missing"), None);
+
+        let req = upload_request(&image, 0x10000 - 44, 44);
+        assert_eq!(cbor_map_int(&req, "off"), Some(0x10000 - 44));
+        assert_eq!(cbor_map_int(&req, "len"), None);
+
+        // { "rc": -3 }
+        assert_eq!(cbor_map_int(&[0xa1, 0x62, b'r', b'c', 0x22], "rc"), Some(-3));
+        // { "rc": 0, "off": 512 }, as encoded by zcbor.
+        let rsp = [0xbf, 0x62, b'r', b'c', 0x00, 0x63, b'o', b'f', b'f', 0x19, 0x02, 0x00, 0xff];
+        assert_eq!(cbor_map_int(&rsp, "off"), Some(512));
+        assert_eq!(cbor_map_int(&rsp, "len"), None);
+    }
+}
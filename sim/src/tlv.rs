@@ -52,16 +52,20 @@ pub enum TlvKinds {
     KEYHASH = 0x01,
     SHA256 = 0x10,
     SHA384 = 0x11,
+    HASHTREE = 0x13,
     RSA2048 = 0x20,
     ECDSASIG = 0x22,
     RSA3072 = 0x23,
     ED25519 = 0x24,
+    SIGPURE = 0x25,
     ENCRSA2048 = 0x30,
     ENCKW = 0x31,
     ENCEC256 = 0x32,
     ENCX25519 = 0x33,
     DEPENDENCY = 0x40,
     SECCNT = 0x50,
+    DELTABASE = 0x74,
+    DELTATARGET = 0x75,
 }
 
 #[allow(dead_code, non_camel_case_types)]
@@ -71,6 +75,7 @@ pub enum TlvFlags {
     ENCRYPTED_AES128 = 0x04,
     ENCRYPTED_AES256 = 0x08,
     RAM_LOAD = 0x20,
+    DELTA = 0x1000,
 }
 
 /// A generator for manifests.  The format of the manifest can be either a
@@ -118,6 +123,11 @@ pub trait ManifestGen {
     /// Sets the ignore_ram_load_flag so that can be validated when it is missing,
     /// it will not load successfully.
     fn set_ignore_ram_load_flag(&mut self);
+
+    /// Make this a delta image, whose payload is a patch from the `base` image to the `target`
+    /// one, both whole images.
+    #[cfg_attr(not(feature = "delta"), allow(dead_code))]
+    fn set_delta(&mut self, base: &[u8], target: &[u8]);
 }
 
 #[derive(Debug, Default)]
@@ -132,6 +142,8 @@ pub struct TlvGen {
     security_cnt: Option<u32>,
     /// Ignore RAM_LOAD flag
     ignore_ram_load_flag: bool,
+    /// Size and hash of the base and the target of a delta image.
+    delta: Option<(Vec<u8>, Vec<u8>)>,
 }
 
 #[derive(Debug)]
@@ -345,7 +357,8 @@ impl ManifestGen for TlvGen {
 
     fn protect_size(&self) -> u16 {
         let mut size = 0;
-        if !self.dependencies.is_empty() || (Caps::HwRollbackProtection.present() && self.security_cnt.is_some()) {
+        if !self.dependencies.is_empty() || (Caps::HwRollbackProtection.present() && self.security_cnt.is_some()) ||
+            self.delta.is_some() {
             // include the TLV area header.
             size += 4;
             // add space for each dependency.
@@ -353,6 +366,9 @@ impl ManifestGen for TlvGen {
             if Caps::HwRollbackProtection.present() && self.security_cnt.is_some() {
                 size += 4 + 4;
             }
+            if let Some((base, target)) = &self.delta {
+                size += 4 + base.len() as u16 + 4 + target.len() as u16;
+            }
         }
         size
     }
@@ -379,6 +395,15 @@ impl ManifestGen for TlvGen {
         } else if self.kinds.contains(&TlvKinds::SHA384) {
             estimate += 4 + 48;
         }
+        if cfg!(feature = "hash-tree") {
+            // The leaf size, and the digests of the leaves after the first,
+            // which is counted as the hash above.  Before the payload is
+            // added, the space of those digests is left to the caller.
+            let len = self.payload.len() + self.protect_size() as usize;
+            let leaf_size = hash_tree_leaf_size(len);
+            let leaves = (len + leaf_size - 1) / leaf_size;
+            estimate += 4 + 32 * leaves.saturating_sub(1);
+        }
 
         // Add an estimate in for each of the signature algorithms.
         if self.kinds.contains(&TlvKinds::RSA2048) {
@@ -392,6 +417,9 @@ impl ManifestGen for TlvGen {
         if self.kinds.contains(&TlvKinds::ED25519) {
             estimate += 4 + 32; // keyhash
             estimate += 4 + 64; // ED25519 signature.
+            if cfg!(feature = "sig-pure") {
+                estimate += 4 + 1; // SIG_PURE
+            }
         }
         if self.kinds.contains(&TlvKinds::ECDSASIG) {
             // ECDSA signatures are encoded as ASN.1 with the x and y values
@@ -462,6 +490,14 @@ impl ManifestGen for TlvGen {
                 protected_tlv.write_u32::<LittleEndian>(self.security_cnt.unwrap() as u32).unwrap();
             }
 
+            if let Some((base, target)) = &self.delta {
+                for (kind, image) in &[(TlvKinds::DELTABASE, base), (TlvKinds::DELTATARGET, target)] {
+                    protected_tlv.write_u16::<LittleEndian>(*kind as u16).unwrap();
+                    protected_tlv.write_u16::<LittleEndian>(image.len() as u16).unwrap();
+                    protected_tlv.extend_from_slice(image);
+                }
+            }
+
             assert_eq!(size, protected_tlv.len() as u16, "protected TLV length incorrect");
         }
 
@@ -505,21 +541,34 @@ impl ManifestGen for TlvGen {
             if corrupt_hash {
                 sig_payload[0] ^= 1;
             }
-            let (hash,hash_size,tlv_kind) =  if self.kinds.contains(&TlvKinds::SHA256)
-            {
-                let hash = digest::digest(&digest::SHA256, &sig_payload);
-                (hash,32,TlvKinds::SHA256)
+            if cfg!(feature = "hash-tree") {
+                // The leaf size and the digests of the leaves replace the
+                // hash.  The root they make up is what gets signed.
+                let leaf_size = hash_tree_leaf_size(sig_payload.len());
+                let leaves = hash_tree_leaves(&sig_payload, leaf_size);
+                result.write_u16::<LittleEndian>(TlvKinds::HASHTREE as u16).unwrap();
+                result.write_u16::<LittleEndian>(4 + 32 * leaves.len() as u16).unwrap();
+                result.write_u32::<LittleEndian>(leaf_size as u32).unwrap();
+                for leaf in &leaves {
+                    result.extend_from_slice(leaf);
+                }
+            } else {
+                let (hash,hash_size,tlv_kind) =  if self.kinds.contains(&TlvKinds::SHA256)
+                {
+                    let hash = digest::digest(&digest::SHA256, &sig_payload);
+                    (hash,32,TlvKinds::SHA256)
+                }
+                else {
+                    let hash = digest::digest(&digest::SHA384, &sig_payload);
+                    (hash,48,TlvKinds::SHA384)
+                };
+                let hash = hash.as_ref();
+
+                assert!(hash.len() == hash_size);
+                result.write_u16::<LittleEndian>(tlv_kind as u16).unwrap();
+                result.write_u16::<LittleEndian>(hash_size as u16).unwrap();
+                result.extend_from_slice(hash);
             }
-            else {
-                let hash = digest::digest(&digest::SHA384, &sig_payload);
-                (hash,48,TlvKinds::SHA384)
-            };
-            let hash = hash.as_ref();
-
-            assert!(hash.len() == hash_size);
-            result.write_u16::<LittleEndian>(tlv_kind as u16).unwrap();
-            result.write_u16::<LittleEndian>(hash_size as u16).unwrap();
-            result.extend_from_slice(hash);
 
             // Undo the corruption.
             if corrupt_hash {
@@ -553,21 +602,7 @@ impl ManifestGen for TlvGen {
             result.extend_from_slice(hash);
 
             // For now assume PSS.
-            let key_bytes = if is_rsa2048 {
-                pem::parse(include_bytes!("../../root-rsa-2048.pem").as_ref()).unwrap()
-            } else {
-                pem::parse(include_bytes!("../../root-rsa-3072.pem").as_ref()).unwrap()
-            };
-            assert_eq!(key_bytes.tag, "RSA PRIVATE KEY");
-            let key_pair = RsaKeyPair::from_der(&key_bytes.contents).unwrap();
-            let rng = rand::SystemRandom::new();
-            let mut signature = vec![0; key_pair.public_modulus_len()];
-            if is_rsa2048 {
-                assert_eq!(signature.len(), 256);
-            } else {
-                assert_eq!(signature.len(), 384);
-            }
-            key_pair.sign(&RSA_PSS_SHA256, &rng, &sig_payload, &mut signature).unwrap();
+            let signature = rsa_sign(&sig_payload, !is_rsa2048);
 
             if is_rsa2048 {
                 result.write_u16::<LittleEndian>(TlvKinds::RSA2048 as u16).unwrap();
@@ -654,20 +689,26 @@ impl ManifestGen for TlvGen {
             result.write_u16::<LittleEndian>(32).unwrap();
             result.extend_from_slice(keyhash);
 
-            let hash = digest::digest(&digest::SHA256, &sig_payload);
-            let hash = hash.as_ref();
-            assert!(hash.len() == 32);
+            // A pure signature is over the signed payload itself, and is
+            // marked by the SIG_PURE TLV.
+            let signature = if cfg!(feature = "sig-pure") {
+                result.write_u16::<LittleEndian>(TlvKinds::SIGPURE as u16).unwrap();
+                result.write_u16::<LittleEndian>(1).unwrap();
+                result.push(1);
 
-            let key_bytes = pem::parse(include_bytes!("../../root-ed25519.pem").as_ref()).unwrap();
-            assert_eq!(key_bytes.tag, "PRIVATE KEY");
+                ed25519_sign(&sig_payload)
+            } else if cfg!(feature = "hash-tree") {
+                ed25519_sign(&hash_tree_root(&sig_payload, hash_tree_leaf_size(sig_payload.len())))
+            } else {
+                let hash = digest::digest(&digest::SHA256, &sig_payload);
+                let hash = hash.as_ref();
+                assert!(hash.len() == 32);
 
-            let key_pair = Ed25519KeyPair::from_seed_and_public_key(
-                &key_bytes.contents[16..48], &ED25519_PUB_KEY[12..44]).unwrap();
-            let signature = key_pair.sign(&hash);
+                ed25519_sign(&hash)
+            };
 
             result.write_u16::<LittleEndian>(TlvKinds::ED25519 as u16).unwrap();
 
-            let signature = signature.as_ref().to_vec();
             result.write_u16::<LittleEndian>(signature.len() as u16).unwrap();
             result.extend_from_slice(signature.as_ref());
         }
@@ -855,6 +896,107 @@ impl ManifestGen for TlvGen {
     fn set_ignore_ram_load_flag(&mut self) {
         self.ignore_ram_load_flag = true;
     }
+
+    fn set_delta(&mut self, base: &[u8], target: &[u8]) {
+        // The images are hashed as bootutil does, which is with SHA384 along with the P-384
+        // signatures and with SHA256 otherwise.
+        let algorithm = if self.kinds.contains(&TlvKinds::SHA384) {
+            &digest::SHA384
+        } else {
+            &digest::SHA256
+        };
+        let describe = |image: &[u8]| {
+            let mut tlv = vec![];
+            tlv.write_u32::<LittleEndian>(image.len() as u32).unwrap();
+            tlv.extend_from_slice(digest::digest(algorithm, image).as_ref());
+            tlv
+        };
+        self.flags |= TlvFlags::DELTA as u32;
+        self.delta = Some((describe(base), describe(target)));
+    }
+}
+
+/// Sign a message with the simulator's ED25519 key.
+pub fn ed25519_sign(msg: &[u8]) -> [u8; 64] {
+    let key_bytes = pem::parse(include_bytes!("../../root-ed25519.pem").as_ref()).unwrap();
+    assert_eq!(key_bytes.tag, "PRIVATE KEY");
+
+    let key_pair = Ed25519KeyPair::from_seed_and_public_key(
+        &key_bytes.contents[16..48], &ED25519_PUB_KEY[12..44]).unwrap();
+    key_pair.sign(msg).as_ref().try_into().unwrap()
+}
+
+/// Smallest size of the leaves of the tree hash of the images, with the
+/// hash-tree feature.
+pub const HASH_TREE_LEAF: usize = 1024;
+
+/// Most leaves of the tree hash of an image, whose digests are all in its
+/// TLV.
+pub const HASH_TREE_MAX_LEAVES: usize = 1024;
+
+/// Size of the leaves of the tree hash of `len` bytes of image: HASH_TREE_LEAF,
+/// doubled until there are at most HASH_TREE_MAX_LEAVES of them.
+pub fn hash_tree_leaf_size(len: usize) -> usize {
+    let mut leaf_size = HASH_TREE_LEAF;
+    while len > leaf_size * HASH_TREE_MAX_LEAVES {
+        leaf_size *= 2;
+    }
+    leaf_size
+}
+
+fn hash_tree_hash(parts: &[&[u8]]) -> Vec<u8> {
+    let mut ctx = digest::Context::new(&digest::SHA256);
+    for part in parts {
+        ctx.update(part);
+    }
+    ctx.finish().as_ref().to_vec()
+}
+
+/// SHA-256 digests of the leaves of `leaf_size` bytes of `data`, as in
+/// bootutil/hash_tree.h.
+pub fn hash_tree_leaves(data: &[u8], leaf_size: usize) -> Vec<Vec<u8>> {
+    data.chunks(leaf_size)
+        .map(|leaf| hash_tree_hash(&[&[0x00], leaf]))
+        .collect()
+}
+
+/// Root of the SHA-256 tree hash of `data` with leaves of `leaf_size` bytes,
+/// as in bootutil/hash_tree.h.
+pub fn hash_tree_root(data: &[u8], leaf_size: usize) -> Vec<u8> {
+    hash_tree_root_of(&hash_tree_leaves(data, leaf_size), leaf_size)
+}
+
+/// Root of a SHA-256 tree hash with leaves of `leaf_size` bytes, from the
+/// digests of its leaves.
+pub fn hash_tree_root_of(leaves: &[Vec<u8>], leaf_size: usize) -> Vec<u8> {
+    fn node(leaves: &[Vec<u8>]) -> Vec<u8> {
+        if leaves.len() == 1 {
+            return leaves[0].clone();
+        }
+        let mut split = 1;
+        while split * 2 < leaves.len() {
+            split *= 2;
+        }
+        hash_tree_hash(&[&[0x01], &node(&leaves[..split]), &node(&leaves[split..])])
+    }
+
+    hash_tree_hash(&[&[0x02], &(leaf_size as u32).to_le_bytes(), &node(leaves)])
+}
+
+/// Sign `msg` with RSA-PSS and SHA-256, with the RSA 2048 or 3072 root key.
+pub fn rsa_sign(msg: &[u8], rsa3072: bool) -> Vec<u8> {
+    let key_bytes = if rsa3072 {
+        pem::parse(include_bytes!("../../root-rsa-3072.pem").as_ref()).unwrap()
+    } else {
+        pem::parse(include_bytes!("../../root-rsa-2048.pem").as_ref()).unwrap()
+    };
+    assert_eq!(key_bytes.tag, "RSA PRIVATE KEY");
+    let key_pair = RsaKeyPair::from_der(&key_bytes.contents).unwrap();
+    let rng = rand::SystemRandom::new();
+    let mut signature = vec![0; key_pair.public_modulus_len()];
+    assert_eq!(signature.len(), if rsa3072 { 384 } else { 256 });
+    key_pair.sign(&RSA_PSS_SHA256, &rng, msg, &mut signature).unwrap();
+    signature
 }
 
 include!("rsa_pub_key-rs.txt");
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: Apache-2.0
+
+//! Inspect flash operation traces recorded by the tests (see `MCUBOOT_TRACE` in tests/core.rs).
+
+use simflash::{
+    Result,
+    trace::{self, Trace, TraceDiff, phase_name},
+};
+
+fn select(traces: &[Trace], boot: usize) -> Result<&Trace> {
+    traces.get(boot).ok_or_else(|| {
+        simflash::FlashError::Trace(format!("no boot {} (file has {})", boot, traces.len()))
+    })
+}
+
+/// Print every operation of one or all of the boots in a trace file.
+pub fn show(path: &str, boot: Option<usize>) -> Result<()> {
+    let traces = trace::read_traces(path)?;
+    for (num, t) in traces.iter().enumerate() {
+        if boot.map_or(false, |sel| sel != num) {
+            continue;
+        }
+        println!("boot {}: {} operations", num, t.records.len());
+        let mut counted = 0;
+        for (i, rec) in t.records.iter().enumerate() {
+            if rec.op.is_counted() {
+                counted += 1;
+                println!("{:6} stop={:<6} {}", i, counted, rec);
+            } else {
+                println!("{:6} {:11} {}", i, "", rec);
+            }
+        }
+        for ((phase, op), (count, bytes)) in t.summary() {
+            println!("  {:>8} {:?}: {} ops, {} bytes", phase_name(phase), op, count, bytes);
+        }
+    }
+    Ok(())
+}
+
+/// Reconstruct the flash after `index` operations of a given boot, and write the device(s) out
+/// the same way as `Images::debug_dump`.
+pub fn replay(path: &str, boot: usize, index: usize, prefix: &str) -> Result<()> {
+    let traces = trace::read_traces(path)?;
+    let flash = select(&traces, boot)?.replay(index)?;
+    for (id, fdev) in &flash {
+        let name = if flash.len() == 1 {
+            format!("{}.mcubin", prefix)
+        } else {
+            format!("{}-{:>0}.mcubin", prefix, id)
+        };
+        fdev.write_file(&name)?;
+    }
+    Ok(())
+}
+
+/// Compare two trace files, boot by boot.
+pub fn diff(path_a: &str, path_b: &str, boot: Option<usize>) -> Result<()> {
+    let a = trace::read_traces(path_a)?;
+    let b = trace::read_traces(path_b)?;
+    if a.len() != b.len() {
+        println!("number of boots differ: {} vs {}", a.len(), b.len());
+    }
+    for num in 0 .. a.len().min(b.len()) {
+        if boot.map_or(false, |sel| sel != num) {
+            continue;
+        }
+        println!("boot {}: {}", num, TraceDiff::new(select(&a, num)?, select(&b, num)?));
+    }
+    Ok(())
+}
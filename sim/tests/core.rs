@@ -18,6 +18,7 @@ use bootsim::{
     ImageManipulation
 };
 use std::{
+    cell::Cell,
     env,
     sync::atomic::{AtomicUsize, Ordering},
 };
@@ -44,7 +45,10 @@ macro_rules! sim_test {
         test_shell!($name, r, {
             let image = r.$maker($($margs),*);
             dump_image(&image, stringify!($name));
-            assert!(!image.$test($($targs),*));
+            let trace = trace_begin(stringify!($name));
+            let failed = image.$test($($targs),*);
+            trace_end(trace);
+            assert!(!failed);
         });
     };
 }
@@ -64,6 +68,36 @@ sim_test!(oversized_secondary_slot, make_oversized_secondary_slot_image(), run_o
 sim_test!(status_write_fails_complete, make_image(&NO_DEPS, true), run_with_status_fails_complete());
 sim_test!(status_write_fails_with_reset, make_image(&NO_DEPS, true), run_with_status_fails_with_reset());
 sim_test!(downgrade_prevention, make_image(&REV_DEPS, true), run_nodowngrade());
+sim_test!(trailer_writes, make_image(&NO_DEPS, true), run_trailer_writes());
+#[cfg(feature = "image-extent")]
+sim_test!(scramble_extent, make_small_bad_secondary_slot_image(), run_scramble_extent());
+#[cfg(feature = "erase-range")]
+sim_test!(erase_range, make_bad_secondary_slot_image(), run_erase_range());
+#[cfg(feature = "overwrite-resume")]
+sim_test!(overwrite_resume, make_image(&NO_DEPS, true), run_overwrite_resume());
+#[cfg(feature = "flash-async")]
+sim_test!(flash_async, make_image(&NO_DEPS, true), run_flash_async());
+#[cfg(feature = "swap-move-batch")]
+sim_test!(swap_move_batch, make_image(&NO_DEPS, true), run_swap_move_batch());
+#[cfg(feature = "scratch-wear-leveling")]
+sim_test!(scratch_wear_leveling, make_image(&NO_DEPS, true), run_scratch_wear_leveling());
+#[cfg(feature = "slot-snapshot")]
+sim_test!(slot_snapshot, make_no_upgrade_image(&NO_DEPS, ImageManipulation::None), run_slot_snapshot());
+#[cfg(feature = "hash-tree")]
+sim_test!(hash_tree_bad_leaf, make_no_upgrade_image(&NO_DEPS, ImageManipulation::None),
+          run_hash_tree_bad_leaf());
+
+#[cfg(feature = "serial-recovery")]
+sim_test!(serial_recovery, make_no_upgrade_image(&NO_DEPS, ImageManipulation::None),
+          run_serial_recovery());
+#[cfg(feature = "serial-recovery")]
+sim_test!(serial_throughput, make_no_upgrade_image(&NO_DEPS, ImageManipulation::None),
+          run_serial_throughput());
+
+#[cfg(feature = "large-geometry")]
+test_shell!(upgrade_scaling, r, {
+    assert!(!r.run_upgrade_scaling());
+});
 
 sim_test!(direct_xip_first, make_no_upgrade_image(&NO_DEPS, ImageManipulation::None), run_direct_xip());
 sim_test!(ram_load_first, make_no_upgrade_image(&NO_DEPS, ImageManipulation::None), run_ram_load());
@@ -95,6 +129,315 @@ test_shell!(dependency_combos, r, {
     }
 });
 
+// Report the RAM used by the bootloader in this configuration: the static
+// data and bss, and the deepest stack reached while upgrading and reverting on
+// each device.  Setting MCUBOOT_STACK_LIMIT or MCUBOOT_STATIC_RAM_LIMIT (in
+// bytes) turns these into regression checks.
+#[test]
+fn ram_usage() {
+    testlog::setup();
+
+    let peak = Cell::new(0);
+    ImagesBuilder::each_device(|r| {
+        let image = r.make_image(&NO_DEPS, true);
+        c::take_stack_peak();
+        assert!(!image.run_basic_revert());
+        peak.set(peak.get().max(c::take_stack_peak()));
+    });
+
+    let (data, bss) = c::static_ram_usage();
+    println!("ram usage: data {} bss {} stack {}", data, bss, peak.get());
+    if let Some(limit) = env_limit("MCUBOOT_STATIC_RAM_LIMIT") {
+        assert!(data + bss <= limit, "static RAM {} exceeds {}", data + bss, limit);
+    }
+    if let Some(limit) = env_limit("MCUBOOT_STACK_LIMIT") {
+        assert!(peak.get() <= limit, "stack use {} exceeds {}", peak.get(), limit);
+    }
+}
+
+// Compare the time of an ED25519 verification with the generic double-scalar
+// multiplication and with the comb table of the key.
+#[cfg(feature = "ed25519-comb")]
+#[test]
+fn ed25519_verify_speed() {
+    testlog::setup();
+
+    let msg = [0xa5u8; 32];
+    let sig = bootsim::ed25519_sign(&msg);
+    let generic = c::ed25519_verify_time(&msg, &sig, false, 200)
+        .expect("generic verification failed");
+    let comb = c::ed25519_verify_time(&msg, &sig, true, 200)
+        .expect("comb verification failed");
+    println!("ed25519 verify: generic {} ns, comb {} ns", generic, comb);
+
+    let mut bad_sig = sig;
+    bad_sig[0] ^= 1;
+    assert!(c::ed25519_verify_time(&msg, &bad_sig, true, 1).is_none());
+}
+
+// Compare the time of verifying the signatures of four images one by one and
+// as a batch, and check that a batch with one bad signature fails.
+#[cfg(feature = "batch-verify")]
+#[test]
+fn ed25519_batch_verify() {
+    testlog::setup();
+
+    let msgs: Vec<[u8; 32]> = (0..4u8).map(|i| [0xa5 ^ i; 32]).collect();
+    let sigs: Vec<[u8; 64]> = msgs.iter().map(|m| bootsim::ed25519_sign(m)).collect();
+    let single = c::ed25519_verify_batch_time(&msgs, &sigs, false, 50)
+        .expect("single verification failed");
+    let batch = c::ed25519_verify_batch_time(&msgs, &sigs, true, 50)
+        .expect("batch verification failed");
+    println!("ed25519 verify of {} images: single {} ns, batch {} ns",
+             msgs.len(), single, batch);
+
+    for i in 0..sigs.len() {
+        let mut bad_sigs = sigs.clone();
+        bad_sigs[i][40] ^= 1;
+        assert!(c::ed25519_verify_batch_time(&msgs, &bad_sigs, true, 1).is_none());
+    }
+}
+
+// Compare the time of the RSA public operation with Mbed TLS and with the
+// Montgomery constants of the key, which must give the same result.
+#[cfg(feature = "rsa-mont")]
+#[test]
+fn rsa_mont_speed() {
+    testlog::setup();
+
+    let sig = bootsim::rsa_sign(&[0xa5u8; 32], cfg!(feature = "sig-rsa3072"));
+    let (generic, em) = c::rsa_public_time(&sig, false, 50)
+        .expect("generic RSA public operation failed");
+    let (mont, mont_em) = c::rsa_public_time(&sig, true, 50)
+        .expect("Montgomery RSA public operation failed");
+    println!("rsa public: generic {} ns, mont {} ns", generic, mont);
+    assert_eq!(em, mont_em);
+    assert_eq!(em.last(), Some(&0xbc));
+
+    // The signature must be less than the modulus.
+    let bad_sig = vec![0xffu8; sig.len()];
+    assert!(c::rsa_public_time(&bad_sig, true, 1).is_none());
+}
+
+// Check every SHA kernel the host can run against ring, for lengths around
+// the block boundaries and updates of various sizes, and report its speed.
+#[cfg(any(feature = "sha-kernel", feature = "sha-kernel-unroll"))]
+#[test]
+fn sha_kernels() {
+    use ring::digest;
+
+    testlog::setup();
+
+    let data: Vec<u8> = (0..65536u32).map(|i| (i * 131 + 7) as u8).collect();
+    let algs = [(256, &digest::SHA256), (384, &digest::SHA384), (512, &digest::SHA512)];
+
+    let mut kernel = 0;
+    while let Some(name) = c::sha_kernel_name(kernel) {
+        for &(bits, alg) in &algs {
+            for &len in &[0, 1, 55, 56, 64, 111, 112, 128, 129, 1000, 4099] {
+                let expected = digest::digest(alg, &data[..len]);
+                for &chunk in &[1, 7, 64, 1000] {
+                    let got = match c::sha_time(kernel, bits, &data[..len], chunk, 1) {
+                        Some((_, got)) => got,
+                        None => break,
+                    };
+                    assert_eq!(got, expected.as_ref(),
+                               "{} SHA-{} of {} bytes in {} byte updates", name, bits, len,
+                               chunk);
+                }
+            }
+
+            if let Some((ns, _)) = c::sha_time(kernel, bits, &data, 4096, 20) {
+                println!("sha{} {}: {} MB/s", bits, name, data.len() as u64 * 1000 / ns);
+            }
+        }
+        kernel += 1;
+    }
+}
+
+// Check the tree hash of the bootloader against the one the simulator signs
+// the images with, and time it.
+#[cfg(feature = "hash-tree")]
+#[test]
+fn hash_tree() {
+    testlog::setup();
+
+    let leaf = bootsim::HASH_TREE_LEAF;
+    let data: Vec<u8> = (0..65536u32).map(|i| (i * 131 + 7) as u8).collect();
+
+    for &len in &[1, leaf - 1, leaf, leaf + 1, 3 * leaf, 5 * leaf + 7, data.len()] {
+        let expected = bootsim::hash_tree_root(&data[..len], leaf);
+        let (_, root) = c::hash_tree_time(&data[..len], leaf as u32, 1)
+            .expect("tree hash failed");
+        assert_eq!(root, expected, "tree hash of {} bytes", len);
+    }
+
+    let (ns, _) = c::hash_tree_time(&data, leaf as u32, 20).unwrap();
+    println!("tree hash of {} bytes: {} ns", data.len(), ns);
+}
+
+// Upgrade with the image hash, and the AES of encrypted images, run as jobs
+// on the worker thread of the simulator, and check that they were.
+#[cfg(feature = "crypto-async")]
+test_shell!(crypto_async, r, {
+    let image = r.make_image(&NO_DEPS, true);
+    let jobs = c::crypto_async_jobs();
+    assert!(!image.run_norevert());
+    assert!(c::crypto_async_jobs() > jobs, "no crypto job was submitted");
+});
+
+// Upgrade every device that has room for it with a delta image, interrupted at
+// each point of the upgrade.  The image the delta image is built into must end
+// up in the primary slot, whether the boot is interrupted while building it in
+// the secondary slot or while copying it.
+#[cfg(feature = "delta")]
+#[test]
+fn delta_upgrade() {
+    testlog::setup();
+
+    let upgraded = Cell::new(0);
+    ImagesBuilder::each_device(|r| {
+        if let Some(image) = r.make_delta_image() {
+            assert!(!image.run_perm_with_fails());
+            upgraded.set(upgraded.get() + 1);
+        }
+    });
+    assert!(upgraded.get() > 0, "no device had room for a delta image");
+}
+
+// Time the crypto primitives bootutil is built with over a few input sizes,
+// checking their results against ring and the TLVs the simulator makes, and
+// print a "crypto-bench <backend> <primitive> <bytes> <ns> ns" line for each of
+// them.
+#[cfg(feature = "crypto-bench")]
+#[test]
+fn crypto_bench() {
+    use aes::{Aes128, Aes128Ctr, Aes256, Aes256Ctr, NewBlockCipher};
+    use cipher::{generic_array::GenericArray, FromBlockCipher, StreamCipher};
+    use ring::{digest, hkdf, hmac};
+
+    struct OkmLen(usize);
+
+    impl hkdf::KeyType for OkmLen {
+        fn len(&self) -> usize {
+            self.0
+        }
+    }
+
+    testlog::setup();
+
+    let backend = c::crypto_backend();
+    let report = |primitive: &str, bytes: usize, ns: u64| {
+        println!("crypto-bench {} {} {} {} ns", backend, primitive, bytes, ns);
+    };
+    // About 1 MB of input for each size, and at least 8 iterations.
+    let iterations = |bytes: usize| ((1 << 20) / bytes).max(8) as u32;
+    let sizes = [64, 1024, 16384, 65536];
+    let data: Vec<u8> = (0..65536u32).map(|i| (i * 131 + 7) as u8).collect();
+
+    let (sha, sha_name) = if cfg!(feature = "sig-p384") {
+        (&digest::SHA384, "sha384")
+    } else {
+        (&digest::SHA256, "sha256")
+    };
+    for &len in &sizes {
+        let (ns, got) = c::bootutil_sha_time(&data[..len], sha.output_len, iterations(len));
+        assert_eq!(got, digest::digest(sha, &data[..len]).as_ref(), "{} of {} bytes",
+                   sha_name, len);
+        report(sha_name, len, ns);
+    }
+
+    // The TLVs of a payload, as they are in an image.
+    let (manifest, enc_key) = bootsim::make_manifest(&data[..4096]);
+    assert_eq!(&manifest[..2], &[0x07, 0x69]);
+    let mut tlvs = vec![];
+    let mut off = 4;
+    while off < manifest.len() {
+        let kind = u16::from_le_bytes([manifest[off], manifest[off + 1]]);
+        let len = u16::from_le_bytes([manifest[off + 2], manifest[off + 3]]) as usize;
+        tlvs.push((kind, &manifest[off + 4..off + 4 + len]));
+        off += 4 + len;
+    }
+    let find = |kinds: &[(u16, &'static str)]| {
+        tlvs.iter().find_map(|&(kind, value)| {
+            kinds.iter().find(|k| k.0 == kind).map(|k| (k.1, value))
+        })
+    };
+
+    let hash = match find(&[(0x10, "sha256"), (0x11, "sha384"), (0x13, "hash-tree")]) {
+        // The root of a tree hash is that of the leaf digests after the
+        // leaf size.
+        Some(("hash-tree", value)) => {
+            let leaf_size = u32::from_le_bytes([value[0], value[1], value[2], value[3]]);
+            let leaves: Vec<Vec<u8>> = value[4..].chunks(32).map(|d| d.to_vec()).collect();
+            bootsim::hash_tree_root_of(&leaves, leaf_size as usize)
+        }
+        Some((_, value)) => value.to_vec(),
+        None => vec![],
+    };
+    let sig = find(&[(0x20, "rsa2048"), (0x22, "ecdsa"), (0x23, "rsa3072"),
+                     (0x24, "ed25519")]);
+    if let (Some((name, sig)), false) = (sig, cfg!(feature = "sig-pure")) {
+        let ns = c::verify_sig_time(&hash, sig, 20).expect("signature did not verify");
+        report(&format!("verify-{}", name), hash.len(), ns);
+
+        let mut bad_hash = hash.clone();
+        bad_hash[0] ^= 1;
+        assert!(c::verify_sig_time(&bad_hash, sig, 1).is_none());
+    }
+
+    let enc = find(&[(0x30, "rsa-oaep"), (0x31, "kw"), (0x32, "ecies-p256"),
+                     (0x33, "ecies-x25519")]);
+    if let Some((name, tlv)) = enc {
+        let (ns, key) = c::enc_unwrap_time(tlv, enc_key.len(), 10)
+            .expect("key unwrap failed");
+        assert_eq!(key, enc_key);
+        report(&format!("unwrap-{}", name), tlv.len(), ns);
+
+        let aes_name = format!("aes{}-ctr", enc_key.len() * 8);
+        for &len in &sizes {
+            let (ns, got) = c::aes_ctr_time(&enc_key, &data[..len], iterations(len))
+                .expect("AES-CTR failed");
+            let mut expected = data[..len].to_vec();
+            let nonce = GenericArray::from_slice(&[0; 16]);
+            if enc_key.len() == 32 {
+                let block = Aes256::new(GenericArray::from_slice(&enc_key));
+                Aes256Ctr::from_block_cipher(block, nonce).apply_keystream(&mut expected);
+            } else {
+                let block = Aes128::new(GenericArray::from_slice(&enc_key));
+                Aes128Ctr::from_block_cipher(block, nonce).apply_keystream(&mut expected);
+            }
+            assert_eq!(got, expected, "{} of {} bytes", aes_name, len);
+            report(&aes_name, len, ns);
+        }
+    }
+
+    // The HMAC and the HKDF of the ECIES key unwraps.
+    if let Some(("ecies-p256", _)) | Some(("ecies-x25519", _)) = enc {
+        let key = &data[1000..1032];
+        for &len in &sizes {
+            let (ns, mac) = c::hmac_sha256_time(key, &data[..len], iterations(len))
+                .expect("HMAC-SHA256 failed");
+            let expected = hmac::sign(&hmac::Key::new(hmac::HMAC_SHA256, key), &data[..len]);
+            assert_eq!(mac, expected.as_ref(), "HMAC-SHA256 of {} bytes", len);
+            report("hmac-sha256", len, ns);
+        }
+
+        let okm_len = enc_key.len() + 32;
+        let (ns, okm) = c::hkdf_time(key, okm_len, 1000).expect("HKDF failed");
+        let prk = hkdf::Salt::new(hkdf::HKDF_SHA256, &[]).extract(key);
+        let mut expected = vec![0u8; okm_len];
+        prk.expand(&[b"MCUBoot_ECIES_v1"], OkmLen(okm_len)).unwrap()
+            .fill(&mut expected).unwrap();
+        assert_eq!(okm, expected);
+        report("hkdf-sha256", okm_len, ns);
+    }
+}
+
+fn env_limit(name: &str) -> Option<usize> {
+    env::var(name).ok().map(|v| v.parse().expect("limit must be a number of bytes"))
+}
+
 /// These are the variants of dependencies we will test.
 pub static TEST_DEPS: &[DepTest] = &[
     // A sanity test, no dependencies should upgrade.
@@ -199,3 +542,31 @@ fn dump_image(image: &Images, name: &str) {
         }
     }
 }
+
+/// Start recording flash operation traces, if the MCUBOOT_TRACE environment
+/// variable selects this test, using the same matching as MCUBOOT_DEBUG_DUMP.
+/// Returns the name to write the trace under.
+fn trace_begin(name: &str) -> Option<String> {
+    if let Ok(request) = env::var("MCUBOOT_TRACE") {
+        if request.split(',').any(|req| {
+            req == "all" || name.contains(req)
+        }) {
+            let count = IMAGE_NUMBER.fetch_add(1, Ordering::SeqCst);
+            c::trace_enable(true);
+            return Some(format!("{}-{:04}", name, count));
+        }
+    }
+    None
+}
+
+/// Write out the traces recorded since `trace_begin`, one per invocation of
+/// the bootloader, to "{name}.mctrace".
+fn trace_end(name: Option<String>) {
+    if let Some(name) = name {
+        let traces = c::take_traces();
+        let full_name = format!("{}.mctrace", name);
+        log::info!("Trace {:?}: {} boots", full_name, traces.len());
+        simflash::trace::write_traces(&full_name, &traces).unwrap();
+        c::trace_enable(false);
+    }
+}